@@ -0,0 +1,163 @@
+#include "native_async.h"
+#include "dart_api_dl.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// How long the forwarding thread waits on the batch before checking for cancel
+#define NATIVE_ASYNC_POLL_MS 100
+
+struct RawBatchAsync {
+    RawBatch* batch;
+    Dart_Port port;
+    int64_t request_id;
+    int cancelled;
+    int refs;    // Forwarding thread + caller
+};
+
+intptr_t native_async_init(void* dart_api_data) {
+    return Dart_InitializeApiDL(dart_api_data);
+}
+
+static void release_handle(RawBatchAsync* handle) {
+    if (__atomic_sub_fetch(&handle->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(handle);
+    }
+}
+
+// Runs when Dart collects the Uint8List (or the message is dropped)
+static void free_result_finalizer(void* isolate_callback_data, void* peer) {
+    (void)isolate_callback_data;
+    raw_batch_free_result((RawBatchResult*)peer);
+}
+
+// Post one result. Takes ownership of the result: it moves to Dart when
+// posted and is freed here otherwise, so the caller must not touch it after.
+static int post_result(RawBatchAsync* handle, RawBatchResult* result) {
+    Dart_CObject request_id, index, status, width, height, payload;
+    request_id.type = Dart_CObject_kInt64;
+    request_id.value.as_int64 = handle->request_id;
+    index.type = Dart_CObject_kInt32;
+    index.value.as_int32 = result->index;
+    status.type = Dart_CObject_kInt32;
+    status.value.as_int32 = result->status;
+
+    if (result->status == 0) {
+        width.type = Dart_CObject_kInt32;
+        width.value.as_int32 = result->width;
+        height.type = Dart_CObject_kInt32;
+        height.value.as_int32 = result->height;
+        payload.type = Dart_CObject_kExternalTypedData;
+        payload.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+        payload.value.as_external_typed_data.length = (intptr_t)result->size;
+        payload.value.as_external_typed_data.data = result->data;
+        payload.value.as_external_typed_data.peer = result;
+        payload.value.as_external_typed_data.callback = free_result_finalizer;
+
+        Dart_CObject* values[] = {&request_id, &index, &status, &width, &height, &payload};
+        Dart_CObject message;
+        message.type = Dart_CObject_kArray;
+        message.value.as_array.length = 6;
+        message.value.as_array.values = values;
+        if (Dart_PostCObject_DL(handle->port, &message)) return 1;
+        // Not posted: the finalizer never runs, the pixels are still ours
+        raw_batch_free_result(result);
+        return 0;
+    }
+
+    payload.type = Dart_CObject_kString;
+    payload.value.as_string = result->error;
+
+    Dart_CObject* values[] = {&request_id, &index, &status, &payload};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 4;
+    message.value.as_array.values = values;
+    int posted = Dart_PostCObject_DL(handle->port, &message);
+    // Strings are copied into the message, so the result is still ours
+    raw_batch_free_result(result);
+    return posted;
+}
+
+static void post_done(RawBatchAsync* handle) {
+    Dart_CObject request_id, index;
+    request_id.type = Dart_CObject_kInt64;
+    request_id.value.as_int64 = handle->request_id;
+    index.type = Dart_CObject_kInt32;
+    index.value.as_int32 = NATIVE_ASYNC_DONE_INDEX;
+
+    Dart_CObject* values[] = {&request_id, &index};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 2;
+    message.value.as_array.values = values;
+    Dart_PostCObject_DL(handle->port, &message);
+}
+
+static void* forward_thread(void* arg) {
+    RawBatchAsync* handle = (RawBatchAsync*)arg;
+
+    while (!__atomic_load_n(&handle->cancelled, __ATOMIC_ACQUIRE)) {
+        RawBatchResult* result = raw_batch_next(handle->batch, NATIVE_ASYNC_POLL_MS);
+        if (!result) {
+            if (raw_batch_is_done(handle->batch)) break;
+            continue;
+        }
+        if (!post_result(handle, result)) {
+            // Port closed: nobody is listening any more
+            break;
+        }
+    }
+
+    // Joins the readers and decoders; only this thread waits on them
+    raw_batch_destroy(handle->batch);
+    handle->batch = NULL;
+
+    post_done(handle);
+    release_handle(handle);
+    return NULL;
+}
+
+RawBatchAsync* raw_batch_start_async(
+    const char** paths,
+    int count,
+    const RawBatchOptions* options,
+    int64_t port,
+    int64_t request_id
+) {
+    RawBatchAsync* handle = (RawBatchAsync*)calloc(1, sizeof(RawBatchAsync));
+    if (!handle) return NULL;
+
+    handle->batch = raw_batch_start(paths, count, options);
+    if (!handle->batch) {
+        free(handle);
+        return NULL;
+    }
+    handle->port = (Dart_Port)port;
+    handle->request_id = request_id;
+    handle->refs = 2;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_t thread;
+    int created = pthread_create(&thread, &attr, forward_thread, handle);
+    pthread_attr_destroy(&attr);
+
+    if (created != 0) {
+        raw_batch_destroy(handle->batch);
+        free(handle);
+        return NULL;
+    }
+    return handle;
+}
+
+void raw_batch_async_cancel(RawBatchAsync* handle) {
+    if (!handle) return;
+    __atomic_store_n(&handle->cancelled, 1, __ATOMIC_RELEASE);
+}
+
+void raw_batch_async_release(RawBatchAsync* handle) {
+    if (!handle) return;
+    release_handle(handle);
+}
@@ -0,0 +1,61 @@
+import 'dart:ffi';
+import 'dart:io';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'native_async_bindings.dart';
+
+/// Loader for libnative_async, which runs native work on its own threads and
+/// posts completions straight to Dart ReceivePorts
+class NativeAsync extends FfiBase {
+  static DynamicLibrary? _library;
+  static NativeAsyncBindings? _bindings;
+  static bool _unavailable = false;
+  static int _nextRequestId = 1;
+  
+  /// Load the library and hook up the dynamically linked Dart API
+  static void initialize() {
+    if (_bindings != null) return;
+    
+    _library = FfiBase.loadLibrary(
+      'native_async',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+    
+    final bindings = NativeAsyncBindings(_library!);
+    if (bindings.nativeAsyncInit(NativeApi.initializeApiDLData) != 0) {
+      throw Exception('Dart API version mismatch in libnative_async');
+    }
+    _bindings = bindings;
+  }
+  
+  /// Whether the library could be loaded; callers fall back to isolates if not
+  static bool get isAvailable {
+    if (_bindings != null) return true;
+    if (_unavailable) return false;
+    try {
+      initialize();
+      return true;
+    } catch (e) {
+      print('Native async completions unavailable: $e');
+      _unavailable = true;
+      return false;
+    }
+  }
+  
+  /// Get the native async bindings instance
+  static NativeAsyncBindings get bindings {
+    if (_bindings == null) {
+      initialize();
+    }
+    return _bindings!;
+  }
+  
+  /// Id echoed back in every message of a request
+  static int nextRequestId() => _nextRequestId++;
+}
@@ -0,0 +1,50 @@
+#ifndef NATIVE_ASYNC_H
+#define NATIVE_ASYNC_H
+
+#include <stdint.h>
+#include "raw_batch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Completion messages posted to a Dart ReceivePort. Every message is a list
+// whose first element is the request id the caller passed in:
+//
+//   [request_id, index, 0, width, height, Uint8List rgb]   decoded file
+//   [request_id, index, status, error]                      failed file
+//   [request_id, -1]                                        batch finished
+//
+// Pixel buffers are sent as external typed data: Dart sees the native
+// buffer directly and a finalizer frees it when the Uint8List is collected.
+#define NATIVE_ASYNC_DONE_INDEX -1
+
+// Handle to a batch decode posting to a port
+typedef struct RawBatchAsync RawBatchAsync;
+
+// Initialize the dynamically linked Dart API with
+// NativeApi.initializeApiDLData. Returns 0 on success.
+intptr_t native_async_init(void* dart_api_data);
+
+// Start decoding paths on native threads. Results are posted to port as
+// they complete. Returns NULL if the batch could not be started.
+RawBatchAsync* raw_batch_start_async(
+    const char** paths,
+    int count,
+    const RawBatchOptions* options,
+    int64_t port,
+    int64_t request_id
+);
+
+// Ask the batch to stop; the done message still follows
+void raw_batch_async_cancel(RawBatchAsync* handle);
+
+// Drop the caller's reference. Call exactly once, after the done message
+// or after cancelling; the handle must not be used afterwards.
+void raw_batch_async_release(RawBatchAsync* handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NATIVE_ASYNC_H
@@ -0,0 +1,49 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+import '../raw/raw_batch_bindings.dart';
+
+/// Opaque native RawBatchAsync handle
+final class NativeRawBatchAsync extends Opaque {}
+
+/// Index used by the final message of a batch, mirrors NATIVE_ASYNC_DONE_INDEX
+const int nativeAsyncDoneIndex = -1;
+
+// Bindings for libnative_async
+class NativeAsyncBindings {
+  final DynamicLibrary _lib;
+  
+  NativeAsyncBindings(this._lib);
+  
+  late final _native_async_init = _lib.lookupFunction<
+      IntPtr Function(Pointer<Void>),
+      int Function(Pointer<Void>)>('native_async_init');
+  
+  late final _raw_batch_start_async = _lib.lookupFunction<
+      Pointer<NativeRawBatchAsync> Function(Pointer<Pointer<Utf8>>, Int32, Pointer<RawBatchOptions>, Int64, Int64),
+      Pointer<NativeRawBatchAsync> Function(Pointer<Pointer<Utf8>>, int, Pointer<RawBatchOptions>, int, int)>('raw_batch_start_async');
+  
+  late final _raw_batch_async_cancel = _lib.lookupFunction<
+      Void Function(Pointer<NativeRawBatchAsync>),
+      void Function(Pointer<NativeRawBatchAsync>)>('raw_batch_async_cancel');
+  
+  late final _raw_batch_async_release = _lib.lookupFunction<
+      Void Function(Pointer<NativeRawBatchAsync>),
+      void Function(Pointer<NativeRawBatchAsync>)>('raw_batch_async_release');
+  
+  int nativeAsyncInit(Pointer<Void> dartApiData) {
+    return _native_async_init(dartApiData);
+  }
+  
+  Pointer<NativeRawBatchAsync> rawBatchStartAsync(Pointer<Pointer<Utf8>> paths, int count,
+      Pointer<RawBatchOptions> options, int port, int requestId) {
+    return _raw_batch_start_async(paths, count, options, port, requestId);
+  }
+  
+  void rawBatchAsyncCancel(Pointer<NativeRawBatchAsync> handle) {
+    _raw_batch_async_cancel(handle);
+  }
+  
+  void rawBatchAsyncRelease(Pointer<NativeRawBatchAsync> handle) {
+    _raw_batch_async_release(handle);
+  }
+}
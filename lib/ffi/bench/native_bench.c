@@ -0,0 +1,241 @@
+// aks_bench: time the native hot paths on a synthetic corpus.
+//
+//   aks_bench [options]
+//
+// Writes Bayer and X-Trans DNGs with libsynthetic_raw, then times full
+// decodes, smart preview generation, culling, hashing and the CPU kernel
+// on them. The corpus is the same on every run, so numbers from two builds
+// compare directly; it is also the training run of the PGO build
+// (scripts/build_native_pgo.sh).
+
+#include "synthetic_raw.h"
+#include "raw_processor.h"
+#include "raw_cull.h"
+#include "raw_hash.h"
+#include "smart_preview.h"
+#include "cpu_kernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: aks_bench [options]\n"
+        "  --megapixels N      size of each frame (default 24)\n"
+        "  --frames N          number of frames, alternately Bayer and X-Trans (default 4)\n"
+        "  --iterations N      CPU kernel passes over each decoded frame (default 3)\n"
+        "  --threads N         worker threads (default: all cores)\n"
+        "  --dir PATH          keep the corpus in PATH instead of a temporary directory\n");
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void report(const char* stage, double ms, int items, double megapixels) {
+    printf("%-10s %10.1f ms %10.1f ms/item %10.1f MP/s\n",
+           stage, ms, items > 0 ? ms / items : 0.0, ms > 0 ? megapixels * 1e3 / ms : 0.0);
+}
+
+// Full decode to 8-bit sRGB, as opening an image in the editor does
+static uint8_t* decode(const char* path, int* width, int* height) {
+    void* processor = raw_processor_init();
+    if (!processor) return NULL;
+
+    uint8_t* pixels = NULL;
+    if (raw_processor_open(processor, path) == 0 && raw_processor_process(processor) == 0) {
+        RawImageData* image = raw_processor_get_rgb(processor);
+        if (image && image->info.colors == 3 && image->info.bits == 8) {
+            pixels = image->data;
+            image->data = NULL;
+            *width = image->info.width;
+            *height = image->info.height;
+        }
+        raw_processor_free_image(image);
+    }
+    if (!pixels) fprintf(stderr, "aks_bench: %s: %s\n", path, raw_processor_get_error());
+    raw_processor_cleanup(processor);
+    return pixels;
+}
+
+// Every stage the kernel has, with a tone curve, so each code path is timed
+static void bench_params(AksAdjustmentParams* params, uint8_t curve[256]) {
+    aks_params_init(params);
+    params->stages = AKS_STAGE_BASIC | AKS_STAGE_TONE_CURVE;
+    params->temperature = 0.15f;
+    params->tint = -0.05f;
+    params->exposure = 0.4f;
+    params->contrast = 0.2f;
+    params->highlights = -0.5f;
+    params->shadows = 0.4f;
+    params->blacks = 0.05f;
+    params->whites = -0.1f;
+    params->saturation = 0.1f;
+    params->vibrance = 0.25f;
+    for (int i = 0; i < 256; i++) {
+        curve[i] = (uint8_t)lround(255.0 * pow(i / 255.0, 0.9));
+    }
+}
+
+int main(int argc, char** argv) {
+    double megapixels = 24;
+    int frames = 4;
+    int iterations = 3;
+    int threads = 0;
+    const char* dir = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage();
+            return 2;
+        }
+        i++;
+
+        if (strcmp(arg, "--megapixels") == 0) {
+            megapixels = atof(value);
+        } else if (strcmp(arg, "--frames") == 0) {
+            frames = atoi(value);
+        } else if (strcmp(arg, "--iterations") == 0) {
+            iterations = atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            threads = atoi(value);
+        } else if (strcmp(arg, "--dir") == 0) {
+            dir = value;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (megapixels <= 0 || frames <= 0 || iterations <= 0) {
+        usage();
+        return 2;
+    }
+
+    // The corpus goes away afterwards unless it was asked for
+    int keep = dir != NULL;
+    char temp_dir[4096];
+    if (!keep) {
+        const char* tmp = getenv("TMPDIR");
+        snprintf(temp_dir, sizeof(temp_dir), "%s/aks_bench.XXXXXX", tmp && *tmp ? tmp : "/tmp");
+        dir = mkdtemp(temp_dir);
+        if (!dir) {
+            perror("aks_bench: mkdtemp");
+            return 1;
+        }
+    }
+
+    SyntheticOptions options;
+    synthetic_default_options(&options);
+    options.width = (int)lround(sqrt(megapixels * 1e6 * 1.5) / 6.0) * 6;
+    options.height = (int)lround(options.width / 1.5 / 6.0) * 6;
+    options.thread_count = threads;
+    double frame_mp = (double)options.width * options.height / 1e6;
+
+    char** paths = calloc(frames, sizeof(char*));
+    char** proxies = calloc(frames, sizeof(char*));
+    if (!paths || !proxies) return 1;
+
+    printf("aks_bench: %d frames of %dx%d in %s\n", frames, options.width, options.height, dir);
+
+    int failed = 0;
+    double start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        paths[i] = malloc(4200);
+        proxies[i] = malloc(4200);
+        snprintf(paths[i], 4200, "%s/frame%d.dng", dir, i);
+        snprintf(proxies[i], 4200, "%s/frame%d.proxy", dir, i);
+        options.pattern = i % 2 ? SYNTH_PATTERN_XTRANS : SYNTH_PATTERN_BAYER;
+        options.seed = (uint32_t)i + 1;
+        if (!synthetic_write_dng(&options, paths[i])) {
+            fprintf(stderr, "aks_bench: could not write %s\n", paths[i]);
+            return 1;
+        }
+    }
+    report("corpus", now_ms() - start, frames, frame_mp * frames);
+
+    uint8_t** decoded = calloc(frames, sizeof(uint8_t*));
+    int* widths = calloc(frames, sizeof(int));
+    int* heights = calloc(frames, sizeof(int));
+    if (!decoded || !widths || !heights) return 1;
+
+    start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        decoded[i] = decode(paths[i], &widths[i], &heights[i]);
+        if (!decoded[i]) failed++;
+    }
+    report("decode", now_ms() - start, frames, frame_mp * frames);
+
+    start = now_ms();
+    for (int i = 0; i < frames; i++) {
+        if (smart_preview_generate(paths[i], proxies[i], 2560, 3) != 0) failed++;
+    }
+    report("preview", now_ms() - start, frames, frame_mp * frames);
+
+    RawCullOptions cull_options;
+    raw_cull_default_options(&cull_options);
+    cull_options.threads = threads;
+    RawCullScore* scores = calloc(frames, sizeof(RawCullScore));
+    start = now_ms();
+    if (!scores || raw_cull_run((const char**)paths, frames, &cull_options, scores) != frames) failed++;
+    report("cull", now_ms() - start, frames, frame_mp * frames);
+    free(scores);
+
+    RawHashOptions hash_options;
+    raw_hash_default_options(&hash_options);
+    hash_options.threads = threads;
+    RawHash* hashes = calloc(frames, sizeof(RawHash));
+    start = now_ms();
+    if (!hashes || raw_hash_run((const char**)paths, frames, &hash_options, hashes) != frames) failed++;
+    report("hash", now_ms() - start, frames, frame_mp * frames);
+    free(hashes);
+
+    AksAdjustmentParams params;
+    uint8_t curve[256];
+    bench_params(&params, curve);
+    int passes = 0;
+    double kernel_mp = 0;
+    start = now_ms();
+    for (int n = 0; n < iterations; n++) {
+        for (int i = 0; i < frames; i++) {
+            if (!decoded[i]) continue;
+            uint8_t* output = NULL;
+            int output_width, output_height;
+            if (!cpu_process_image_params(decoded[i], widths[i], heights[i], &params,
+                                          curve, NULL, NULL, NULL,
+                                          &output, &output_width, &output_height)) {
+                failed++;
+                continue;
+            }
+            cpu_free_buffer(output);
+            passes++;
+            kernel_mp += (double)widths[i] * heights[i] / 1e6;
+        }
+    }
+    report("kernel", now_ms() - start, passes, kernel_mp);
+
+    for (int i = 0; i < frames; i++) {
+        free(decoded[i]);
+        if (!keep) {
+            unlink(paths[i]);
+            unlink(proxies[i]);
+        }
+        free(paths[i]);
+        free(proxies[i]);
+    }
+    free(decoded);
+    free(widths);
+    free(heights);
+    free(paths);
+    free(proxies);
+    if (!keep) rmdir(dir);
+
+    if (failed) fprintf(stderr, "aks_bench: %d steps failed\n", failed);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+import 'dart:ffi';
+
+/// Version of the parameter layout, mirrors AKS_PARAMS_VERSION
+const int adjustmentParamsVersion = 2;
+
+/// Number of HSL bands, mirrors AKS_HSL_BANDS
+const int adjustmentParamsHslBands = 8;
+
+/// Pipeline stages, mirrors AKS_STAGE_* in adjustment_params.h
+abstract class AdjustmentStage {
+  static const int whiteBalance = 1 << 0;
+  static const int exposure = 1 << 1;
+  static const int contrast = 1 << 2;
+  static const int highlightsShadows = 1 << 3;
+  static const int blacksWhites = 1 << 4;
+  static const int saturation = 1 << 5;
+  static const int toneCurve = 1 << 6;
+  static const int hsl = 1 << 7;
+  static const int masks = 1 << 8;
+  static const int lut3d = 1 << 9;
+
+  static const int basic = whiteBalance | exposure | contrast |
+      highlightsShadows | blacksWhites | saturation;
+}
+
+/// Engine capabilities, mirrors AKS_CAP_* in adjustment_params.h
+abstract class EngineCapability {
+  static const int basic = 1 << 0;
+  static const int crop = 1 << 1;
+  static const int toneCurve = 1 << 2;
+  static const int curve16 = 1 << 3;
+  static const int hsl = 1 << 4;
+  static const int masks = 1 << 5;
+  static const int lut3d = 1 << 6;
+}
+
+/// Mirrors AksAdjustmentParams in adjustment_params.h, which is shared by
+/// the native CPU kernel and the Vulkan shader
+final class AdjustmentParams extends Struct {
+  @Uint32()
+  external int version;
+  @Uint32()
+  external int size;
+  @Uint32()
+  external int stages;
+  @Uint32()
+  external int curveBits;
+
+  @Float()
+  external double temperature;
+  @Float()
+  external double tint;
+  @Float()
+  external double exposure;
+  @Float()
+  external double contrast;
+  @Float()
+  external double highlights;
+  @Float()
+  external double shadows;
+  @Float()
+  external double blacks;
+  @Float()
+  external double whites;
+  @Float()
+  external double saturation;
+  @Float()
+  external double vibrance;
+  @Float()
+  external double imageWidth;
+  @Float()
+  external double imageHeight;
+
+  @Float()
+  external double cropLeft;
+  @Float()
+  external double cropTop;
+  @Float()
+  external double cropRight;
+  @Float()
+  external double cropBottom;
+
+  /// Hue shift, saturation, luminance and an unused slot per band
+  @Array(adjustmentParamsHslBands * 4)
+  external Array<Float> hsl;
+
+  @Uint32()
+  external int maskCount;
+
+  /// Id of a registered .cube LUT (CubeLut.id) and how much of it to blend
+  @Uint32()
+  external int lutId;
+  @Float()
+  external double lutOpacity;
+
+  @Uint32()
+  external int reserved;
+
+  /// Neutral parameters of the current version, mirrors aks_params_init
+  void reset() {
+    version = adjustmentParamsVersion;
+    size = sizeOf<AdjustmentParams>();
+    stages = AdjustmentStage.basic;
+    curveBits = 8;
+    temperature = 5500.0;
+    tint = 0.0;
+    exposure = 0.0;
+    contrast = 0.0;
+    highlights = 0.0;
+    shadows = 0.0;
+    blacks = 0.0;
+    whites = 0.0;
+    saturation = 0.0;
+    vibrance = 0.0;
+    imageWidth = 0.0;
+    imageHeight = 0.0;
+    cropLeft = 0.0;
+    cropTop = 0.0;
+    cropRight = 1.0;
+    cropBottom = 1.0;
+    for (int i = 0; i < adjustmentParamsHslBands * 4; i++) {
+      hsl[i] = 0.0;
+    }
+    maskCount = 0;
+    lutId = 0;
+    lutOpacity = 1.0;
+    reserved = 0;
+  }
+}
@@ -0,0 +1,180 @@
+#ifndef ADJUSTMENT_PARAMS_H
+#define ADJUSTMENT_PARAMS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Version of AksAdjustmentParams. Fields are only ever appended, so an engine
+// accepts any version and reads the fields it knows about.
+#define AKS_PARAMS_VERSION 2
+
+// Stages enabled in AksAdjustmentParams.stages
+#define AKS_STAGE_WHITE_BALANCE      (1u << 0)
+#define AKS_STAGE_EXPOSURE           (1u << 1)
+#define AKS_STAGE_CONTRAST           (1u << 2)
+#define AKS_STAGE_HIGHLIGHTS_SHADOWS (1u << 3)
+#define AKS_STAGE_BLACKS_WHITES      (1u << 4)
+#define AKS_STAGE_SATURATION         (1u << 5)
+#define AKS_STAGE_TONE_CURVE         (1u << 6)
+#define AKS_STAGE_HSL                (1u << 7)
+#define AKS_STAGE_MASKS              (1u << 8)
+#define AKS_STAGE_LUT_3D             (1u << 9)
+
+#define AKS_STAGE_BASIC (AKS_STAGE_WHITE_BALANCE | AKS_STAGE_EXPOSURE | AKS_STAGE_CONTRAST | \
+                         AKS_STAGE_HIGHLIGHTS_SHADOWS | AKS_STAGE_BLACKS_WHITES | AKS_STAGE_SATURATION)
+
+// Engine capabilities (vk_get_capabilities, cpu_get_capabilities)
+#define AKS_CAP_BASIC       (1u << 0)   // The AKS_STAGE_BASIC stages
+#define AKS_CAP_CROP        (1u << 1)
+#define AKS_CAP_TONE_CURVE  (1u << 2)   // 8-bit per-channel curve LUTs
+#define AKS_CAP_CURVE_16    (1u << 3)   // 16-bit curve LUTs
+#define AKS_CAP_HSL         (1u << 4)
+#define AKS_CAP_MASKS       (1u << 5)
+#define AKS_CAP_LUT_3D      (1u << 6)   // .cube LUTs from cube_lut.h
+
+#define AKS_HSL_BANDS 8
+
+// Adjustment parameters shared by the CPU kernel and image_process.comp.
+// The layout matches the shader's AdjustmentParams uniform block (std140:
+// 4-byte scalars, then vec4-sized rows), so it is uploaded without repacking.
+typedef struct {
+    uint32_t version;       // AKS_PARAMS_VERSION of the writer
+    uint32_t size;          // sizeof(AksAdjustmentParams) of the writer
+    uint32_t stages;        // AKS_STAGE_* bits
+    uint32_t curve_bits;    // Bits per tone curve LUT entry (8)
+
+    float temperature;
+    float tint;
+    float exposure;
+    float contrast;
+    float highlights;
+    float shadows;
+    float blacks;
+    float whites;
+    float saturation;
+    float vibrance;
+    float image_width;      // Filled in by the engine
+    float image_height;
+
+    float crop_left;        // Normalized 0-1
+    float crop_top;
+    float crop_right;
+    float crop_bottom;
+
+    float hsl[AKS_HSL_BANDS][4];    // Hue shift, saturation, luminance per band; w unused
+
+    uint32_t mask_count;
+    uint32_t lut_id;        // cube_lut_register id of the 3D LUT (version 2)
+    float lut_opacity;      // Blend of the LUT result over its input, 0-1
+    uint32_t reserved;
+} AksAdjustmentParams;
+
+#ifdef __cplusplus
+static_assert(sizeof(AksAdjustmentParams) == 224, "AksAdjustmentParams must match the shader layout");
+#else
+_Static_assert(sizeof(AksAdjustmentParams) == 224, "AksAdjustmentParams must match the shader layout");
+#endif
+
+// Smallest struct any version may pass (the version 1 basic block and crop)
+#define AKS_PARAMS_MIN_SIZE offsetof(AksAdjustmentParams, hsl)
+
+// Neutral parameters of the current version
+static inline void aks_params_init(AksAdjustmentParams* params) {
+    memset(params, 0, sizeof(*params));
+    params->version = AKS_PARAMS_VERSION;
+    params->size = sizeof(AksAdjustmentParams);
+    params->stages = AKS_STAGE_BASIC;
+    params->curve_bits = 8;
+    params->temperature = 5500.0f;
+    params->crop_right = 1.0f;
+    params->crop_bottom = 1.0f;
+    params->lut_opacity = 1.0f;
+}
+
+// Copy caller parameters of any version into the current layout. Fields the
+// caller's version lacks keep their neutral values. Returns 0 if invalid.
+static inline int aks_params_load(AksAdjustmentParams* dst, const AksAdjustmentParams* src) {
+    aks_params_init(dst);
+    if (!src || src->version == 0 || src->size < AKS_PARAMS_MIN_SIZE) return 0;
+    size_t size = src->size < sizeof(*dst) ? src->size : sizeof(*dst);
+    memcpy(dst, src, size);
+    if (src->version < 2) {
+        // The LUT fields were reserved
+        dst->stages &= ~AKS_STAGE_LUT_3D;
+        dst->lut_id = 0;
+        dst->lut_opacity = 1.0f;
+    }
+    dst->version = AKS_PARAMS_VERSION;
+    dst->size = sizeof(AksAdjustmentParams);
+    if (dst->curve_bits == 0) dst->curve_bits = 8;
+    return 1;
+}
+
+// Convert the legacy positional float layout: temperature, tint, exposure,
+// contrast, highlights, shadows, blacks, whites, saturation, vibrance,
+// toneCurveEnabled, imageWidth, imageHeight, padding, crop l/t/r/b
+static inline void aks_params_from_floats(AksAdjustmentParams* params, const float* adjustments, int count) {
+    aks_params_init(params);
+    float basic[10] = {5500.0f, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    for (int i = 0; i < count && i < 10; i++) {
+        basic[i] = adjustments[i];
+    }
+    params->temperature = basic[0];
+    params->tint = basic[1];
+    params->exposure = basic[2];
+    params->contrast = basic[3];
+    params->highlights = basic[4];
+    params->shadows = basic[5];
+    params->blacks = basic[6];
+    params->whites = basic[7];
+    params->saturation = basic[8];
+    params->vibrance = basic[9];
+    if (count > 10 && adjustments[10] != 0.0f) {
+        params->stages |= AKS_STAGE_TONE_CURVE;
+    }
+    if (count >= 18) {
+        params->crop_left = adjustments[14];
+        params->crop_top = adjustments[15];
+        params->crop_right = adjustments[16];
+        params->crop_bottom = adjustments[17];
+    }
+}
+
+// Clamp the crop to the image; an empty crop selects the full image
+static inline void aks_params_clamp_crop(AksAdjustmentParams* params) {
+    if (params->crop_left < 0.0f) params->crop_left = 0.0f;
+    if (params->crop_top < 0.0f) params->crop_top = 0.0f;
+    if (params->crop_right > 1.0f) params->crop_right = 1.0f;
+    if (params->crop_bottom > 1.0f) params->crop_bottom = 1.0f;
+    if (params->crop_left >= params->crop_right || params->crop_top >= params->crop_bottom) {
+        params->crop_left = 0.0f;
+        params->crop_top = 0.0f;
+        params->crop_right = 1.0f;
+        params->crop_bottom = 1.0f;
+    }
+}
+
+// Cropped rectangle in pixels. Rounds each edge first, like the shader.
+static inline void aks_params_crop_rect(const AksAdjustmentParams* params, int width, int height,
+                                        int* x, int* y, int* crop_width, int* crop_height) {
+    int left = (int)roundf(params->crop_left * width);
+    int top = (int)roundf(params->crop_top * height);
+    int right = (int)roundf(params->crop_right * width);
+    int bottom = (int)roundf(params->crop_bottom * height);
+    *x = left;
+    *y = top;
+    *crop_width = right - left;
+    *crop_height = bottom - top;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADJUSTMENT_PARAMS_H
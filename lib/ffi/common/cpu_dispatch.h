@@ -0,0 +1,25 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// Function multiversioning for the hot loops of the native libraries. The
+// libraries are built for baseline x86-64 so they run anywhere; marked
+// functions get an x86-64-v3 (AVX2, FMA, BMI2) version as well, and the
+// dynamic loader picks one when the library is loaded.
+//
+// Only integer loops are marked, where the wider registers pay off and both
+// versions give the same result. Floating-point code would have its
+// multiply-adds fused into FMA in the x86-64-v3 version and round
+// differently from the baseline one.
+//
+// Define AKS_NO_MULTIVERSION for single versions, e.g. under sanitizers. A
+// build with -march=x86-64-v3 or newer needs no second version either.
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(__AVX2__) && \
+    !defined(AKS_NO_MULTIVERSION) && \
+    (defined(__clang__) ? __clang_major__ >= 14 : defined(__GNUC__) && __GNUC__ >= 11)
+#define AKS_MULTIVERSION __attribute__((target_clones("arch=x86-64-v3", "default")))
+#else
+#define AKS_MULTIVERSION
+#endif
+
+#endif // CPU_DISPATCH_H
@@ -0,0 +1,134 @@
+#include "job_scheduler.h"
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+static pthread_once_t scheduler_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t scheduler_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scheduler_changed = PTHREAD_COND_INITIALIZER;
+static JobSchedulerStats state;
+
+static int default_limit(int job_class) {
+    int capacity = state.capacity;
+    switch (job_class) {
+        case JOB_CLASS_INTERACTIVE: return capacity;
+        case JOB_CLASS_PREFETCH: return capacity > 1 ? capacity / 2 : 1;
+        default: return capacity > 1 ? capacity - 1 : 1;
+    }
+}
+
+static void scheduler_init(void) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    state.capacity = cores > 0 ? (int32_t)cores : 1;
+    for (int c = 0; c < JOB_CLASS_COUNT; c++) {
+        state.limit[c] = default_limit(c);
+    }
+}
+
+static int clamp_class(int job_class) {
+    if (job_class < 0) return JOB_CLASS_BATCH;
+    if (job_class >= JOB_CLASS_COUNT) return JOB_CLASS_INTERACTIVE;
+    return job_class;
+}
+
+static int total_running(void) {
+    int total = 0;
+    for (int c = 0; c < JOB_CLASS_COUNT; c++) total += state.running[c];
+    return total;
+}
+
+static int higher_waiting(int job_class) {
+    for (int c = job_class + 1; c < JOB_CLASS_COUNT; c++) {
+        if (state.waiting[c] > 0) return 1;
+    }
+    return 0;
+}
+
+// Called with the lock held
+static int can_start(int job_class) {
+    if (state.running[job_class] >= state.limit[job_class]) return 0;
+    if (job_class == JOB_CLASS_INTERACTIVE) return 1;
+    return !higher_waiting(job_class) && total_running() < state.capacity;
+}
+
+// Called with the lock held, by a worker that holds a slot of job_class
+static int should_step_aside(int job_class) {
+    if (job_class == JOB_CLASS_INTERACTIVE) {
+        return state.running[job_class] > state.limit[job_class];
+    }
+    int total = total_running();
+    return total > state.capacity ||
+           state.running[job_class] > state.limit[job_class] ||
+           (total >= state.capacity && higher_waiting(job_class));
+}
+
+static void wait_for_slot(int job_class) {
+    state.waiting[job_class]++;
+    while (!can_start(job_class)) {
+        pthread_cond_wait(&scheduler_changed, &scheduler_lock);
+    }
+    state.waiting[job_class]--;
+    state.running[job_class]++;
+}
+
+void job_begin(int job_class) {
+    pthread_once(&scheduler_once, scheduler_init);
+    job_class = clamp_class(job_class);
+
+    pthread_mutex_lock(&scheduler_lock);
+    wait_for_slot(job_class);
+    pthread_mutex_unlock(&scheduler_lock);
+}
+
+void job_end(int job_class) {
+    pthread_once(&scheduler_once, scheduler_init);
+    job_class = clamp_class(job_class);
+
+    pthread_mutex_lock(&scheduler_lock);
+    if (state.running[job_class] > 0) state.running[job_class]--;
+    pthread_cond_broadcast(&scheduler_changed);
+    pthread_mutex_unlock(&scheduler_lock);
+}
+
+int job_yield(int job_class) {
+    pthread_once(&scheduler_once, scheduler_init);
+    job_class = clamp_class(job_class);
+
+    pthread_mutex_lock(&scheduler_lock);
+    int stepped_aside = should_step_aside(job_class);
+    if (stepped_aside) {
+        state.running[job_class]--;
+        state.preemptions[job_class]++;
+        pthread_cond_broadcast(&scheduler_changed);
+        wait_for_slot(job_class);
+    }
+    pthread_mutex_unlock(&scheduler_lock);
+    return stepped_aside;
+}
+
+int job_scheduler_limit(int job_class) {
+    pthread_once(&scheduler_once, scheduler_init);
+    pthread_mutex_lock(&scheduler_lock);
+    int limit = state.limit[clamp_class(job_class)];
+    pthread_mutex_unlock(&scheduler_lock);
+    return limit;
+}
+
+void job_scheduler_set_limit(int job_class, int limit) {
+    pthread_once(&scheduler_once, scheduler_init);
+    job_class = clamp_class(job_class);
+
+    pthread_mutex_lock(&scheduler_lock);
+    state.limit[job_class] = limit > 0 ? limit : default_limit(job_class);
+    // Raised limits let waiters in; lowered ones apply at the next yield
+    pthread_cond_broadcast(&scheduler_changed);
+    pthread_mutex_unlock(&scheduler_lock);
+}
+
+void job_scheduler_get_stats(JobSchedulerStats* stats) {
+    if (!stats) return;
+    pthread_once(&scheduler_once, scheduler_init);
+    pthread_mutex_lock(&scheduler_lock);
+    memcpy(stats, &state, sizeof(*stats));
+    pthread_mutex_unlock(&scheduler_lock);
+}
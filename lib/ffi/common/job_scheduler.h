@@ -0,0 +1,54 @@
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide arbiter for the CPU work of the native libraries (RAW
+// decoding, the CPU kernel, GPU host work, encoders). Work is done in units
+// such as a tile or a file; a worker takes a slot of its class before a
+// unit and hands it back after. There is one slot per core.
+//
+// Higher classes go first. Interactive work never waits for lower classes:
+// it may briefly run above capacity, and lower classes step aside at their
+// next preemption point (job_yield) until it is done. Each class is also
+// capped by its own concurrency limit.
+
+#define JOB_CLASS_BATCH 0           // Background export and batch decoding
+#define JOB_CLASS_PREFETCH 1        // Prefetch of visible images, thumbnails
+#define JOB_CLASS_INTERACTIVE 2     // Preview rendering and opening images
+#define JOB_CLASS_COUNT 3
+
+typedef struct {
+    int32_t capacity;                       // Slots (cores)
+    int32_t limit[JOB_CLASS_COUNT];
+    int32_t running[JOB_CLASS_COUNT];
+    int32_t waiting[JOB_CLASS_COUNT];
+    int64_t preemptions[JOB_CLASS_COUNT];   // Times a worker stepped aside
+} JobSchedulerStats;
+
+// Take a slot for one unit of work, waiting for it if needed
+void job_begin(int job_class);
+
+// Hand the slot back
+void job_end(int job_class);
+
+// Preemption point between units. If higher classes need the cores, gives
+// up the slot and waits to get one back. Returns 1 if it waited.
+int job_yield(int job_class);
+
+// Concurrency limit of a class; limit <= 0 restores the default (every
+// core for interactive, half for prefetch, all but one for batch)
+int job_scheduler_limit(int job_class);
+void job_scheduler_set_limit(int job_class, int limit);
+
+void job_scheduler_get_stats(JobSchedulerStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JOB_SCHEDULER_H
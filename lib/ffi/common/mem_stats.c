@@ -0,0 +1,127 @@
+#include "mem_stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// Objects tracked through mem_stats_set_owner; LibRaw handles and the like,
+// a few per worker thread at most
+#define OWNER_SLOTS 256
+
+typedef struct {
+    const void* owner;
+    int32_t component;
+    int64_t bytes;
+} OwnerEntry;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static MemStats state;
+static OwnerEntry owners[OWNER_SLOTS];
+static MemHeapQuery heap_query = NULL;
+
+static int valid_component(int component) {
+    return component >= 0 && component < MEM_COMPONENT_COUNT;
+}
+
+// Called with the lock held
+static void apply(int component, int64_t bytes) {
+    state.current[component] += bytes;
+    if (state.current[component] < 0) state.current[component] = 0;
+    if (state.current[component] > state.peak[component]) {
+        state.peak[component] = state.current[component];
+    }
+    if (bytes > 0) state.allocations[component]++;
+
+    state.total_current += bytes;
+    if (state.total_current < 0) state.total_current = 0;
+    if (state.total_current > state.total_peak) state.total_peak = state.total_current;
+}
+
+void mem_stats_add(int component, int64_t bytes) {
+    if (!valid_component(component) || bytes == 0) return;
+    pthread_mutex_lock(&stats_lock);
+    apply(component, bytes);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static size_t owner_hash(const void* owner) {
+    uintptr_t value = (uintptr_t)owner;
+    value ^= value >> 17;
+    value *= 0x9E3779B1u;
+    return (size_t)(value % OWNER_SLOTS);
+}
+
+void mem_stats_set_owner(int component, const void* owner, int64_t bytes) {
+    if (!valid_component(component) || !owner) return;
+    if (bytes < 0) bytes = 0;
+
+    pthread_mutex_lock(&stats_lock);
+
+    // Linear probing; deleted entries are left as tombstones with no owner
+    // and bytes -1 so probing continues past them
+    OwnerEntry* entry = NULL;
+    OwnerEntry* free_entry = NULL;
+    size_t start = owner_hash(owner);
+    for (size_t i = 0; i < OWNER_SLOTS; i++) {
+        OwnerEntry* candidate = &owners[(start + i) % OWNER_SLOTS];
+        if (candidate->owner == owner && candidate->component == component) {
+            entry = candidate;
+            break;
+        }
+        if (!candidate->owner) {
+            if (!free_entry) free_entry = candidate;
+            if (candidate->bytes == 0) break;   // Never used: the owner isn't further on
+        }
+    }
+
+    if (entry) {
+        apply(component, bytes - entry->bytes);
+        if (bytes > 0) {
+            entry->bytes = bytes;
+        } else {
+            entry->owner = NULL;
+            entry->bytes = -1;
+        }
+    } else if (bytes > 0) {
+        if (free_entry) {
+            free_entry->owner = owner;
+            free_entry->component = component;
+            free_entry->bytes = bytes;
+            apply(component, bytes);
+        } else {
+            static int warned = 0;
+            if (!warned) fprintf(stderr, "mem_stats: too many tracked objects\n");
+            warned = 1;
+        }
+    }
+
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void mem_stats_set_heap_query(MemHeapQuery query) {
+    pthread_mutex_lock(&heap_lock);
+    heap_query = query;
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void mem_stats_get(MemStats* stats) {
+    if (!stats) return;
+
+    pthread_mutex_lock(&stats_lock);
+    memcpy(stats, &state, sizeof(*stats));
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_mutex_lock(&heap_lock);
+    if (heap_query) heap_query(stats);
+    pthread_mutex_unlock(&heap_lock);
+    if (stats->heap_count > MEM_MAX_HEAPS) stats->heap_count = MEM_MAX_HEAPS;
+}
+
+void mem_stats_reset_peaks(void) {
+    pthread_mutex_lock(&stats_lock);
+    for (int c = 0; c < MEM_COMPONENT_COUNT; c++) {
+        state.peak[c] = state.current[c];
+    }
+    state.total_peak = state.total_current;
+    pthread_mutex_unlock(&stats_lock);
+}
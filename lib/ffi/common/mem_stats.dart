@@ -0,0 +1,142 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'package:ffi/ffi.dart';
+import 'ffi_base.dart';
+import 'mem_stats_bindings.dart';
+import 'platform_utils.dart';
+
+/// One Vulkan memory heap as seen by the driver
+class MemoryHeap {
+  final bool deviceLocal;
+  final int size;
+  final int budget;   // 0 without VK_EXT_memory_budget
+  final int usage;
+
+  const MemoryHeap({
+    required this.deviceLocal,
+    required this.size,
+    required this.budget,
+    required this.usage,
+  });
+}
+
+/// Snapshot of the native memory counters, in bytes
+class MemorySnapshot {
+  final List<int> current;
+  final List<int> peak;
+  final List<int> allocations;
+  final int totalCurrent;
+  final int totalPeak;
+  final List<MemoryHeap> heaps;
+
+  const MemorySnapshot({
+    required this.current,
+    required this.peak,
+    required this.allocations,
+    required this.totalCurrent,
+    required this.totalPeak,
+    required this.heaps,
+  });
+
+  /// Bytes held in GPU memory by the Vulkan processor
+  int get gpuCurrent =>
+      current[MemComponent.vkInput] +
+      current[MemComponent.vkOutput] +
+      current[MemComponent.vkStaging] +
+      current[MemComponent.vkLut] +
+      current[MemComponent.vkTransient];
+
+  /// Process-wide device local usage reported by the driver, if known
+  int? get deviceUsage {
+    final local = heaps.where((h) => h.deviceLocal && h.budget > 0);
+    if (local.isEmpty) return null;
+    return local.fold<int>(0, (sum, h) => sum + h.usage);
+  }
+
+  int? get deviceBudget {
+    final local = heaps.where((h) => h.deviceLocal && h.budget > 0);
+    if (local.isEmpty) return null;
+    return local.fold<int>(0, (sum, h) => sum + h.budget);
+  }
+}
+
+/// Polls the memory accounting shared by the native libraries
+class MemoryTelemetry {
+  static MemStatsBindings? _bindings;
+  static bool _unavailable = false;
+
+  static MemStatsBindings? _load() {
+    if (_bindings != null || _unavailable) return _bindings;
+    try {
+      final library = FfiBase.loadLibrary(
+        'mem_stats',
+        linuxPaths: [
+          ...PlatformUtils.commonLibraryPaths,
+          '${Directory.current.path}/linux',
+          '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+        ],
+        macosPaths: PlatformUtils.commonLibraryPaths,
+        windowsPaths: PlatformUtils.commonLibraryPaths,
+      );
+      _bindings = MemStatsBindings(library);
+    } catch (e) {
+      print('Memory telemetry unavailable: $e');
+      _unavailable = true;
+    }
+    return _bindings;
+  }
+
+  static bool get isAvailable => _load() != null;
+
+  /// Current counters, null when the library can't be loaded
+  static MemorySnapshot? poll() {
+    final bindings = _load();
+    if (bindings == null) return null;
+
+    final stats = calloc<NativeMemStats>();
+    try {
+      bindings.memStatsGet(stats);
+      final s = stats.ref;
+
+      List<int> read(Array<Int64> values) =>
+          List<int>.generate(MemComponent.count, (i) => values[i]);
+
+      final heapCount = s.heapCount.clamp(0, memMaxHeaps);
+      return MemorySnapshot(
+        current: read(s.current),
+        peak: read(s.peak),
+        allocations: read(s.allocations),
+        totalCurrent: s.totalCurrent,
+        totalPeak: s.totalPeak,
+        heaps: List<MemoryHeap>.generate(heapCount, (i) => MemoryHeap(
+          deviceLocal: s.heapDeviceLocal[i] != 0,
+          size: s.heapSize[i],
+          budget: s.heapBudget[i],
+          usage: s.heapUsage[i],
+        )),
+      );
+    } finally {
+      calloc.free(stats);
+    }
+  }
+
+  /// Start new high-water marks from the current values
+  static void resetPeaks() {
+    _load()?.memStatsResetPeaks();
+  }
+
+  /// Human readable size, e.g. 512 KB, 1.4 GB
+  static String formatBytes(int bytes) {
+    if (bytes < 1024) return '$bytes B';
+    const units = ['KB', 'MB', 'GB'];
+    double value = bytes / 1024;
+    int unit = 0;
+    while (value >= 1024 && unit < units.length - 1) {
+      value /= 1024;
+      unit++;
+    }
+    return value >= 100 || unit == 0
+        ? '${value.round()} ${units[unit]}'
+        : '${value.toStringAsFixed(1)} ${units[unit]}';
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef MEM_STATS_H
+#define MEM_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Process-wide memory accounting for the native libraries, polled by the
+// app to see where memory goes for a given image. Counters are updated at
+// allocation sites; GPU heap usage comes from the Vulkan processor when it
+// is running.
+
+#define MEM_LIBRAW 0            // LibRaw handles with their raw and processed data
+#define MEM_DECODED 1           // Decoded frames handed to Dart
+#define MEM_VK_INPUT 2          // Source pixels on the GPU, resident images included
+#define MEM_VK_OUTPUT 3         // Processed pixels on the GPU
+#define MEM_VK_STAGING 4        // Host visible upload and readback buffers
+#define MEM_VK_LUT 5            // Curve and 3D LUTs, parameters and quantization tables
+#define MEM_VK_TRANSIENT 6      // Render graph intermediates
+#define MEM_ENCODER 7           // JPEG coefficients and encoded files
+#define MEM_COMPONENT_COUNT 8
+
+#define MEM_MAX_HEAPS 16
+
+typedef struct {
+    int64_t current[MEM_COMPONENT_COUNT];       // Bytes
+    int64_t peak[MEM_COMPONENT_COUNT];          // High-water marks since the last reset
+    int64_t allocations[MEM_COMPONENT_COUNT];   // Allocations made, for churn
+    int64_t total_current;
+    int64_t total_peak;
+
+    // Vulkan memory heaps. Budget and usage are the driver's view of the
+    // whole process (VK_EXT_memory_budget), 0 when it isn't supported.
+    int32_t heap_count;                         // 0 without a Vulkan device
+    int32_t heap_device_local[MEM_MAX_HEAPS];
+    int64_t heap_size[MEM_MAX_HEAPS];
+    int64_t heap_budget[MEM_MAX_HEAPS];
+    int64_t heap_usage[MEM_MAX_HEAPS];
+} MemStats;
+
+// Account an allocation (bytes > 0) or a release (bytes < 0)
+void mem_stats_add(int component, int64_t bytes);
+
+// For objects whose footprint changes over their life: attribute bytes to
+// owner, replacing what was attributed before. 0 forgets the owner.
+void mem_stats_set_owner(int component, const void* owner, int64_t bytes);
+
+// Fills heap_count and the heap arrays of stats
+typedef void (*MemHeapQuery)(MemStats* stats);
+
+// Registered by the Vulkan processor while its device exists; NULL clears.
+// Returns once no query is running, so the device can go away afterwards.
+void mem_stats_set_heap_query(MemHeapQuery query);
+
+void mem_stats_get(MemStats* stats);
+
+// Start new high-water marks from the current values
+void mem_stats_reset_peaks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEM_STATS_H
@@ -0,0 +1,74 @@
+import 'dart:ffi';
+
+/// Accounting components, mirrors MEM_* in mem_stats.h
+abstract class MemComponent {
+  static const int libraw = 0;
+  static const int decoded = 1;
+  static const int vkInput = 2;
+  static const int vkOutput = 3;
+  static const int vkStaging = 4;
+  static const int vkLut = 5;
+  static const int vkTransient = 6;
+  static const int encoder = 7;
+  static const int count = 8;
+
+  static const List<String> names = [
+    'LibRaw',
+    'Decoded images',
+    'GPU input',
+    'GPU output',
+    'GPU staging',
+    'GPU LUTs',
+    'GPU intermediates',
+    'Encoders',
+  ];
+}
+
+const int memMaxHeaps = 16;
+
+/// Mirrors MemStats in mem_stats.h
+final class NativeMemStats extends Struct {
+  @Array(MemComponent.count)
+  external Array<Int64> current;
+  @Array(MemComponent.count)
+  external Array<Int64> peak;
+  @Array(MemComponent.count)
+  external Array<Int64> allocations;
+  @Int64()
+  external int totalCurrent;
+  @Int64()
+  external int totalPeak;
+  @Int32()
+  external int heapCount;
+  @Array(memMaxHeaps)
+  external Array<Int32> heapDeviceLocal;
+  @Array(memMaxHeaps)
+  external Array<Int64> heapSize;
+  @Array(memMaxHeaps)
+  external Array<Int64> heapBudget;
+  @Array(memMaxHeaps)
+  external Array<Int64> heapUsage;
+}
+
+// Bindings for libmem_stats
+class MemStatsBindings {
+  final DynamicLibrary _lib;
+
+  MemStatsBindings(this._lib);
+
+  late final _mem_stats_get = _lib.lookupFunction<
+      Void Function(Pointer<NativeMemStats>),
+      void Function(Pointer<NativeMemStats>)>('mem_stats_get');
+
+  late final _mem_stats_reset_peaks = _lib.lookupFunction<
+      Void Function(),
+      void Function()>('mem_stats_reset_peaks');
+
+  void memStatsGet(Pointer<NativeMemStats> stats) {
+    _mem_stats_get(stats);
+  }
+
+  void memStatsResetPeaks() {
+    _mem_stats_reset_peaks();
+  }
+}
@@ -0,0 +1,747 @@
+#include "synthetic_raw.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Scene values are relative to a fixed 14-bit range so the content and the
+// noise don't depend on the bit depth asked for
+#define REFERENCE_RANGE 16383.0f
+#define READ_NOISE 4.0f             // DN at base ISO
+#define SHOT_GAIN 0.5f              // DN per electron
+#define NOISE_SCENE_BOOST 16.0f
+
+#define DNG_ROWS_PER_STRIP 64
+
+// ColorChecker Classic patches, sRGB
+static const uint8_t checker_srgb[24][3] = {
+    {115, 82, 68}, {194, 150, 130}, {98, 122, 157}, {87, 108, 67}, {133, 128, 177}, {103, 189, 170},
+    {214, 126, 44}, {80, 91, 166}, {193, 90, 99}, {94, 60, 108}, {157, 188, 64}, {224, 163, 46},
+    {56, 61, 150}, {70, 148, 73}, {175, 54, 60}, {231, 199, 31}, {187, 86, 149}, {8, 133, 161},
+    {243, 243, 242}, {200, 200, 200}, {160, 160, 160}, {122, 122, 121}, {85, 85, 85}, {52, 52, 52}
+};
+
+static const uint8_t xtrans_pattern[6][6] = {
+    {1, 1, 0, 1, 1, 2},
+    {1, 1, 2, 1, 1, 0},
+    {2, 0, 1, 0, 2, 1},
+    {1, 1, 2, 1, 1, 0},
+    {1, 1, 0, 1, 1, 2},
+    {0, 2, 1, 2, 0, 1}
+};
+
+// Specular highlights of the highlight scene: centre and radius, normalized
+static const float speculars[4][3] = {
+    {0.15f, 0.72f, 0.030f},
+    {0.32f, 0.85f, 0.015f},
+    {0.70f, 0.30f, 0.050f},
+    {0.88f, 0.10f, 0.008f}
+};
+
+static float checker_linear[24][3];
+static uint8_t linear_to_srgb[65536];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static float srgb_decode(float c) {
+    return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static void init_tables(void) {
+    for (int i = 0; i < 24; i++) {
+        for (int c = 0; c < 3; c++) {
+            checker_linear[i][c] = srgb_decode(checker_srgb[i][c] / 255.0f);
+        }
+    }
+    for (int i = 0; i < 65536; i++) {
+        float l = i / 65535.0f;
+        float s = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        linear_to_srgb[i] = (uint8_t)lrintf(s * 255.0f);
+    }
+}
+
+typedef struct {
+    const SyntheticOptions* options;
+    float gain;                 // 2^exposure
+    float noise;                // Effective noise scale for the scene
+    float zone_x, zone_y;       // Zone plate centre, pixels
+    float zone_radius;
+    int black;
+    int white;
+} Scene;
+
+static void scene_init(Scene* scene, const SyntheticOptions* options) {
+    pthread_once(&tables_once, init_tables);
+    scene->options = options;
+    scene->gain = exp2f(options->exposure + (options->scene == SYNTH_SCENE_HIGHLIGHTS ? 3.0f : 0.0f));
+    scene->noise = options->noise * (options->scene == SYNTH_SCENE_NOISE ? NOISE_SCENE_BOOST : 1.0f);
+
+    // Zone plate in the lower right quarter, reaching Nyquist at its edge
+    float region_w = options->width * 0.5f;
+    float region_h = options->height * 0.4f;
+    scene->zone_x = options->width * 0.75f;
+    scene->zone_y = options->height * 0.8f;
+    scene->zone_radius = 0.5f * (region_w < region_h ? region_w : region_h);
+
+    scene->white = (1 << options->bits) - 1;
+    scene->black = 1 << (options->bits - 5);
+}
+
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Standard normal sample for one (x, y, channel) of the image
+static float gaussian(uint32_t seed, int x, int y, int channel) {
+    uint64_t h = mix64(((uint64_t)seed << 32) ^ ((uint64_t)(uint32_t)y << 2) ^ (uint64_t)channel);
+    h = mix64(h ^ ((uint64_t)(uint32_t)x * 0x9E3779B97F4A7C15ull));
+    float u1 = ((h >> 40) + 1.0f) / 16777217.0f;           // (0, 1]
+    float u2 = (float)((h >> 16) & 0xFFFFFF) / 16777216.0f;
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+// Sensor noise on a value relative to REFERENCE_RANGE
+static inline float add_noise(const Scene* scene, float value, int x, int y, int channel) {
+    if (scene->noise <= 0.0f) return value;
+    float dn = (value > 0.0f ? value : 0.0f) * REFERENCE_RANGE;
+    float sigma = scene->noise * sqrtf(READ_NOISE * READ_NOISE + SHOT_GAIN * dn);
+    return value + gaussian(scene->options->seed, x, y, channel) * sigma / REFERENCE_RANGE;
+}
+
+// Noiseless linear scene radiance at a pixel; can exceed 1
+static void scene_sample(const Scene* scene, int x, int y, float rgb[3]) {
+    const SyntheticOptions* options = scene->options;
+    float u = (x + 0.5f) / options->width;
+    float v = (y + 0.5f) / options->height;
+
+    if (options->scene == SYNTH_SCENE_NOISE) {
+        rgb[0] = rgb[1] = rgb[2] = 0.18f * scene->gain;
+        return;
+    }
+
+    float value[3] = {0.05f, 0.05f, 0.05f};     // Dark surround
+    if (v < 0.6f) {
+        // 6x4 patches with gaps between them
+        float pu = (u - 0.05f) / 0.9f * 6.0f;
+        float pv = (v - 0.05f) / 0.5f * 4.0f;
+        int col = (int)floorf(pu);
+        int row = (int)floorf(pv);
+        if (col >= 0 && col < 6 && row >= 0 && row < 4 &&
+            pu - col > 0.08f && pu - col < 0.92f && pv - row > 0.08f && pv - row < 0.92f) {
+            memcpy(value, checker_linear[row * 6 + col], sizeof(value));
+        }
+    } else if (u < 0.5f) {
+        // 12 stop ramp, smooth above and in third stop steps below
+        float t = u / 0.5f;
+        float stops = v < 0.8f ? t * 12.0f : floorf(t * 36.0f) / 3.0f;
+        value[0] = value[1] = value[2] = exp2f(stops - 12.0f);
+    } else {
+        float dx = x + 0.5f - scene->zone_x;
+        float dy = y + 0.5f - scene->zone_y;
+        float r2 = dx * dx + dy * dy;
+        if (r2 < scene->zone_radius * scene->zone_radius) {
+            float phase = 3.14159265f * r2 / (2.0f * scene->zone_radius);
+            value[0] = value[1] = value[2] = 0.18f * (1.0f + 0.9f * cosf(phase));
+        }
+    }
+
+    if (options->scene == SYNTH_SCENE_HIGHLIGHTS) {
+        for (int i = 0; i < 4; i++) {
+            float sx = (u - speculars[i][0]) * options->width;
+            float sy = (v - speculars[i][1]) * options->height;
+            float radius = speculars[i][2] * options->height;
+            if (sx * sx + sy * sy < radius * radius) {
+                value[0] = value[1] = value[2] = 4.0f;  // Clips at any exposure
+            }
+        }
+    }
+
+    for (int c = 0; c < 3; c++) rgb[c] = value[c] * scene->gain;
+}
+
+static inline int cfa_color(int pattern, int x, int y) {
+    if (pattern == SYNTH_PATTERN_XTRANS) return xtrans_pattern[y % 6][x % 6];
+    return (y & 1) + (x & 1);      // RGGB: R=0, G=1, B=2
+}
+
+static inline uint16_t to_sensor(const Scene* scene, float value) {
+    float dn = scene->black + value * (scene->white - scene->black);
+    if (dn < 0.0f) dn = 0.0f;
+    if (dn > scene->white) dn = (float)scene->white;
+    return (uint16_t)lrintf(dn);
+}
+
+static inline uint16_t to_linear16(float value) {
+    if (value <= 0.0f) return 0;
+    if (value >= 1.0f) return 65535;
+    return (uint16_t)lrintf(value * 65535.0f);
+}
+
+typedef enum {
+    OUTPUT_CFA,
+    OUTPUT_LINEAR,
+    OUTPUT_SRGB8
+} OutputKind;
+
+typedef struct {
+    Scene scene;
+    OutputKind kind;
+    void* out;
+    size_t stride;              // Elements per row
+    int channels;
+    int first_row;
+    int next_row;
+    int row_count;
+    pthread_mutex_t mutex;
+} RenderJob;
+
+static void render_row(RenderJob* job, int y) {
+    const Scene* scene = &job->scene;
+    const SyntheticOptions* options = scene->options;
+    float rgb[3];
+
+    if (job->kind == OUTPUT_CFA) {
+        uint16_t* out = (uint16_t*)job->out + (size_t)(y - job->first_row) * job->stride;
+        for (int x = 0; x < options->width; x++) {
+            int c = cfa_color(options->pattern, x, y);
+            scene_sample(scene, x, y, rgb);
+            out[x] = to_sensor(scene, add_noise(scene, rgb[c], x, y, 0));
+        }
+        return;
+    }
+
+    for (int x = 0; x < options->width; x++) {
+        scene_sample(scene, x, y, rgb);
+        size_t i = (size_t)y * job->stride + (size_t)x * job->channels;
+        for (int c = 0; c < 3; c++) {
+            uint16_t value = to_linear16(add_noise(scene, rgb[c], x, y, c));
+            if (job->kind == OUTPUT_LINEAR) {
+                ((uint16_t*)job->out)[i + c] = value;
+            } else {
+                ((uint8_t*)job->out)[i + c] = linear_to_srgb[value];
+            }
+        }
+        if (job->channels == 4) {
+            if (job->kind == OUTPUT_LINEAR) ((uint16_t*)job->out)[i + 3] = 65535;
+            else ((uint8_t*)job->out)[i + 3] = 255;
+        }
+    }
+}
+
+static void* render_worker(void* arg) {
+    RenderJob* job = (RenderJob*)arg;
+    while (1) {
+        pthread_mutex_lock(&job->mutex);
+        int row = job->next_row++;
+        pthread_mutex_unlock(&job->mutex);
+        if (row >= job->row_count) break;
+        render_row(job, job->first_row + row);
+    }
+    return NULL;
+}
+
+// Render rows [first_row, first_row + row_count)
+static void render_rows(RenderJob* job, int first_row, int row_count) {
+    job->first_row = first_row;
+    job->next_row = 0;
+    job->row_count = row_count;
+    pthread_mutex_init(&job->mutex, NULL);
+
+    int thread_count = job->scene.options->thread_count;
+    if (thread_count <= 0) thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count > row_count) thread_count = row_count;
+    if (thread_count < 1) thread_count = 1;
+
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, render_worker, job) != 0) break;
+            started++;
+        }
+    }
+    render_worker(job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&job->mutex);
+}
+
+static int validate(const SyntheticOptions* options) {
+    if (!options || options->width <= 0 || options->height <= 0) return 0;
+    if (options->bits < 10 || options->bits > 16) {
+        fprintf(stderr, "synthetic_raw: unsupported bit depth %d\n", options->bits);
+        return 0;
+    }
+    if (options->pattern != SYNTH_PATTERN_BAYER && options->pattern != SYNTH_PATTERN_XTRANS) {
+        fprintf(stderr, "synthetic_raw: unknown CFA pattern %d\n", options->pattern);
+        return 0;
+    }
+    return 1;
+}
+
+void synthetic_default_options(SyntheticOptions* options) {
+    if (!options) return;
+    options->width = 6000;
+    options->height = 4000;
+    options->pattern = SYNTH_PATTERN_BAYER;
+    options->scene = SYNTH_SCENE_CHART;
+    options->seed = 1;
+    options->noise = 1.0f;
+    options->exposure = 0.0f;
+    options->bits = 14;
+    options->thread_count = 0;
+}
+
+int synthetic_render_cfa(const SyntheticOptions* options, uint16_t* out, size_t stride) {
+    if (!validate(options) || !out) return 0;
+    RenderJob job = {
+        .kind = OUTPUT_CFA,
+        .out = out,
+        .stride = stride ? stride : (size_t)options->width
+    };
+    scene_init(&job.scene, options);
+    render_rows(&job, 0, options->height);
+    return 1;
+}
+
+int synthetic_render_linear(const SyntheticOptions* options, uint16_t* out, int channels) {
+    if (!validate(options) || !out || (channels != 3 && channels != 4)) return 0;
+    RenderJob job = {
+        .kind = OUTPUT_LINEAR,
+        .out = out,
+        .stride = (size_t)options->width * channels,
+        .channels = channels
+    };
+    scene_init(&job.scene, options);
+    render_rows(&job, 0, options->height);
+    return 1;
+}
+
+int synthetic_render_srgb8(const SyntheticOptions* options, uint8_t* out, int channels) {
+    if (!validate(options) || !out || (channels != 3 && channels != 4)) return 0;
+    RenderJob job = {
+        .kind = OUTPUT_SRGB8,
+        .out = out,
+        .stride = (size_t)options->width * channels,
+        .channels = channels
+    };
+    scene_init(&job.scene, options);
+    render_rows(&job, 0, options->height);
+    return 1;
+}
+
+// Minimal little-endian TIFF writer for one IFD
+
+#define TIFF_BYTE 1
+#define TIFF_ASCII 2
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+#define TIFF_RATIONAL 5
+#define TIFF_SRATIONAL 10
+
+#define TIFF_MAX_ENTRIES 32
+
+typedef struct {
+    uint16_t tag;
+    uint16_t type;
+    uint32_t count;
+    const void* data;           // Host order values
+    uint32_t offset;            // Of the data when it doesn't fit in the entry
+} TiffEntry;
+
+static size_t tiff_type_size(uint16_t type) {
+    switch (type) {
+        case TIFF_SHORT: return 2;
+        case TIFF_LONG: return 4;
+        case TIFF_RATIONAL:
+        case TIFF_SRATIONAL: return 8;
+        default: return 1;
+    }
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Entry values in file order
+static void tiff_put_values(uint8_t* p, const TiffEntry* entry) {
+    size_t element = entry->type == TIFF_RATIONAL || entry->type == TIFF_SRATIONAL ? 4 : tiff_type_size(entry->type);
+    size_t count = entry->count * (tiff_type_size(entry->type) / element);
+    for (size_t i = 0; i < count; i++) {
+        if (element == 2) put16(p + i * 2, ((const uint16_t*)entry->data)[i]);
+        else if (element == 4) put32(p + i * 4, ((const uint32_t*)entry->data)[i]);
+        else p[i] = ((const uint8_t*)entry->data)[i];
+    }
+}
+
+// Place the out-of-line values after the IFD. Returns the header size, which
+// is where the image data starts.
+static uint32_t tiff_layout(TiffEntry* entries, int entry_count) {
+    uint32_t ifd_size = 2 + 12 * entry_count + 4;
+    uint32_t offset = 8 + ifd_size;
+    for (int i = 0; i < entry_count; i++) {
+        size_t size = tiff_type_size(entries[i].type) * entries[i].count;
+        if (size > 4) {
+            entries[i].offset = offset;
+            offset += (uint32_t)((size + 3) & ~(size_t)3);
+        }
+    }
+    return (offset + 15) & ~15u;
+}
+
+static void tiff_fill_header(uint8_t* header, const TiffEntry* entries, int entry_count) {
+    memcpy(header, "II*\0", 4);
+    put32(header + 4, 8);
+    put16(header + 8, (uint16_t)entry_count);
+    for (int i = 0; i < entry_count; i++) {
+        uint8_t* p = header + 10 + 12 * i;
+        put16(p, entries[i].tag);
+        put16(p + 2, entries[i].type);
+        put32(p + 4, entries[i].count);
+        if (tiff_type_size(entries[i].type) * entries[i].count > 4) {
+            put32(p + 8, entries[i].offset);
+            tiff_put_values(header + entries[i].offset, &entries[i]);
+        } else {
+            tiff_put_values(p + 8, &entries[i]);
+        }
+    }
+    put32(header + 10 + 12 * entry_count, 0);  // No next IFD
+}
+
+// Lossless JPEG (ITU T.81 process 14) tiles as DNG converters write them:
+// each tile row is one JPEG row of two interleaved components, so predictor
+// 1 (the left neighbour) sees a sample of the same colour in Bayer data.
+
+// One Huffman table for every tile, shortest codes for the differences of
+// smooth, mildly noisy data
+static const uint8_t lj_counts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0};
+static const uint8_t lj_values[17] = {6, 4, 5, 7, 8, 3, 9, 2, 10, 1, 11, 0, 12, 13, 14, 15, 16};
+
+typedef struct {
+    uint16_t code[17];
+    uint8_t length[17];
+} LjTable;
+
+typedef struct {
+    uint8_t* out;
+    size_t size;
+    uint64_t bits;
+    int count;
+} LjWriter;
+
+static void lj_build_table(LjTable* table) {
+    int code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < lj_counts[length - 1]; i++, k++) {
+            table->code[lj_values[k]] = (uint16_t)code++;
+            table->length[lj_values[k]] = (uint8_t)length;
+        }
+        code <<= 1;
+    }
+}
+
+static inline void lj_put(LjWriter* writer, uint32_t value, int length) {
+    writer->bits = writer->bits << length | (value & ((1u << length) - 1));
+    writer->count += length;
+    while (writer->count >= 8) {
+        writer->count -= 8;
+        uint8_t byte = (uint8_t)(writer->bits >> writer->count);
+        writer->out[writer->size++] = byte;
+        if (byte == 0xFF) writer->out[writer->size++] = 0x00;
+    }
+}
+
+// Worst case for one tile: a 14 bit code and 15 extra bits per sample,
+// doubled by byte stuffing, plus the headers
+static size_t lj_max_size(int tile_size) {
+    return (size_t)tile_size * tile_size * 8 + 128;
+}
+
+// Encode tile_size rows of tile_size samples (row stride in samples) and
+// return the size of the JPEG written to out
+static size_t lj_encode_tile(const LjTable* table, const uint16_t* samples, size_t stride,
+                             int tile_size, int bits, uint8_t* out) {
+    size_t pos = 0;
+    out[pos++] = 0xFF;
+    out[pos++] = 0xD8;          // SOI
+
+    out[pos++] = 0xFF;
+    out[pos++] = 0xC4;          // DHT
+    out[pos++] = 0;
+    out[pos++] = 2 + 1 + 16 + 17;
+    out[pos++] = 0x00;          // DC class, table 0
+    memcpy(out + pos, lj_counts, 16);
+    pos += 16;
+    memcpy(out + pos, lj_values, 17);
+    pos += 17;
+
+    int wide = tile_size / 2;
+    out[pos++] = 0xFF;
+    out[pos++] = 0xC3;          // SOF3
+    out[pos++] = 0;
+    out[pos++] = 8 + 3 * 2;
+    out[pos++] = (uint8_t)bits;
+    out[pos++] = (uint8_t)(tile_size >> 8);
+    out[pos++] = (uint8_t)tile_size;
+    out[pos++] = (uint8_t)(wide >> 8);
+    out[pos++] = (uint8_t)wide;
+    out[pos++] = 2;
+    for (int c = 0; c < 2; c++) {
+        out[pos++] = (uint8_t)(c + 1);
+        out[pos++] = 0x11;
+        out[pos++] = 0;
+    }
+
+    out[pos++] = 0xFF;
+    out[pos++] = 0xDA;          // SOS
+    out[pos++] = 0;
+    out[pos++] = 6 + 2 * 2;
+    out[pos++] = 2;
+    for (int c = 0; c < 2; c++) {
+        out[pos++] = (uint8_t)(c + 1);
+        out[pos++] = 0x00;
+    }
+    out[pos++] = 1;             // Predictor
+    out[pos++] = 0;
+    out[pos++] = 0;
+
+    LjWriter writer = { .out = out, .size = pos };
+    int first_column[2] = {1 << (bits - 1), 1 << (bits - 1)};
+    for (int y = 0; y < tile_size; y++) {
+        const uint16_t* row = samples + (size_t)y * stride;
+        for (int x = 0; x < tile_size; x++) {
+            // The first sample of each component predicts from the row above
+            int c = x & 1;
+            int prediction = x < 2 ? first_column[c] : row[x - 2];
+            if (x < 2) first_column[c] = row[x];
+
+            // Differences are modulo 2^16; -32768 is sent as category 16
+            // with no extra bits
+            int diff = (int16_t)(uint16_t)(row[x] - prediction);
+            int magnitude = diff < 0 ? -diff : diff;
+            int category = 0;
+            while (magnitude >> category) category++;
+
+            lj_put(&writer, table->code[category], table->length[category]);
+            if (category > 0 && category < 16) {
+                lj_put(&writer, (uint32_t)(diff < 0 ? diff - 1 : diff), category);
+            }
+        }
+    }
+    if (writer.count > 0) lj_put(&writer, 0xFF, 8 - writer.count);
+
+    writer.out[writer.size++] = 0xFF;
+    writer.out[writer.size++] = 0xD9;   // EOI
+    return writer.size;
+}
+
+// Write a CFA DNG, uncompressed in strips when tile_size is 0, otherwise in
+// tile_size square lossless JPEG tiles
+static int write_dng(const SyntheticOptions* options, const char* path, int tile_size) {
+    if (!validate(options) || !path) return 0;
+
+    uint32_t width = (uint32_t)options->width;
+    uint32_t height = (uint32_t)options->height;
+    uint64_t image_bytes = 2ull * width * height;
+    if (image_bytes > 0xF0000000ull) {
+        fprintf(stderr, "synthetic_raw: %ux%u is too large for a classic TIFF\n", width, height);
+        return 0;
+    }
+
+    // Strips, or tiles in rows of tiles_x; each band of rows is rendered once
+    uint32_t band_rows = tile_size ? (uint32_t)tile_size : DNG_ROWS_PER_STRIP;
+    uint32_t tiles_x = tile_size ? (width + tile_size - 1) / tile_size : 1;
+    uint32_t band_width = tile_size ? tiles_x * tile_size : width;
+    uint32_t band_count = (height + band_rows - 1) / band_rows;
+    uint32_t chunk_count = band_count * tiles_x;
+
+    uint32_t* chunk_offsets = malloc(sizeof(uint32_t) * chunk_count);
+    uint32_t* chunk_sizes = malloc(sizeof(uint32_t) * chunk_count);
+    uint16_t* band = malloc(sizeof(uint16_t) * band_width * band_rows);
+    size_t chunk_capacity = tile_size ? lj_max_size(tile_size) : 2 * (size_t)width * band_rows;
+    uint8_t* chunk = malloc(chunk_capacity);
+    if (!chunk_offsets || !chunk_sizes || !band || !chunk) {
+        fprintf(stderr, "synthetic_raw: out of memory\n");
+        free(chunk_offsets);
+        free(chunk_sizes);
+        free(band);
+        free(chunk);
+        return 0;
+    }
+
+    Scene scene;
+    scene_init(&scene, options);
+
+    uint32_t zero = 0;
+    uint16_t bits = tile_size ? (uint16_t)options->bits : 16;
+    uint16_t compression = tile_size ? 7 : 1;
+    uint16_t photometric = 32803, one = 1, illuminant = 21;
+    uint32_t rows_per_strip = DNG_ROWS_PER_STRIP;
+    uint32_t tile_dimension = (uint32_t)tile_size;
+    uint32_t black = (uint32_t)scene.black, white = (uint32_t)scene.white;
+    uint16_t repeat_bayer[2] = {2, 2};
+    uint16_t repeat_xtrans[2] = {6, 6};
+    uint8_t bayer[4] = {0, 1, 1, 2};
+    uint8_t plane_color[3] = {0, 1, 2};
+    uint8_t dng_version[4] = {1, 4, 0, 0};
+    uint8_t backward_version[4] = {1, 1, 0, 0};
+    // XYZ (D65) to the camera, which here is linear sRGB
+    int32_t color_matrix[18] = {
+        32405, 10000, -15371, 10000, -4985, 10000,
+        -9693, 10000, 18760, 10000, 416, 10000,
+        556, 10000, -2040, 10000, 10572, 10000
+    };
+    uint32_t neutral[6] = {1, 1, 1, 1, 1, 1};
+    const char* make = "AKS";
+    const char* model = options->pattern == SYNTH_PATTERN_XTRANS ? "Synthetic X-Trans" : "Synthetic Bayer";
+    const char* unique_model = options->pattern == SYNTH_PATTERN_XTRANS ? "AKS Synthetic X-Trans" : "AKS Synthetic Bayer";
+    const char* software = "aks synthetic_raw";
+
+    // In tag order; the strip and tile tags fall in different places
+    TiffEntry entries[TIFF_MAX_ENTRIES];
+    int entry_count = 0;
+#define ADD_ENTRY(...) entries[entry_count++] = (TiffEntry){__VA_ARGS__, 0}
+    ADD_ENTRY(254, TIFF_LONG, 1, &zero);                            // NewSubFileType
+    ADD_ENTRY(256, TIFF_LONG, 1, &width);
+    ADD_ENTRY(257, TIFF_LONG, 1, &height);
+    ADD_ENTRY(258, TIFF_SHORT, 1, &bits);
+    ADD_ENTRY(259, TIFF_SHORT, 1, &compression);
+    ADD_ENTRY(262, TIFF_SHORT, 1, &photometric);                    // CFA
+    ADD_ENTRY(271, TIFF_ASCII, (uint32_t)strlen(make) + 1, make);
+    ADD_ENTRY(272, TIFF_ASCII, (uint32_t)strlen(model) + 1, model);
+    if (!tile_size) ADD_ENTRY(273, TIFF_LONG, chunk_count, chunk_offsets);
+    ADD_ENTRY(274, TIFF_SHORT, 1, &one);                            // Orientation
+    ADD_ENTRY(277, TIFF_SHORT, 1, &one);                            // SamplesPerPixel
+    if (!tile_size) {
+        ADD_ENTRY(278, TIFF_LONG, 1, &rows_per_strip);
+        ADD_ENTRY(279, TIFF_LONG, chunk_count, chunk_sizes);
+    }
+    ADD_ENTRY(284, TIFF_SHORT, 1, &one);                            // PlanarConfiguration
+    ADD_ENTRY(305, TIFF_ASCII, (uint32_t)strlen(software) + 1, software);
+    if (tile_size) {
+        ADD_ENTRY(322, TIFF_LONG, 1, &tile_dimension);              // TileWidth
+        ADD_ENTRY(323, TIFF_LONG, 1, &tile_dimension);              // TileLength
+        ADD_ENTRY(324, TIFF_LONG, chunk_count, chunk_offsets);
+        ADD_ENTRY(325, TIFF_LONG, chunk_count, chunk_sizes);
+    }
+    ADD_ENTRY(33421, TIFF_SHORT, 2, options->pattern == SYNTH_PATTERN_XTRANS ? repeat_xtrans : repeat_bayer);
+    ADD_ENTRY(33422, TIFF_BYTE, options->pattern == SYNTH_PATTERN_XTRANS ? 36 : 4,
+              options->pattern == SYNTH_PATTERN_XTRANS ? &xtrans_pattern[0][0] : bayer);
+    ADD_ENTRY(50706, TIFF_BYTE, 4, dng_version);
+    ADD_ENTRY(50707, TIFF_BYTE, 4, backward_version);
+    ADD_ENTRY(50708, TIFF_ASCII, (uint32_t)strlen(unique_model) + 1, unique_model);
+    ADD_ENTRY(50710, TIFF_BYTE, 3, plane_color);                    // CFAPlaneColor
+    ADD_ENTRY(50711, TIFF_SHORT, 1, &one);                          // CFALayout
+    ADD_ENTRY(50714, TIFF_LONG, 1, &black);
+    ADD_ENTRY(50717, TIFF_LONG, 1, &white);
+    ADD_ENTRY(50721, TIFF_SRATIONAL, 9, color_matrix);              // ColorMatrix1
+    ADD_ENTRY(50728, TIFF_RATIONAL, 3, neutral);                    // AsShotNeutral
+    ADD_ENTRY(50778, TIFF_SHORT, 1, &illuminant);                   // CalibrationIlluminant1, D65
+#undef ADD_ENTRY
+
+    // Header, IFD, out-of-line values, then the image data. Strip offsets
+    // are known up front; tile sizes only once they are encoded, so the
+    // header is written again at the end.
+    uint32_t header_size = tiff_layout(entries, entry_count);
+    for (uint32_t s = 0; !tile_size && s < chunk_count; s++) {
+        uint32_t rows = height - s * band_rows < band_rows ? height - s * band_rows : band_rows;
+        chunk_sizes[s] = rows * width * 2;
+        chunk_offsets[s] = header_size + s * band_rows * width * 2;
+    }
+
+    uint8_t* header = calloc(1, header_size);
+    FILE* file = header ? fopen(path, "wb") : NULL;
+    int ok = file != NULL;
+    if (!file) fprintf(stderr, "synthetic_raw: cannot write %s\n", path);
+
+    if (ok) {
+        tiff_fill_header(header, entries, entry_count);
+        ok = fwrite(header, 1, header_size, file) == header_size;
+    }
+
+    LjTable table;
+    if (tile_size) lj_build_table(&table);
+
+    RenderJob job = {
+        .scene = scene,
+        .kind = OUTPUT_CFA,
+        .out = band,
+        .stride = band_width
+    };
+    uint64_t position = header_size;
+    for (uint32_t b = 0; ok && b < band_count; b++) {
+        uint32_t rows = height - b * band_rows < band_rows ? height - b * band_rows : band_rows;
+        render_rows(&job, (int)(b * band_rows), (int)rows);
+
+        if (!tile_size) {
+            size_t count = (size_t)rows * width;
+            for (size_t i = 0; i < count; i++) put16(chunk + i * 2, band[i]);
+            ok = fwrite(chunk, 1, count * 2, file) == count * 2;
+            continue;
+        }
+
+        // Edge tiles repeat the last column and row
+        for (uint32_t y = 0; y < band_rows; y++) {
+            uint16_t* row = band + (size_t)y * band_width;
+            if (y >= rows) memcpy(row, row - band_width, sizeof(uint16_t) * band_width);
+            for (uint32_t x = width; x < band_width; x++) row[x] = row[width - 1];
+        }
+        for (uint32_t t = 0; ok && t < tiles_x; t++) {
+            size_t size = lj_encode_tile(&table, band + (size_t)t * tile_size, band_width,
+                                         tile_size, options->bits, chunk);
+            if (position + size > 0xFFFFFFFFull) {
+                fprintf(stderr, "synthetic_raw: %ux%u is too large for a classic TIFF\n", width, height);
+                ok = 0;
+                break;
+            }
+            chunk_offsets[b * tiles_x + t] = (uint32_t)position;
+            chunk_sizes[b * tiles_x + t] = (uint32_t)size;
+            ok = fwrite(chunk, 1, size, file) == size;
+            position += size;
+        }
+    }
+
+    if (ok && tile_size) {
+        tiff_fill_header(header, entries, entry_count);
+        ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(header, 1, header_size, file) == header_size;
+    }
+
+    if (file && fclose(file) != 0) ok = 0;
+    if (file && !ok) {
+        fprintf(stderr, "synthetic_raw: failed writing %s\n", path);
+        remove(path);
+    }
+
+    free(header);
+    free(chunk_offsets);
+    free(chunk_sizes);
+    free(band);
+    free(chunk);
+    return ok;
+}
+
+int synthetic_write_dng(const SyntheticOptions* options, const char* path) {
+    return write_dng(options, path, 0);
+}
+
+int synthetic_write_tiled_dng(const SyntheticOptions* options, int tile_size, const char* path) {
+    if (options && (tile_size < 16 || tile_size % 16 != 0 || tile_size >= options->width)) {
+        fprintf(stderr, "synthetic_raw: tile size %d is not a multiple of 16 below the width\n", tile_size);
+        return 0;
+    }
+    return write_dng(options, path, tile_size);
+}
@@ -0,0 +1,191 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'synthetic_raw_bindings.dart';
+
+/// Colour filter layouts, in the native id order
+enum CfaPattern {
+  bayer,
+  xtrans,
+}
+
+/// Scene content, in the native id order
+enum SyntheticScene {
+  /// Colour patches, a tonal ramp and a zone plate
+  chart,
+
+  /// Flat mid grey under heavy noise
+  noise,
+
+  /// The chart overexposed, with clipped speculars
+  highlights,
+}
+
+/// Parameters of a synthetic image. The same spec always gives the same
+/// pixels, whatever the resolution or thread count.
+class SyntheticSpec {
+  final int width;
+  final int height;
+  final CfaPattern pattern;
+  final SyntheticScene scene;
+  final int seed;
+  final double noise;
+  final double exposure;
+  final int bits;
+
+  const SyntheticSpec({
+    required this.width,
+    required this.height,
+    this.pattern = CfaPattern.bayer,
+    this.scene = SyntheticScene.chart,
+    this.seed = 1,
+    this.noise = 1.0,
+    this.exposure = 0.0,
+    this.bits = 14,
+  });
+
+  /// A 3:2 image of about the given number of megapixels
+  factory SyntheticSpec.megapixels(
+    double megapixels, {
+    CfaPattern pattern = CfaPattern.bayer,
+    SyntheticScene scene = SyntheticScene.chart,
+    int seed = 1,
+    double noise = 1.0,
+  }) {
+    final width = (math.sqrt(megapixels * 1e6 * 1.5) / 2).round() * 2;
+    final height = (width / 1.5 / 2).round() * 2;
+    return SyntheticSpec(
+      width: width,
+      height: height,
+      pattern: pattern,
+      scene: scene,
+      seed: seed,
+      noise: noise,
+    );
+  }
+
+  double get megapixels => width * height / 1e6;
+
+  void _fill(NativeSyntheticOptions options) {
+    options
+      ..width = width
+      ..height = height
+      ..pattern = pattern.index
+      ..scene = scene.index
+      ..seed = seed
+      ..noise = noise
+      ..exposure = exposure
+      ..bits = bits
+      ..threadCount = 0;
+  }
+
+  @override
+  String toString() => '${width}x$height ${pattern.name} ${scene.name}';
+}
+
+/// Generator for synthetic RAW files and decoded buffers, so benchmarks can
+/// sweep resolutions without shipping large fixtures
+class SyntheticRaw extends FfiBase {
+  static DynamicLibrary? _library;
+  static SyntheticRawBindings? _bindings;
+
+  /// Initialize the generator library
+  static void initialize() {
+    if (_bindings != null) return;
+
+    _library = FfiBase.loadLibrary(
+      'synthetic_raw',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+
+    _bindings = SyntheticRawBindings(_library!);
+  }
+
+  static bool get isAvailable {
+    try {
+      initialize();
+      return true;
+    } catch (_) {
+      return false;
+    }
+  }
+
+  /// Write an uncompressed CFA DNG that LibRaw decodes like a camera file
+  static void writeDng(SyntheticSpec spec, String path) {
+    initialize();
+    final options = calloc<NativeSyntheticOptions>();
+    final pathPointer = path.toNativeUtf8();
+    try {
+      spec._fill(options.ref);
+      if (_bindings!.syntheticWriteDng(options, pathPointer) == 0) {
+        throw Exception('Failed to write synthetic DNG $path');
+      }
+    } finally {
+      calloc.free(options);
+      malloc.free(pathPointer);
+    }
+  }
+
+  /// Write the same DNG with the raw image in lossless JPEG tiles, as phones
+  /// and drones store it. tileSize is a multiple of 16 below the width.
+  static void writeTiledDng(SyntheticSpec spec, String path, {int tileSize = 256}) {
+    initialize();
+    final options = calloc<NativeSyntheticOptions>();
+    final pathPointer = path.toNativeUtf8();
+    try {
+      spec._fill(options.ref);
+      if (_bindings!.syntheticWriteTiledDng(options, tileSize, pathPointer) == 0) {
+        throw Exception('Failed to write tiled synthetic DNG $path');
+      }
+    } finally {
+      calloc.free(options);
+      malloc.free(pathPointer);
+    }
+  }
+
+  /// The scene sRGB encoded, as a decoded image would be (RGBA by default)
+  static Uint8List renderSrgb8(SyntheticSpec spec, {int channels = 4}) {
+    initialize();
+    final size = spec.width * spec.height * channels;
+    final options = calloc<NativeSyntheticOptions>();
+    final pixels = malloc<Uint8>(size);
+    try {
+      spec._fill(options.ref);
+      if (_bindings!.syntheticRenderSrgb8(options, pixels, channels) == 0) {
+        throw Exception('Failed to render synthetic image $spec');
+      }
+      return Uint8List.fromList(pixels.asTypedList(size));
+    } finally {
+      calloc.free(options);
+      malloc.free(pixels);
+    }
+  }
+
+  /// Ground truth linear RGB, 16 bits per channel
+  static Uint16List renderLinear(SyntheticSpec spec, {int channels = 3}) {
+    initialize();
+    final count = spec.width * spec.height * channels;
+    final options = calloc<NativeSyntheticOptions>();
+    final pixels = malloc<Uint16>(count);
+    try {
+      spec._fill(options.ref);
+      if (_bindings!.syntheticRenderLinear(options, pixels, channels) == 0) {
+        throw Exception('Failed to render synthetic image $spec');
+      }
+      return Uint16List.fromList(pixels.asTypedList(count));
+    } finally {
+      calloc.free(options);
+      malloc.free(pixels);
+    }
+  }
+}
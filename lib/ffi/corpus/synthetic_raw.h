@@ -0,0 +1,61 @@
+#ifndef SYNTHETIC_RAW_H
+#define SYNTHETIC_RAW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Deterministic synthetic images for benchmarks and tests. The scene is
+// defined in normalized coordinates, so every resolution shows the same
+// content; noise comes from a hash of (seed, x, y, channel), so output is
+// identical whatever the thread count.
+
+#define SYNTH_PATTERN_BAYER 0       // RGGB
+#define SYNTH_PATTERN_XTRANS 1      // Fujifilm 6x6
+
+#define SYNTH_SCENE_CHART 0         // Colour patches, a tonal ramp and a zone plate
+#define SYNTH_SCENE_NOISE 1         // Flat mid grey under heavy noise
+#define SYNTH_SCENE_HIGHLIGHTS 2    // The chart overexposed, with clipped speculars
+
+typedef struct {
+    int32_t width;
+    int32_t height;
+    int32_t pattern;            // SYNTH_PATTERN_*
+    int32_t scene;              // SYNTH_SCENE_*
+    uint32_t seed;
+    float noise;                // 0 is noiseless, 1 a base ISO sensor
+    float exposure;             // Stops
+    int32_t bits;               // Sensor bit depth for CFA data and DNGs, 10-16
+    int32_t thread_count;       // <= 0 uses every core
+} SyntheticOptions;
+
+void synthetic_default_options(SyntheticOptions* options);
+
+// Mosaiced sensor values with black level and white clip applied, as LibRaw
+// would see them. stride is in samples; 0 means width.
+int synthetic_render_cfa(const SyntheticOptions* options, uint16_t* out, size_t stride);
+
+// Ground truth scene-referred RGB, 16-bit linear, 0-65535 (no mosaic)
+int synthetic_render_linear(const SyntheticOptions* options, uint16_t* out, int channels);
+
+// The same scene sRGB encoded, as a decoded preview would be. channels is 3
+// or 4 (alpha 255).
+int synthetic_render_srgb8(const SyntheticOptions* options, uint8_t* out, int channels);
+
+// Write an uncompressed CFA DNG. Strips are rendered in parallel and
+// streamed out, so memory use doesn't grow with the resolution.
+int synthetic_write_dng(const SyntheticOptions* options, const char* path);
+
+// Write the same DNG with the raw image in tile_size square lossless JPEG
+// tiles, as phones and drones store it. tile_size must be a multiple of 16
+// and smaller than the width, so there is more than one tile.
+int synthetic_write_tiled_dng(const SyntheticOptions* options, int tile_size, const char* path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYNTHETIC_RAW_H
@@ -0,0 +1,71 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Mirrors SyntheticOptions in synthetic_raw.h
+final class NativeSyntheticOptions extends Struct {
+  @Int32()
+  external int width;
+  @Int32()
+  external int height;
+  @Int32()
+  external int pattern;
+  @Int32()
+  external int scene;
+  @Uint32()
+  external int seed;
+  @Float()
+  external double noise;
+  @Float()
+  external double exposure;
+  @Int32()
+  external int bits;
+  @Int32()
+  external int threadCount;
+}
+
+// Bindings for libsynthetic_raw
+class SyntheticRawBindings {
+  final DynamicLibrary _lib;
+
+  SyntheticRawBindings(this._lib);
+
+  late final _synthetic_default_options = _lib.lookupFunction<
+      Void Function(Pointer<NativeSyntheticOptions>),
+      void Function(Pointer<NativeSyntheticOptions>)>('synthetic_default_options');
+
+  late final _synthetic_render_linear = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSyntheticOptions>, Pointer<Uint16>, Int32),
+      int Function(Pointer<NativeSyntheticOptions>, Pointer<Uint16>, int)>('synthetic_render_linear');
+
+  late final _synthetic_render_srgb8 = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSyntheticOptions>, Pointer<Uint8>, Int32),
+      int Function(Pointer<NativeSyntheticOptions>, Pointer<Uint8>, int)>('synthetic_render_srgb8');
+
+  late final _synthetic_write_dng = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSyntheticOptions>, Pointer<Utf8>),
+      int Function(Pointer<NativeSyntheticOptions>, Pointer<Utf8>)>('synthetic_write_dng');
+
+  late final _synthetic_write_tiled_dng = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSyntheticOptions>, Int32, Pointer<Utf8>),
+      int Function(Pointer<NativeSyntheticOptions>, int, Pointer<Utf8>)>('synthetic_write_tiled_dng');
+
+  void syntheticDefaultOptions(Pointer<NativeSyntheticOptions> options) {
+    _synthetic_default_options(options);
+  }
+
+  int syntheticRenderLinear(Pointer<NativeSyntheticOptions> options, Pointer<Uint16> out, int channels) {
+    return _synthetic_render_linear(options, out, channels);
+  }
+
+  int syntheticRenderSrgb8(Pointer<NativeSyntheticOptions> options, Pointer<Uint8> out, int channels) {
+    return _synthetic_render_srgb8(options, out, channels);
+  }
+
+  int syntheticWriteDng(Pointer<NativeSyntheticOptions> options, Pointer<Utf8> path) {
+    return _synthetic_write_dng(options, path);
+  }
+
+  int syntheticWriteTiledDng(Pointer<NativeSyntheticOptions> options, int tileSize, Pointer<Utf8> path) {
+    return _synthetic_write_tiled_dng(options, tileSize, path);
+  }
+}
@@ -0,0 +1,168 @@
+// aks_corpus: write a synthetic test image.
+//
+//   aks_corpus [options] output.{dng,ppm,pam}
+//
+// .dng writes mosaiced sensor data, .ppm the sRGB scene (8-bit) and .pam
+// the linear scene (16-bit). The same options always produce the same file.
+
+#include "synthetic_raw.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: aks_corpus [options] output.{dng,ppm,pam}\n"
+        "  --size WxH          dimensions (default 6000x4000)\n"
+        "  --megapixels N      3:2 image of about N megapixels instead of --size\n"
+        "  --pattern P         bayer or xtrans (default bayer)\n"
+        "  --scene S           chart, noise or highlights (default chart)\n"
+        "  --seed N            noise seed (default 1)\n"
+        "  --noise X           noise scale, 0 for none (default 1)\n"
+        "  --exposure EV       exposure offset in stops (default 0)\n"
+        "  --bits N            sensor bit depth, 10-16 (default 14)\n"
+        "  --threads N         worker threads (default: all cores)\n"
+        "  --tile N            DNG in N pixel lossless JPEG tiles, a multiple of 16\n");
+}
+
+static const char* extension(const char* path) {
+    const char* dot = strrchr(path, '.');
+    return dot ? dot + 1 : "";
+}
+
+static int write_ppm(const SyntheticOptions* options, const char* path) {
+    size_t size = (size_t)options->width * options->height * 3;
+    uint8_t* pixels = malloc(size);
+    if (!pixels || !synthetic_render_srgb8(options, pixels, 3)) {
+        free(pixels);
+        return 0;
+    }
+    FILE* file = fopen(path, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        fprintf(file, "P6\n%d %d\n255\n", options->width, options->height);
+        ok = fwrite(pixels, 1, size, file) == size;
+        if (fclose(file) != 0) ok = 0;
+    }
+    free(pixels);
+    return ok;
+}
+
+static int write_pam16(const SyntheticOptions* options, const char* path) {
+    size_t count = (size_t)options->width * options->height * 3;
+    uint16_t* pixels = malloc(count * sizeof(uint16_t));
+    if (!pixels || !synthetic_render_linear(options, pixels, 3)) {
+        free(pixels);
+        return 0;
+    }
+    // PAM samples are big-endian
+    uint8_t* bytes = (uint8_t*)pixels;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t v = pixels[i];
+        bytes[i * 2] = (uint8_t)(v >> 8);
+        bytes[i * 2 + 1] = (uint8_t)v;
+    }
+    FILE* file = fopen(path, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        fprintf(file, "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 3\nMAXVAL 65535\nTUPLTYPE RGB\nENDHDR\n",
+                options->width, options->height);
+        ok = fwrite(bytes, 1, count * 2, file) == count * 2;
+        if (fclose(file) != 0) ok = 0;
+    }
+    free(pixels);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    SyntheticOptions options;
+    synthetic_default_options(&options);
+    const char* path = NULL;
+    int tile_size = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (arg[0] != '-') {
+            if (path) {
+                usage();
+                return 2;
+            }
+            path = arg;
+            continue;
+        }
+        if (!value) {
+            usage();
+            return 2;
+        }
+        i++;
+
+        if (strcmp(arg, "--size") == 0) {
+            if (sscanf(value, "%dx%d", &options.width, &options.height) != 2) {
+                usage();
+                return 2;
+            }
+        } else if (strcmp(arg, "--megapixels") == 0) {
+            double pixels = atof(value) * 1e6;
+            options.width = (int)lround(sqrt(pixels * 1.5) / 2.0) * 2;
+            options.height = (int)lround(options.width / 1.5 / 2.0) * 2;
+        } else if (strcmp(arg, "--pattern") == 0) {
+            if (strcmp(value, "bayer") == 0) options.pattern = SYNTH_PATTERN_BAYER;
+            else if (strcmp(value, "xtrans") == 0) options.pattern = SYNTH_PATTERN_XTRANS;
+            else {
+                usage();
+                return 2;
+            }
+        } else if (strcmp(arg, "--scene") == 0) {
+            if (strcmp(value, "chart") == 0) options.scene = SYNTH_SCENE_CHART;
+            else if (strcmp(value, "noise") == 0) options.scene = SYNTH_SCENE_NOISE;
+            else if (strcmp(value, "highlights") == 0) options.scene = SYNTH_SCENE_HIGHLIGHTS;
+            else {
+                usage();
+                return 2;
+            }
+        } else if (strcmp(arg, "--seed") == 0) {
+            options.seed = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(arg, "--noise") == 0) {
+            options.noise = (float)atof(value);
+        } else if (strcmp(arg, "--exposure") == 0) {
+            options.exposure = (float)atof(value);
+        } else if (strcmp(arg, "--bits") == 0) {
+            options.bits = atoi(value);
+        } else if (strcmp(arg, "--threads") == 0) {
+            options.thread_count = atoi(value);
+        } else if (strcmp(arg, "--tile") == 0) {
+            tile_size = atoi(value);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!path) {
+        usage();
+        return 2;
+    }
+
+    const char* ext = extension(path);
+    int ok;
+    if (strcasecmp(ext, "dng") == 0) {
+        ok = tile_size ? synthetic_write_tiled_dng(&options, tile_size, path)
+                       : synthetic_write_dng(&options, path);
+    } else if (strcasecmp(ext, "ppm") == 0) {
+        ok = write_ppm(&options, path);
+    } else if (strcasecmp(ext, "pam") == 0) {
+        ok = write_pam16(&options, path);
+    } else {
+        fprintf(stderr, "aks_corpus: unknown output format .%s\n", ext);
+        return 2;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "aks_corpus: failed to write %s\n", path);
+        return 1;
+    }
+    printf("%s: %dx%d\n", path, options.width, options.height);
+    return 0;
+}
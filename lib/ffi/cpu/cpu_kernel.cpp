@@ -0,0 +1,578 @@
+#include "cpu_kernel.h"
+#include "../common/job_scheduler.h"
+#include "../lut/cube_lut.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct LutRelease {
+    void operator()(const CubeLut* lut) const { cube_lut_release(lut); }
+};
+
+// Adjustment values from AksAdjustmentParams, plus per-call constants
+struct KernelParams {
+    uint32_t stages;
+    float temperature;
+    float tint;
+    float exposure;
+    float contrast;
+    float highlights;
+    float shadows;
+    float blacks;
+    float whites;
+    float saturation;
+    float vibrance;
+
+    float exposure_scale;
+    const uint8_t* luts[4];  // rgb, red, green, blue
+
+    std::unique_ptr<const CubeLut, LutRelease> lut;    // Held while the params live
+    float lut_opacity;
+};
+
+uint8_t identity_lut[256];
+
+struct IdentityLutInit {
+    IdentityLutInit() {
+        for (int i = 0; i < 256; i++) identity_lut[i] = (uint8_t)i;
+    }
+} identity_lut_init;
+
+KernelParams unpack_params(
+    const AksAdjustmentParams& params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    KernelParams p;
+    p.stages = params.stages;
+    p.temperature = params.temperature;
+    p.tint = params.tint;
+    p.exposure = params.exposure;
+    p.contrast = params.contrast;
+    p.highlights = params.highlights;
+    p.shadows = params.shadows;
+    p.blacks = params.blacks;
+    p.whites = params.whites;
+    p.saturation = params.saturation;
+    p.vibrance = params.vibrance;
+    p.exposure_scale = powf(2.0f, p.exposure);
+    p.luts[0] = rgb_lut ? rgb_lut : identity_lut;
+    p.luts[1] = red_lut ? red_lut : identity_lut;
+    p.luts[2] = green_lut ? green_lut : identity_lut;
+    p.luts[3] = blue_lut ? blue_lut : identity_lut;
+
+    // A LUT that isn't registered is left out, like a missing curve
+    if (p.stages & AKS_STAGE_LUT_3D) p.lut.reset(cube_lut_acquire(params.lut_id));
+    if (!p.lut) p.stages &= ~AKS_STAGE_LUT_3D;
+    p.lut_opacity = fminf(fmaxf(params.lut_opacity, 0.0f), 1.0f);
+    return p;
+}
+
+KernelParams unpack_floats(
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    AksAdjustmentParams params;
+    aks_params_from_floats(&params, adjustments, adjustment_count);
+    return unpack_params(params, rgb_lut, red_lut, green_lut, blue_lut);
+}
+
+// GLSL built-ins with the same semantics as in the shader
+inline float clampf(float x, float lo, float hi) { return x < lo ? lo : (x > hi ? hi : x); }
+inline float mixf(float a, float b, float t) { return a * (1.0f - t) + b * t; }
+inline float stepf(float edge, float x) { return x < edge ? 0.0f : 1.0f; }
+inline float smoothstepf(float e0, float e1, float x) {
+    float t = clampf((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Four floats in one SIMD register (SSE, NEON)
+typedef float Vec4 __attribute__((vector_size(16)));
+
+inline Vec4 load_entry(const float* entry) {
+    Vec4 v;
+    memcpy(&v, entry, sizeof(v));
+    return v;
+}
+
+// Tetrahedral interpolation in a .cube LUT; keep in sync with applyLut3D in
+// image_process.comp. Entries are r, g, b, 0, so each corner is one vector
+// and the blend covers all channels at once.
+inline Vec4 sample_lut(const CubeLut* lut, float r, float g, float b) {
+    int n = lut->size;
+    float scale = (float)(n - 1);
+    float sr = clampf(r, 0.0f, 1.0f) * scale;
+    float sg = clampf(g, 0.0f, 1.0f) * scale;
+    float sb = clampf(b, 0.0f, 1.0f) * scale;
+    int r0 = (int)sr < n - 2 ? (int)sr : n - 2;
+    int g0 = (int)sg < n - 2 ? (int)sg : n - 2;
+    int b0 = (int)sb < n - 2 ? (int)sb : n - 2;
+    float fr = sr - r0;
+    float fg = sg - g0;
+    float fb = sb - b0;
+
+    size_t dr = 4;
+    size_t dg = (size_t)n * 4;
+    size_t db = (size_t)n * n * 4;
+    const float* c000 = lut->data + (size_t)r0 * dr + (size_t)g0 * dg + (size_t)b0 * db;
+
+    // Walk from c000 to c111 along the axes in order of decreasing fraction
+    size_t step1, step2;
+    float f1, f2, f3;
+    if (fr > fg) {
+        if (fg > fb)      { step1 = dr; step2 = dr + dg; f1 = fr; f2 = fg; f3 = fb; }
+        else if (fr > fb) { step1 = dr; step2 = dr + db; f1 = fr; f2 = fb; f3 = fg; }
+        else              { step1 = db; step2 = db + dr; f1 = fb; f2 = fr; f3 = fg; }
+    } else {
+        if (fb > fg)      { step1 = db; step2 = db + dg; f1 = fb; f2 = fg; f3 = fr; }
+        else if (fb > fr) { step1 = dg; step2 = dg + db; f1 = fg; f2 = fb; f3 = fr; }
+        else              { step1 = dg; step2 = dg + dr; f1 = fg; f2 = fr; f3 = fb; }
+    }
+
+    // Written as steps from c000 rather than a weighted sum of the corners,
+    // so linear LUTs with 2^k+1 entries (17, 33, 65) reproduce their input
+    // exactly
+    Vec4 v0 = load_entry(c000);
+    Vec4 v1 = load_entry(c000 + step1);
+    Vec4 v2 = load_entry(c000 + step2);
+    Vec4 v3 = load_entry(c000 + dr + dg + db);
+    return v0 + (v1 - v0) * f1 + (v2 - v1) * f2 + (v3 - v2) * f3;
+}
+
+// Stages the kernel implements. Every combination gets its own inner loop
+// with only those stages compiled in, the CPU counterpart of shader
+// specialization constants. The basic stages and the curve are the low bits
+// of the table index; the LUT stage, past the unimplemented HSL and masks
+// bits, is the bit above them.
+constexpr uint32_t kLowStages = AKS_STAGE_BASIC | AKS_STAGE_TONE_CURVE;
+constexpr uint32_t kLutVariant = kLowStages + 1;
+constexpr uint32_t kVariantCount = kLutVariant * 2;
+static_assert((kLutVariant & kLowStages) == 0, "kernel stages must be the low bits");
+
+constexpr uint32_t variant_index(uint32_t stages) {
+    return (stages & kLowStages) | ((stages & AKS_STAGE_LUT_3D) ? kLutVariant : 0);
+}
+
+constexpr uint32_t variant_stages(size_t index) {
+    return ((uint32_t)index & kLowStages) | ((index & kLutVariant) ? AKS_STAGE_LUT_3D : 0);
+}
+
+// Per-pixel pipeline; keep in sync with image_process.comp
+template <uint32_t Stages>
+inline void process_pixel(const KernelParams& p, const uint8_t* in, uint8_t* out) {
+    float r = in[0] / 255.0f;
+    float g = in[1] / 255.0f;
+    float b = in[2] / 255.0f;
+
+    // White balance
+    if constexpr ((Stages & AKS_STAGE_WHITE_BALANCE) != 0) {
+        float temp_scale = (p.temperature - 5500.0f) / 5500.0f;
+        r *= 1.0f + temp_scale * 0.5f;
+        b *= 1.0f - temp_scale * 0.5f;
+        float tint_scale = p.tint / 150.0f;
+        g *= 1.0f - fabsf(tint_scale) * 0.3f;
+        if (tint_scale > 0) {
+            r *= 1.0f + tint_scale * 0.2f;
+            b *= 1.0f + tint_scale * 0.2f;
+        }
+    }
+
+    // Exposure
+    if constexpr ((Stages & AKS_STAGE_EXPOSURE) != 0) {
+        r *= p.exposure_scale;
+        g *= p.exposure_scale;
+        b *= p.exposure_scale;
+    }
+
+    // Contrast
+    if constexpr ((Stages & AKS_STAGE_CONTRAST) != 0) {
+        float factor = (100.0f + p.contrast) / 100.0f;
+        r = (r - 0.5f) * factor + 0.5f;
+        g = (g - 0.5f) * factor + 0.5f;
+        b = (b - 0.5f) * factor + 0.5f;
+    }
+
+    // Highlights and shadows
+    if constexpr ((Stages & AKS_STAGE_HIGHLIGHTS_SHADOWS) != 0) {
+        float luminance = r * 0.299f + g * 0.587f + b * 0.114f;
+        float shadow_weight = smoothstepf(0.5f, 0.0f, luminance);
+        float shadow_factor = mixf(1.0f, 1.0f + (p.shadows / 100.0f) * (1.0f - luminance * 2.0f),
+                                   shadow_weight * stepf(0.001f, fabsf(p.shadows)));
+        float highlight_weight = smoothstepf(0.5f, 1.0f, luminance);
+        float highlight_factor = mixf(1.0f, 1.0f + (p.highlights / 100.0f) * ((luminance - 0.5f) * 2.0f),
+                                      highlight_weight * stepf(0.001f, fabsf(p.highlights)));
+        float hs = shadow_factor * highlight_factor;
+        r *= hs;
+        g *= hs;
+        b *= hs;
+    }
+
+    // Blacks and whites
+    if constexpr ((Stages & AKS_STAGE_BLACKS_WHITES) != 0) {
+        float black_point = p.blacks > 0 ? p.blacks * 0.005f : p.blacks * 0.003f;
+        float white_point = 1.0f + (p.whites > 0 ? p.whites * 0.005f : p.whites * 0.003f);
+        float range = white_point - black_point;
+        r = (r - black_point) / range;
+        g = (g - black_point) / range;
+        b = (b - black_point) / range;
+    }
+
+    // Saturation and vibrance
+    if constexpr ((Stages & AKS_STAGE_SATURATION) != 0) {
+        float gray = r * 0.299f + g * 0.587f + b * 0.114f;
+        float sat_factor = mixf(1.0f, (100.0f + p.saturation) / 100.0f, stepf(0.001f, fabsf(p.saturation)));
+        float max_channel = fmaxf(fmaxf(r, g), b);
+        float min_channel = fminf(fminf(r, g), b);
+        float current_sat = max_channel - min_channel;
+        float vib_factor = mixf(1.0f, (100.0f + p.vibrance * (1.0f - current_sat)) / 100.0f,
+                                stepf(0.001f, fabsf(p.vibrance)));
+        float combined = sat_factor * vib_factor;
+        r = mixf(gray, r, combined);
+        g = mixf(gray, g, combined);
+        b = mixf(gray, b, combined);
+    }
+
+    // Tone curves
+    if constexpr ((Stages & AKS_STAGE_TONE_CURVE) != 0) {
+        int ri = (int)clampf(r * 255.0f, 0.0f, 255.0f);
+        int gi = (int)clampf(g * 255.0f, 0.0f, 255.0f);
+        int bi = (int)clampf(b * 255.0f, 0.0f, 255.0f);
+        ri = p.luts[1][p.luts[0][ri]];
+        gi = p.luts[2][p.luts[0][gi]];
+        bi = p.luts[3][p.luts[0][bi]];
+        r = ri / 255.0f;
+        g = gi / 255.0f;
+        b = bi / 255.0f;
+    }
+
+    // 3D LUT
+    if constexpr ((Stages & AKS_STAGE_LUT_3D) != 0) {
+        Vec4 look = sample_lut(p.lut.get(), r, g, b);
+        r = mixf(r, look[0], p.lut_opacity);
+        g = mixf(g, look[1], p.lut_opacity);
+        b = mixf(b, look[2], p.lut_opacity);
+    }
+
+    out[0] = (uint8_t)(clampf(r, 0.0f, 1.0f) * 255.0f);
+    out[1] = (uint8_t)(clampf(g, 0.0f, 1.0f) * 255.0f);
+    out[2] = (uint8_t)(clampf(b, 0.0f, 1.0f) * 255.0f);
+    out[3] = 255;
+}
+
+template <uint32_t Stages>
+void process_rows_for(
+    const KernelParams& p,
+    const uint8_t* input,
+    size_t input_stride,
+    int width,
+    int height,
+    uint8_t* output,
+    size_t output_stride
+) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t* in = input + (size_t)y * input_stride;
+        uint8_t* out = output + (size_t)y * output_stride;
+        for (int x = 0; x < width; x++) {
+            process_pixel<Stages>(p, in + x * 3, out + x * 4);
+        }
+    }
+}
+
+using RowKernel = void (*)(const KernelParams&, const uint8_t*, size_t, int, int, uint8_t*, size_t);
+
+template <size_t... Masks>
+constexpr std::array<RowKernel, sizeof...(Masks)> make_row_kernels(std::index_sequence<Masks...>) {
+    return {{ &process_rows_for<variant_stages(Masks)>... }};
+}
+
+// Indexed by variant_index of the active stages
+constexpr std::array<RowKernel, kVariantCount> row_kernels =
+    make_row_kernels(std::make_index_sequence<kVariantCount>());
+
+void process_rows(
+    const KernelParams& p,
+    const uint8_t* input,
+    size_t input_stride,
+    int width,
+    int height,
+    uint8_t* output,
+    size_t output_stride
+) {
+    row_kernels[variant_index(p.stages)](p, input, input_stride, width, height, output, output_stride);
+}
+
+int resolve_thread_count(int requested) {
+    if (requested > 0) return requested;
+    unsigned int cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+// Rows split across cores into a packed RGBA buffer. This is the preview
+// path, so it runs as interactive work.
+void process_image_rows(
+    const KernelParams& params,
+    const uint8_t* input,
+    size_t input_stride,
+    int width,
+    int height,
+    uint8_t* output
+) {
+    int thread_count = resolve_thread_count(0);
+    if (thread_count > height) thread_count = height;
+    int rows_per_thread = (height + thread_count - 1) / thread_count;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < thread_count; t++) {
+        int y0 = t * rows_per_thread;
+        int rows = y0 + rows_per_thread <= height ? rows_per_thread : height - y0;
+        if (rows <= 0) break;
+        workers.emplace_back([&, y0, rows]() {
+            job_begin(JOB_CLASS_INTERACTIVE);
+            process_rows(params,
+                input + (size_t)y0 * input_stride, input_stride,
+                width, rows,
+                output + (size_t)y0 * width * 4, (size_t)width * 4);
+            job_end(JOB_CLASS_INTERACTIVE);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+}
+
+int process_tiled(
+    const KernelParams& params,
+    TiledImage* source,
+    TiledImage* destination,
+    int thread_count
+) {
+    if (!source || !destination ||
+        tiled_image_channels(source) != 3 || tiled_image_channels(destination) != 4 ||
+        tiled_image_width(source) != tiled_image_width(destination) ||
+        tiled_image_height(source) != tiled_image_height(destination) ||
+        tiled_image_tile_size(source) != tiled_image_tile_size(destination)) {
+        fprintf(stderr, "cpu_process_tiled: source must be RGB and destination RGBA of the same geometry\n");
+        return 0;
+    }
+
+    int tile_size = tiled_image_tile_size(source);
+    int tiles_x = tiled_image_tiles_x(source);
+    int tile_count = tiles_x * tiled_image_tiles_y(source);
+    std::atomic<int> next_tile(0);
+    std::atomic<int> failed(0);
+
+    // Workers pull tiles from a shared counter; each holds at most two tiles pinned.
+    // Tiled processing is export work and steps aside for previews between tiles.
+    auto worker = [&]() {
+        job_begin(JOB_CLASS_BATCH);
+        for (int index = next_tile++; index < tile_count && !failed; index = next_tile++) {
+            int tx = index % tiles_x;
+            int ty = index / tiles_x;
+            uint8_t* in = tiled_image_acquire_tile(source, tx, ty);
+            uint8_t* out = tiled_image_acquire_tile(destination, tx, ty);
+            if (!in || !out) {
+                failed = 1;
+            } else {
+                process_rows(params, in, (size_t)tile_size * 3, tile_size, tile_size,
+                             out, (size_t)tile_size * 4);
+            }
+            if (in) tiled_image_release_tile(source, tx, ty, 0);
+            if (out) tiled_image_release_tile(destination, tx, ty, 1);
+            job_yield(JOB_CLASS_BATCH);
+        }
+        job_end(JOB_CLASS_BATCH);
+    };
+
+    int workers_wanted = resolve_thread_count(thread_count);
+    if (workers_wanted > tile_count) workers_wanted = tile_count;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < workers_wanted; t++) {
+        workers.emplace_back(worker);
+    }
+    for (auto& w : workers) w.join();
+
+    return failed ? 0 : 1;
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t cpu_get_capabilities(uint32_t* params_version) {
+    if (params_version) *params_version = AKS_PARAMS_VERSION;
+    return AKS_CAP_BASIC | AKS_CAP_CROP | AKS_CAP_TONE_CURVE | AKS_CAP_LUT_3D;
+}
+
+int cpu_process_region(
+    const uint8_t* input_pixels,
+    size_t input_stride,
+    int width,
+    int height,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t* output_pixels,
+    size_t output_stride
+) {
+    if (!input_pixels || !output_pixels || !adjustments || width <= 0 || height <= 0) {
+        return 0;
+    }
+
+    KernelParams params = unpack_floats(adjustments, adjustment_count,
+        rgb_lut, red_lut, green_lut, blue_lut);
+    process_rows(params, input_pixels, input_stride, width, height, output_pixels, output_stride);
+    return 1;
+}
+
+int cpu_process_region_params(
+    const uint8_t* input_pixels,
+    size_t input_stride,
+    int width,
+    int height,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t* output_pixels,
+    size_t output_stride
+) {
+    AksAdjustmentParams loaded;
+    if (!input_pixels || !output_pixels || width <= 0 || height <= 0 ||
+        !aks_params_load(&loaded, adjustments)) {
+        return 0;
+    }
+
+    KernelParams params = unpack_params(loaded, rgb_lut, red_lut, green_lut, blue_lut);
+    process_rows(params, input_pixels, input_stride, width, height, output_pixels, output_stride);
+    return 1;
+}
+
+int cpu_process_image(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels
+) {
+    if (!output_pixels || width <= 0 || height <= 0) return 0;
+
+    uint8_t* output = (uint8_t*)malloc((size_t)width * height * 4);
+    if (!output) {
+        fprintf(stderr, "cpu_process_image: allocation failed\n");
+        return 0;
+    }
+
+    KernelParams params = unpack_floats(adjustments, adjustment_count,
+        rgb_lut, red_lut, green_lut, blue_lut);
+    process_image_rows(params, input_pixels, (size_t)width * 3, width, height, output);
+
+    *output_pixels = output;
+    return 1;
+}
+
+int cpu_process_image_params(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    AksAdjustmentParams loaded;
+    if (!input_pixels || !output_pixels || width <= 0 || height <= 0 ||
+        !aks_params_load(&loaded, adjustments)) {
+        return 0;
+    }
+    aks_params_clamp_crop(&loaded);
+
+    // Cropping only moves the start of the input and shrinks the region
+    int crop_x, crop_y, crop_width, crop_height;
+    aks_params_crop_rect(&loaded, width, height, &crop_x, &crop_y, &crop_width, &crop_height);
+    if (crop_width <= 0 || crop_height <= 0) return 0;
+
+    uint8_t* output = (uint8_t*)malloc((size_t)crop_width * crop_height * 4);
+    if (!output) {
+        fprintf(stderr, "cpu_process_image_params: allocation failed\n");
+        return 0;
+    }
+
+    KernelParams params = unpack_params(loaded, rgb_lut, red_lut, green_lut, blue_lut);
+    size_t input_stride = (size_t)width * 3;
+    process_image_rows(params,
+        input_pixels + (size_t)crop_y * input_stride + (size_t)crop_x * 3, input_stride,
+        crop_width, crop_height, output);
+
+    *output_pixels = output;
+    if (output_width) *output_width = crop_width;
+    if (output_height) *output_height = crop_height;
+    return 1;
+}
+
+int cpu_process_tiled(
+    TiledImage* source,
+    TiledImage* destination,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int thread_count
+) {
+    KernelParams params = unpack_floats(adjustments, adjustment_count,
+        rgb_lut, red_lut, green_lut, blue_lut);
+    return process_tiled(params, source, destination, thread_count);
+}
+
+int cpu_process_tiled_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int thread_count
+) {
+    AksAdjustmentParams loaded;
+    if (!aks_params_load(&loaded, adjustments)) {
+        fprintf(stderr, "cpu_process_tiled_params: invalid parameters\n");
+        return 0;
+    }
+
+    KernelParams params = unpack_params(loaded, rgb_lut, red_lut, green_lut, blue_lut);
+    return process_tiled(params, source, destination, thread_count);
+}
+
+void cpu_free_buffer(uint8_t* buffer) {
+    free(buffer);
+}
+
+} // extern "C"
@@ -0,0 +1,37 @@
+import 'dart:ffi';
+import 'dart:io';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'cpu_kernel_bindings.dart';
+
+/// Loader for the native CPU implementation of the adjustment pipeline
+class CpuKernel extends FfiBase {
+  static DynamicLibrary? _library;
+  static CpuKernelBindings? _bindings;
+  
+  /// Initialize the CPU kernel library
+  static void initialize() {
+    if (_bindings != null) return;
+    
+    _library = FfiBase.loadLibrary(
+      'cpu_kernel',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+    
+    _bindings = CpuKernelBindings(_library!);
+  }
+  
+  /// Get the CPU kernel bindings instance
+  static CpuKernelBindings get bindings {
+    if (_bindings == null) {
+      initialize();
+    }
+    return _bindings!;
+  }
+}
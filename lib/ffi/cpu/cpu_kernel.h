@@ -0,0 +1,116 @@
+#ifndef CPU_KERNEL_H
+#define CPU_KERNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../tiles/tiled_image.h"
+#include "../common/adjustment_params.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Native CPU implementation of the adjustment pipeline in image_process.comp.
+// The *_params entry points take the AksAdjustmentParams struct shared with
+// the Vulkan processor. The float variants take the legacy packed layout:
+// temperature, tint, exposure, contrast, highlights, shadows, blacks, whites,
+// saturation, vibrance, toneCurveEnabled. LUT pointers may be NULL (identity).
+
+// Capabilities of this engine (AKS_CAP_* bits). params_version, if not NULL,
+// receives the AksAdjustmentParams version it was built against.
+uint32_t cpu_get_capabilities(uint32_t* params_version);
+
+// Process packed RGB pixels into a newly allocated, cropped RGBA buffer
+int cpu_process_image_params(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,   // Output cropped width
+    int* output_height   // Output cropped height
+);
+
+// cpu_process_region with a versioned parameter struct; the crop is ignored
+int cpu_process_region_params(
+    const uint8_t* input_pixels,
+    size_t input_stride,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t* output_pixels,
+    size_t output_stride
+);
+
+// cpu_process_tiled with a versioned parameter struct; the crop is ignored
+int cpu_process_tiled_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int thread_count
+);
+
+// Process packed RGB pixels into a newly allocated RGBA buffer
+int cpu_process_image(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,    // 256 bytes tone curve LUT for RGB
+    const uint8_t* red_lut,    // 256 bytes tone curve LUT for red
+    const uint8_t* green_lut,  // 256 bytes tone curve LUT for green
+    const uint8_t* blue_lut,   // 256 bytes tone curve LUT for blue
+    uint8_t** output_pixels
+);
+
+// Process a strided RGB region into a strided RGBA region (no allocation)
+int cpu_process_region(
+    const uint8_t* input_pixels,
+    size_t input_stride,
+    int width,
+    int height,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t* output_pixels,
+    size_t output_stride
+);
+
+// Stream every tile of an RGB tiled image through the kernel into an RGBA
+// tiled image of the same geometry. thread_count <= 0 uses all cores.
+int cpu_process_tiled(
+    TiledImage* source,
+    TiledImage* destination,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int thread_count
+);
+
+// Free a buffer returned by cpu_process_image
+void cpu_free_buffer(uint8_t* buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CPU_KERNEL_H
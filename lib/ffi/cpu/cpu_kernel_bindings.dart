@@ -0,0 +1,80 @@
+import 'dart:ffi';
+import '../common/adjustment_params.dart';
+import '../tiles/tiled_image_bindings.dart';
+
+// Native CPU kernel FFI bindings
+class CpuKernelBindings {
+  final DynamicLibrary _lib;
+  
+  CpuKernelBindings(this._lib);
+  
+  late final _cpu_process_image = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Pointer<Float>, Int32,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Pointer<Uint8>>),
+      int Function(Pointer<Uint8>, int, int, Pointer<Float>, int,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Pointer<Uint8>>)>('cpu_process_image');
+  
+  late final _cpu_process_tiled = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>, Pointer<NativeTiledImage>, Pointer<Float>, Int32,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Int32),
+      int Function(Pointer<NativeTiledImage>, Pointer<NativeTiledImage>, Pointer<Float>, int,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, int)>('cpu_process_tiled');
+  
+  late final _cpu_get_capabilities = _lib.lookupFunction<
+      Uint32 Function(Pointer<Uint32>),
+      int Function(Pointer<Uint32>)>('cpu_get_capabilities');
+  
+  late final _cpu_process_image_params = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Pointer<AdjustmentParams>,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Pointer<Uint8>>,
+          Pointer<Int32>, Pointer<Int32>),
+      int Function(Pointer<Uint8>, int, int, Pointer<AdjustmentParams>,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Pointer<Uint8>>,
+          Pointer<Int32>, Pointer<Int32>)>('cpu_process_image_params');
+  
+  late final _cpu_process_tiled_params = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>, Pointer<NativeTiledImage>, Pointer<AdjustmentParams>,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Int32),
+      int Function(Pointer<NativeTiledImage>, Pointer<NativeTiledImage>, Pointer<AdjustmentParams>,
+          Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, Pointer<Uint8>, int)>('cpu_process_tiled_params');
+  
+  late final _cpu_free_buffer = _lib.lookupFunction<
+      Void Function(Pointer<Uint8>),
+      void Function(Pointer<Uint8>)>('cpu_free_buffer');
+  
+  int cpuProcessImage(Pointer<Uint8> input, int width, int height, Pointer<Float> adjustments,
+      int adjustmentCount, Pointer<Uint8> rgbLut, Pointer<Uint8> redLut, Pointer<Uint8> greenLut,
+      Pointer<Uint8> blueLut, Pointer<Pointer<Uint8>> output) {
+    return _cpu_process_image(input, width, height, adjustments, adjustmentCount,
+        rgbLut, redLut, greenLut, blueLut, output);
+  }
+  
+  int cpuProcessTiled(Pointer<NativeTiledImage> source, Pointer<NativeTiledImage> destination,
+      Pointer<Float> adjustments, int adjustmentCount, Pointer<Uint8> rgbLut, Pointer<Uint8> redLut,
+      Pointer<Uint8> greenLut, Pointer<Uint8> blueLut, int threadCount) {
+    return _cpu_process_tiled(source, destination, adjustments, adjustmentCount,
+        rgbLut, redLut, greenLut, blueLut, threadCount);
+  }
+  
+  int cpuGetCapabilities(Pointer<Uint32> paramsVersion) {
+    return _cpu_get_capabilities(paramsVersion);
+  }
+  
+  int cpuProcessImageParams(Pointer<Uint8> input, int width, int height, Pointer<AdjustmentParams> params,
+      Pointer<Uint8> rgbLut, Pointer<Uint8> redLut, Pointer<Uint8> greenLut, Pointer<Uint8> blueLut,
+      Pointer<Pointer<Uint8>> output, Pointer<Int32> outputWidth, Pointer<Int32> outputHeight) {
+    return _cpu_process_image_params(input, width, height, params,
+        rgbLut, redLut, greenLut, blueLut, output, outputWidth, outputHeight);
+  }
+  
+  int cpuProcessTiledParams(Pointer<NativeTiledImage> source, Pointer<NativeTiledImage> destination,
+      Pointer<AdjustmentParams> params, Pointer<Uint8> rgbLut, Pointer<Uint8> redLut,
+      Pointer<Uint8> greenLut, Pointer<Uint8> blueLut, int threadCount) {
+    return _cpu_process_tiled_params(source, destination, params,
+        rgbLut, redLut, greenLut, blueLut, threadCount);
+  }
+  
+  void cpuFreeBuffer(Pointer<Uint8> buffer) {
+    _cpu_free_buffer(buffer);
+  }
+}
@@ -0,0 +1,370 @@
+#include "export_plan.h"
+#include "../common/job_scheduler.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define MAX_LEVELS 16
+#define LANCZOS_LOBES 3
+
+typedef struct {
+    uint8_t* owned;             // NULL for views of the input
+    const uint8_t* pixels;
+    int width;
+    int height;
+    int stride;
+    float extent_x;             // Input pixels covered, in pixels of this plane:
+    float extent_y;             // odd sizes leave the last one partly outside
+} Plane;
+
+// ---------------------------------------------------------------------------
+// Row-parallel passes
+
+typedef void (*RowFunction)(void* context, int row);
+
+typedef struct {
+    RowFunction function;
+    void* context;
+    int next_row;
+    int row_count;
+    pthread_mutex_t mutex;
+} RowPass;
+
+static void* row_worker(void* arg) {
+    RowPass* pass = (RowPass*)arg;
+    while (1) {
+        pthread_mutex_lock(&pass->mutex);
+        int row = pass->next_row++;
+        pthread_mutex_unlock(&pass->mutex);
+        if (row >= pass->row_count) break;
+        pass->function(pass->context, row);
+    }
+    return NULL;
+}
+
+static void run_rows(int row_count, RowFunction function, void* context, int thread_count) {
+    RowPass pass = {
+        .function = function,
+        .context = context,
+        .next_row = 0,
+        .row_count = row_count
+    };
+    pthread_mutex_init(&pass.mutex, NULL);
+
+    if (thread_count > row_count) thread_count = row_count;
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, row_worker, &pass) != 0) break;
+            started++;
+        }
+    }
+    row_worker(&pass);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&pass.mutex);
+}
+
+static int plane_alloc(Plane* plane, int width, int height) {
+    plane->stride = width * 4;
+    plane->owned = malloc((size_t)plane->stride * height);
+    plane->pixels = plane->owned;
+    plane->width = width;
+    plane->height = height;
+    plane->extent_x = (float)width;
+    plane->extent_y = (float)height;
+    return plane->owned != NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Pyramid: 2x2 box halving, replicating the last row and column of odd sizes
+
+typedef struct {
+    const Plane* src;
+    Plane* dst;
+} HalveJob;
+
+static void halve_row(void* context, int y) {
+    HalveJob* job = (HalveJob*)context;
+    const Plane* src = job->src;
+    int y0 = y * 2;
+    int y1 = y0 + 1 < src->height ? y0 + 1 : y0;
+    const uint8_t* row0 = src->pixels + (size_t)y0 * src->stride;
+    const uint8_t* row1 = src->pixels + (size_t)y1 * src->stride;
+    uint8_t* out = job->dst->owned + (size_t)y * job->dst->stride;
+
+    for (int x = 0; x < job->dst->width; x++) {
+        int x0 = x * 2 * 4;
+        int x1 = x * 2 + 1 < src->width ? x0 + 4 : x0;
+        for (int c = 0; c < 4; c++) {
+            out[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+static int halve(const Plane* src, Plane* dst, int thread_count) {
+    if (!plane_alloc(dst, (src->width + 1) / 2, (src->height + 1) / 2)) return 0;
+    dst->extent_x = src->extent_x * 0.5f;
+    dst->extent_y = src->extent_y * 0.5f;
+    HalveJob job = { src, dst };
+    run_rows(dst->height, halve_row, &job, thread_count);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Lanczos-3 resampling, separable, vertical then horizontal per output row
+
+typedef struct {
+    int taps;
+    int* index;                 // Source sample of each tap, clamped to the edges
+    float* weights;
+} FilterAxis;
+
+static float lanczos(float x) {
+    if (x == 0.0f) return 1.0f;
+    if (x <= -LANCZOS_LOBES || x >= LANCZOS_LOBES) return 0.0f;
+    float pi_x = (float)M_PI * x;
+    return LANCZOS_LOBES * sinf(pi_x) * sinf(pi_x / LANCZOS_LOBES) / (pi_x * pi_x);
+}
+
+static int build_axis(int src, float extent, int dst, FilterAxis* axis) {
+    // Downscaling only: the kernel is stretched by the ratio
+    float ratio = extent / (float)dst;
+    float support = LANCZOS_LOBES * ratio;
+    axis->taps = (int)ceilf(support * 2.0f) + 2;
+    axis->index = malloc(sizeof(int) * dst * axis->taps);
+    axis->weights = malloc(sizeof(float) * dst * axis->taps);
+    if (!axis->index || !axis->weights) return 0;
+
+    for (int i = 0; i < dst; i++) {
+        float center = ((float)i + 0.5f) * ratio;
+        int first = (int)floorf(center - support);
+        int* index = axis->index + (size_t)i * axis->taps;
+        float* weights = axis->weights + (size_t)i * axis->taps;
+
+        float sum = 0.0f;
+        for (int k = 0; k < axis->taps; k++) {
+            int j = first + k;
+            weights[k] = lanczos(((float)j + 0.5f - center) / ratio);
+            index[k] = j < 0 ? 0 : (j >= src ? src - 1 : j);
+            sum += weights[k];
+        }
+        for (int k = 0; k < axis->taps; k++) weights[k] /= sum;
+    }
+    return 1;
+}
+
+static void free_axis(FilterAxis* axis) {
+    free(axis->index);
+    free(axis->weights);
+}
+
+typedef struct {
+    const Plane* src;
+    Plane* dst;
+    FilterAxis horizontal;
+    FilterAxis vertical;
+} ResizeJob;
+
+static void resize_row(void* context, int y) {
+    ResizeJob* job = (ResizeJob*)context;
+    const Plane* src = job->src;
+    float* column = malloc(sizeof(float) * src->width * 4);
+    if (!column) return;
+
+    const int* rows = job->vertical.index + (size_t)y * job->vertical.taps;
+    const float* row_weights = job->vertical.weights + (size_t)y * job->vertical.taps;
+    memset(column, 0, sizeof(float) * src->width * 4);
+    for (int k = 0; k < job->vertical.taps; k++) {
+        float weight = row_weights[k];
+        if (weight == 0.0f) continue;
+        const uint8_t* in = src->pixels + (size_t)rows[k] * src->stride;
+        for (int i = 0; i < src->width * 4; i++) column[i] += weight * in[i];
+    }
+
+    uint8_t* out = job->dst->owned + (size_t)y * job->dst->stride;
+    for (int x = 0; x < job->dst->width; x++) {
+        const int* cols = job->horizontal.index + (size_t)x * job->horizontal.taps;
+        const float* col_weights = job->horizontal.weights + (size_t)x * job->horizontal.taps;
+        float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < job->horizontal.taps; k++) {
+            const float* p = column + cols[k] * 4;
+            for (int c = 0; c < 4; c++) sum[c] += col_weights[k] * p[c];
+        }
+        // Lanczos lobes overshoot at edges
+        for (int c = 0; c < 4; c++) {
+            float v = sum[c] + 0.5f;
+            out[x * 4 + c] = (uint8_t)(v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v));
+        }
+    }
+    free(column);
+}
+
+static int resize(const Plane* src, Plane* dst, int width, int height, int thread_count) {
+    ResizeJob job = { .src = src, .dst = dst };
+    int ok = build_axis(src->width, src->extent_x, width, &job.horizontal) &&
+             build_axis(src->height, src->extent_y, height, &job.vertical) &&
+             plane_alloc(dst, width, height);
+    if (ok) run_rows(height, resize_row, &job, thread_count);
+    free_axis(&job.horizontal);
+    free_axis(&job.vertical);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Encoding
+
+typedef struct {
+    ExportTarget* target;
+    const Plane* plane;
+    int thread_count;
+} EncodeJob;
+
+static void* encode_worker(void* arg) {
+    EncodeJob* job = (EncodeJob*)arg;
+    ExportTarget* target = job->target;
+    const Plane* plane = job->plane;
+
+    EncodedImage encoded = image_encode_rgba(target->format, plane->pixels, plane->width,
+                                             plane->height, plane->stride, target->quality,
+                                             target->preset, job->thread_count);
+    if (!encoded.data) return NULL;
+
+    FILE* file = fopen(target->path, "wb");
+    if (!file) {
+        fprintf(stderr, "export_plan: cannot open %s\n", target->path);
+    } else {
+        int ok = fwrite(encoded.data, 1, encoded.size, file) == encoded.size;
+        ok = fclose(file) == 0 && ok;
+        if (ok) {
+            target->written = 1;
+        } else {
+            fprintf(stderr, "export_plan: failed to write %s\n", target->path);
+            remove(target->path);
+        }
+    }
+    image_encoder_free(encoded);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+
+int export_plan_run(
+    const uint8_t* rgba,
+    int width,
+    int height,
+    int stride,
+    ExportTarget* targets,
+    int target_count,
+    int thread_count
+) {
+    if (!rgba || width <= 0 || height <= 0 || stride < width * 4 || !targets || target_count <= 0) {
+        return 0;
+    }
+    if (thread_count <= 0) thread_count = job_scheduler_limit(JOB_CLASS_BATCH);
+
+    Plane levels[MAX_LEVELS];
+    int level_count = 1;
+    levels[0] = (Plane){ NULL, rgba, width, height, stride, (float)width, (float)height };
+
+    Plane* outputs = calloc(target_count, sizeof(Plane));
+    const Plane** planes = calloc(target_count, sizeof(Plane*));
+    EncodeJob* jobs = calloc(target_count, sizeof(EncodeJob));
+    pthread_t* threads = calloc(target_count, sizeof(pthread_t));
+    int* started = calloc(target_count, sizeof(int));
+    if (!outputs || !planes || !jobs || !threads || !started) {
+        fprintf(stderr, "export_plan: out of memory\n");
+        free(outputs);
+        free(planes);
+        free(jobs);
+        free(threads);
+        free(started);
+        return 0;
+    }
+
+    // Resize everything first; the pyramid is shared between targets
+    job_begin(JOB_CLASS_BATCH);
+    int long_edge = width > height ? width : height;
+    for (int t = 0; t < target_count; t++) {
+        ExportTarget* target = &targets[t];
+        target->written = 0;
+        if (!target->path) continue;
+
+        int size = target->max_dimension;
+        if (size <= 0 || size >= long_edge) {
+            planes[t] = &levels[0];
+            continue;
+        }
+        int out_w = (int)lround((double)width * size / long_edge);
+        int out_h = (int)lround((double)height * size / long_edge);
+        if (out_w < 1) out_w = 1;
+        if (out_h < 1) out_h = 1;
+
+        // Targets of the same size share one output
+        for (int other = 0; other < t && !planes[t]; other++) {
+            if (planes[other] && planes[other]->width == out_w && planes[other]->height == out_h) {
+                planes[t] = planes[other];
+            }
+        }
+        if (planes[t]) continue;
+
+        // Halve while the next level still covers the output
+        int level = 0;
+        while (1) {
+            int next_w = (levels[level].width + 1) / 2;
+            int next_h = (levels[level].height + 1) / 2;
+            if (next_w < out_w || next_h < out_h) break;
+            if (level + 1 == level_count) {
+                if (level_count == MAX_LEVELS || !halve(&levels[level], &levels[level_count], thread_count)) break;
+                level_count++;
+            }
+            level++;
+        }
+
+        const Plane* source = &levels[level];
+        if (source->width == out_w && source->height == out_h) {
+            planes[t] = source;
+        } else if (resize(source, &outputs[t], out_w, out_h, thread_count)) {
+            planes[t] = &outputs[t];
+        } else {
+            fprintf(stderr, "export_plan: out of memory resizing to %dx%d\n", out_w, out_h);
+        }
+    }
+    job_end(JOB_CLASS_BATCH);
+
+    // Encoders take their own scheduler slots; split the threads between them
+    int jobs_to_run = 0;
+    for (int t = 0; t < target_count; t++) {
+        if (planes[t]) jobs_to_run++;
+    }
+    int threads_per_job = jobs_to_run > 0 ? thread_count / jobs_to_run : 1;
+    if (threads_per_job < 1) threads_per_job = 1;
+
+    for (int t = 0; t < target_count; t++) {
+        if (!planes[t]) continue;
+        jobs[t] = (EncodeJob){ &targets[t], planes[t], threads_per_job };
+        started[t] = pthread_create(&threads[t], NULL, encode_worker, &jobs[t]) == 0;
+        if (!started[t]) encode_worker(&jobs[t]);
+    }
+
+    int written = 0;
+    for (int t = 0; t < target_count; t++) {
+        if (started[t]) pthread_join(threads[t], NULL);
+        written += targets[t].written;
+    }
+
+    for (int t = 0; t < target_count; t++) free(outputs[t].owned);
+    for (int l = 1; l < level_count; l++) free(levels[l].owned);
+    free(outputs);
+    free(planes);
+    free(jobs);
+    free(threads);
+    free(started);
+    return written;
+}
@@ -0,0 +1,43 @@
+#ifndef EXPORT_PLAN_H
+#define EXPORT_PLAN_H
+
+#include <stdint.h>
+#include "image_encoder.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Several outputs from one render. Downscaled outputs come from a resize
+// pyramid: the image is halved with a box filter until the next halving
+// would undershoot, and each output is resampled with Lanczos-3 from the
+// smallest level that is still large enough. All outputs are then encoded
+// in parallel and written to disk.
+
+typedef struct {
+    int32_t max_dimension;      // Long edge in pixels; <= 0 or larger than the image keeps full size
+    int32_t format;             // IMAGE_FORMAT_*
+    int32_t quality;            // 1-100
+    int32_t preset;             // IMAGE_PRESET_*
+    const char* path;
+    int32_t written;            // Out: 1 if the file was written
+} ExportTarget;
+
+// Run every target against 8-bit sRGB RGBA pixels. thread_count <= 0 uses
+// the scheduler's batch limit, shared between the encoders. Returns the
+// number of files written.
+int export_plan_run(
+    const uint8_t* rgba,
+    int width,
+    int height,
+    int stride,
+    ExportTarget* targets,
+    int target_count,
+    int thread_count
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EXPORT_PLAN_H
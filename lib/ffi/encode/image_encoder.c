@@ -0,0 +1,369 @@
+#include "image_encoder.h"
+#include "../common/job_scheduler.h"
+#include "../common/mem_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <turbojpeg.h>
+
+#ifdef AKS_HAVE_JXL
+#include <jxl/encode.h>
+#include <jxl/thread_parallel_runner.h>
+#endif
+#ifdef AKS_HAVE_AVIF
+#include <avif/avif.h>
+#endif
+#ifdef AKS_HAVE_WEBP
+#include <webp/encode.h>
+#endif
+
+// The encoders' own threads can't be preempted, so size them to what the
+// scheduler allows background work
+static int resolve_threads(int thread_count) {
+    if (thread_count > 0) return thread_count;
+    return job_scheduler_limit(JOB_CLASS_BATCH);
+}
+
+static int clamp_preset(int preset) {
+    if (preset < IMAGE_PRESET_FAST) return IMAGE_PRESET_FAST;
+    if (preset > IMAGE_PRESET_SMALLEST) return IMAGE_PRESET_SMALLEST;
+    return preset;
+}
+
+// ---------------------------------------------------------------------------
+// JPEG XL
+
+#ifdef AKS_HAVE_JXL
+// Effort 1-9; 7 is libjxl's default
+static const int jxl_effort[] = { 3, 7, 9 };
+
+static EncodedImage encode_jxl(const uint8_t* rgba, int width, int height, int stride,
+                               int quality, int preset, int threads) {
+    EncodedImage result = { NULL, 0 };
+
+    // libjxl wants tightly packed pixels; drop alpha on the way
+    size_t rgb_stride = (size_t)width * 3;
+    uint8_t* rgb = malloc(rgb_stride * height);
+    if (!rgb) return result;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = rgba + (size_t)y * stride;
+        uint8_t* dst = rgb + (size_t)y * rgb_stride;
+        for (int x = 0; x < width; x++) {
+            dst[x * 3] = src[x * 4];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4 + 2];
+        }
+    }
+
+    JxlEncoder* encoder = JxlEncoderCreate(NULL);
+    void* runner = JxlThreadParallelRunnerCreate(NULL, (size_t)threads);
+    if (!encoder || !runner ||
+        JxlEncoderSetParallelRunner(encoder, JxlThreadParallelRunner, runner) != JXL_ENC_SUCCESS) {
+        fprintf(stderr, "image_encoder: failed to create JPEG XL encoder\n");
+        goto done;
+    }
+
+    JxlBasicInfo info;
+    JxlEncoderInitBasicInfo(&info);
+    info.xsize = (uint32_t)width;
+    info.ysize = (uint32_t)height;
+    info.bits_per_sample = 8;
+    info.num_color_channels = 3;
+    info.uses_original_profile = quality >= 100 ? JXL_TRUE : JXL_FALSE;
+    if (JxlEncoderSetBasicInfo(encoder, &info) != JXL_ENC_SUCCESS) goto failed;
+
+    JxlColorEncoding color;
+    JxlColorEncodingSetToSRGB(&color, JXL_FALSE);
+    if (JxlEncoderSetColorEncoding(encoder, &color) != JXL_ENC_SUCCESS) goto failed;
+
+    JxlEncoderFrameSettings* settings = JxlEncoderFrameSettingsCreate(encoder, NULL);
+    JxlEncoderFrameSettingsSetOption(settings, JXL_ENC_FRAME_SETTING_EFFORT, jxl_effort[preset]);
+    if (quality >= 100) {
+        JxlEncoderSetFrameLossless(settings, JXL_TRUE);
+    } else {
+        JxlEncoderSetFrameDistance(settings, JxlEncoderDistanceFromQuality((float)quality));
+    }
+
+    JxlPixelFormat format = { 3, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 };
+    if (JxlEncoderAddImageFrame(settings, &format, rgb, rgb_stride * height) != JXL_ENC_SUCCESS) {
+        goto failed;
+    }
+    JxlEncoderCloseInput(encoder);
+
+    // Grow the output until the encoder is done
+    size_t capacity = 1 << 20;
+    uint8_t* output = malloc(capacity);
+    uint8_t* next = output;
+    size_t available = capacity;
+    JxlEncoderStatus status = JXL_ENC_NEED_MORE_OUTPUT;
+    while (output && status == JXL_ENC_NEED_MORE_OUTPUT) {
+        status = JxlEncoderProcessOutput(encoder, &next, &available);
+        if (status == JXL_ENC_NEED_MORE_OUTPUT) {
+            size_t used = (size_t)(next - output);
+            uint8_t* grown = realloc(output, capacity * 2);
+            if (!grown) {
+                free(output);
+                output = NULL;
+                break;
+            }
+            output = grown;
+            capacity *= 2;
+            next = output + used;
+            available = capacity - used;
+        }
+    }
+    if (output && status == JXL_ENC_SUCCESS) {
+        result.data = output;
+        result.size = (size_t)(next - output);
+        goto done;
+    }
+    free(output);
+
+failed:
+    fprintf(stderr, "image_encoder: JPEG XL encoding failed\n");
+done:
+    if (runner) JxlThreadParallelRunnerDestroy(runner);
+    if (encoder) JxlEncoderDestroy(encoder);
+    free(rgb);
+    return result;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// AVIF
+
+#ifdef AKS_HAVE_AVIF
+// Speed 0-10, slowest to fastest
+static const int avif_speed[] = { 9, 6, 3 };
+
+static int floor_log2(int value) {
+    int log = 0;
+    while (value > 1) {
+        value >>= 1;
+        log++;
+    }
+    return log;
+}
+
+static EncodedImage encode_avif(const uint8_t* rgba, int width, int height, int stride,
+                                int quality, int preset, int threads) {
+    EncodedImage result = { NULL, 0 };
+
+    avifPixelFormat yuv = quality >= 90 ? AVIF_PIXEL_FORMAT_YUV444 : AVIF_PIXEL_FORMAT_YUV420;
+    avifImage* image = avifImageCreate((uint32_t)width, (uint32_t)height, 8, yuv);
+    avifEncoder* encoder = avifEncoderCreate();
+    avifRWData output = AVIF_DATA_EMPTY;
+    if (!image || !encoder) goto done;
+
+    avifRGBImage rgb;
+    avifRGBImageSetDefaults(&rgb, image);
+    rgb.format = AVIF_RGB_FORMAT_RGBA;
+    rgb.ignoreAlpha = AVIF_TRUE;
+    rgb.pixels = (uint8_t*)rgba;
+    rgb.rowBytes = (uint32_t)stride;
+    rgb.maxThreads = threads;
+
+    avifResult status = avifImageRGBToYUV(image, &rgb);
+    if (status != AVIF_RESULT_OK) {
+        fprintf(stderr, "image_encoder: AVIF conversion failed: %s\n", avifResultToString(status));
+        goto done;
+    }
+
+    encoder->maxThreads = threads;
+    encoder->speed = avif_speed[preset];
+    encoder->quality = quality;
+
+    // AV1 encoders only run as many threads as there are tiles. Split into
+    // one tile per thread, at least 512 pixels on a side.
+    int tiles_log2 = floor_log2(threads);
+    int cols_log2 = (tiles_log2 + 1) / 2;
+    int rows_log2 = tiles_log2 / 2;
+    while (cols_log2 > 0 && (width >> cols_log2) < 512) cols_log2--;
+    while (rows_log2 > 0 && (height >> rows_log2) < 512) rows_log2--;
+    encoder->tileColsLog2 = cols_log2 < 6 ? cols_log2 : 6;
+    encoder->tileRowsLog2 = rows_log2 < 6 ? rows_log2 : 6;
+
+    status = avifEncoderWrite(encoder, image, &output);
+    if (status != AVIF_RESULT_OK) {
+        fprintf(stderr, "image_encoder: AVIF encoding failed: %s\n", avifResultToString(status));
+        goto done;
+    }
+
+    // Hand out a malloc'd copy so every format is freed the same way
+    result.data = malloc(output.size);
+    if (result.data) {
+        memcpy(result.data, output.data, output.size);
+        result.size = output.size;
+    }
+
+done:
+    avifRWDataFree(&output);
+    if (encoder) avifEncoderDestroy(encoder);
+    if (image) avifImageDestroy(image);
+    return result;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// WebP
+
+#ifdef AKS_HAVE_WEBP
+// Method 0-6 and lossless level 0-9, fastest to smallest
+static const int webp_method[] = { 2, 4, 6 };
+static const int webp_lossless_level[] = { 1, 6, 9 };
+
+static EncodedImage encode_webp(const uint8_t* rgba, int width, int height, int stride,
+                                int quality, int preset) {
+    EncodedImage result = { NULL, 0 };
+
+    if (width > WEBP_MAX_DIMENSION || height > WEBP_MAX_DIMENSION) {
+        fprintf(stderr, "image_encoder: %dx%d is too large for WebP\n", width, height);
+        return result;
+    }
+
+    WebPConfig config;
+    if (!WebPConfigPreset(&config, WEBP_PRESET_PHOTO, (float)quality)) return result;
+    if (quality >= 100) {
+        WebPConfigLosslessPreset(&config, webp_lossless_level[preset]);
+    } else {
+        config.method = webp_method[preset];
+    }
+    // libwebp splits analysis and encoding across its own threads
+    config.thread_level = 1;
+    if (!WebPValidateConfig(&config)) return result;
+
+    WebPPicture picture;
+    if (!WebPPictureInit(&picture)) return result;
+    picture.width = width;
+    picture.height = height;
+    picture.use_argb = config.lossless;
+    if (!WebPPictureImportRGBX(&picture, rgba, stride)) {
+        WebPPictureFree(&picture);
+        return result;
+    }
+
+    WebPMemoryWriter writer;
+    WebPMemoryWriterInit(&writer);
+    picture.writer = WebPMemoryWrite;
+    picture.custom_ptr = &writer;
+
+    if (WebPEncode(&config, &picture)) {
+        result.data = malloc(writer.size);
+        if (result.data) {
+            memcpy(result.data, writer.mem, writer.size);
+            result.size = writer.size;
+        }
+    } else {
+        fprintf(stderr, "image_encoder: WebP encoding failed (%d)\n", picture.error_code);
+    }
+
+    WebPMemoryWriterClear(&writer);
+    WebPPictureFree(&picture);
+    return result;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// JPEG
+
+// Fast DCT, accurate DCT, progressive (smaller at the same quality)
+static const int jpeg_flags[] = { TJFLAG_FASTDCT, TJFLAG_ACCURATEDCT, TJFLAG_ACCURATEDCT | TJFLAG_PROGRESSIVE };
+
+static EncodedImage encode_jpeg(const uint8_t* rgba, int width, int height, int stride,
+                                int quality, int preset) {
+    EncodedImage result = { NULL, 0 };
+
+    tjhandle handle = tjInitCompress();
+    if (!handle) return result;
+
+    // Let turbojpeg allocate; copied below so every format is freed the same way
+    unsigned char* jpeg = NULL;
+    unsigned long jpeg_size = 0;
+    if (tjCompress2(handle, rgba, width, stride, height, TJPF_RGBA, &jpeg, &jpeg_size,
+                    TJSAMP_420, quality, jpeg_flags[preset]) == 0) {
+        result.data = malloc(jpeg_size);
+        if (result.data) {
+            memcpy(result.data, jpeg, jpeg_size);
+            result.size = jpeg_size;
+        }
+    } else {
+        fprintf(stderr, "image_encoder: JPEG encoding failed: %s\n", tjGetErrorStr2(handle));
+    }
+
+    tjFree(jpeg);
+    tjDestroy(handle);
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+
+EncodedImage image_encode_rgba(
+    int format,
+    const uint8_t* rgba,
+    int width,
+    int height,
+    int stride,
+    int quality,
+    int preset,
+    int thread_count
+) {
+    EncodedImage result = { NULL, 0 };
+    if (!rgba || width <= 0 || height <= 0 || stride < width * 4) return result;
+
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    preset = clamp_preset(preset);
+    int threads = resolve_threads(thread_count);
+    (void)threads;
+
+    job_begin(JOB_CLASS_BATCH);
+    switch (format) {
+#ifdef AKS_HAVE_JXL
+        case IMAGE_FORMAT_JXL:
+            result = encode_jxl(rgba, width, height, stride, quality, preset, threads);
+            break;
+#endif
+#ifdef AKS_HAVE_AVIF
+        case IMAGE_FORMAT_AVIF:
+            result = encode_avif(rgba, width, height, stride, quality, preset, threads);
+            break;
+#endif
+#ifdef AKS_HAVE_WEBP
+        case IMAGE_FORMAT_WEBP:
+            result = encode_webp(rgba, width, height, stride, quality, preset);
+            break;
+#endif
+        case IMAGE_FORMAT_JPEG:
+            result = encode_jpeg(rgba, width, height, stride, quality, preset);
+            break;
+        default:
+            fprintf(stderr, "image_encoder: format %d is not available\n", format);
+            break;
+    }
+    job_end(JOB_CLASS_BATCH);
+    if (result.data) mem_stats_add(MEM_ENCODER, (int64_t)result.size);
+    return result;
+}
+
+void image_encoder_free(EncodedImage image) {
+    if (!image.data) return;
+    mem_stats_add(MEM_ENCODER, -(int64_t)image.size);
+    free(image.data);
+}
+
+int image_encoder_supported(int format) {
+    switch (format) {
+#ifdef AKS_HAVE_JXL
+        case IMAGE_FORMAT_JXL: return 1;
+#endif
+#ifdef AKS_HAVE_AVIF
+        case IMAGE_FORMAT_AVIF: return 1;
+#endif
+#ifdef AKS_HAVE_WEBP
+        case IMAGE_FORMAT_WEBP: return 1;
+#endif
+        case IMAGE_FORMAT_JPEG: return 1;
+        default: return 0;
+    }
+}
@@ -0,0 +1,204 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
+import 'package:ffi/ffi.dart';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'image_encoder_bindings.dart';
+
+/// Formats handled by the native encoder library, in the native id order
+enum ImageCodec {
+  jxl,
+  avif,
+  webp,
+  jpeg,
+}
+
+/// Speed/size trade-off passed to the encoder
+enum EncodePreset {
+  fast,
+  balanced,
+  smallest,
+}
+
+/// One file of a multi-output export
+class ExportTarget {
+  /// Long edge in pixels; null keeps the full size
+  final int? maxDimension;
+  final ImageCodec codec;
+  final int quality;
+  final EncodePreset preset;
+  final String path;
+
+  const ExportTarget({
+    this.maxDimension,
+    required this.codec,
+    this.quality = 90,
+    this.preset = EncodePreset.balanced,
+    required this.path,
+  });
+}
+
+/// JPEG XL, AVIF and WebP encoding through libjxl, libavif and libwebp
+class ImageEncoder extends FfiBase {
+  static DynamicLibrary? _library;
+  static ImageEncoderBindings? _bindings;
+
+  /// Initialize the encoder library
+  static void initialize() {
+    if (_bindings != null) return;
+
+    _library = FfiBase.loadLibrary(
+      'image_encoder',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+
+    _bindings = ImageEncoderBindings(_library!);
+  }
+
+  /// Whether the library is present and was built with this codec
+  static bool isSupported(ImageCodec codec) {
+    try {
+      initialize();
+      return _bindings!.imageEncoderSupported(codec.index) != 0;
+    } catch (e) {
+      return false;
+    }
+  }
+
+  /// Encode an image. The encoders run on their own worker threads, inside
+  /// a short-lived isolate so the UI keeps drawing meanwhile.
+  static Future<Uint8List> encodeImage({
+    required ui.Image image,
+    required ImageCodec codec,
+    int quality = 90,
+    EncodePreset preset = EncodePreset.balanced,
+  }) async {
+    final byteData = await image.toByteData(
+      format: ui.ImageByteFormat.rawRgba,
+    );
+
+    if (byteData == null) {
+      throw Exception('Failed to convert image to byte data');
+    }
+
+    final rgbaData = byteData.buffer.asUint8List();
+    final rgbaPointer = malloc<Uint8>(rgbaData.length);
+    rgbaPointer.asTypedList(rgbaData.length).setAll(0, rgbaData);
+
+    final address = rgbaPointer.address;
+    final width = image.width;
+    final height = image.height;
+    try {
+      return await Isolate.run(() => _encode(
+            codec.index,
+            address,
+            width,
+            height,
+            quality,
+            preset.index,
+          ));
+    } finally {
+      malloc.free(rgbaPointer);
+    }
+  }
+
+  static Uint8List _encode(int format, int address, int width, int height,
+      int quality, int preset) {
+    initialize();
+
+    final encoded = _bindings!.imageEncodeRgba(
+      format,
+      Pointer<Uint8>.fromAddress(address),
+      width,
+      height,
+      width * 4,
+      quality,
+      preset,
+      0,  // All cores
+    );
+
+    if (encoded.data == nullptr) {
+      throw Exception('Failed to encode ${ImageCodec.values[format].name}');
+    }
+
+    try {
+      return Uint8List.fromList(encoded.data.asTypedList(encoded.size));
+    } finally {
+      _bindings!.imageEncoderFree(encoded);
+    }
+  }
+
+  /// Write several sizes and formats of one image. Downscaled outputs come
+  /// from a shared resize pyramid and all outputs are encoded in parallel.
+  /// Returns whether each target was written.
+  static Future<List<bool>> exportAll({
+    required ui.Image image,
+    required List<ExportTarget> targets,
+  }) async {
+    if (targets.isEmpty) return const [];
+
+    final byteData = await image.toByteData(
+      format: ui.ImageByteFormat.rawRgba,
+    );
+
+    if (byteData == null) {
+      throw Exception('Failed to convert image to byte data');
+    }
+
+    final rgbaData = byteData.buffer.asUint8List();
+    final rgbaPointer = malloc<Uint8>(rgbaData.length);
+    rgbaPointer.asTypedList(rgbaData.length).setAll(0, rgbaData);
+
+    final address = rgbaPointer.address;
+    final width = image.width;
+    final height = image.height;
+    try {
+      return await Isolate.run(() => _exportAll(address, width, height, targets));
+    } finally {
+      malloc.free(rgbaPointer);
+    }
+  }
+
+  static List<bool> _exportAll(int address, int width, int height,
+      List<ExportTarget> targets) {
+    initialize();
+
+    final native = calloc<NativeExportTarget>(targets.length);
+    try {
+      for (int i = 0; i < targets.length; i++) {
+        final target = targets[i];
+        native[i]
+          ..maxDimension = target.maxDimension ?? 0
+          ..format = target.codec.index
+          ..quality = target.quality
+          ..preset = target.preset.index
+          ..path = target.path.toNativeUtf8();
+      }
+
+      _bindings!.exportPlanRun(
+        Pointer<Uint8>.fromAddress(address),
+        width,
+        height,
+        width * 4,
+        native,
+        targets.length,
+        0,  // All cores
+      );
+
+      return [for (int i = 0; i < targets.length; i++) native[i].written != 0];
+    } finally {
+      for (int i = 0; i < targets.length; i++) {
+        malloc.free(native[i].path);
+      }
+      calloc.free(native);
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Export encoders for the modern formats: JPEG XL (libjxl), AVIF (libavif)
+// and WebP (libwebp). Each one runs on the library's own worker threads.
+// Baseline JPEG (libjpeg-turbo) is always available, so multi-output
+// exports can go through one entry point.
+
+#define IMAGE_FORMAT_JXL 0
+#define IMAGE_FORMAT_AVIF 1
+#define IMAGE_FORMAT_WEBP 2
+#define IMAGE_FORMAT_JPEG 3
+
+// Speed/size trade-off, mapped to each encoder's effort setting
+#define IMAGE_PRESET_FAST 0
+#define IMAGE_PRESET_BALANCED 1
+#define IMAGE_PRESET_SMALLEST 2
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} EncodedImage;
+
+// Encode 8-bit sRGB RGBA pixels (alpha is ignored). quality is 1-100; 100
+// is lossless for JPEG XL and WebP. Runs as batch work; thread_count <= 0
+// uses the scheduler's batch limit. Returns an empty image on failure; free
+// the result with image_encoder_free.
+EncodedImage image_encode_rgba(
+    int format,
+    const uint8_t* rgba,
+    int width,
+    int height,
+    int stride,
+    int quality,
+    int preset,
+    int thread_count
+);
+
+void image_encoder_free(EncodedImage image);
+
+// Whether the library was built with an encoder for format
+int image_encoder_supported(int format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_ENCODER_H
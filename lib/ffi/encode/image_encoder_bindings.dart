@@ -0,0 +1,64 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+// Image encoder FFI bindings
+base class EncodedImage extends Struct {
+  external Pointer<Uint8> data;
+  @Size()
+  external int size;
+}
+
+// One output of export_plan_run
+base class NativeExportTarget extends Struct {
+  @Int32()
+  external int maxDimension;
+  @Int32()
+  external int format;
+  @Int32()
+  external int quality;
+  @Int32()
+  external int preset;
+  external Pointer<Utf8> path;
+  @Int32()
+  external int written;
+}
+
+class ImageEncoderBindings {
+  final DynamicLibrary _lib;
+
+  ImageEncoderBindings(this._lib);
+
+  late final _image_encode_rgba = _lib.lookupFunction<
+      EncodedImage Function(Int32, Pointer<Uint8>, Int32, Int32, Int32, Int32, Int32, Int32),
+      EncodedImage Function(int, Pointer<Uint8>, int, int, int, int, int, int)>('image_encode_rgba');
+
+  late final _image_encoder_free = _lib.lookupFunction<
+      Void Function(EncodedImage),
+      void Function(EncodedImage)>('image_encoder_free');
+
+  late final _image_encoder_supported = _lib.lookupFunction<
+      Int32 Function(Int32),
+      int Function(int)>('image_encoder_supported');
+
+  late final _export_plan_run = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Int32, Pointer<NativeExportTarget>, Int32, Int32),
+      int Function(Pointer<Uint8>, int, int, int, Pointer<NativeExportTarget>, int, int)>('export_plan_run');
+
+  EncodedImage imageEncodeRgba(int format, Pointer<Uint8> rgba, int width, int height,
+      int stride, int quality, int preset, int threadCount) {
+    return _image_encode_rgba(format, rgba, width, height, stride, quality, preset, threadCount);
+  }
+
+  void imageEncoderFree(EncodedImage image) {
+    _image_encoder_free(image);
+  }
+
+  int imageEncoderSupported(int format) {
+    return _image_encoder_supported(format);
+  }
+
+  int exportPlanRun(Pointer<Uint8> rgba, int width, int height, int stride,
+      Pointer<NativeExportTarget> targets, int targetCount, int threadCount) {
+    return _export_plan_run(rgba, width, height, stride, targets, targetCount, threadCount);
+  }
+}
@@ -2,7 +2,26 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
 #include "jpeg_binding.h"
+#include "../common/mem_stats.h"
+
+namespace {
+    // libjpeg calls exit() on errors by default; jump back out instead
+    struct JpegErrorManager {
+        jpeg_error_mgr base;
+        jmp_buf jump;
+    };
+    
+    void jpeg_error_exit(j_common_ptr cinfo) {
+        JpegErrorManager* manager = (JpegErrorManager*)cinfo->err;
+        char message[JMSG_LENGTH_MAX];
+        (*cinfo->err->format_message)(cinfo, message);
+        fprintf(stderr, "jpeg_write_tiled: %s\n", message);
+        longjmp(manager->jump, 1);
+    }
+}
 
 extern "C" {
     void* jpeg_compress_init(int width, int height, int quality) {
@@ -48,6 +67,7 @@ extern "C" {
         if (success == 0) {
             result.data = jpeg_buf;
             result.size = jpeg_size;
+            mem_stats_add(MEM_ENCODER, (int64_t)jpeg_size);
         } else {
             free(jpeg_buf);
         }
@@ -86,6 +106,7 @@ extern "C" {
         if (success == 0) {
             result.data = jpeg_buf;
             result.size = jpeg_size;
+            mem_stats_add(MEM_ENCODER, (int64_t)jpeg_size);
         } else {
             free(jpeg_buf);
         }
@@ -96,13 +117,147 @@ extern "C" {
     
     void jpeg_free_buffer(JpegBuffer buffer) {
         if (buffer.data) {
+            mem_stats_add(MEM_ENCODER, -(int64_t)buffer.size);
             free(buffer.data);
         }
     }
     
+    JpegBuffer jpeg_decompress_rgb(const uint8_t* jpeg_data, size_t jpeg_size,
+                                   int* width, int* height) {
+        JpegBuffer result = {NULL, 0};
+        if (!jpeg_data || !width || !height) return result;
+        
+        tjhandle jpeg_handle = tjInitDecompress();
+        if (!jpeg_handle) return result;
+        
+        int w, h, subsampling, colorspace;
+        if (tjDecompressHeader3(jpeg_handle, jpeg_data, jpeg_size,
+                                &w, &h, &subsampling, &colorspace) != 0) {
+            fprintf(stderr, "jpeg_decompress_rgb: %s\n", tjGetErrorStr2(jpeg_handle));
+            tjDestroy(jpeg_handle);
+            return result;
+        }
+        
+        size_t size = (size_t)w * h * 3;
+        unsigned char* pixels = (unsigned char*)malloc(size);
+        // Warnings such as a bad restart marker fail the decode too
+        if (pixels && tjDecompress2(jpeg_handle, jpeg_data, jpeg_size, pixels, w, 0, h,
+                                    TJPF_RGB, TJFLAG_ACCURATEDCT | TJFLAG_STOPONWARNING) == 0) {
+            result.data = pixels;
+            result.size = size;
+            *width = w;
+            *height = h;
+            mem_stats_add(MEM_ENCODER, (int64_t)size);
+        } else {
+            if (pixels) fprintf(stderr, "jpeg_decompress_rgb: %s\n", tjGetErrorStr2(jpeg_handle));
+            free(pixels);
+        }
+        
+        tjDestroy(jpeg_handle);
+        return result;
+    }
+    
     void jpeg_compress_cleanup(void* handle) {
         if (handle) {
             free(handle);
         }
     }
-}
\ No newline at end of file
+    
+    int jpeg_write_tiled(const char* path, TiledImage* image, int x, int y,
+                         int width, int height, int quality) {
+        if (!path || !image || width <= 0 || height <= 0 ||
+            x < 0 || y < 0 ||
+            x + width > tiled_image_width(image) ||
+            y + height > tiled_image_height(image)) {
+            return 0;
+        }
+        
+        int channels = tiled_image_channels(image);
+        if (channels != 3 && channels != 4) return 0;
+        
+        FILE* file = fopen(path, "wb");
+        if (!file) {
+            fprintf(stderr, "jpeg_write_tiled: cannot open %s\n", path);
+            return 0;
+        }
+        
+        // Only one band of tile rows is held in memory at a time
+        int band_rows = tiled_image_tile_size(image);
+        size_t row_stride = (size_t)width * channels;
+        uint8_t* volatile band = (uint8_t*)malloc(row_stride * band_rows);
+        if (!band) {
+            fclose(file);
+            return 0;
+        }
+        
+        jpeg_compress_struct cinfo;
+        JpegErrorManager error_manager;
+        cinfo.err = jpeg_std_error(&error_manager.base);
+        error_manager.base.error_exit = jpeg_error_exit;
+        
+        if (setjmp(error_manager.jump)) {
+            jpeg_destroy_compress(&cinfo);
+            free(band);
+            fclose(file);
+            remove(path);
+            return 0;
+        }
+        
+        jpeg_create_compress(&cinfo);
+        jpeg_stdio_dest(&cinfo, file);
+        
+        cinfo.image_width = width;
+        cinfo.image_height = height;
+        cinfo.input_components = channels;
+#ifdef JCS_EXTENSIONS
+        cinfo.in_color_space = channels == 4 ? JCS_EXT_RGBA : JCS_RGB;
+#else
+        cinfo.in_color_space = JCS_RGB;
+#endif
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, quality, TRUE);
+        cinfo.dct_method = JDCT_IFAST;
+        
+#ifndef JCS_EXTENSIONS
+        // Without libjpeg-turbo extensions alpha has to be stripped by hand
+        if (channels == 4) {
+            cinfo.input_components = 3;
+        }
+#endif
+        
+        jpeg_start_compress(&cinfo, TRUE);
+        
+        for (int band_y = 0; band_y < height; band_y += band_rows) {
+            int rows = band_y + band_rows <= height ? band_rows : height - band_y;
+            if (!tiled_image_read_region(image, x, y + band_y, width, rows, band, row_stride)) {
+                fprintf(stderr, "jpeg_write_tiled: %s\n", tiled_image_get_error());
+                jpeg_abort_compress(&cinfo);
+                jpeg_destroy_compress(&cinfo);
+                free(band);
+                fclose(file);
+                remove(path);
+                return 0;
+            }
+            
+            for (int r = 0; r < rows; r++) {
+                JSAMPROW row = band + (size_t)r * row_stride;
+#ifndef JCS_EXTENSIONS
+                if (channels == 4) {
+                    for (int px = 0; px < width; px++) {
+                        row[px * 3] = row[px * 4];
+                        row[px * 3 + 1] = row[px * 4 + 1];
+                        row[px * 3 + 2] = row[px * 4 + 2];
+                    }
+                }
+#endif
+                jpeg_write_scanlines(&cinfo, &row, 1);
+            }
+        }
+        
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+        free(band);
+        
+        return fclose(file) == 0 ? 1 : 0;
+    }
+}
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include "../tiles/tiled_image.h"
 
 typedef struct {
     uint8_t* data;
@@ -21,6 +22,16 @@ extern "C" {
     // Free JPEG buffer
     void jpeg_free_buffer(JpegBuffer buffer);
     
+    // Decode a JPEG to packed RGB and return its size in width and height.
+    // Any libjpeg warning counts as a failure. Free with jpeg_free_buffer.
+    JpegBuffer jpeg_decompress_rgb(const uint8_t* jpeg_data, size_t jpeg_size,
+                                   int* width, int* height);
+    
     // Cleanup compression handle
     void jpeg_compress_cleanup(void* handle);
+    
+    // Stream a region of an RGB or RGBA tiled image straight to a JPEG file,
+    // one band of tiles at a time. Returns 1 on success, 0 on failure.
+    int jpeg_write_tiled(const char* path, TiledImage* image, int x, int y,
+                         int width, int height, int quality);
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 import 'dart:ffi';
 import 'package:ffi/ffi.dart';
+import '../tiles/tiled_image_bindings.dart';
 
 // JPEG FFI bindings
 base class JpegBuffer extends Struct {
@@ -29,10 +30,28 @@ class JpegBindings {
       Void Function(JpegBuffer),
       void Function(JpegBuffer)>('jpeg_free_buffer');
   
+  late final _jpeg_decompress_rgb = _lib.lookupFunction<
+      JpegBuffer Function(Pointer<Uint8>, Size, Pointer<Int32>, Pointer<Int32>),
+      JpegBuffer Function(Pointer<Uint8>, int, Pointer<Int32>, Pointer<Int32>)>('jpeg_decompress_rgb');
+  
   late final _jpeg_compress_cleanup = _lib.lookupFunction<
       Void Function(Pointer<Void>),
       void Function(Pointer<Void>)>('jpeg_compress_cleanup');
   
+  late final _jpeg_write_tiled = _lib.lookupFunction<
+      Int32 Function(Pointer<Utf8>, Pointer<NativeTiledImage>, Int32, Int32, Int32, Int32, Int32),
+      int Function(Pointer<Utf8>, Pointer<NativeTiledImage>, int, int, int, int, int)>('jpeg_write_tiled');
+  
+  late final _jpeg_encode_target_size = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Int32, Size, Int32, Size, Int32, Int32, Int32,
+          Pointer<Pointer<Uint8>>, Pointer<Size>, Pointer<Int32>),
+      int Function(Pointer<Uint8>, int, int, int, int, int, int, int, int, int,
+          Pointer<Pointer<Uint8>>, Pointer<Size>, Pointer<Int32>)>('jpeg_encode_target_size');
+  
+  late final _jpeg_target_free = _lib.lookupFunction<
+      Void Function(Pointer<Uint8>),
+      void Function(Pointer<Uint8>)>('jpeg_target_free');
+  
   Pointer<Void> jpegCompressInit(int width, int height, int quality) {
     return _jpeg_compress_init(width, height, quality);
   }
@@ -45,7 +64,30 @@ class JpegBindings {
     _jpeg_free_buffer(buffer);
   }
   
+  JpegBuffer jpegDecompressRgb(Pointer<Uint8> jpegData, int jpegSize,
+      Pointer<Int32> width, Pointer<Int32> height) {
+    return _jpeg_decompress_rgb(jpegData, jpegSize, width, height);
+  }
+  
   void jpegCompressCleanup(Pointer<Void> handle) {
     _jpeg_compress_cleanup(handle);
   }
+  
+  int jpegWriteTiled(Pointer<Utf8> path, Pointer<NativeTiledImage> image,
+      int x, int y, int width, int height, int quality) {
+    return _jpeg_write_tiled(path, image, x, y, width, height, quality);
+  }
+  
+  int jpegEncodeTargetSize(Pointer<Uint8> pixels, int width, int height,
+      int channels, int stride, int subsampling, int maxBytes, int minQuality,
+      int maxQuality, int threadCount, Pointer<Pointer<Uint8>> jpegData,
+      Pointer<Size> jpegSize, Pointer<Int32> qualityUsed) {
+    return _jpeg_encode_target_size(pixels, width, height, channels, stride,
+        subsampling, maxBytes, minQuality, maxQuality, threadCount, jpegData,
+        jpegSize, qualityUsed);
+  }
+  
+  void jpegTargetFree(Pointer<Uint8> jpegData) {
+    _jpeg_target_free(jpegData);
+  }
 }
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "jpeg_entropy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+const uint8_t jpeg_zigzag_to_natural[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63
+};
+
+// Annex K tables, natural order
+static const uint8_t base_luma_table[64] = {
+    16, 11, 10, 16,  24,  40,  51,  61,
+    12, 12, 14, 19,  26,  58,  60,  55,
+    14, 13, 16, 24,  40,  57,  69,  56,
+    14, 17, 22, 29,  51,  87,  80,  62,
+    18, 22, 37, 56,  68, 109, 103,  77,
+    24, 35, 55, 64,  81, 104, 113,  92,
+    49, 64, 78, 87, 103, 121, 120, 101,
+    72, 92, 95, 98, 112, 100, 103,  99
+};
+
+static const uint8_t base_chroma_table[64] = {
+    17, 18, 24, 47, 99, 99, 99, 99,
+    18, 21, 26, 66, 99, 99, 99, 99,
+    24, 26, 56, 99, 99, 99, 99, 99,
+    47, 66, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99,
+    99, 99, 99, 99, 99, 99, 99, 99
+};
+
+static const uint8_t dc_luma_bits[16] = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t dc_chroma_bits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dc_values[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+
+static const uint8_t ac_luma_bits[16] = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+static const uint8_t ac_luma_values[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+static const uint8_t ac_chroma_bits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t ac_chroma_values[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa
+};
+
+typedef struct {
+    uint16_t code[256];
+    uint8_t length[256];
+} HuffmanTable;
+
+// Canonical codes from the bit counts (Annex C)
+static void build_huffman_table(const uint8_t bits[16], const uint8_t* values, HuffmanTable* table) {
+    memset(table, 0, sizeof(*table));
+    uint16_t code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        for (int i = 0; i < bits[length - 1]; i++) {
+            table->code[values[k]] = code++;
+            table->length[values[k]] = (uint8_t)length;
+            k++;
+        }
+        code <<= 1;
+    }
+}
+
+int jpeg_coef_layout(int width, int height, int subsampling, JpegCoefLayout* layout) {
+    if (!layout || width <= 0 || height <= 0 || width > 65535 || height > 65535) return 0;
+
+    memset(layout, 0, sizeof(*layout));
+    switch (subsampling) {
+        case JPEG_SUBSAMPLING_444: layout->h_samp = 1; layout->v_samp = 1; break;
+        case JPEG_SUBSAMPLING_422: layout->h_samp = 2; layout->v_samp = 1; break;
+        case JPEG_SUBSAMPLING_420: layout->h_samp = 2; layout->v_samp = 2; break;
+        default: return 0;
+    }
+
+    layout->width = width;
+    layout->height = height;
+    layout->subsampling = subsampling;
+    layout->mcus_x = (width + layout->h_samp * 8 - 1) / (layout->h_samp * 8);
+    layout->mcus_y = (height + layout->v_samp * 8 - 1) / (layout->v_samp * 8);
+
+    size_t offset = 0;
+    for (int c = 0; c < 3; c++) {
+        layout->blocks_w[c] = layout->mcus_x * (c == 0 ? layout->h_samp : 1);
+        layout->blocks_h[c] = layout->mcus_y * (c == 0 ? layout->v_samp : 1);
+        layout->offset[c] = offset;
+        offset += (size_t)layout->blocks_w[c] * layout->blocks_h[c] * 64;
+    }
+    layout->coefficient_count = offset;
+    return 1;
+}
+
+void jpeg_quant_tables(int quality, uint16_t luma[64], uint16_t chroma[64]) {
+    if (quality < 1) quality = 1;
+    if (quality > 100) quality = 100;
+    int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+
+    for (int i = 0; i < 64; i++) {
+        int l = (base_luma_table[i] * scale + 50) / 100;
+        int c = (base_chroma_table[i] * scale + 50) / 100;
+        luma[i] = (uint16_t)(l < 1 ? 1 : (l > 255 ? 255 : l));
+        chroma[i] = (uint16_t)(c < 1 ? 1 : (c > 255 ? 255 : c));
+    }
+}
+
+// Growable output with byte stuffing
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    uint32_t bits;
+    int bit_count;
+    int failed;
+} BitWriter;
+
+static void writer_reserve(BitWriter* writer, size_t extra) {
+    if (writer->size + extra <= writer->capacity) return;
+    size_t capacity = writer->capacity ? writer->capacity * 2 : 4096;
+    while (capacity < writer->size + extra) capacity *= 2;
+    uint8_t* data = realloc(writer->data, capacity);
+    if (!data) {
+        writer->failed = 1;
+        return;
+    }
+    writer->data = data;
+    writer->capacity = capacity;
+}
+
+static void writer_byte(BitWriter* writer, uint8_t byte) {
+    writer_reserve(writer, 1);
+    if (writer->failed) return;
+    writer->data[writer->size++] = byte;
+}
+
+static void writer_bytes(BitWriter* writer, const uint8_t* bytes, size_t count) {
+    writer_reserve(writer, count);
+    if (writer->failed) return;
+    memcpy(writer->data + writer->size, bytes, count);
+    writer->size += count;
+}
+
+static void writer_u16(BitWriter* writer, int value) {
+    writer_byte(writer, (uint8_t)(value >> 8));
+    writer_byte(writer, (uint8_t)value);
+}
+
+static void writer_bits(BitWriter* writer, uint32_t value, int count) {
+    writer->bits = (writer->bits << count) | (value & ((1u << count) - 1));
+    writer->bit_count += count;
+    while (writer->bit_count >= 8) {
+        uint8_t byte = (uint8_t)(writer->bits >> (writer->bit_count - 8));
+        writer_byte(writer, byte);
+        if (byte == 0xFF) writer_byte(writer, 0x00);
+        writer->bit_count -= 8;
+    }
+}
+
+// Pad the last byte with ones, as required before a marker
+static void writer_flush(BitWriter* writer) {
+    if (writer->bit_count > 0) {
+        writer_bits(writer, 0x7F, 8 - writer->bit_count);
+    }
+    writer->bits = 0;
+}
+
+static int magnitude_category(int value) {
+    if (value < 0) value = -value;
+    int category = 0;
+    while (value) {
+        category++;
+        value >>= 1;
+    }
+    return category;
+}
+
+static void encode_block(
+    BitWriter* writer,
+    const int16_t* block,
+    int* dc_predictor,
+    const HuffmanTable* dc_table,
+    const HuffmanTable* ac_table
+) {
+    int diff = block[0] - *dc_predictor;
+    *dc_predictor = block[0];
+
+    int category = magnitude_category(diff);
+    writer_bits(writer, dc_table->code[category], dc_table->length[category]);
+    if (category) {
+        writer_bits(writer, diff < 0 ? diff - 1 : diff, category);
+    }
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int value = block[k];
+        if (value == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            writer_bits(writer, ac_table->code[0xF0], ac_table->length[0xF0]);
+            run -= 16;
+        }
+        category = magnitude_category(value);
+        int symbol = (run << 4) | category;
+        writer_bits(writer, ac_table->code[symbol], ac_table->length[symbol]);
+        writer_bits(writer, value < 0 ? value - 1 : value, category);
+        run = 0;
+    }
+    if (run > 0) {
+        writer_bits(writer, ac_table->code[0x00], ac_table->length[0x00]);
+    }
+}
+
+typedef struct {
+    const JpegCoefLayout* layout;
+    const int16_t* coefficients;
+    const HuffmanTable* tables;     // DC luma, AC luma, DC chroma, AC chroma
+    BitWriter* intervals;           // One per MCU row
+    int next_row;
+    pthread_mutex_t mutex;
+} EncodeJob;
+
+// One restart interval is one MCU row; predictors start at zero
+static void encode_mcu_row(EncodeJob* job, int mcu_y) {
+    const JpegCoefLayout* layout = job->layout;
+    BitWriter* writer = &job->intervals[mcu_y];
+    int predictors[3] = { 0, 0, 0 };
+
+    for (int mcu_x = 0; mcu_x < layout->mcus_x; mcu_x++) {
+        for (int c = 0; c < 3; c++) {
+            int h = c == 0 ? layout->h_samp : 1;
+            int v = c == 0 ? layout->v_samp : 1;
+            const HuffmanTable* dc_table = &job->tables[c == 0 ? 0 : 2];
+            const HuffmanTable* ac_table = &job->tables[c == 0 ? 1 : 3];
+            for (int by = 0; by < v; by++) {
+                for (int bx = 0; bx < h; bx++) {
+                    size_t block_index = (size_t)(mcu_y * v + by) * layout->blocks_w[c] + mcu_x * h + bx;
+                    const int16_t* block = job->coefficients + layout->offset[c] + block_index * 64;
+                    encode_block(writer, block, &predictors[c], dc_table, ac_table);
+                }
+            }
+        }
+    }
+    writer_flush(writer);
+}
+
+static void* encode_worker(void* arg) {
+    EncodeJob* job = (EncodeJob*)arg;
+    for (;;) {
+        pthread_mutex_lock(&job->mutex);
+        int row = job->next_row++;
+        pthread_mutex_unlock(&job->mutex);
+        if (row >= job->layout->mcus_y) break;
+        encode_mcu_row(job, row);
+    }
+    return NULL;
+}
+
+static void write_quant_table(BitWriter* writer, int id, const uint16_t table[64]) {
+    writer_byte(writer, (uint8_t)id);
+    for (int k = 0; k < 64; k++) {
+        writer_byte(writer, (uint8_t)table[jpeg_zigzag_to_natural[k]]);
+    }
+}
+
+static void write_huffman_table(BitWriter* writer, int table_class, int id,
+                                const uint8_t bits[16], const uint8_t* values) {
+    int count = 0;
+    for (int i = 0; i < 16; i++) count += bits[i];
+    writer_byte(writer, (uint8_t)((table_class << 4) | id));
+    writer_bytes(writer, bits, 16);
+    writer_bytes(writer, values, count);
+}
+
+static void write_headers(BitWriter* writer, const JpegCoefLayout* layout,
+                          const uint16_t luma_table[64], const uint16_t chroma_table[64]) {
+    static const uint8_t jfif[] = {
+        0xFF, 0xD8,                                     // SOI
+        0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00,
+        0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00
+    };
+    writer_bytes(writer, jfif, sizeof(jfif));
+
+    // DQT
+    writer_u16(writer, 0xFFDB);
+    writer_u16(writer, 2 + 2 * 65);
+    write_quant_table(writer, 0, luma_table);
+    write_quant_table(writer, 1, chroma_table);
+
+    // SOF0
+    writer_u16(writer, 0xFFC0);
+    writer_u16(writer, 8 + 3 * 3);
+    writer_byte(writer, 8);
+    writer_u16(writer, layout->height);
+    writer_u16(writer, layout->width);
+    writer_byte(writer, 3);
+    for (int c = 0; c < 3; c++) {
+        writer_byte(writer, (uint8_t)(c + 1));
+        writer_byte(writer, c == 0 ? (uint8_t)((layout->h_samp << 4) | layout->v_samp) : 0x11);
+        writer_byte(writer, c == 0 ? 0 : 1);
+    }
+
+    // DHT
+    writer_u16(writer, 0xFFC4);
+    writer_u16(writer, 2 + 2 * (17 + 12) + 2 * (17 + 162));
+    write_huffman_table(writer, 0, 0, dc_luma_bits, dc_values);
+    write_huffman_table(writer, 1, 0, ac_luma_bits, ac_luma_values);
+    write_huffman_table(writer, 0, 1, dc_chroma_bits, dc_values);
+    write_huffman_table(writer, 1, 1, ac_chroma_bits, ac_chroma_values);
+
+    // DRI, one MCU row per restart interval
+    writer_u16(writer, 0xFFDD);
+    writer_u16(writer, 4);
+    writer_u16(writer, layout->mcus_x);
+
+    // SOS
+    writer_u16(writer, 0xFFDA);
+    writer_u16(writer, 6 + 2 * 3);
+    writer_byte(writer, 3);
+    for (int c = 0; c < 3; c++) {
+        writer_byte(writer, (uint8_t)(c + 1));
+        writer_byte(writer, c == 0 ? 0x00 : 0x11);
+    }
+    writer_byte(writer, 0);
+    writer_byte(writer, 63);
+    writer_byte(writer, 0);
+}
+
+int jpeg_encode_coefficients(
+    const JpegCoefLayout* layout,
+    const int16_t* coefficients,
+    const uint16_t luma_table[64],
+    const uint16_t chroma_table[64],
+    int thread_count,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
+) {
+    if (!layout || !coefficients || !luma_table || !chroma_table || !jpeg_data || !jpeg_size) {
+        return 0;
+    }
+    if (layout->mcus_x <= 0 || layout->mcus_x > 65535 || layout->mcus_y <= 0) return 0;
+
+    HuffmanTable tables[4];
+    build_huffman_table(dc_luma_bits, dc_values, &tables[0]);
+    build_huffman_table(ac_luma_bits, ac_luma_values, &tables[1]);
+    build_huffman_table(dc_chroma_bits, dc_values, &tables[2]);
+    build_huffman_table(ac_chroma_bits, ac_chroma_values, &tables[3]);
+
+    EncodeJob job = {
+        .layout = layout,
+        .coefficients = coefficients,
+        .tables = tables,
+        .intervals = calloc(layout->mcus_y, sizeof(BitWriter)),
+        .next_row = 0
+    };
+    if (!job.intervals) return 0;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    if (thread_count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (int)cores : 1;
+    }
+    if (thread_count > layout->mcus_y) thread_count = layout->mcus_y;
+
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, encode_worker, &job) != 0) break;
+            started++;
+        }
+    }
+    encode_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&job.mutex);
+
+    BitWriter output = {0};
+    int failed = 0;
+    size_t total = 1024;
+    for (int row = 0; row < layout->mcus_y; row++) {
+        failed |= job.intervals[row].failed;
+        total += job.intervals[row].size + 2;
+    }
+
+    if (!failed) {
+        writer_reserve(&output, total);
+        write_headers(&output, layout, luma_table, chroma_table);
+        for (int row = 0; row < layout->mcus_y; row++) {
+            if (row > 0) {
+                writer_byte(&output, 0xFF);
+                writer_byte(&output, (uint8_t)(0xD0 + ((row - 1) & 7)));
+            }
+            writer_bytes(&output, job.intervals[row].data, job.intervals[row].size);
+        }
+        writer_u16(&output, 0xFFD9);
+        failed = output.failed;
+    }
+
+    for (int row = 0; row < layout->mcus_y; row++) {
+        free(job.intervals[row].data);
+    }
+    free(job.intervals);
+
+    if (failed) {
+        fprintf(stderr, "jpeg_encode_coefficients: out of memory\n");
+        free(output.data);
+        return 0;
+    }
+
+    *jpeg_data = output.data;
+    *jpeg_size = output.size;
+    return 1;
+}
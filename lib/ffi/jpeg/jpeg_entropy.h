@@ -0,0 +1,63 @@
+#ifndef JPEG_ENTROPY_H
+#define JPEG_ENTROPY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Baseline JPEG writer for coefficients that were transformed and quantized
+// elsewhere (the Vulkan DCT pass). Only Huffman coding happens here, split
+// into restart intervals of one MCU row that are encoded in parallel.
+
+#define JPEG_SUBSAMPLING_444 0
+#define JPEG_SUBSAMPLING_422 1
+#define JPEG_SUBSAMPLING_420 2
+
+// Where the blocks of each component (Y, Cb, Cr) live in the coefficient
+// buffer. Every block is 64 int16 values in zigzag order; blocks of a
+// component are stored row by row over a grid padded to whole MCUs.
+typedef struct {
+    int width;
+    int height;
+    int subsampling;
+    int h_samp;             // Luma blocks per MCU horizontally
+    int v_samp;             // Luma blocks per MCU vertically
+    int mcus_x;
+    int mcus_y;
+    int blocks_w[3];
+    int blocks_h[3];
+    size_t offset[3];       // First coefficient of each component
+    size_t coefficient_count;
+} JpegCoefLayout;
+
+// Fill in the block layout for an image. Returns 0 for invalid arguments.
+int jpeg_coef_layout(int width, int height, int subsampling, JpegCoefLayout* layout);
+
+// IJG quality scaled quantization tables (1-100), natural order
+void jpeg_quant_tables(int quality, uint16_t luma[64], uint16_t chroma[64]);
+
+// Natural index of each zigzag position
+extern const uint8_t jpeg_zigzag_to_natural[64];
+
+// Entropy code the coefficients and write a complete JFIF file to a newly
+// allocated buffer (free with free()). The tables must be the ones the
+// coefficients were quantized with. thread_count <= 0 uses all cores.
+// Returns 1 on success, 0 on failure.
+int jpeg_encode_coefficients(
+    const JpegCoefLayout* layout,
+    const int16_t* coefficients,
+    const uint16_t luma_table[64],
+    const uint16_t chroma_table[64],
+    int thread_count,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_ENTROPY_H
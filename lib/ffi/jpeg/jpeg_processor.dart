@@ -1,5 +1,6 @@
 import 'dart:ffi';
 import 'dart:io';
+import 'dart:isolate';
 import 'dart:typed_data';
 import 'dart:ui' as ui;
 import 'package:ffi/ffi.dart';
@@ -20,6 +21,7 @@ class JpegProcessor extends FfiBase {
       'jpeg_binding',
       linuxPaths: [
         ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
         '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
       ],
       macosPaths: PlatformUtils.commonLibraryPaths,
@@ -92,6 +94,88 @@ class JpegProcessor extends FfiBase {
     }
   }
   
+  /// Compress to the highest quality in [minQuality, maxQuality] whose file
+  /// fits in maxBytes. The DCT runs once and only quantization and Huffman
+  /// coding are repeated per trial. If even minQuality doesn't fit, that
+  /// result is returned anyway.
+  static Future<Uint8List> compressToSize({
+    required ui.Image image,
+    required int maxBytes,
+    int minQuality = 30,
+    int maxQuality = 95,
+  }) async {
+    final byteData = await image.toByteData(
+      format: ui.ImageByteFormat.rawRgba,
+    );
+    
+    if (byteData == null) {
+      throw Exception('Failed to convert image to byte data');
+    }
+    
+    final rgbaData = byteData.buffer.asUint8List();
+    final rgbaPointer = malloc<Uint8>(rgbaData.length);
+    rgbaPointer.asTypedList(rgbaData.length).setAll(0, rgbaData);
+    
+    final address = rgbaPointer.address;
+    final width = image.width;
+    final height = image.height;
+    try {
+      // Runs off the UI isolate; the search itself is multithreaded
+      return await Isolate.run(() => _compressToSize(
+            address,
+            width,
+            height,
+            maxBytes,
+            minQuality,
+            maxQuality,
+          ));
+    } finally {
+      malloc.free(rgbaPointer);
+    }
+  }
+  
+  static Uint8List _compressToSize(int address, int width, int height,
+      int maxBytes, int minQuality, int maxQuality) {
+    initialize();
+    
+    final jpegData = malloc<Pointer<Uint8>>();
+    final jpegSize = malloc<Size>();
+    final qualityUsed = malloc<Int32>();
+    try {
+      final ok = _bindings!.jpegEncodeTargetSize(
+        Pointer<Uint8>.fromAddress(address),
+        width,
+        height,
+        4,
+        width * 4,
+        2,  // 4:2:0, as in compressImage
+        maxBytes,
+        minQuality,
+        maxQuality,
+        0,  // Scheduler's batch limit
+        jpegData,
+        jpegSize,
+        qualityUsed,
+      );
+      
+      if (ok == 0) {
+        throw Exception('Failed to compress JPEG');
+      }
+      
+      try {
+        print('JPEG size target ${maxBytes ~/ 1024} KB: quality ${qualityUsed.value}, '
+            '${jpegSize.value ~/ 1024} KB');
+        return Uint8List.fromList(jpegData.value.asTypedList(jpegSize.value));
+      } finally {
+        _bindings!.jpegTargetFree(jpegData.value);
+      }
+    } finally {
+      malloc.free(jpegData);
+      malloc.free(jpegSize);
+      malloc.free(qualityUsed);
+    }
+  }
+  
   /// Get the JPEG bindings instance
   static JpegBindings get bindings {
     if (_bindings == null) {
@@ -0,0 +1,316 @@
+#include "jpeg_target.h"
+#include "job_scheduler.h"
+#include "mem_stats.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// Unquantized coefficients are kept as int16 with 4 fractional bits. The
+// DCT output of 8-bit samples stays within +-1024, so this fits and is
+// exact enough for every quantizer step (>= 1).
+#define COEF_FRACTION_BITS 4
+
+typedef struct {
+    const uint8_t* pixels;
+    int channels;
+    size_t stride;
+    const JpegCoefLayout* layout;
+    int16_t* raw;               // Zigzag order, COEF_FRACTION_BITS fixed point
+    int16_t* quantized;         // Zigzag order
+    float reciprocal[2][64];    // Luma and chroma, zigzag order
+    float cosines[8][8];        // Scaled DCT basis, [frequency][sample]
+} TargetJob;
+
+// Runs one unit of a pass: a block row of one component
+typedef void (*RowFunction)(TargetJob* job, int component, int block_row);
+
+typedef struct {
+    TargetJob* job;
+    RowFunction function;
+    int next_row;
+    int row_count;
+    pthread_mutex_t mutex;
+} RowPass;
+
+static void locate_row(const JpegCoefLayout* layout, int row, int* component, int* block_row) {
+    int c = 0;
+    while (c < 2 && row >= layout->blocks_h[c]) {
+        row -= layout->blocks_h[c];
+        c++;
+    }
+    *component = c;
+    *block_row = row;
+}
+
+static void* row_worker(void* arg) {
+    RowPass* pass = (RowPass*)arg;
+    while (1) {
+        pthread_mutex_lock(&pass->mutex);
+        int row = pass->next_row++;
+        pthread_mutex_unlock(&pass->mutex);
+        if (row >= pass->row_count) break;
+
+        int component, block_row;
+        locate_row(pass->job->layout, row, &component, &block_row);
+        pass->function(pass->job, component, block_row);
+    }
+    return NULL;
+}
+
+// Run a function over every block row of the three components
+static void run_rows(TargetJob* job, RowFunction function, int thread_count) {
+    const JpegCoefLayout* layout = job->layout;
+    RowPass pass = {
+        .job = job,
+        .function = function,
+        .next_row = 0,
+        .row_count = layout->blocks_h[0] + layout->blocks_h[1] + layout->blocks_h[2]
+    };
+    pthread_mutex_init(&pass.mutex, NULL);
+
+    if (thread_count > pass.row_count) thread_count = pass.row_count;
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, row_worker, &pass) != 0) break;
+            started++;
+        }
+    }
+    row_worker(&pass);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&pass.mutex);
+}
+
+// Same sampling and colour conversion as jpeg_dct.comp: average the pixels
+// behind each sample, replicating the last row and column, then JFIF YCbCr
+static void load_block(const TargetJob* job, int component, int block_x, int block_y,
+                       float samples[64]) {
+    const JpegCoefLayout* layout = job->layout;
+    int sample_x = component == 0 ? 1 : layout->h_samp;
+    int sample_y = component == 0 ? 1 : layout->v_samp;
+    float scale = 1.0f / (float)(sample_x * sample_y);
+
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            int base_x = (block_x * 8 + x) * sample_x;
+            int base_y = (block_y * 8 + y) * sample_y;
+            for (int j = 0; j < sample_y; j++) {
+                int py = base_y + j < layout->height ? base_y + j : layout->height - 1;
+                const uint8_t* row = job->pixels + (size_t)py * job->stride;
+                for (int i = 0; i < sample_x; i++) {
+                    int px = base_x + i < layout->width ? base_x + i : layout->width - 1;
+                    const uint8_t* p = row + (size_t)px * job->channels;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                }
+            }
+            r *= scale;
+            g *= scale;
+            b *= scale;
+
+            float value;
+            if (component == 0) {
+                value = 0.299f * r + 0.587f * g + 0.114f * b - 128.0f;
+            } else if (component == 1) {
+                value = -0.168736f * r - 0.331264f * g + 0.5f * b;
+            } else {
+                value = 0.5f * r - 0.418688f * g - 0.081312f * b;
+            }
+            samples[y * 8 + x] = value;
+        }
+    }
+}
+
+static void transform_row(TargetJob* job, int component, int block_row) {
+    const JpegCoefLayout* layout = job->layout;
+    int blocks_w = layout->blocks_w[component];
+    int16_t* out = job->raw + layout->offset[component] + (size_t)block_row * blocks_w * 64;
+    const float fixed_scale = (float)(1 << COEF_FRACTION_BITS);
+
+    float samples[64];
+    float rows[64];
+    for (int block_x = 0; block_x < blocks_w; block_x++, out += 64) {
+        load_block(job, component, block_x, block_row, samples);
+
+        // Separable 2D DCT: rows, then columns
+        for (int y = 0; y < 8; y++) {
+            for (int u = 0; u < 8; u++) {
+                float sum = 0.0f;
+                for (int x = 0; x < 8; x++) sum += samples[y * 8 + x] * job->cosines[u][x];
+                rows[y * 8 + u] = sum;
+            }
+        }
+        for (int z = 0; z < 64; z++) {
+            int natural = jpeg_zigzag_to_natural[z];
+            int u = natural & 7;
+            int v = natural >> 3;
+            float sum = 0.0f;
+            for (int y = 0; y < 8; y++) sum += rows[y * 8 + u] * job->cosines[v][y];
+            long value = lrintf(sum * fixed_scale);
+            out[z] = (int16_t)(value < -32768 ? -32768 : (value > 32767 ? 32767 : value));
+        }
+    }
+}
+
+static void quantize_row(TargetJob* job, int component, int block_row) {
+    const JpegCoefLayout* layout = job->layout;
+    size_t start = layout->offset[component] + (size_t)block_row * layout->blocks_w[component] * 64;
+    size_t count = (size_t)layout->blocks_w[component] * 64;
+    const float* reciprocal = job->reciprocal[component == 0 ? 0 : 1];
+
+    const int16_t* in = job->raw + start;
+    int16_t* out = job->quantized + start;
+    for (size_t i = 0; i < count; i += 64) {
+        for (int z = 0; z < 64; z++) {
+            out[i + z] = (int16_t)lrintf((float)in[i + z] * reciprocal[z]);
+        }
+    }
+}
+
+// Quantize the stored coefficients at one quality and entropy code them
+static int encode_trial(TargetJob* job, int quality, int thread_count,
+                        uint8_t** jpeg_data, size_t* jpeg_size) {
+    uint16_t luma[64], chroma[64];
+    jpeg_quant_tables(quality, luma, chroma);
+    for (int z = 0; z < 64; z++) {
+        int natural = jpeg_zigzag_to_natural[z];
+        job->reciprocal[0][z] = 1.0f / (float)(luma[natural] << COEF_FRACTION_BITS);
+        job->reciprocal[1][z] = 1.0f / (float)(chroma[natural] << COEF_FRACTION_BITS);
+    }
+
+    run_rows(job, quantize_row, thread_count);
+    return jpeg_encode_coefficients(job->layout, job->quantized, luma, chroma,
+                                    thread_count, jpeg_data, jpeg_size);
+}
+
+// Highest quality in [min_quality, max_quality] that fits. The top is tried
+// first since most images under budget are done after one pass.
+static int search_quality(TargetJob* job, size_t max_bytes, int min_quality, int max_quality,
+                          int thread_count, uint8_t** jpeg_data, size_t* jpeg_size,
+                          int* quality_used) {
+    uint8_t* best = NULL;
+    size_t best_size = 0;
+    if (!encode_trial(job, max_quality, thread_count, &best, &best_size)) return 0;
+    int best_quality = max_quality;
+
+    if (best_size > max_bytes && min_quality < max_quality) {
+        free(best);
+        best = NULL;
+
+        // Everything above hi is too big. min_quality is kept even when it
+        // doesn't fit, as the closest result there is.
+        int lo = min_quality;
+        int hi = max_quality - 1;
+        while (lo <= hi) {
+            int mid = lo + (hi - lo) / 2;
+            uint8_t* trial = NULL;
+            size_t trial_size = 0;
+            if (!encode_trial(job, mid, thread_count, &trial, &trial_size)) {
+                free(best);
+                return 0;
+            }
+
+            int fits = trial_size <= max_bytes;
+            if (fits || mid == min_quality) {
+                free(best);
+                best = trial;
+                best_size = trial_size;
+                best_quality = mid;
+            } else {
+                free(trial);
+            }
+
+            if (fits) {
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+    }
+
+    *jpeg_data = best;
+    *jpeg_size = best_size;
+    if (quality_used) *quality_used = best_quality;
+    return 1;
+}
+
+int jpeg_encode_target_size(
+    const uint8_t* pixels,
+    int width,
+    int height,
+    int channels,
+    size_t stride,
+    int subsampling,
+    size_t max_bytes,
+    int min_quality,
+    int max_quality,
+    int thread_count,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size,
+    int* quality_used
+) {
+    if (!pixels || !jpeg_data || !jpeg_size || max_bytes == 0) return 0;
+    if (channels != 3 && channels != 4) return 0;
+    if (stride == 0) stride = (size_t)width * channels;
+
+    if (min_quality < 1) min_quality = 1;
+    if (max_quality > 100) max_quality = 100;
+    if (min_quality > max_quality) min_quality = max_quality;
+
+    JpegCoefLayout layout;
+    if (!jpeg_coef_layout(width, height, subsampling, &layout)) return 0;
+
+    TargetJob job = {
+        .pixels = pixels,
+        .channels = channels,
+        .stride = stride,
+        .layout = &layout,
+        .raw = malloc(layout.coefficient_count * sizeof(int16_t)),
+        .quantized = malloc(layout.coefficient_count * sizeof(int16_t))
+    };
+    if (!job.raw || !job.quantized) {
+        fprintf(stderr, "jpeg_encode_target_size: out of memory\n");
+        free(job.raw);
+        free(job.quantized);
+        return 0;
+    }
+
+    for (int u = 0; u < 8; u++) {
+        float scale = u == 0 ? 0.5f * 0.70710678f : 0.5f;
+        for (int x = 0; x < 8; x++) {
+            job.cosines[u][x] = scale * cosf((float)((2 * x + 1) * u) * 3.14159265f / 16.0f);
+        }
+    }
+
+    int64_t working_bytes = (int64_t)(layout.coefficient_count * sizeof(int16_t) * 2);
+    mem_stats_add(MEM_ENCODER, working_bytes);
+
+    job_begin(JOB_CLASS_BATCH);
+    if (thread_count <= 0) thread_count = job_scheduler_limit(JOB_CLASS_BATCH);
+
+    run_rows(&job, transform_row, thread_count);
+    int ok = search_quality(&job, max_bytes, min_quality, max_quality, thread_count,
+                            jpeg_data, jpeg_size, quality_used);
+
+    job_end(JOB_CLASS_BATCH);
+
+    free(job.raw);
+    free(job.quantized);
+    mem_stats_add(MEM_ENCODER, -working_bytes);
+    if (ok) mem_stats_set_owner(MEM_ENCODER, *jpeg_data, (int64_t)*jpeg_size);
+    return ok;
+}
+
+void jpeg_target_free(uint8_t* jpeg_data) {
+    if (!jpeg_data) return;
+    mem_stats_set_owner(MEM_ENCODER, jpeg_data, 0);
+    free(jpeg_data);
+}
@@ -0,0 +1,46 @@
+#ifndef JPEG_TARGET_H
+#define JPEG_TARGET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "jpeg_entropy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// JPEG encoding to a file size budget. Colour conversion and the forward
+// DCT run once; each quality trial only re-quantizes the stored
+// coefficients and entropy codes them (jpeg_entropy.c), so a binary search
+// over the quality costs a handful of Huffman passes rather than full
+// encodes.
+
+// Encode 8-bit RGB or RGBA pixels (alpha is ignored) at the highest quality
+// in [min_quality, max_quality] whose file fits in max_bytes. If even
+// min_quality is too big, that result is returned anyway; check jpeg_size.
+// thread_count <= 0 uses the scheduler's batch limit. The output is freed
+// with jpeg_target_free. Returns 1 on success, 0 on failure (including a
+// max_bytes of 0 or a channel count other than 3 or 4).
+int jpeg_encode_target_size(
+    const uint8_t* pixels,
+    int width,
+    int height,
+    int channels,
+    size_t stride,
+    int subsampling,
+    size_t max_bytes,
+    int min_quality,
+    int max_quality,
+    int thread_count,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size,
+    int* quality_used
+);
+
+void jpeg_target_free(uint8_t* jpeg_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JPEG_TARGET_H
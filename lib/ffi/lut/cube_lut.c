@@ -0,0 +1,287 @@
+#include "cube_lut.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define LINE_MAX_LENGTH 512
+#define REGISTRY_SIZE 64
+
+// A LUT and its registry state. The LUT comes first, so the CubeLut pointers
+// handed out are the entry.
+typedef struct {
+    CubeLut lut;
+    uint32_t id;            // 0 until registered
+    int refs;               // The registration plus every acquire
+} LutEntry;
+
+static LutEntry* registry[REGISTRY_SIZE];
+static uint32_t next_id = 1;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void set_error(char* error, size_t error_size, const char* format, ...) {
+    if (!error || error_size == 0) return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(error, error_size, format, args);
+    va_end(args);
+}
+
+static void entry_free(LutEntry* entry) {
+    if (!entry) return;
+    free(entry->lut.data);
+    free(entry);
+}
+
+// Keyword at the start of line, followed by whitespace
+static const char* keyword(const char* line, const char* name) {
+    size_t length = strlen(name);
+    if (strncmp(line, name, length) != 0 || !isspace((unsigned char)line[length])) return NULL;
+    return line + length;
+}
+
+// Three floats and nothing else; returns the number parsed
+static int parse_floats(const char* text, float values[3]) {
+    char* end = (char*)text;
+    int count = 0;
+    while (count < 3) {
+        const char* start = end;
+        float value = strtof(start, &end);
+        if (end == start) break;
+        values[count++] = value;
+    }
+    while (isspace((unsigned char)*end)) end++;
+    return *end == '\0' ? count : -1;
+}
+
+// DOMAIN_MIN/MAX and LUT_3D_INPUT_RANGE must describe the default 0-1 domain
+static int is_domain(const float* values, int count, float expected) {
+    for (int i = 0; i < count; i++) {
+        if (fabsf(values[i] - expected) > 1e-6f) return 0;
+    }
+    return 1;
+}
+
+CubeLut* cube_lut_parse(const char* text, size_t length, char* error, size_t error_size) {
+    if (!text) {
+        set_error(error, error_size, "no data");
+        return NULL;
+    }
+
+    LutEntry* entry = calloc(1, sizeof(LutEntry));
+    if (!entry) {
+        set_error(error, error_size, "out of memory");
+        return NULL;
+    }
+    CubeLut* lut = &entry->lut;
+
+    size_t entries = 0;
+    size_t expected = 0;
+    int line_number = 0;
+    size_t position = 0;
+    char line[LINE_MAX_LENGTH];
+
+    while (position < length) {
+        size_t end = position;
+        while (end < length && text[end] != '\n') end++;
+        size_t line_length = end - position;
+        line_number++;
+
+        if (line_length >= LINE_MAX_LENGTH) {
+            set_error(error, error_size, "line %d is too long", line_number);
+            goto fail;
+        }
+        memcpy(line, text + position, line_length);
+        line[line_length] = '\0';
+        position = end + 1;
+
+        // Trim, including the \r of CRLF files
+        char* start = line;
+        while (isspace((unsigned char)*start)) start++;
+        char* last = start + strlen(start);
+        while (last > start && isspace((unsigned char)last[-1])) *--last = '\0';
+        if (*start == '\0' || *start == '#') continue;
+
+        const char* rest;
+        float values[3];
+        int count;
+        if ((rest = keyword(start, "TITLE"))) {
+            while (isspace((unsigned char)*rest)) rest++;
+            if (*rest == '"') rest++;
+            snprintf(lut->title, sizeof(lut->title), "%s", rest);
+            size_t title_length = strlen(lut->title);
+            if (title_length > 0 && lut->title[title_length - 1] == '"') lut->title[title_length - 1] = '\0';
+        } else if ((rest = keyword(start, "LUT_3D_SIZE"))) {
+            char* number_end;
+            long size = strtol(rest, &number_end, 10);
+            while (isspace((unsigned char)*number_end)) number_end++;
+            if (*number_end != '\0' || size < CUBE_LUT_MIN_SIZE || size > CUBE_LUT_MAX_SIZE) {
+                set_error(error, error_size, "line %d: LUT_3D_SIZE must be %d to %d",
+                          line_number, CUBE_LUT_MIN_SIZE, CUBE_LUT_MAX_SIZE);
+                goto fail;
+            }
+            if (lut->data) {
+                set_error(error, error_size, "line %d: second LUT_3D_SIZE", line_number);
+                goto fail;
+            }
+            lut->size = (int32_t)size;
+            expected = (size_t)size * size * size;
+            lut->data = aligned_alloc(16, expected * 4 * sizeof(float));
+            if (!lut->data) {
+                set_error(error, error_size, "out of memory");
+                goto fail;
+            }
+        } else if (keyword(start, "LUT_1D_SIZE")) {
+            set_error(error, error_size, "1D LUTs are not supported");
+            goto fail;
+        } else if ((rest = keyword(start, "DOMAIN_MIN")) || (rest = keyword(start, "DOMAIN_MAX"))) {
+            float domain = strncmp(start, "DOMAIN_MIN", 10) == 0 ? 0.0f : 1.0f;
+            count = parse_floats(rest, values);
+            if (count != 3 || !is_domain(values, 3, domain)) {
+                set_error(error, error_size, "line %d: only the 0-1 domain is supported", line_number);
+                goto fail;
+            }
+        } else if ((rest = keyword(start, "LUT_3D_INPUT_RANGE"))) {
+            count = parse_floats(rest, values);
+            if (count != 2 || !is_domain(values, 1, 0.0f) || !is_domain(values + 1, 1, 1.0f)) {
+                set_error(error, error_size, "line %d: only the 0-1 input range is supported", line_number);
+                goto fail;
+            }
+        } else if (isalpha((unsigned char)*start)) {
+            // Other keywords (LUT_IN_VIDEO_RANGE and such) don't change the table
+            continue;
+        } else {
+            count = parse_floats(start, values);
+            if (count != 3) {
+                set_error(error, error_size, "line %d: expected three numbers", line_number);
+                goto fail;
+            }
+            if (!lut->data) {
+                set_error(error, error_size, "line %d: data before LUT_3D_SIZE", line_number);
+                goto fail;
+            }
+            if (entries == expected) {
+                set_error(error, error_size, "line %d: more than %zu entries", line_number, expected);
+                goto fail;
+            }
+            float* out = lut->data + entries * 4;
+            out[0] = values[0];
+            out[1] = values[1];
+            out[2] = values[2];
+            out[3] = 0.0f;
+            entries++;
+        }
+    }
+
+    if (!lut->data) {
+        set_error(error, error_size, "no LUT_3D_SIZE");
+        goto fail;
+    }
+    if (entries != expected) {
+        set_error(error, error_size, "%zu of %zu entries", entries, expected);
+        goto fail;
+    }
+    return lut;
+
+fail:
+    entry_free(entry);
+    return NULL;
+}
+
+CubeLut* cube_lut_load(const char* path, char* error, size_t error_size) {
+    FILE* file = path ? fopen(path, "rb") : NULL;
+    if (!file) {
+        set_error(error, error_size, "cannot open %s", path ? path : "(null)");
+        return NULL;
+    }
+
+    // A 65^3 LUT is around 8 MB of text
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* text = length > 0 ? malloc((size_t)length) : NULL;
+    if (!text || fread(text, 1, (size_t)length, file) != (size_t)length) {
+        set_error(error, error_size, "cannot read %s", path);
+        free(text);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    CubeLut* lut = cube_lut_parse(text, (size_t)length, error, error_size);
+    free(text);
+    return lut;
+}
+
+void cube_lut_free(CubeLut* lut) {
+    LutEntry* entry = (LutEntry*)lut;
+    if (entry && entry->id == 0) entry_free(entry);
+}
+
+uint32_t cube_lut_register(CubeLut* lut) {
+    LutEntry* entry = (LutEntry*)lut;
+    if (!entry || entry->id != 0) return 0;
+
+    pthread_mutex_lock(&registry_lock);
+    uint32_t id = 0;
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (!registry[i]) {
+            id = next_id++;
+            entry->id = id;
+            entry->refs = 1;
+            registry[i] = entry;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    if (id == 0) fprintf(stderr, "cube_lut_register: more than %d LUTs registered\n", REGISTRY_SIZE);
+    return id;
+}
+
+void cube_lut_unregister(uint32_t id) {
+    if (id == 0) return;
+    LutEntry* unused = NULL;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (registry[i] && registry[i]->id == id) {
+            if (--registry[i]->refs == 0) unused = registry[i];
+            registry[i] = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    entry_free(unused);
+}
+
+const CubeLut* cube_lut_acquire(uint32_t id) {
+    if (id == 0) return NULL;
+    const CubeLut* lut = NULL;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < REGISTRY_SIZE; i++) {
+        if (registry[i] && registry[i]->id == id) {
+            registry[i]->refs++;
+            lut = &registry[i]->lut;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return lut;
+}
+
+void cube_lut_release(const CubeLut* lut) {
+    LutEntry* entry = (LutEntry*)lut;
+    if (!entry) return;
+
+    pthread_mutex_lock(&registry_lock);
+    int unused = --entry->refs == 0;
+    pthread_mutex_unlock(&registry_lock);
+
+    if (unused) entry_free(entry);
+}
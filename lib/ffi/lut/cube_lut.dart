@@ -0,0 +1,109 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'package:ffi/ffi.dart';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'cube_lut_bindings.dart';
+
+/// A .cube 3D LUT registered with the native engines. Apply it by setting
+/// AdjustmentParams.lutId to [id] and enabling AdjustmentStage.lut3d.
+class CubeLut extends FfiBase {
+  static DynamicLibrary? _library;
+  static CubeLutBindings? _bindings;
+
+  static const int _errorSize = 256;
+
+  /// Registry id, 0 once disposed
+  int id;
+  /// Entries per axis
+  final int size;
+  /// TITLE from the file, empty if it has none
+  final String title;
+
+  CubeLut._(this.id, this.size, this.title);
+
+  /// Initialize the LUT library
+  static void initialize() {
+    if (_bindings != null) return;
+
+    _library = FfiBase.loadLibrary(
+      'cube_lut',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+
+    _bindings = CubeLutBindings(_library!);
+  }
+
+  static bool get isAvailable {
+    try {
+      initialize();
+      return true;
+    } catch (_) {
+      return false;
+    }
+  }
+
+  /// Load and register a .cube file. Throws a FormatException with the
+  /// parser's message if it can't be read or isn't a 3D LUT the engines can
+  /// use.
+  static CubeLut load(String path) {
+    initialize();
+    final pathPointer = path.toNativeUtf8();
+    final error = calloc<Uint8>(_errorSize).cast<Utf8>();
+    try {
+      return _register(_bindings!.cubeLutLoad(pathPointer, error, _errorSize), error);
+    } finally {
+      calloc.free(pathPointer);
+      calloc.free(error);
+    }
+  }
+
+  /// Parse and register .cube text
+  static CubeLut parse(String text) {
+    initialize();
+    final bytes = utf8.encode(text);
+    final textPointer = malloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+    final error = calloc<Uint8>(_errorSize).cast<Utf8>();
+    try {
+      textPointer.asTypedList(bytes.length).setAll(0, bytes);
+      return _register(_bindings!.cubeLutParse(textPointer.cast(), bytes.length, error, _errorSize), error);
+    } finally {
+      malloc.free(textPointer);
+      calloc.free(error);
+    }
+  }
+
+  static CubeLut _register(Pointer<NativeCubeLut> lut, Pointer<Utf8> error) {
+    if (lut == nullptr) {
+      throw FormatException('Invalid .cube LUT: ${error.toDartString()}');
+    }
+
+    final size = lut.ref.size;
+    final titleBytes = <int>[];
+    for (int i = 0; i < 128 && lut.ref.title[i] != 0; i++) {
+      titleBytes.add(lut.ref.title[i]);
+    }
+    final title = utf8.decode(titleBytes, allowMalformed: true);
+
+    final id = _bindings!.cubeLutRegister(lut);
+    if (id == 0) {
+      _bindings!.cubeLutFree(lut);
+      throw StateError('Too many LUTs registered');
+    }
+    return CubeLut._(id, size, title);
+  }
+
+  /// Unregister the LUT. Engines still using it finish with it first.
+  void dispose() {
+    if (id == 0) return;
+    _bindings!.cubeLutUnregister(id);
+    id = 0;
+  }
+}
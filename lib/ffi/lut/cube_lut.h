@@ -0,0 +1,53 @@
+#ifndef CUBE_LUT_H
+#define CUBE_LUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 3D colour LUTs in the .cube format (Resolve, Adobe), applied by the CPU
+// kernel and image_process.comp as the AKS_STAGE_LUT_3D stage. Engines find
+// LUTs by the id cube_lut_register hands out, which the caller puts in
+// AksAdjustmentParams.lut_id.
+
+#define CUBE_LUT_MIN_SIZE 2
+#define CUBE_LUT_MAX_SIZE 65
+
+typedef struct {
+    int32_t size;           // Entries per axis
+    float* data;            // size^3 entries of r, g, b, 0; red changes fastest,
+                            // then green, then blue. 16-byte aligned.
+    char title[128];        // TITLE, if the file has one
+} CubeLut;
+
+// Parse .cube text. Only 3D LUTs with the default 0-1 domain are accepted.
+// Returns NULL with a message in error (if not NULL) when the text isn't one.
+CubeLut* cube_lut_parse(const char* text, size_t length, char* error, size_t error_size);
+
+// cube_lut_parse on the contents of a file
+CubeLut* cube_lut_load(const char* path, char* error, size_t error_size);
+
+// Free a LUT that was never registered
+void cube_lut_free(CubeLut* lut);
+
+// Hand a LUT to the registry, which owns it from then on. Returns its id,
+// never 0, or 0 if the registry is full. Ids are not reused, so engines may
+// cache what they derive from a LUT by id.
+uint32_t cube_lut_register(CubeLut* lut);
+
+// Drop a registration. The LUT is freed once no engine is using it.
+void cube_lut_unregister(uint32_t id);
+
+// For the engines: a registered LUT, kept alive until cube_lut_release.
+// NULL if the id isn't registered.
+const CubeLut* cube_lut_acquire(uint32_t id);
+void cube_lut_release(const CubeLut* lut);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CUBE_LUT_H
@@ -0,0 +1,58 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Mirrors CubeLut in cube_lut.h
+final class NativeCubeLut extends Struct {
+  @Int32()
+  external int size;
+  external Pointer<Float> data;
+  @Array(128)
+  external Array<Uint8> title;
+}
+
+// Bindings for libcube_lut
+class CubeLutBindings {
+  final DynamicLibrary _lib;
+
+  CubeLutBindings(this._lib);
+
+  late final _cube_lut_parse = _lib.lookupFunction<
+      Pointer<NativeCubeLut> Function(Pointer<Utf8>, Size, Pointer<Utf8>, Size),
+      Pointer<NativeCubeLut> Function(Pointer<Utf8>, int, Pointer<Utf8>, int)>('cube_lut_parse');
+
+  late final _cube_lut_load = _lib.lookupFunction<
+      Pointer<NativeCubeLut> Function(Pointer<Utf8>, Pointer<Utf8>, Size),
+      Pointer<NativeCubeLut> Function(Pointer<Utf8>, Pointer<Utf8>, int)>('cube_lut_load');
+
+  late final _cube_lut_free = _lib.lookupFunction<
+      Void Function(Pointer<NativeCubeLut>),
+      void Function(Pointer<NativeCubeLut>)>('cube_lut_free');
+
+  late final _cube_lut_register = _lib.lookupFunction<
+      Uint32 Function(Pointer<NativeCubeLut>),
+      int Function(Pointer<NativeCubeLut>)>('cube_lut_register');
+
+  late final _cube_lut_unregister = _lib.lookupFunction<
+      Void Function(Uint32),
+      void Function(int)>('cube_lut_unregister');
+
+  Pointer<NativeCubeLut> cubeLutParse(Pointer<Utf8> text, int length, Pointer<Utf8> error, int errorSize) {
+    return _cube_lut_parse(text, length, error, errorSize);
+  }
+
+  Pointer<NativeCubeLut> cubeLutLoad(Pointer<Utf8> path, Pointer<Utf8> error, int errorSize) {
+    return _cube_lut_load(path, error, errorSize);
+  }
+
+  void cubeLutFree(Pointer<NativeCubeLut> lut) {
+    _cube_lut_free(lut);
+  }
+
+  int cubeLutRegister(Pointer<NativeCubeLut> lut) {
+    return _cube_lut_register(lut);
+  }
+
+  void cubeLutUnregister(int id) {
+    _cube_lut_unregister(id);
+  }
+}
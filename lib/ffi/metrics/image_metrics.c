@@ -0,0 +1,432 @@
+#include "image_metrics.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define SSIM_BLOCK 4                        // Windows are 2x2 blocks, one block apart
+#define SSIM_C1 (0.01 * 255.0 * 0.01 * 255.0)
+#define SSIM_C2 (0.03 * 255.0 * 0.03 * 255.0)
+
+typedef struct {
+    uint64_t abs_sum;
+    uint64_t square_sum;
+    int max_abs;
+} ErrorRow;
+
+typedef struct {
+    const uint8_t* reference;
+    const uint8_t* test;
+    size_t reference_stride;
+    size_t test_stride;
+    int width;
+    int height;
+    int channels;
+
+    ErrorRow* error_rows;               // One per image row
+
+    int ssim_rows;                      // Rows of windows
+    int ssim_columns;
+    int ssim_whole;                     // Image smaller than a window: one window over all of it
+    double* ssim_row_sums;
+
+    int delta_e_step;
+    int delta_e_rows;
+    int delta_e_columns;
+    float* delta_e;                     // delta_e_rows x delta_e_columns
+
+    int next_unit;
+    int unit_count;
+    pthread_mutex_t mutex;
+} MetricsJob;
+
+static float srgb_to_linear[256];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static void init_tables(void) {
+    for (int i = 0; i < 256; i++) {
+        double c = i / 255.0;
+        srgb_to_linear[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+    }
+}
+
+static inline const uint8_t* reference_row(const MetricsJob* job, int y) {
+    return job->reference + (size_t)y * job->reference_stride;
+}
+
+static inline const uint8_t* test_row(const MetricsJob* job, int y) {
+    return job->test + (size_t)y * job->test_stride;
+}
+
+static void error_row(MetricsJob* job, int y) {
+    const uint8_t* a = reference_row(job, y);
+    const uint8_t* b = test_row(job, y);
+    uint64_t abs_sum = 0, square_sum = 0;
+    int max_abs = 0;
+
+    for (int x = 0; x < job->width; x++, a += job->channels, b += job->channels) {
+        for (int c = 0; c < 3; c++) {
+            int d = abs((int)a[c] - (int)b[c]);
+            abs_sum += (uint64_t)d;
+            square_sum += (uint64_t)(d * d);
+            if (d > max_abs) max_abs = d;
+        }
+    }
+
+    job->error_rows[y].abs_sum = abs_sum;
+    job->error_rows[y].square_sum = square_sum;
+    job->error_rows[y].max_abs = max_abs;
+}
+
+// BT.601 luma in 8-bit integers, as in most SSIM reference implementations
+static inline int luma(const uint8_t* p) {
+    return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+}
+
+typedef struct {
+    int64_t a, b, aa, bb, ab;
+} WindowSums;
+
+static void block_sums(const MetricsJob* job, int x0, int y0, int w, int h, WindowSums* sums) {
+    memset(sums, 0, sizeof(*sums));
+    for (int y = y0; y < y0 + h; y++) {
+        const uint8_t* a = reference_row(job, y) + (size_t)x0 * job->channels;
+        const uint8_t* b = test_row(job, y) + (size_t)x0 * job->channels;
+        for (int x = 0; x < w; x++, a += job->channels, b += job->channels) {
+            int la = luma(a);
+            int lb = luma(b);
+            sums->a += la;
+            sums->b += lb;
+            sums->aa += la * la;
+            sums->bb += lb * lb;
+            sums->ab += la * lb;
+        }
+    }
+}
+
+static double window_ssim(const WindowSums* s, int64_t n) {
+    double inv = 1.0 / (double)n;
+    double mean_a = s->a * inv;
+    double mean_b = s->b * inv;
+    double var_a = s->aa * inv - mean_a * mean_a;
+    double var_b = s->bb * inv - mean_b * mean_b;
+    double covariance = s->ab * inv - mean_a * mean_b;
+    return ((2.0 * mean_a * mean_b + SSIM_C1) * (2.0 * covariance + SSIM_C2)) /
+           ((mean_a * mean_a + mean_b * mean_b + SSIM_C1) * (var_a + var_b + SSIM_C2));
+}
+
+// One row of 8x8 windows from two rows of 4x4 block sums
+static void ssim_row(MetricsJob* job, int row) {
+    if (job->ssim_whole) {
+        WindowSums sums;
+        block_sums(job, 0, 0, job->width, job->height, &sums);
+        job->ssim_row_sums[0] = window_ssim(&sums, (int64_t)job->width * job->height);
+        return;
+    }
+
+    int blocks = job->ssim_columns + 1;
+    WindowSums* top = malloc(sizeof(WindowSums) * blocks * 2);
+    if (!top) {
+        job->ssim_row_sums[row] = NAN;
+        return;
+    }
+    WindowSums* bottom = top + blocks;
+    for (int bx = 0; bx < blocks; bx++) {
+        block_sums(job, bx * SSIM_BLOCK, row * SSIM_BLOCK, SSIM_BLOCK, SSIM_BLOCK, &top[bx]);
+        block_sums(job, bx * SSIM_BLOCK, (row + 1) * SSIM_BLOCK, SSIM_BLOCK, SSIM_BLOCK, &bottom[bx]);
+    }
+
+    double sum = 0.0;
+    for (int wx = 0; wx < job->ssim_columns; wx++) {
+        WindowSums s = top[wx];
+        const WindowSums* parts[3] = { &top[wx + 1], &bottom[wx], &bottom[wx + 1] };
+        for (int i = 0; i < 3; i++) {
+            s.a += parts[i]->a;
+            s.b += parts[i]->b;
+            s.aa += parts[i]->aa;
+            s.bb += parts[i]->bb;
+            s.ab += parts[i]->ab;
+        }
+        sum += window_ssim(&s, 4 * SSIM_BLOCK * SSIM_BLOCK);
+    }
+    job->ssim_row_sums[row] = sum;
+    free(top);
+}
+
+static void srgb_to_lab(const uint8_t* p, double lab[3]) {
+    double r = srgb_to_linear[p[0]];
+    double g = srgb_to_linear[p[1]];
+    double b = srgb_to_linear[p[2]];
+
+    // sRGB to XYZ, relative to the D65 white
+    double xyz[3] = {
+        (0.4124564 * r + 0.3575761 * g + 0.1804375 * b) / 0.95047,
+        (0.2126729 * r + 0.7151522 * g + 0.0721750 * b),
+        (0.0193339 * r + 0.1191920 * g + 0.9503041 * b) / 1.08883
+    };
+    double f[3];
+    for (int i = 0; i < 3; i++) {
+        f[i] = xyz[i] > 216.0 / 24389.0 ? cbrt(xyz[i]) : (24389.0 / 27.0 * xyz[i] + 16.0) / 116.0;
+    }
+    lab[0] = 116.0 * f[1] - 16.0;
+    lab[1] = 500.0 * (f[0] - f[1]);
+    lab[2] = 200.0 * (f[1] - f[2]);
+}
+
+static double degrees(double radians) {
+    return radians * (180.0 / M_PI);
+}
+
+static double radians(double degrees) {
+    return degrees * (M_PI / 180.0);
+}
+
+// CIEDE2000 with kL = kC = kH = 1 (Sharma, Wu and Dalal 2005)
+static double ciede2000(const double lab1[3], const double lab2[3]) {
+    double c1 = hypot(lab1[1], lab1[2]);
+    double c2 = hypot(lab2[1], lab2[2]);
+    double c_mean7 = pow((c1 + c2) * 0.5, 7.0);
+    double g = 0.5 * (1.0 - sqrt(c_mean7 / (c_mean7 + 6103515625.0)));   // 25^7
+
+    double a1 = (1.0 + g) * lab1[1];
+    double a2 = (1.0 + g) * lab2[1];
+    double cp1 = hypot(a1, lab1[2]);
+    double cp2 = hypot(a2, lab2[2]);
+    double hp1 = (a1 == 0.0 && lab1[2] == 0.0) ? 0.0 : degrees(atan2(lab1[2], a1));
+    double hp2 = (a2 == 0.0 && lab2[2] == 0.0) ? 0.0 : degrees(atan2(lab2[2], a2));
+    if (hp1 < 0.0) hp1 += 360.0;
+    if (hp2 < 0.0) hp2 += 360.0;
+
+    double dl = lab2[0] - lab1[0];
+    double dc = cp2 - cp1;
+    double dh = 0.0;
+    if (cp1 * cp2 != 0.0) {
+        dh = hp2 - hp1;
+        if (dh > 180.0) dh -= 360.0;
+        else if (dh < -180.0) dh += 360.0;
+    }
+    double dH = 2.0 * sqrt(cp1 * cp2) * sin(radians(dh * 0.5));
+
+    double l_mean = (lab1[0] + lab2[0]) * 0.5;
+    double c_mean = (cp1 + cp2) * 0.5;
+    double h_mean = hp1 + hp2;
+    if (cp1 * cp2 != 0.0) {
+        if (fabs(hp1 - hp2) <= 180.0) h_mean *= 0.5;
+        else if (hp1 + hp2 < 360.0) h_mean = (h_mean + 360.0) * 0.5;
+        else h_mean = (h_mean - 360.0) * 0.5;
+    }
+
+    double t = 1.0 - 0.17 * cos(radians(h_mean - 30.0)) + 0.24 * cos(radians(2.0 * h_mean)) +
+               0.32 * cos(radians(3.0 * h_mean + 6.0)) - 0.20 * cos(radians(4.0 * h_mean - 63.0));
+    double l50 = (l_mean - 50.0) * (l_mean - 50.0);
+    double sl = 1.0 + 0.015 * l50 / sqrt(20.0 + l50);
+    double sc = 1.0 + 0.045 * c_mean;
+    double sh = 1.0 + 0.015 * c_mean * t;
+    double c_mean_p7 = pow(c_mean, 7.0);
+    double rotation = (h_mean - 275.0) / 25.0;
+    double rt = -2.0 * sqrt(c_mean_p7 / (c_mean_p7 + 6103515625.0)) *
+                sin(radians(60.0 * exp(-rotation * rotation)));
+
+    double tl = dl / sl;
+    double tc = dc / sc;
+    double th = dH / sh;
+    return sqrt(tl * tl + tc * tc + th * th + rt * tc * th);
+}
+
+static void delta_e_row(MetricsJob* job, int row) {
+    int y = row * job->delta_e_step;
+    const uint8_t* a = reference_row(job, y);
+    const uint8_t* b = test_row(job, y);
+    float* out = job->delta_e + (size_t)row * job->delta_e_columns;
+
+    for (int i = 0; i < job->delta_e_columns; i++) {
+        size_t offset = (size_t)i * job->delta_e_step * job->channels;
+        const uint8_t* pa = a + offset;
+        const uint8_t* pb = b + offset;
+        if (pa[0] == pb[0] && pa[1] == pb[1] && pa[2] == pb[2]) {
+            out[i] = 0.0f;
+            continue;
+        }
+        double lab_a[3], lab_b[3];
+        srgb_to_lab(pa, lab_a);
+        srgb_to_lab(pb, lab_b);
+        out[i] = (float)ciede2000(lab_a, lab_b);
+    }
+}
+
+// Units are image rows for the error sums, then rows of SSIM windows, then
+// rows of delta E samples, all handed out from one counter
+static void run_unit(MetricsJob* job, int unit) {
+    if (unit < job->height) {
+        error_row(job, unit);
+        return;
+    }
+    unit -= job->height;
+    if (unit < job->ssim_rows) {
+        ssim_row(job, unit);
+        return;
+    }
+    delta_e_row(job, unit - job->ssim_rows);
+}
+
+static void* metrics_worker(void* arg) {
+    MetricsJob* job = (MetricsJob*)arg;
+    while (1) {
+        pthread_mutex_lock(&job->mutex);
+        int unit = job->next_unit++;
+        pthread_mutex_unlock(&job->mutex);
+        if (unit >= job->unit_count) break;
+        run_unit(job, unit);
+    }
+    return NULL;
+}
+
+// Quickselect for the k-th smallest value; reorders values
+static float select_kth(float* values, size_t count, size_t k) {
+    size_t lo = 0, hi = count - 1;
+    while (lo < hi) {
+        float pivot = values[lo + (hi - lo) / 2];
+        size_t i = lo, j = hi;
+        while (i <= j) {
+            while (values[i] < pivot) i++;
+            while (values[j] > pivot) j--;
+            if (i <= j) {
+                float t = values[i];
+                values[i] = values[j];
+                values[j] = t;
+                i++;
+                if (j == 0) break;
+                j--;
+            }
+        }
+        if (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
+    return values[k];
+}
+
+void image_metrics_default_options(ImageMetricsOptions* options) {
+    if (!options) return;
+    options->delta_e_step = 4;
+    options->thread_count = 0;
+}
+
+int image_metrics_compare(
+    const uint8_t* reference,
+    size_t reference_stride,
+    const uint8_t* test,
+    size_t test_stride,
+    int width,
+    int height,
+    int channels,
+    const ImageMetricsOptions* options,
+    ImageMetrics* metrics
+) {
+    if (!reference || !test || !metrics || width <= 0 || height <= 0) return 0;
+    if (channels != 3 && channels != 4) {
+        fprintf(stderr, "image_metrics: unsupported channel count %d\n", channels);
+        return 0;
+    }
+    pthread_once(&tables_once, init_tables);
+
+    ImageMetricsOptions defaults;
+    image_metrics_default_options(&defaults);
+    if (!options) options = &defaults;
+
+    MetricsJob job = {
+        .reference = reference,
+        .test = test,
+        .reference_stride = reference_stride ? reference_stride : (size_t)width * channels,
+        .test_stride = test_stride ? test_stride : (size_t)width * channels,
+        .width = width,
+        .height = height,
+        .channels = channels,
+        .delta_e_step = options->delta_e_step > 0 ? options->delta_e_step : defaults.delta_e_step
+    };
+
+    if (width < 2 * SSIM_BLOCK || height < 2 * SSIM_BLOCK) {
+        job.ssim_whole = 1;
+        job.ssim_rows = 1;
+        job.ssim_columns = 1;
+    } else {
+        job.ssim_rows = height / SSIM_BLOCK - 1;
+        job.ssim_columns = width / SSIM_BLOCK - 1;
+    }
+    job.delta_e_rows = (height + job.delta_e_step - 1) / job.delta_e_step;
+    job.delta_e_columns = (width + job.delta_e_step - 1) / job.delta_e_step;
+    size_t delta_e_count = (size_t)job.delta_e_rows * job.delta_e_columns;
+
+    job.error_rows = malloc(sizeof(ErrorRow) * height);
+    job.ssim_row_sums = malloc(sizeof(double) * job.ssim_rows);
+    job.delta_e = malloc(sizeof(float) * delta_e_count);
+    if (!job.error_rows || !job.ssim_row_sums || !job.delta_e) {
+        fprintf(stderr, "image_metrics: out of memory\n");
+        free(job.error_rows);
+        free(job.ssim_row_sums);
+        free(job.delta_e);
+        return 0;
+    }
+
+    job.unit_count = height + job.ssim_rows + job.delta_e_rows;
+    pthread_mutex_init(&job.mutex, NULL);
+
+    int thread_count = options->thread_count;
+    if (thread_count <= 0) thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > job.unit_count) thread_count = job.unit_count;
+
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, metrics_worker, &job) != 0) break;
+            started++;
+        }
+    }
+    metrics_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&job.mutex);
+
+    uint64_t abs_sum = 0, square_sum = 0;
+    int max_abs = 0;
+    for (int y = 0; y < height; y++) {
+        abs_sum += job.error_rows[y].abs_sum;
+        square_sum += job.error_rows[y].square_sum;
+        if (job.error_rows[y].max_abs > max_abs) max_abs = job.error_rows[y].max_abs;
+    }
+    double samples = (double)width * height * 3.0;
+    double mse = square_sum / samples;
+
+    double ssim_sum = 0.0;
+    for (int r = 0; r < job.ssim_rows; r++) ssim_sum += job.ssim_row_sums[r];
+
+    double delta_e_sum = 0.0;
+    float delta_e_max = 0.0f;
+    for (size_t i = 0; i < delta_e_count; i++) {
+        delta_e_sum += job.delta_e[i];
+        if (job.delta_e[i] > delta_e_max) delta_e_max = job.delta_e[i];
+    }
+    float delta_e_p95 = delta_e_max > 0.0f
+        ? select_kth(job.delta_e, delta_e_count, (size_t)((delta_e_count - 1) * 0.95))
+        : 0.0f;
+
+    metrics->max_abs_error = max_abs;
+    metrics->mean_abs_error = abs_sum / samples;
+    metrics->psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+    metrics->ssim = ssim_sum / ((double)job.ssim_rows * job.ssim_columns);
+    metrics->delta_e_mean = delta_e_sum / (double)delta_e_count;
+    metrics->delta_e_max = delta_e_max;
+    metrics->delta_e_p95 = delta_e_p95;
+    metrics->delta_e_samples = (int64_t)delta_e_count;
+
+    free(job.error_rows);
+    free(job.ssim_row_sums);
+    free(job.delta_e);
+    return 1;
+}
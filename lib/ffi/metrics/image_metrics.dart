@@ -0,0 +1,167 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import 'image_metrics_bindings.dart';
+
+/// Quality limits for an approximate path; null limits are not checked
+class QualityBudget {
+  final int? maxAbsError;
+  final double? minPsnr;
+  final double? minSsim;
+  final double? maxDeltaE;
+  final double? maxDeltaEP95;
+
+  const QualityBudget({
+    this.maxAbsError,
+    this.minPsnr,
+    this.minSsim,
+    this.maxDeltaE,
+    this.maxDeltaEP95,
+  });
+}
+
+/// Result of comparing a test image against a reference
+class ImageQuality {
+  final int maxAbsError;
+  final double meanAbsError;
+  final double psnr;          // double.infinity for identical images
+  final double ssim;
+  final double deltaEMean;
+  final double deltaEMax;
+  final double deltaEP95;
+  final int deltaESamples;
+
+  const ImageQuality({
+    required this.maxAbsError,
+    required this.meanAbsError,
+    required this.psnr,
+    required this.ssim,
+    required this.deltaEMean,
+    required this.deltaEMax,
+    required this.deltaEP95,
+    required this.deltaESamples,
+  });
+
+  /// Descriptions of every limit of budget this result exceeds
+  List<String> violations(QualityBudget budget) {
+    return [
+      if (budget.maxAbsError != null && maxAbsError > budget.maxAbsError!)
+        'max error $maxAbsError > ${budget.maxAbsError}',
+      if (budget.minPsnr != null && psnr < budget.minPsnr!)
+        'PSNR ${psnr.toStringAsFixed(2)} < ${budget.minPsnr}',
+      if (budget.minSsim != null && ssim < budget.minSsim!)
+        'SSIM ${ssim.toStringAsFixed(5)} < ${budget.minSsim}',
+      if (budget.maxDeltaE != null && deltaEMean > budget.maxDeltaE!)
+        'mean ΔE ${deltaEMean.toStringAsFixed(3)} > ${budget.maxDeltaE}',
+      if (budget.maxDeltaEP95 != null && deltaEP95 > budget.maxDeltaEP95!)
+        'ΔE p95 ${deltaEP95.toStringAsFixed(3)} > ${budget.maxDeltaEP95}',
+    ];
+  }
+
+  bool meets(QualityBudget budget) => violations(budget).isEmpty;
+
+  @override
+  String toString() {
+    return 'max error $maxAbsError, mean error ${meanAbsError.toStringAsFixed(3)}, '
+        'PSNR ${psnr.isInfinite ? 'inf' : psnr.toStringAsFixed(2)} dB, '
+        'SSIM ${ssim.toStringAsFixed(5)}, '
+        'ΔE mean ${deltaEMean.toStringAsFixed(3)} p95 ${deltaEP95.toStringAsFixed(3)} '
+        'max ${deltaEMax.toStringAsFixed(3)}';
+  }
+}
+
+/// Native image quality metrics: error, PSNR, SSIM and CIEDE2000
+class ImageMetrics extends FfiBase {
+  static DynamicLibrary? _library;
+  static ImageMetricsBindings? _bindings;
+
+  /// Initialize the metrics library
+  static void initialize() {
+    if (_bindings != null) return;
+
+    _library = FfiBase.loadLibrary(
+      'image_metrics',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+
+    _bindings = ImageMetricsBindings(_library!);
+  }
+
+  static bool get isAvailable {
+    try {
+      initialize();
+      return true;
+    } catch (_) {
+      return false;
+    }
+  }
+
+  /// Compare two tightly packed 8-bit images of the same size. CIEDE2000 is
+  /// computed on every deltaEStep-th pixel in each direction.
+  static ImageQuality compare(
+    Uint8List reference,
+    Uint8List test,
+    int width,
+    int height, {
+    int channels = 4,
+    int deltaEStep = 4,
+  }) {
+    final size = width * height * channels;
+    if (reference.length < size || test.length < size) {
+      throw ArgumentError('Pixel buffers are smaller than ${width}x$height');
+    }
+    initialize();
+
+    final referencePointer = malloc<Uint8>(size);
+    final testPointer = malloc<Uint8>(size);
+    final options = calloc<NativeImageMetricsOptions>();
+    final metrics = calloc<NativeImageMetrics>();
+    try {
+      referencePointer.asTypedList(size).setAll(0, Uint8List.sublistView(reference, 0, size));
+      testPointer.asTypedList(size).setAll(0, Uint8List.sublistView(test, 0, size));
+      _bindings!.imageMetricsDefaultOptions(options);
+      options.ref.deltaEStep = deltaEStep;
+
+      final ok = _bindings!.imageMetricsCompare(
+        referencePointer,
+        0,
+        testPointer,
+        0,
+        width,
+        height,
+        channels,
+        options,
+        metrics,
+      );
+      if (ok == 0) {
+        throw Exception('Failed to compare images');
+      }
+
+      final m = metrics.ref;
+      return ImageQuality(
+        maxAbsError: m.maxAbsError,
+        meanAbsError: m.meanAbsError,
+        psnr: m.psnr,
+        ssim: m.ssim,
+        deltaEMean: m.deltaEMean,
+        deltaEMax: m.deltaEMax,
+        deltaEP95: m.deltaEP95,
+        deltaESamples: m.deltaESamples,
+      );
+    } finally {
+      malloc.free(referencePointer);
+      malloc.free(testPointer);
+      calloc.free(options);
+      calloc.free(metrics);
+    }
+  }
+}
@@ -0,0 +1,51 @@
+#ifndef IMAGE_METRICS_H
+#define IMAGE_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Full-reference quality metrics between two 8-bit sRGB images of the same
+// size, used to hold approximate processing paths to a quality budget.
+// Alpha is ignored.
+
+typedef struct {
+    int32_t delta_e_step;       // CIEDE2000 on every Nth pixel in x and y; <= 0 uses 4
+    int32_t thread_count;       // <= 0 uses every core
+} ImageMetricsOptions;
+
+typedef struct {
+    int32_t max_abs_error;      // Largest channel difference
+    double mean_abs_error;      // Over all RGB channels
+    double psnr;                // dB over RGB; INFINITY for identical images
+    double ssim;                // Mean SSIM of luma, 8x8 windows every 4 pixels
+    double delta_e_mean;        // CIEDE2000 over the sampled pixels
+    double delta_e_max;
+    double delta_e_p95;
+    int64_t delta_e_samples;
+} ImageMetrics;
+
+void image_metrics_default_options(ImageMetricsOptions* options);
+
+// channels is 3 or 4; a stride of 0 means tightly packed rows. options may
+// be NULL. Returns 1 on success.
+int image_metrics_compare(
+    const uint8_t* reference,
+    size_t reference_stride,
+    const uint8_t* test,
+    size_t test_stride,
+    int width,
+    int height,
+    int channels,
+    const ImageMetricsOptions* options,
+    ImageMetrics* metrics
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_METRICS_H
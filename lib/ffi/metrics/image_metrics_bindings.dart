@@ -0,0 +1,65 @@
+import 'dart:ffi';
+
+/// Mirrors ImageMetricsOptions in image_metrics.h
+final class NativeImageMetricsOptions extends Struct {
+  @Int32()
+  external int deltaEStep;
+  @Int32()
+  external int threadCount;
+}
+
+/// Mirrors ImageMetrics in image_metrics.h
+final class NativeImageMetrics extends Struct {
+  @Int32()
+  external int maxAbsError;
+  @Double()
+  external double meanAbsError;
+  @Double()
+  external double psnr;
+  @Double()
+  external double ssim;
+  @Double()
+  external double deltaEMean;
+  @Double()
+  external double deltaEMax;
+  @Double()
+  external double deltaEP95;
+  @Int64()
+  external int deltaESamples;
+}
+
+// Bindings for libimage_metrics
+class ImageMetricsBindings {
+  final DynamicLibrary _lib;
+
+  ImageMetricsBindings(this._lib);
+
+  late final _image_metrics_default_options = _lib.lookupFunction<
+      Void Function(Pointer<NativeImageMetricsOptions>),
+      void Function(Pointer<NativeImageMetricsOptions>)>('image_metrics_default_options');
+
+  late final _image_metrics_compare = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Size, Pointer<Uint8>, Size, Int32, Int32, Int32,
+          Pointer<NativeImageMetricsOptions>, Pointer<NativeImageMetrics>),
+      int Function(Pointer<Uint8>, int, Pointer<Uint8>, int, int, int, int,
+          Pointer<NativeImageMetricsOptions>, Pointer<NativeImageMetrics>)>('image_metrics_compare');
+
+  void imageMetricsDefaultOptions(Pointer<NativeImageMetricsOptions> options) {
+    _image_metrics_default_options(options);
+  }
+
+  int imageMetricsCompare(
+    Pointer<Uint8> reference,
+    int referenceStride,
+    Pointer<Uint8> test,
+    int testStride,
+    int width,
+    int height,
+    int channels,
+    Pointer<NativeImageMetricsOptions> options,
+    Pointer<NativeImageMetrics> metrics,
+  ) {
+    return _image_metrics_compare(reference, referenceStride, test, testStride,
+        width, height, channels, options, metrics);
+  }
+}
@@ -0,0 +1,241 @@
+// aks_metrics: compare two images and check them against quality budgets.
+//
+//   aks_metrics [options] reference test
+//
+// Images are binary PPM (P6) or PAM (P7, RGB or RGB_ALPHA), 8 bits per
+// channel. Exits 0 when every budget given holds, 1 when one is exceeded
+// and 2 on errors.
+
+#include "image_metrics.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int width;
+    int height;
+    int channels;
+    uint8_t* pixels;
+} Image;
+
+// Next header token, skipping whitespace and comments
+static int read_token(FILE* file, char* token, size_t size) {
+    int c = fgetc(file);
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = fgetc(file);
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            c = fgetc(file);
+        } else {
+            break;
+        }
+    }
+    size_t length = 0;
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        if (length + 1 < size) token[length++] = (char)c;
+        c = fgetc(file);
+    }
+    token[length] = '\0';
+    return length > 0;
+}
+
+static int read_pam_header(FILE* file, Image* image, int* maxval) {
+    char token[64];
+    while (read_token(file, token, sizeof(token))) {
+        if (strcmp(token, "ENDHDR") == 0) return 1;
+        if (strcmp(token, "WIDTH") == 0 && read_token(file, token, sizeof(token))) {
+            image->width = atoi(token);
+        } else if (strcmp(token, "HEIGHT") == 0 && read_token(file, token, sizeof(token))) {
+            image->height = atoi(token);
+        } else if (strcmp(token, "DEPTH") == 0 && read_token(file, token, sizeof(token))) {
+            image->channels = atoi(token);
+        } else if (strcmp(token, "MAXVAL") == 0 && read_token(file, token, sizeof(token))) {
+            *maxval = atoi(token);
+        } else if (strcmp(token, "TUPLTYPE") == 0) {
+            read_token(file, token, sizeof(token));
+        }
+    }
+    return 0;
+}
+
+static int load_image(const char* path, Image* image) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "aks_metrics: cannot open %s\n", path);
+        return 0;
+    }
+
+    char token[64];
+    int maxval = 0;
+    int ok = read_token(file, token, sizeof(token));
+    memset(image, 0, sizeof(*image));
+    if (ok && strcmp(token, "P6") == 0) {
+        image->channels = 3;
+        char w[16], h[16], m[16];
+        ok = read_token(file, w, sizeof(w)) && read_token(file, h, sizeof(h)) &&
+             read_token(file, m, sizeof(m));
+        image->width = atoi(w);
+        image->height = atoi(h);
+        maxval = atoi(m);
+    } else if (ok && strcmp(token, "P7") == 0) {
+        ok = read_pam_header(file, image, &maxval);
+    } else {
+        ok = 0;
+    }
+
+    if (!ok || maxval != 255 || image->width <= 0 || image->height <= 0 ||
+        (image->channels != 3 && image->channels != 4)) {
+        fprintf(stderr, "aks_metrics: %s is not an 8-bit RGB PPM or PAM file\n", path);
+        fclose(file);
+        return 0;
+    }
+
+    size_t size = (size_t)image->width * image->height * image->channels;
+    image->pixels = malloc(size);
+    if (!image->pixels || fread(image->pixels, 1, size, file) != size) {
+        fprintf(stderr, "aks_metrics: %s is truncated\n", path);
+        free(image->pixels);
+        image->pixels = NULL;
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    return 1;
+}
+
+// Repack to the channel count of the reference so strides match
+static int match_channels(Image* image, int channels) {
+    if (image->channels == channels) return 1;
+    size_t count = (size_t)image->width * image->height;
+    uint8_t* pixels = malloc(count * channels);
+    if (!pixels) return 0;
+    for (size_t i = 0; i < count; i++) {
+        memcpy(pixels + i * channels, image->pixels + i * image->channels, 3);
+        if (channels == 4) pixels[i * 4 + 3] = 255;
+    }
+    free(image->pixels);
+    image->pixels = pixels;
+    image->channels = channels;
+    return 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+        "usage: aks_metrics [options] reference test\n"
+        "  --step N            CIEDE2000 on every Nth pixel (default 4)\n"
+        "  --threads N         worker threads (default: all cores)\n"
+        "  --max-error N       fail if any channel differs by more than N\n"
+        "  --min-psnr DB       fail below this PSNR\n"
+        "  --min-ssim X        fail below this SSIM\n"
+        "  --max-delta-e X     fail if the mean CIEDE2000 is above X\n"
+        "  --max-delta-e-p95 X fail if the 95th percentile CIEDE2000 is above X\n"
+        "  --json              print the metrics as JSON\n");
+}
+
+int main(int argc, char** argv) {
+    ImageMetricsOptions options;
+    image_metrics_default_options(&options);
+
+    const char* paths[2] = { NULL, NULL };
+    int path_count = 0;
+    int json = 0;
+    double max_error = -1.0, min_psnr = -1.0, min_ssim = -1.0;
+    double max_delta_e = -1.0, max_delta_e_p95 = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+        if (strcmp(arg, "--json") == 0) {
+            json = 1;
+        } else if (strcmp(arg, "--step") == 0 && has_value) {
+            options.delta_e_step = atoi(argv[++i]);
+        } else if (strcmp(arg, "--threads") == 0 && has_value) {
+            options.thread_count = atoi(argv[++i]);
+        } else if (strcmp(arg, "--max-error") == 0 && has_value) {
+            max_error = atof(argv[++i]);
+        } else if (strcmp(arg, "--min-psnr") == 0 && has_value) {
+            min_psnr = atof(argv[++i]);
+        } else if (strcmp(arg, "--min-ssim") == 0 && has_value) {
+            min_ssim = atof(argv[++i]);
+        } else if (strcmp(arg, "--max-delta-e") == 0 && has_value) {
+            max_delta_e = atof(argv[++i]);
+        } else if (strcmp(arg, "--max-delta-e-p95") == 0 && has_value) {
+            max_delta_e_p95 = atof(argv[++i]);
+        } else if (arg[0] != '-' && path_count < 2) {
+            paths[path_count++] = arg;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (path_count != 2) {
+        usage();
+        return 2;
+    }
+
+    Image reference, test;
+    if (!load_image(paths[0], &reference)) return 2;
+    if (!load_image(paths[1], &test)) {
+        free(reference.pixels);
+        return 2;
+    }
+
+    int status = 2;
+    ImageMetrics metrics;
+    if (reference.width != test.width || reference.height != test.height) {
+        fprintf(stderr, "aks_metrics: size mismatch, %dx%d vs %dx%d\n",
+                reference.width, reference.height, test.width, test.height);
+    } else if (!match_channels(&test, reference.channels)) {
+        fprintf(stderr, "aks_metrics: out of memory\n");
+    } else if (image_metrics_compare(reference.pixels, 0, test.pixels, 0, reference.width,
+                                     reference.height, reference.channels, &options, &metrics)) {
+        if (json) {
+            // JSON has no infinity; identical images report a null PSNR
+            char psnr[32];
+            if (isinf(metrics.psnr)) snprintf(psnr, sizeof(psnr), "null");
+            else snprintf(psnr, sizeof(psnr), "%.4f", metrics.psnr);
+            printf("{\"max_abs_error\": %d, \"mean_abs_error\": %.6f, \"psnr\": %s, "
+                   "\"ssim\": %.6f, \"delta_e_mean\": %.6f, \"delta_e_p95\": %.6f, "
+                   "\"delta_e_max\": %.6f, \"delta_e_samples\": %lld}\n",
+                   metrics.max_abs_error, metrics.mean_abs_error, psnr, metrics.ssim,
+                   metrics.delta_e_mean, metrics.delta_e_p95, metrics.delta_e_max,
+                   (long long)metrics.delta_e_samples);
+        } else {
+            printf("max abs error   %d\n", metrics.max_abs_error);
+            printf("mean abs error  %.4f\n", metrics.mean_abs_error);
+            printf("PSNR            %.2f dB\n", metrics.psnr);
+            printf("SSIM            %.6f\n", metrics.ssim);
+            printf("delta E mean    %.4f\n", metrics.delta_e_mean);
+            printf("delta E p95     %.4f\n", metrics.delta_e_p95);
+            printf("delta E max     %.4f (%lld samples)\n", metrics.delta_e_max,
+                   (long long)metrics.delta_e_samples);
+        }
+
+        status = 0;
+        if (max_error >= 0.0 && metrics.max_abs_error > max_error) {
+            fprintf(stderr, "aks_metrics: max error %d above %g\n", metrics.max_abs_error, max_error);
+            status = 1;
+        }
+        if (min_psnr >= 0.0 && metrics.psnr < min_psnr) {
+            fprintf(stderr, "aks_metrics: PSNR %.2f below %g\n", metrics.psnr, min_psnr);
+            status = 1;
+        }
+        if (min_ssim >= 0.0 && metrics.ssim < min_ssim) {
+            fprintf(stderr, "aks_metrics: SSIM %.6f below %g\n", metrics.ssim, min_ssim);
+            status = 1;
+        }
+        if (max_delta_e >= 0.0 && metrics.delta_e_mean > max_delta_e) {
+            fprintf(stderr, "aks_metrics: mean delta E %.4f above %g\n", metrics.delta_e_mean, max_delta_e);
+            status = 1;
+        }
+        if (max_delta_e_p95 >= 0.0 && metrics.delta_e_p95 > max_delta_e_p95) {
+            fprintf(stderr, "aks_metrics: delta E p95 %.4f above %g\n", metrics.delta_e_p95, max_delta_e_p95);
+            status = 1;
+        }
+    }
+
+    free(reference.pixels);
+    free(test.pixels);
+    return status;
+}
@@ -0,0 +1,664 @@
+#include "dng_tiles.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DNG_MAX_IFDS 32
+
+// TIFF tags used here
+#define TAG_NEW_SUBFILE_TYPE 254
+#define TAG_IMAGE_WIDTH 256
+#define TAG_IMAGE_LENGTH 257
+#define TAG_BITS_PER_SAMPLE 258
+#define TAG_COMPRESSION 259
+#define TAG_PHOTOMETRIC 262
+#define TAG_SAMPLES_PER_PIXEL 277
+#define TAG_TILE_WIDTH 322
+#define TAG_TILE_LENGTH 323
+#define TAG_TILE_OFFSETS 324
+#define TAG_TILE_BYTE_COUNTS 325
+#define TAG_SUB_IFDS 330
+#define TAG_DNG_VERSION 50706
+#define TAG_WHITE_LEVEL 50717
+
+#define TIFF_SHORT 3
+#define TIFF_LONG 4
+#define TIFF_IFD 13
+
+#define COMPRESSION_NONE 1
+#define COMPRESSION_LOSSLESS_JPEG 7
+#define PHOTOMETRIC_CFA 32803
+
+// ---------------------------------------------------------------------------
+// TIFF structure
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    int big_endian;
+} TiffFile;
+
+static uint32_t tiff_get16(const TiffFile* tiff, size_t pos) {
+    if (pos + 2 > tiff->size) return 0;
+    const uint8_t* p = tiff->data + pos;
+    return tiff->big_endian ? (uint32_t)(p[0] << 8 | p[1]) : (uint32_t)(p[1] << 8 | p[0]);
+}
+
+static uint32_t tiff_get32(const TiffFile* tiff, size_t pos) {
+    if (pos + 4 > tiff->size) return 0;
+    const uint8_t* p = tiff->data + pos;
+    if (tiff->big_endian) {
+        return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+    }
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static void tiff_put16(uint8_t* p, int big_endian, uint32_t value) {
+    if (big_endian) {
+        p[0] = (uint8_t)(value >> 8);
+        p[1] = (uint8_t)value;
+    } else {
+        p[0] = (uint8_t)value;
+        p[1] = (uint8_t)(value >> 8);
+    }
+}
+
+static void tiff_put32(uint8_t* p, int big_endian, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[big_endian ? 3 - i : i] = (uint8_t)(value >> (i * 8));
+    }
+}
+
+static int tiff_type_size(uint32_t type) {
+    switch (type) {
+        case 3: case 8: return 2;
+        case 4: case 9: case 11: case 13: return 4;
+        case 5: case 10: case 12: return 8;
+        default: return 1;
+    }
+}
+
+// One IFD entry: where its value lives and how to read it
+typedef struct {
+    uint32_t type;
+    uint32_t count;
+    size_t value_pos;
+} TiffEntry;
+
+static TiffEntry tiff_entry(const TiffFile* tiff, size_t entry_pos) {
+    TiffEntry entry;
+    entry.type = tiff_get16(tiff, entry_pos + 2);
+    entry.count = tiff_get32(tiff, entry_pos + 4);
+    uint64_t bytes = (uint64_t)entry.count * tiff_type_size(entry.type);
+    entry.value_pos = bytes <= 4 ? entry_pos + 8 : tiff_get32(tiff, entry_pos + 8);
+    return entry;
+}
+
+static uint32_t tiff_scalar(const TiffFile* tiff, const TiffEntry* entry) {
+    return entry->type == TIFF_SHORT ? tiff_get16(tiff, entry->value_pos)
+                                     : tiff_get32(tiff, entry->value_pos);
+}
+
+// The tags of an IFD that decide whether its raw image can be rewritten
+typedef struct {
+    uint32_t subfile_type;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bits;
+    uint32_t compression;
+    uint32_t photometric;
+    uint32_t samples;
+    uint32_t tile_width;
+    uint32_t tile_length;
+    int has_white_level;
+    TiffEntry bits_entry;
+    TiffEntry compression_entry;
+    TiffEntry offsets;
+    TiffEntry byte_counts;
+} RawIfd;
+
+// Parse the IFD at offset; queues its sub IFDs. Returns the next IFD offset.
+static uint32_t parse_ifd(const TiffFile* tiff, uint32_t offset, RawIfd* ifd, int* is_dng,
+                          uint32_t* queue, int* queue_count) {
+    memset(ifd, 0, sizeof(*ifd));
+    ifd->samples = 1;
+
+    uint32_t count = tiff_get16(tiff, offset);
+    if ((uint64_t)offset + 2 + (uint64_t)count * 12 + 4 > tiff->size) return 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        size_t entry_pos = (size_t)offset + 2 + i * 12;
+        uint32_t tag = tiff_get16(tiff, entry_pos);
+        TiffEntry entry = tiff_entry(tiff, entry_pos);
+
+        switch (tag) {
+            case TAG_NEW_SUBFILE_TYPE: ifd->subfile_type = tiff_scalar(tiff, &entry); break;
+            case TAG_IMAGE_WIDTH: ifd->width = tiff_scalar(tiff, &entry); break;
+            case TAG_IMAGE_LENGTH: ifd->height = tiff_scalar(tiff, &entry); break;
+            case TAG_BITS_PER_SAMPLE:
+                ifd->bits = tiff_scalar(tiff, &entry);
+                ifd->bits_entry = entry;
+                break;
+            case TAG_COMPRESSION:
+                ifd->compression = tiff_scalar(tiff, &entry);
+                ifd->compression_entry = entry;
+                break;
+            case TAG_PHOTOMETRIC: ifd->photometric = tiff_scalar(tiff, &entry); break;
+            case TAG_SAMPLES_PER_PIXEL: ifd->samples = tiff_scalar(tiff, &entry); break;
+            case TAG_TILE_WIDTH: ifd->tile_width = tiff_scalar(tiff, &entry); break;
+            case TAG_TILE_LENGTH: ifd->tile_length = tiff_scalar(tiff, &entry); break;
+            case TAG_TILE_OFFSETS: ifd->offsets = entry; break;
+            case TAG_TILE_BYTE_COUNTS: ifd->byte_counts = entry; break;
+            case TAG_WHITE_LEVEL: ifd->has_white_level = 1; break;
+            case TAG_DNG_VERSION: *is_dng = 1; break;
+            case TAG_SUB_IFDS:
+                if (entry.type == TIFF_LONG || entry.type == TIFF_IFD) {
+                    for (uint32_t s = 0; s < entry.count && *queue_count < DNG_MAX_IFDS; s++) {
+                        queue[(*queue_count)++] = tiff_get32(tiff, entry.value_pos + s * 4);
+                    }
+                }
+                break;
+        }
+    }
+
+    return tiff_get32(tiff, (size_t)offset + 2 + count * 12);
+}
+
+// Full-resolution CFA image in lossless JPEG tiles, with the tag layout the
+// in-place rewrite needs
+static int ifd_qualifies(const RawIfd* ifd) {
+    if (ifd->subfile_type != 0 || ifd->compression != COMPRESSION_LOSSLESS_JPEG ||
+        ifd->photometric != PHOTOMETRIC_CFA || ifd->samples != 1 ||
+        ifd->bits < 8 || ifd->bits > 16 || !ifd->has_white_level ||
+        ifd->width == 0 || ifd->height == 0 || ifd->tile_width == 0 || ifd->tile_length == 0) {
+        return 0;
+    }
+    if (ifd->bits_entry.count != 1 || ifd->compression_entry.count != 1) return 0;
+
+    uint64_t tiles = (uint64_t)((ifd->width + ifd->tile_width - 1) / ifd->tile_width) *
+                     ((ifd->height + ifd->tile_length - 1) / ifd->tile_length);
+    return tiles > 1 &&
+           ifd->offsets.type == TIFF_LONG && ifd->offsets.count == tiles &&
+           ifd->byte_counts.type == TIFF_LONG && ifd->byte_counts.count == tiles;
+}
+
+// ---------------------------------------------------------------------------
+// Lossless JPEG (ITU T.81 process 14), as written by DNG converters
+
+typedef struct {
+    int32_t maxcode[17];    // Largest code of each length, -1 if none
+    int32_t mincode[17];
+    int32_t valptr[17];
+    uint8_t values[256];
+    uint16_t lookup[256];   // (length << 8) | value for codes up to 8 bits
+} LjHuffman;
+
+typedef struct {
+    int bits;
+    int high;
+    int wide;
+    int components;
+    int predictor;
+    LjHuffman tables[4];
+    int table_of[4];        // Huffman table of each component
+    const uint8_t* scan;
+    size_t scan_size;
+} LjFrame;
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    size_t pos;
+    uint64_t bits;
+    int count;
+} LjBits;
+
+static int lj_build_huffman(LjHuffman* table, const uint8_t counts[16], const uint8_t* values, int total) {
+    memset(table, 0, sizeof(*table));
+    if (total > 256) return 0;
+    memcpy(table->values, values, total);
+
+    int code = 0;
+    int k = 0;
+    for (int length = 1; length <= 16; length++) {
+        int n = counts[length - 1];
+        table->valptr[length] = k;
+        table->mincode[length] = code;
+        if (length <= 8) {
+            for (int i = 0; i < n; i++) {
+                int shift = 8 - length;
+                for (int j = 0; j < (1 << shift); j++) {
+                    table->lookup[((code + i) << shift) | j] = (uint16_t)(length << 8 | values[k + i]);
+                }
+            }
+        }
+        code += n;
+        k += n;
+        table->maxcode[length] = n ? code - 1 : -1;
+        code <<= 1;
+    }
+    return 1;
+}
+
+// Parse the headers up to the start of the scan
+static int lj_parse(const uint8_t* data, size_t size, LjFrame* frame) {
+    memset(frame, 0, sizeof(*frame));
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return 0;
+
+    size_t pos = 2;
+    int have_frame = 0;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) return 0;
+        int marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        size_t length = (size_t)data[pos + 2] << 8 | data[pos + 3];
+        size_t segment = pos + 4;
+        size_t end = pos + 2 + length;
+        if (length < 2 || end > size) return 0;
+
+        switch (marker) {
+            case 0xC4:  // DHT
+                while (segment + 17 <= end) {
+                    int id = data[segment] & 3;
+                    const uint8_t* counts = data + segment + 1;
+                    int total = 0;
+                    for (int i = 0; i < 16; i++) total += counts[i];
+                    if (segment + 17 + total > end ||
+                        !lj_build_huffman(&frame->tables[id], counts, data + segment + 17, total)) {
+                        return 0;
+                    }
+                    segment += 17 + total;
+                }
+                break;
+            case 0xC3:  // SOF3
+                if (length < 8) return 0;
+                frame->bits = data[segment];
+                frame->high = data[segment + 1] << 8 | data[segment + 2];
+                frame->wide = data[segment + 3] << 8 | data[segment + 4];
+                frame->components = data[segment + 5];
+                have_frame = 1;
+                break;
+            case 0xDD:  // DRI; DNG writers don't use restarts
+                if (length >= 4 && (data[segment] | data[segment + 1])) return 0;
+                break;
+            case 0xDA: {  // SOS
+                int count = data[segment];
+                if (!have_frame || count != frame->components || count < 1 || count > 4 ||
+                    length < (size_t)(6 + count * 2)) {
+                    return 0;
+                }
+                for (int c = 0; c < count; c++) {
+                    frame->table_of[c] = (data[segment + 2 + c * 2] >> 4) & 3;
+                }
+                frame->predictor = data[segment + 1 + count * 2];
+                frame->scan = data + end;
+                frame->scan_size = size - end;
+                return frame->bits >= 2 && frame->bits <= 16 && frame->high > 0 && frame->wide > 0 &&
+                       frame->predictor >= 1 && frame->predictor <= 7;
+            }
+            default:
+                if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+                    return 0;   // Not lossless
+                }
+                break;
+        }
+        pos = end;
+    }
+    return 0;
+}
+
+static inline void lj_fill(LjBits* bits) {
+    while (bits->count <= 56) {
+        uint8_t byte = 0;
+        if (bits->pos < bits->size) {
+            byte = bits->data[bits->pos];
+            if (byte == 0xFF) {
+                uint8_t next = bits->pos + 1 < bits->size ? bits->data[bits->pos + 1] : 0;
+                if (next == 0x00) {
+                    bits->pos += 2;
+                } else {
+                    byte = 0;   // Marker: feed zeros from here on
+                }
+            } else {
+                bits->pos++;
+            }
+        }
+        bits->bits |= (uint64_t)byte << (56 - bits->count);
+        bits->count += 8;
+    }
+}
+
+static inline int lj_decode(LjBits* bits, const LjHuffman* table) {
+    lj_fill(bits);
+    uint16_t entry = table->lookup[bits->bits >> 56];
+    if (entry) {
+        bits->bits <<= entry >> 8;
+        bits->count -= entry >> 8;
+        return entry & 0xFF;
+    }
+    for (int length = 9; length <= 16; length++) {
+        int32_t code = (int32_t)(bits->bits >> (64 - length));
+        if (code <= table->maxcode[length]) {
+            bits->bits <<= length;
+            bits->count -= length;
+            return table->values[(table->valptr[length] + code - table->mincode[length]) & 0xFF];
+        }
+    }
+    return -1;
+}
+
+static inline int lj_diff(LjBits* bits, const LjHuffman* table, int* error) {
+    int length = lj_decode(bits, table);
+    if (length <= 0) {
+        if (length < 0) *error = 1;
+        return 0;
+    }
+    if (length == 16) return -32768;
+    if (length > 16) {
+        *error = 1;
+        return 0;
+    }
+    int value = (int)(bits->bits >> (64 - length));
+    bits->bits <<= length;
+    bits->count -= length;
+    if ((value & (1 << (length - 1))) == 0) value -= (1 << length) - 1;
+    return value;
+}
+
+// Decode one tile into tile_width x tile_length samples. Decoded samples
+// fill the tile row by row, wrapping at wrap_width (LibRaw's layout).
+static int lj_decode_tile(const uint8_t* data, size_t size, uint16_t* tile,
+                          int tile_width, int tile_length, int wrap_width) {
+    LjFrame frame;
+    if (!lj_parse(data, size, &frame)) return 0;
+
+    int clrs = frame.components;
+    int row_length = frame.wide * clrs;
+    uint16_t* rows = malloc(sizeof(uint16_t) * row_length * 2);
+    if (!rows) return 0;
+
+    LjBits bits = { .data = frame.scan, .size = frame.scan_size };
+    int vpred[4];
+    for (int c = 0; c < clrs; c++) vpred[c] = 1 << (frame.bits - 1);
+
+    int error = 0;
+    int out_row = 0, out_col = 0;
+    for (int jrow = 0; jrow < frame.high && !error; jrow++) {
+        uint16_t* cur = rows + (jrow & 1) * row_length;
+        uint16_t* prev = rows + ((jrow + 1) & 1) * row_length;
+
+        for (int col = 0; col < frame.wide; col++) {
+            for (int c = 0; c < clrs; c++) {
+                int i = col * clrs + c;
+                int diff = lj_diff(&bits, &frame.tables[frame.table_of[c]], &error);
+                int pred;
+                if (col == 0) {
+                    // First column predicts from the row above
+                    pred = vpred[c];
+                    vpred[c] += diff;
+                } else {
+                    pred = cur[i - clrs];
+                    if (jrow) {
+                        int above = prev[i];
+                        int corner = prev[i - clrs];
+                        switch (frame.predictor) {
+                            case 2: pred = above; break;
+                            case 3: pred = corner; break;
+                            case 4: pred = pred + above - corner; break;
+                            case 5: pred = pred + ((above - corner) >> 1); break;
+                            case 6: pred = above + ((pred - corner) >> 1); break;
+                            case 7: pred = (pred + above) >> 1; break;
+                        }
+                    }
+                }
+                cur[i] = (uint16_t)(pred + diff);
+            }
+        }
+
+        for (int i = 0; i < row_length; i++) {
+            if (out_row < tile_length) {
+                tile[(size_t)out_row * tile_width + out_col] = cur[i];
+            }
+            if (++out_col >= wrap_width) {
+                out_col = 0;
+                out_row++;
+            }
+        }
+    }
+
+    free(rows);
+    return !error;
+}
+
+// ---------------------------------------------------------------------------
+// Rewrite
+
+typedef struct {
+    const TiffFile* tiff;
+    const RawIfd* ifd;
+    uint8_t* output;
+    size_t tiles_start;
+    size_t tile_bytes;
+    int tile_count;
+    int next_tile;
+    int failed;
+    pthread_mutex_t mutex;
+} DecodeJob;
+
+static int next_tile(DecodeJob* job) {
+    pthread_mutex_lock(&job->mutex);
+    int index = job->failed ? job->tile_count : job->next_tile++;
+    pthread_mutex_unlock(&job->mutex);
+    return index;
+}
+
+static void* decode_worker(void* arg) {
+    DecodeJob* job = arg;
+    const RawIfd* ifd = job->ifd;
+    int wrap_width = (int)(ifd->tile_width < ifd->width ? ifd->tile_width : ifd->width);
+    uint16_t* tile = malloc(job->tile_bytes);
+    if (!tile) {
+        pthread_mutex_lock(&job->mutex);
+        job->failed = 1;
+        pthread_mutex_unlock(&job->mutex);
+        return NULL;
+    }
+
+    for (int index = next_tile(job); index < job->tile_count; index = next_tile(job)) {
+        uint32_t offset = tiff_get32(job->tiff, ifd->offsets.value_pos + (size_t)index * 4);
+        uint32_t bytes = tiff_get32(job->tiff, ifd->byte_counts.value_pos + (size_t)index * 4);
+        int ok = (uint64_t)offset + bytes <= job->tiff->size;
+
+        memset(tile, 0, job->tile_bytes);
+        ok = ok && lj_decode_tile(job->tiff->data + offset, bytes, tile,
+                                  (int)ifd->tile_width, (int)ifd->tile_length, wrap_width);
+
+        if (ok) {
+            uint8_t* out = job->output + job->tiles_start + (size_t)index * job->tile_bytes;
+            size_t samples = job->tile_bytes / 2;
+            for (size_t i = 0; i < samples; i++) {
+                tiff_put16(out + i * 2, job->tiff->big_endian, tile[i]);
+            }
+        } else {
+            pthread_mutex_lock(&job->mutex);
+            job->failed = 1;
+            pthread_mutex_unlock(&job->mutex);
+        }
+    }
+
+    free(tile);
+    return NULL;
+}
+
+static void put_scalar(uint8_t* output, int big_endian, const TiffEntry* entry, uint32_t value) {
+    if (entry->type == TIFF_SHORT) {
+        tiff_put16(output + entry->value_pos, big_endian, value);
+    } else {
+        tiff_put32(output + entry->value_pos, big_endian, value);
+    }
+}
+
+int dng_tiles_decompress(
+    const uint8_t* data,
+    size_t size,
+    int thread_count,
+    uint8_t** output,
+    size_t* output_size
+) {
+    if (!data || size < 8 || !output || !output_size) return 0;
+
+    TiffFile tiff = { .data = data, .size = size };
+    if (data[0] == 'I' && data[1] == 'I') {
+        tiff.big_endian = 0;
+    } else if (data[0] == 'M' && data[1] == 'M') {
+        tiff.big_endian = 1;
+    } else {
+        return 0;
+    }
+    if (tiff_get16(&tiff, 2) != 42) return 0;
+
+    // Walk the IFD0 chain and the sub IFDs for the raw image
+    uint32_t queue[DNG_MAX_IFDS];
+    int in_chain[DNG_MAX_IFDS];
+    int queue_count = 1;
+    queue[0] = tiff_get32(&tiff, 4);
+    in_chain[0] = 1;
+
+    RawIfd ifd, raw;
+    int found = 0;
+    int is_dng = 0;
+    for (int i = 0; i < queue_count; i++) {
+        int seen = queue[i] == 0 || queue[i] >= size;
+        for (int j = 0; j < i && !seen; j++) seen = queue[j] == queue[i];
+        if (seen) continue;
+
+        int first_sub = queue_count;
+        uint32_t next = parse_ifd(&tiff, queue[i], &ifd, &is_dng, queue, &queue_count);
+        for (int j = first_sub; j < queue_count; j++) in_chain[j] = 0;
+
+        if (!found && ifd_qualifies(&ifd)) {
+            raw = ifd;
+            found = 1;
+        }
+        // Only IFD0 continues into a chain
+        if (in_chain[i] && next && queue_count < DNG_MAX_IFDS) {
+            in_chain[queue_count] = 1;
+            queue[queue_count++] = next;
+        }
+    }
+    if (!is_dng || !found) return 0;
+
+    int tile_count = (int)raw.offsets.count;
+    size_t tile_bytes = (size_t)raw.tile_width * raw.tile_length * 2;
+    size_t tiles_start = (size + 1) & ~(size_t)1;
+    uint64_t total = (uint64_t)tiles_start + (uint64_t)tile_count * tile_bytes;
+    if (total > UINT32_MAX) return 0;   // Offsets are 32-bit
+
+    uint8_t* rewritten = malloc(total);
+    if (!rewritten) return 0;
+    memcpy(rewritten, data, size);
+    if (tiles_start > size) rewritten[size] = 0;
+
+    DecodeJob job = {
+        .tiff = &tiff,
+        .ifd = &raw,
+        .output = rewritten,
+        .tiles_start = tiles_start,
+        .tile_bytes = tile_bytes,
+        .tile_count = tile_count
+    };
+    pthread_mutex_init(&job.mutex, NULL);
+
+    if (thread_count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (int)cores : 1;
+    }
+    if (thread_count > tile_count) thread_count = tile_count;
+
+    // The calling thread is one of the workers
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        while (started < thread_count - 1 &&
+               pthread_create(&threads[started], NULL, decode_worker, &job) == 0) {
+            started++;
+        }
+    }
+    decode_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&job.mutex);
+
+    if (job.failed) {
+        free(rewritten);
+        return 0;
+    }
+
+    // Point the raw IFD at the uncompressed tiles
+    for (int i = 0; i < tile_count; i++) {
+        tiff_put32(rewritten + raw.offsets.value_pos + (size_t)i * 4, tiff.big_endian,
+                   (uint32_t)(tiles_start + (size_t)i * tile_bytes));
+        tiff_put32(rewritten + raw.byte_counts.value_pos + (size_t)i * 4, tiff.big_endian,
+                   (uint32_t)tile_bytes);
+    }
+    put_scalar(rewritten, tiff.big_endian, &raw.compression_entry, COMPRESSION_NONE);
+    put_scalar(rewritten, tiff.big_endian, &raw.bits_entry, 16);
+
+    *output = rewritten;
+    *output_size = (size_t)total;
+    return 1;
+}
+
+static uint8_t* read_file(const char* filename, size_t* size) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+
+    uint8_t* data = NULL;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length > 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data = malloc((size_t)length);
+            if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+                free(data);
+                data = NULL;
+            }
+            *size = (size_t)length;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+int dng_tiles_open(libraw_data_t* lr, const char* filename, int thread_count, uint8_t** buffer) {
+    *buffer = NULL;
+
+    // Only DNGs can qualify; don't read other raws twice
+    const char* extension = strrchr(filename, '.');
+    if (extension && strcasecmp(extension, ".dng") == 0) {
+        size_t size = 0;
+        uint8_t* file = read_file(filename, &size);
+        size_t rewritten_size = 0;
+        int rewritten = file && dng_tiles_decompress(file, size, thread_count, buffer, &rewritten_size);
+        free(file);
+
+        if (rewritten) {
+            int ret = libraw_open_buffer(lr, *buffer, rewritten_size);
+            if (ret == LIBRAW_SUCCESS) return ret;
+
+            // Let LibRaw have the original instead
+            free(*buffer);
+            *buffer = NULL;
+            libraw_recycle(lr);
+        }
+    }
+
+    return libraw_open_file(lr, filename);
+}
@@ -0,0 +1,38 @@
+#ifndef DNG_TILES_H
+#define DNG_TILES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <libraw/libraw.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parallel unpack for DNGs whose raw image is stored as lossless JPEG tiles
+// (phones, drones). LibRaw decodes those tiles one after another; here they
+// are decoded on all cores and LibRaw is handed the same DNG with the tiles
+// stored uncompressed, which it unpacks with a plain copy. All other tags
+// are left untouched, so the result is the same as a regular unpack.
+
+// libraw_open_file, or libraw_open_buffer on the rewritten file when the
+// DNG qualifies. *buffer receives the rewritten file (NULL otherwise); LibRaw
+// reads from it until libraw_unpack returns, free() it afterwards.
+// thread_count <= 0 uses all cores. Returns a LibRaw error code.
+int dng_tiles_open(libraw_data_t* lr, const char* filename, int thread_count, uint8_t** buffer);
+
+// The rewrite on its own. Returns 1 and a newly allocated file if data is a
+// DNG with a lossless JPEG tiled raw image, 0 if not (or on decode errors).
+int dng_tiles_decompress(
+    const uint8_t* data,
+    size_t size,
+    int thread_count,
+    uint8_t** output,
+    size_t* output_size
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DNG_TILES_H
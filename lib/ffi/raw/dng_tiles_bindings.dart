@@ -0,0 +1,19 @@
+import 'dart:ffi';
+
+// Bindings for the tiled DNG rewrite in libraw_processor
+class DngTilesBindings {
+  final DynamicLibrary _lib;
+
+  DngTilesBindings(this._lib);
+
+  late final _dng_tiles_decompress = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Size, Int32, Pointer<Pointer<Uint8>>, Pointer<Size>),
+      int Function(Pointer<Uint8>, int, int, Pointer<Pointer<Uint8>>, Pointer<Size>)>('dng_tiles_decompress');
+
+  /// 1 and a malloc'd copy of the DNG with its lossless JPEG tiles stored
+  /// uncompressed, 0 if the file doesn't qualify or a tile fails to decode
+  int dngTilesDecompress(Pointer<Uint8> data, int size, int threadCount,
+      Pointer<Pointer<Uint8>> output, Pointer<Size> outputSize) {
+    return _dng_tiles_decompress(data, size, threadCount, output, outputSize);
+  }
+}
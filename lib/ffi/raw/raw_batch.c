@@ -0,0 +1,1079 @@
+#include "raw_batch.h"
+#include "../common/job_scheduler.h"
+#include "raw_processor_internal.h"
+#include <libraw/libraw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define RAW_BATCH_HAVE_IO_URING 1
+#endif
+#endif
+
+#define RAW_BATCH_DEFAULT_IN_FLIGHT 8
+#define RAW_BATCH_DEFAULT_BUDGET ((int64_t)1 << 30)
+#define RAW_BATCH_POOL_GRANULARITY ((size_t)1 << 20)
+#define RAW_BATCH_CHUNK_SIZE ((size_t)1 << 20)    // io_uring read size
+#define RAW_BATCH_CHUNKS_PER_FILE 4               // Outstanding reads per file
+#define RAW_BATCH_PREAD_CHUNK ((size_t)4 << 20)
+
+// ---------------------------------------------------------------------------
+// Buffer pool
+
+typedef struct PoolBuffer {
+    uint8_t* data;
+    size_t capacity;
+    struct PoolBuffer* next;
+} PoolBuffer;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    PoolBuffer* free_list;
+    int64_t allocated;    // Bytes in free and in-use buffers
+    int64_t budget;
+    int cancelled;
+} BufferPool;
+
+static void pool_init(BufferPool* pool, int64_t budget) {
+    memset(pool, 0, sizeof(*pool));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->available, NULL);
+    pool->budget = budget;
+}
+
+static void pool_free_buffer(PoolBuffer* buffer) {
+    free(buffer->data);
+    free(buffer);
+}
+
+// Take a buffer of at least size bytes. Reuses the smallest free buffer that
+// fits; otherwise allocates within the budget, dropping smaller free buffers
+// to make room. With block = 0 returns NULL instead of waiting.
+static PoolBuffer* pool_acquire(BufferPool* pool, size_t size, int block) {
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        PoolBuffer** best = NULL;
+        for (PoolBuffer** it = &pool->free_list; *it; it = &(*it)->next) {
+            if ((*it)->capacity >= size && (!best || (*it)->capacity < (*best)->capacity)) {
+                best = it;
+            }
+        }
+        if (best) {
+            PoolBuffer* buffer = *best;
+            *best = buffer->next;
+            buffer->next = NULL;
+            pthread_mutex_unlock(&pool->lock);
+            return buffer;
+        }
+
+        size_t capacity = (size + RAW_BATCH_POOL_GRANULARITY - 1) / RAW_BATCH_POOL_GRANULARITY *
+                          RAW_BATCH_POOL_GRANULARITY;
+        while (pool->allocated + (int64_t)capacity > pool->budget && pool->free_list) {
+            PoolBuffer* victim = pool->free_list;
+            pool->free_list = victim->next;
+            pool->allocated -= victim->capacity;
+            pool_free_buffer(victim);
+        }
+
+        // A file larger than the whole budget still gets read, one at a time
+        if (pool->allocated + (int64_t)capacity <= pool->budget || pool->allocated == 0) {
+            PoolBuffer* buffer = (PoolBuffer*)calloc(1, sizeof(PoolBuffer));
+            if (buffer) {
+                buffer->data = (uint8_t*)malloc(capacity);
+                buffer->capacity = capacity;
+            }
+            if (!buffer || !buffer->data) {
+                free(buffer);
+                pthread_mutex_unlock(&pool->lock);
+                return NULL;
+            }
+            pool->allocated += capacity;
+            pthread_mutex_unlock(&pool->lock);
+            return buffer;
+        }
+
+        if (!block || pool->cancelled) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        pthread_cond_wait(&pool->available, &pool->lock);
+    }
+}
+
+static void pool_release(BufferPool* pool, PoolBuffer* buffer) {
+    if (!buffer) return;
+    pthread_mutex_lock(&pool->lock);
+    buffer->next = pool->free_list;
+    pool->free_list = buffer;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_cancel(BufferPool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->cancelled = 1;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_destroy(BufferPool* pool) {
+    while (pool->free_list) {
+        PoolBuffer* buffer = pool->free_list;
+        pool->free_list = buffer->next;
+        pool_free_buffer(buffer);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->available);
+}
+
+// ---------------------------------------------------------------------------
+// Batch state
+
+// A file read into memory (or a read failure) waiting for a decoder
+typedef struct ReadItem {
+    int index;
+    PoolBuffer* buffer;
+    size_t size;
+    int status;
+    struct ReadItem* next;
+} ReadItem;
+
+// Result plus the storage backing its pixels
+typedef struct BatchResult {
+    RawBatchResult result;
+    libraw_processed_image_t* image;
+    uint8_t* owned;
+    struct BatchResult* next;
+} BatchResult;
+
+struct RawBatch {
+    char** paths;
+    int count;
+    RawBatchOptions options;
+    int backend;
+
+    BufferPool pool;
+
+    pthread_mutex_t lock;
+    pthread_cond_t read_ready;
+    pthread_cond_t result_ready;
+    pthread_cond_t result_space;
+
+    ReadItem* read_head;
+    ReadItem* read_tail;
+    BatchResult* result_head;
+    BatchResult* result_tail;
+    int results_queued;
+    int results_returned;
+    int max_queued_results;
+
+    int next_file;        // pread backend
+    int readers_active;
+    int reading_done;
+    int cancelled;
+
+    int files_read;
+    int files_decoded;
+    int64_t bytes_read;
+
+    pthread_t* threads;
+    int thread_count;
+};
+
+static int is_cancelled(RawBatch* batch) {
+    return __atomic_load_n(&batch->cancelled, __ATOMIC_ACQUIRE);
+}
+
+static void push_read_item(RawBatch* batch, int index, PoolBuffer* buffer, size_t size, int status) {
+    ReadItem* item = (ReadItem*)calloc(1, sizeof(ReadItem));
+    pthread_mutex_lock(&batch->lock);
+    if (!item) {
+        // Out of memory: the file is reported as failed by nobody, so count
+        // it as returned to keep raw_batch_next from waiting on it forever
+        batch->results_returned++;
+        pthread_cond_broadcast(&batch->result_ready);
+        pthread_mutex_unlock(&batch->lock);
+        pool_release(&batch->pool, buffer);
+        return;
+    }
+    item->index = index;
+    item->buffer = buffer;
+    item->size = size;
+    item->status = status;
+    if (batch->read_tail) {
+        batch->read_tail->next = item;
+    } else {
+        batch->read_head = item;
+    }
+    batch->read_tail = item;
+    if (status == 0) {
+        batch->files_read++;
+        batch->bytes_read += size;
+    }
+    pthread_cond_signal(&batch->read_ready);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static void finish_reading(RawBatch* batch) {
+    pthread_mutex_lock(&batch->lock);
+    if (--batch->readers_active == 0) {
+        batch->reading_done = 1;
+        pthread_cond_broadcast(&batch->read_ready);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+// Open a file for reading and return its size, or -errno
+static int open_for_read(const char* path, int* fd, size_t* size) {
+    *fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (*fd < 0) return -errno;
+
+    struct stat st;
+    if (fstat(*fd, &st) != 0) {
+        int err = -errno;
+        close(*fd);
+        return err;
+    }
+    if (st.st_size <= 0) {
+        close(*fd);
+        return -EINVAL;
+    }
+    *size = (size_t)st.st_size;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(*fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// pread backend: files_in_flight threads, each reading whole files
+
+static void read_file_pread(RawBatch* batch, int index) {
+    int fd;
+    size_t size;
+    int status = open_for_read(batch->paths[index], &fd, &size);
+    if (status != 0) {
+        push_read_item(batch, index, NULL, 0, status);
+        return;
+    }
+
+    PoolBuffer* buffer = pool_acquire(&batch->pool, size, 1);
+    if (!buffer) {
+        close(fd);
+        push_read_item(batch, index, NULL, 0, is_cancelled(batch) ? -ECANCELED : -ENOMEM);
+        return;
+    }
+
+    size_t done = 0;
+    while (done < size && !is_cancelled(batch)) {
+        size_t chunk = size - done < RAW_BATCH_PREAD_CHUNK ? size - done : RAW_BATCH_PREAD_CHUNK;
+        ssize_t got = pread(fd, buffer->data + done, chunk, (off_t)done);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            status = -errno;
+            break;
+        }
+        if (got == 0) {
+            status = -EIO;  // File shrank under us
+            break;
+        }
+        done += (size_t)got;
+    }
+    close(fd);
+
+    if (status == 0 && is_cancelled(batch)) {
+        status = -ECANCELED;
+    }
+    if (status != 0) {
+        pool_release(&batch->pool, buffer);
+        buffer = NULL;
+        size = 0;
+    }
+    push_read_item(batch, index, buffer, size, status);
+}
+
+static void* pread_reader_thread(void* arg) {
+    RawBatch* batch = (RawBatch*)arg;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        if (batch->cancelled || batch->next_file >= batch->count) {
+            pthread_mutex_unlock(&batch->lock);
+            break;
+        }
+        int index = batch->next_file++;
+        pthread_mutex_unlock(&batch->lock);
+
+        read_file_pread(batch, index);
+    }
+    finish_reading(batch);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// io_uring backend: a single thread keeps files_in_flight files reading with
+// several chunked READV requests each
+
+#ifdef RAW_BATCH_HAVE_IO_URING
+
+typedef struct {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned sq_local_tail;
+    unsigned sq_submitted_tail;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    size_t sq_size;
+    void* cq_ptr;
+    size_t cq_size;
+    size_t sqes_size;
+} Uring;
+
+static int uring_init(Uring* ring, unsigned entries) {
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return 0;
+    ring->fd = fd;
+
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        if (ring->cq_size > ring->sq_size) ring->sq_size = ring->cq_size;
+        ring->cq_size = ring->sq_size;
+    }
+
+    ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    if (single_mmap) {
+        ring->cq_ptr = ring->sq_ptr;
+    } else {
+        ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED) {
+            munmap(ring->sq_ptr, ring->sq_size);
+            close(fd);
+            return 0;
+        }
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (!single_mmap) munmap(ring->cq_ptr, ring->cq_size);
+        munmap(ring->sq_ptr, ring->sq_size);
+        close(fd);
+        return 0;
+    }
+
+    uint8_t* sq = (uint8_t*)ring->sq_ptr;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->sq_submitted_tail = ring->sq_local_tail;
+
+    uint8_t* cq = (uint8_t*)ring->cq_ptr;
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    return 1;
+}
+
+static void uring_destroy(Uring* ring) {
+    if (ring->fd < 0) return;
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ptr != ring->sq_ptr) munmap(ring->cq_ptr, ring->cq_size);
+    munmap(ring->sq_ptr, ring->sq_size);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+static struct io_uring_sqe* uring_get_sqe(Uring* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= ring->sq_entries) return NULL;
+    unsigned index = ring->sq_local_tail & *ring->sq_mask;
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+// Publish queued SQEs and optionally wait for at least one completion
+static int uring_submit_and_wait(Uring* ring, unsigned wait_for) {
+    unsigned to_submit = ring->sq_local_tail - ring->sq_submitted_tail;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    for (;;) {
+        int ret = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_for,
+                               wait_for ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) {
+            ring->sq_submitted_tail += (unsigned)ret;
+            return ret;
+        }
+        if (errno != EINTR) return -errno;
+        // Anything already consumed by the kernel stays consumed
+        to_submit = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        ring->sq_submitted_tail = ring->sq_local_tail - to_submit;
+    }
+}
+
+typedef struct {
+    int used;
+    int index;
+    int fd;
+    PoolBuffer* buffer;
+    size_t size;
+    size_t submitted;
+    size_t completed;
+    int outstanding;
+    int status;
+} ReadSlot;
+
+typedef struct {
+    int slot;
+    int in_use;
+    int pending;    // Rest of a short read, waiting for a free SQE
+    size_t offset;
+    struct iovec iov;
+} ReadOp;
+
+typedef struct {
+    RawBatch* batch;
+    Uring ring;
+} UringReader;
+
+// Queue the read described by ops[op_index]; 0 if the SQ ring is full
+static int submit_op(Uring* ring, ReadOp* ops, int op_index, ReadSlot* slots) {
+    struct io_uring_sqe* sqe = uring_get_sqe(ring);
+    if (!sqe) return 0;
+
+    ReadOp* op = &ops[op_index];
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = slots[op->slot].fd;
+    sqe->off = op->offset;
+    sqe->addr = (uint64_t)(uintptr_t)&op->iov;
+    sqe->len = 1;
+    sqe->user_data = (uint64_t)op_index;
+    return 1;
+}
+
+static int queue_read(Uring* ring, ReadOp* ops, int op_count, ReadSlot* slots,
+                      int slot_index, size_t offset, size_t length) {
+    int op_index = -1;
+    for (int i = 0; i < op_count; i++) {
+        if (!ops[i].in_use) {
+            op_index = i;
+            break;
+        }
+    }
+    if (op_index < 0) return 0;
+
+    ReadSlot* slot = &slots[slot_index];
+    ReadOp* op = &ops[op_index];
+    op->slot = slot_index;
+    op->offset = offset;
+    op->iov.iov_base = slot->buffer->data + offset;
+    op->iov.iov_len = length;
+    if (!submit_op(ring, ops, op_index, slots)) return 0;
+
+    op->in_use = 1;
+    slot->outstanding++;
+    return 1;
+}
+
+static void complete_slot(RawBatch* batch, ReadSlot* slot) {
+    close(slot->fd);
+    if (slot->status == 0 && is_cancelled(batch)) {
+        slot->status = -ECANCELED;
+    }
+    if (slot->status != 0) {
+        pool_release(&batch->pool, slot->buffer);
+        push_read_item(batch, slot->index, NULL, 0, slot->status);
+    } else {
+        push_read_item(batch, slot->index, slot->buffer, slot->size, 0);
+    }
+    memset(slot, 0, sizeof(*slot));
+}
+
+static void* uring_reader_thread(void* arg) {
+    UringReader* reader = (UringReader*)arg;
+    RawBatch* batch = reader->batch;
+    Uring* ring = &reader->ring;
+
+    int slot_count = batch->options.files_in_flight;
+    int op_count = (int)ring->sq_entries;
+    ReadSlot* slots = (ReadSlot*)calloc(slot_count, sizeof(ReadSlot));
+    ReadOp* ops = (ReadOp*)calloc(op_count, sizeof(ReadOp));
+    int next = 0;
+    int active = 0;
+    int ops_outstanding = 0;    // Submitted to the kernel
+    int ops_pending = 0;        // Short-read remainders not yet resubmitted
+
+    while (slots && ops) {
+        // Start new files while there are free slots and buffer budget
+        while (!is_cancelled(batch) && active < slot_count && next < batch->count) {
+            int s = 0;
+            while (slots[s].used) s++;
+
+            int fd;
+            size_t size;
+            int status = open_for_read(batch->paths[next], &fd, &size);
+            if (status != 0) {
+                push_read_item(batch, next++, NULL, 0, status);
+                continue;
+            }
+
+            // Only wait for buffers when nothing is in flight to free one up
+            PoolBuffer* buffer = pool_acquire(&batch->pool, size, active == 0);
+            if (!buffer) {
+                close(fd);
+                if (active == 0) {
+                    push_read_item(batch, next++, NULL, 0,
+                                   is_cancelled(batch) ? -ECANCELED : -ENOMEM);
+                    continue;
+                }
+                break;
+            }
+
+            slots[s].used = 1;
+            slots[s].index = next++;
+            slots[s].fd = fd;
+            slots[s].buffer = buffer;
+            slots[s].size = size;
+            active++;
+        }
+
+        // Finish short reads first. The ring was drained by the last submit,
+        // so there is room unless more than a ring's worth is pending.
+        for (int i = 0; i < op_count && ops_pending > 0; i++) {
+            if (!ops[i].pending) continue;
+            if (!submit_op(ring, ops, i, slots)) break;
+            ops[i].pending = 0;
+            ops_pending--;
+            ops_outstanding++;
+        }
+
+        // Keep a few chunk reads outstanding per file
+        for (int s = 0; s < slot_count && !is_cancelled(batch); s++) {
+            ReadSlot* slot = &slots[s];
+            while (slot->used && slot->status == 0 && slot->submitted < slot->size &&
+                   slot->outstanding < RAW_BATCH_CHUNKS_PER_FILE) {
+                size_t length = slot->size - slot->submitted;
+                if (length > RAW_BATCH_CHUNK_SIZE) length = RAW_BATCH_CHUNK_SIZE;
+                if (!queue_read(ring, ops, op_count, slots, s, slot->submitted, length)) break;
+                slot->submitted += length;
+                ops_outstanding++;
+            }
+        }
+
+        if (ops_outstanding == 0) {
+            // Cancelled, or every remaining file failed to open
+            if (active == 0 && (next >= batch->count || is_cancelled(batch))) break;
+            if (is_cancelled(batch)) break;
+            continue;
+        }
+
+        int ret = uring_submit_and_wait(ring, 1);
+        if (ret < 0) {
+            fprintf(stderr, "raw_batch: io_uring_enter failed: %s\n", strerror(-ret));
+            break;
+        }
+
+        // Reap completions
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            int op_index = (int)cqe->user_data;
+            ReadOp* op = &ops[op_index];
+            ReadSlot* slot = &slots[op->slot];
+            int res = cqe->res;
+            ops_outstanding--;
+            head++;
+
+            if (res > 0 && (size_t)res < op->iov.iov_len && slot->status == 0) {
+                // Short read: reuse the op for the rest, now or on the next pass
+                slot->completed += (size_t)res;
+                op->offset += (size_t)res;
+                op->iov.iov_base = (uint8_t*)op->iov.iov_base + res;
+                op->iov.iov_len -= (size_t)res;
+                if (submit_op(ring, ops, op_index, slots)) {
+                    ops_outstanding++;
+                } else {
+                    op->pending = 1;
+                    ops_pending++;
+                }
+                continue;
+            }
+
+            op->in_use = 0;
+            slot->outstanding--;
+            if (res < 0) {
+                if (slot->status == 0) slot->status = res;
+            } else if (res == 0) {
+                if (slot->status == 0) slot->status = -EIO;
+            } else {
+                slot->completed += (size_t)res;
+            }
+
+            if (slot->outstanding == 0 &&
+                (slot->status != 0 || slot->completed == slot->size || is_cancelled(batch))) {
+                complete_slot(batch, slot);
+                active--;
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Drain anything still owned by the kernel before buffers go away
+    while (ops && ops_outstanding > 0) {
+        if (uring_submit_and_wait(ring, 1) < 0) break;
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            ReadOp* op = &ops[cqe->user_data];
+            op->in_use = 0;
+            slots[op->slot].outstanding--;
+            ops_outstanding--;
+            head++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    for (int s = 0; slots && s < slot_count; s++) {
+        if (slots[s].used) {
+            if (slots[s].status == 0) slots[s].status = -ECANCELED;
+            complete_slot(batch, &slots[s]);
+        }
+    }
+    // Files never started
+    while (next < batch->count) {
+        push_read_item(batch, next++, NULL, 0, -ECANCELED);
+    }
+
+    free(slots);
+    free(ops);
+    uring_destroy(ring);
+    free(reader);
+    finish_reading(batch);
+    return NULL;
+}
+
+#endif // RAW_BATCH_HAVE_IO_URING
+
+// ---------------------------------------------------------------------------
+// Decode workers
+
+static BatchResult* make_result(int index) {
+    BatchResult* result = (BatchResult*)calloc(1, sizeof(BatchResult));
+    if (result) {
+        result->result.index = index;
+    }
+    return result;
+}
+
+static void decode_item(RawBatch* batch, ReadItem* item, BatchResult* out) {
+    RawBatchResult* result = &out->result;
+
+    if (item->status != 0) {
+        result->status = item->status;
+        snprintf(result->error, sizeof(result->error), "Read failed: %s", strerror(-item->status));
+        return;
+    }
+
+    libraw_data_t* lr = libraw_init(0);
+    if (!lr) {
+        pool_release(&batch->pool, item->buffer);
+        result->status = -ENOMEM;
+        snprintf(result->error, sizeof(result->error), "Failed to initialize LibRaw");
+        return;
+    }
+
+    // Same rendering as raw_processor_init
+    lr->params.output_bps = 8;
+    lr->params.output_color = 1;
+    lr->params.use_camera_wb = 1;
+    lr->params.use_auto_wb = 0;
+    lr->params.no_auto_bright = 1;
+    lr->params.output_tiff = 0;
+    lr->params.half_size = batch->options.half_size ? 1 : 0;
+
+    int ret = libraw_open_buffer(lr, item->buffer->data, item->size);
+    if (ret == LIBRAW_SUCCESS) {
+        ret = libraw_unpack(lr);
+        raw_memory_update(lr);
+    }
+
+    // The compressed file is no longer needed once unpacked
+    pool_release(&batch->pool, item->buffer);
+    item->buffer = NULL;
+
+    if (ret == LIBRAW_SUCCESS) {
+        ret = libraw_dcraw_process(lr);
+        raw_memory_update(lr);
+    }
+
+    libraw_processed_image_t* processed = NULL;
+    if (ret == LIBRAW_SUCCESS) {
+        processed = libraw_dcraw_make_mem_image(lr, &ret);
+        if (!processed && ret == LIBRAW_SUCCESS) ret = LIBRAW_UNSPECIFIED_ERROR;
+    }
+    raw_memory_release(lr);
+    libraw_close(lr);
+
+    if (ret != LIBRAW_SUCCESS) {
+        if (processed) libraw_dcraw_clear_mem(processed);
+        result->status = ret;
+        snprintf(result->error, sizeof(result->error), "%s", libraw_strerror(ret));
+        return;
+    }
+
+    result->width = processed->width;
+    result->height = processed->height;
+    result->colors = 3;
+
+    if (processed->colors == 3 && processed->bits == 8) {
+        out->image = processed;
+        result->data = processed->data;
+        result->size = processed->data_size;
+        mem_stats_set_owner(MEM_DECODED, out, (int64_t)result->size);
+        return;
+    }
+
+    // Expand grayscale output
+    size_t pixels = (size_t)processed->width * processed->height;
+    out->owned = (uint8_t*)malloc(pixels * 3);
+    if (!out->owned || processed->bits != 8) {
+        libraw_dcraw_clear_mem(processed);
+        free(out->owned);
+        out->owned = NULL;
+        result->status = -EINVAL;
+        snprintf(result->error, sizeof(result->error), "Unsupported output format");
+        return;
+    }
+    for (size_t i = 0; i < pixels; i++) {
+        out->owned[i * 3] = out->owned[i * 3 + 1] = out->owned[i * 3 + 2] = processed->data[i];
+    }
+    libraw_dcraw_clear_mem(processed);
+    result->data = out->owned;
+    result->size = pixels * 3;
+    mem_stats_set_owner(MEM_DECODED, out, (int64_t)result->size);
+}
+
+static void* decode_thread(void* arg) {
+    RawBatch* batch = (RawBatch*)arg;
+    for (;;) {
+        pthread_mutex_lock(&batch->lock);
+        while (!batch->read_head && !batch->reading_done && !batch->cancelled) {
+            pthread_cond_wait(&batch->read_ready, &batch->lock);
+        }
+        if (batch->cancelled || !batch->read_head) {
+            pthread_mutex_unlock(&batch->lock);
+            break;
+        }
+        ReadItem* item = batch->read_head;
+        batch->read_head = item->next;
+        if (!batch->read_head) batch->read_tail = NULL;
+        pthread_mutex_unlock(&batch->lock);
+
+        BatchResult* result = make_result(item->index);
+        if (result) {
+            // Each file is one unit for the scheduler; reads are not gated
+            job_begin(batch->options.job_class);
+            decode_item(batch, item, result);
+            job_end(batch->options.job_class);
+        } else {
+            pool_release(&batch->pool, item->buffer);
+        }
+        free(item);
+
+        pthread_mutex_lock(&batch->lock);
+        if (!result) {
+            batch->results_returned++;
+            pthread_cond_broadcast(&batch->result_ready);
+            pthread_mutex_unlock(&batch->lock);
+            continue;
+        }
+        // Don't run ahead of the consumer with decoded images
+        while (batch->results_queued >= batch->max_queued_results && !batch->cancelled) {
+            pthread_cond_wait(&batch->result_space, &batch->lock);
+        }
+        if (result->result.status == 0) batch->files_decoded++;
+        if (batch->result_tail) {
+            batch->result_tail->next = result;
+        } else {
+            batch->result_head = result;
+        }
+        batch->result_tail = result;
+        batch->results_queued++;
+        pthread_cond_signal(&batch->result_ready);
+        pthread_mutex_unlock(&batch->lock);
+    }
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Public API
+
+void raw_batch_default_options(RawBatchOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->files_in_flight = RAW_BATCH_DEFAULT_IN_FLIGHT;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    options->decode_threads = cores > 0 ? (int32_t)cores : 1;
+    options->backend = RAW_BATCH_BACKEND_AUTO;
+    options->half_size = 0;
+    options->buffer_budget = RAW_BATCH_DEFAULT_BUDGET;
+    options->job_class = JOB_CLASS_BATCH;
+}
+
+// Free a batch whose threads have been joined (or never started)
+static void free_batch(RawBatch* batch) {
+    pool_destroy(&batch->pool);
+    pthread_mutex_destroy(&batch->lock);
+    pthread_cond_destroy(&batch->read_ready);
+    pthread_cond_destroy(&batch->result_ready);
+    pthread_cond_destroy(&batch->result_space);
+
+    for (int i = 0; batch->paths && i < batch->count; i++) {
+        free(batch->paths[i]);
+    }
+    free(batch->paths);
+    free(batch->threads);
+    free(batch);
+}
+
+RawBatch* raw_batch_start(const char** paths, int count, const RawBatchOptions* options) {
+    if (!paths || count <= 0) return NULL;
+
+    RawBatch* batch = (RawBatch*)calloc(1, sizeof(RawBatch));
+    if (!batch) return NULL;
+
+    raw_batch_default_options(&batch->options);
+    if (options) {
+        if (options->files_in_flight > 0) batch->options.files_in_flight = options->files_in_flight;
+        if (options->decode_threads > 0) batch->options.decode_threads = options->decode_threads;
+        if (options->buffer_budget > 0) batch->options.buffer_budget = options->buffer_budget;
+        batch->options.backend = options->backend;
+        batch->options.half_size = options->half_size;
+        batch->options.job_class = options->job_class;
+    }
+
+    batch->count = count;
+    batch->max_queued_results = batch->options.decode_threads * 2;
+
+    pool_init(&batch->pool, batch->options.buffer_budget);
+    pthread_mutex_init(&batch->lock, NULL);
+    pthread_cond_init(&batch->read_ready, NULL);
+    pthread_cond_init(&batch->result_ready, NULL);
+    pthread_cond_init(&batch->result_space, NULL);
+
+    int reader_threads = batch->options.files_in_flight;
+    batch->paths = (char**)calloc(count, sizeof(char*));
+    batch->threads = (pthread_t*)calloc(reader_threads + batch->options.decode_threads, sizeof(pthread_t));
+    int ok = batch->paths && batch->threads;
+    for (int i = 0; ok && i < count; i++) {
+        batch->paths[i] = strdup(paths[i] ? paths[i] : "");
+        ok = batch->paths[i] != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "raw_batch: out of memory starting a batch of %d files\n", count);
+        free_batch(batch);
+        return NULL;
+    }
+
+    batch->backend = RAW_BATCH_BACKEND_PREAD;
+#ifdef RAW_BATCH_HAVE_IO_URING
+    if (batch->options.backend != RAW_BATCH_BACKEND_PREAD) {
+        UringReader* reader = (UringReader*)calloc(1, sizeof(UringReader));
+        unsigned entries = 8;
+        while (entries < (unsigned)(batch->options.files_in_flight * RAW_BATCH_CHUNKS_PER_FILE) &&
+               entries < 256) {
+            entries <<= 1;
+        }
+        if (reader && uring_init(&reader->ring, entries)) {
+            reader->batch = batch;
+            batch->readers_active = 1;
+            if (pthread_create(&batch->threads[batch->thread_count], NULL,
+                               uring_reader_thread, reader) == 0) {
+                batch->thread_count++;
+                batch->backend = RAW_BATCH_BACKEND_IO_URING;
+            } else {
+                batch->readers_active = 0;
+                uring_destroy(&reader->ring);
+                free(reader);
+            }
+        } else {
+            free(reader);
+        }
+    }
+#endif
+
+    int readers = batch->thread_count;
+    if (batch->backend == RAW_BATCH_BACKEND_PREAD) {
+        batch->readers_active = reader_threads;
+        for (int i = 0; i < reader_threads; i++) {
+            if (pthread_create(&batch->threads[batch->thread_count], NULL,
+                               pread_reader_thread, batch) == 0) {
+                batch->thread_count++;
+                readers++;
+            } else {
+                finish_reading(batch);
+            }
+        }
+    }
+
+    // Fewer threads than asked for only slow the batch down, but with no
+    // readers or no decoders it would never finish
+    int decoders = 0;
+    for (int i = 0; readers > 0 && i < batch->options.decode_threads; i++) {
+        if (pthread_create(&batch->threads[batch->thread_count], NULL, decode_thread, batch) == 0) {
+            batch->thread_count++;
+            decoders++;
+        }
+    }
+    if (readers == 0 || decoders == 0) {
+        fprintf(stderr, "raw_batch: could not start %s threads\n", readers == 0 ? "reader" : "decode");
+        // Cancels and joins the readers that did start
+        raw_batch_destroy(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+RawBatchResult* raw_batch_next(RawBatch* batch, int timeout_ms) {
+    if (!batch) return NULL;
+
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    pthread_mutex_lock(&batch->lock);
+    while (!batch->result_head && batch->results_returned < batch->count && !batch->cancelled) {
+        if (timeout_ms < 0) {
+            pthread_cond_wait(&batch->result_ready, &batch->lock);
+        } else if (pthread_cond_timedwait(&batch->result_ready, &batch->lock, &deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+
+    BatchResult* result = batch->result_head;
+    if (result) {
+        batch->result_head = result->next;
+        if (!batch->result_head) batch->result_tail = NULL;
+        result->next = NULL;
+        batch->results_queued--;
+        batch->results_returned++;
+        pthread_cond_signal(&batch->result_space);
+    }
+    pthread_mutex_unlock(&batch->lock);
+
+    return result ? &result->result : NULL;
+}
+
+int raw_batch_is_done(RawBatch* batch) {
+    if (!batch) return 1;
+    pthread_mutex_lock(&batch->lock);
+    int done = batch->cancelled || batch->results_returned >= batch->count;
+    pthread_mutex_unlock(&batch->lock);
+    return done;
+}
+
+void raw_batch_free_result(RawBatchResult* result) {
+    if (!result) return;
+    BatchResult* storage = (BatchResult*)result;
+    mem_stats_set_owner(MEM_DECODED, storage, 0);
+    if (storage->image) libraw_dcraw_clear_mem(storage->image);
+    free(storage->owned);
+    free(storage);
+}
+
+void raw_batch_get_stats(RawBatch* batch, RawBatchStats* stats) {
+    if (!batch || !stats) return;
+    pthread_mutex_lock(&batch->lock);
+    stats->backend = batch->backend;
+    stats->files_read = batch->files_read;
+    stats->files_decoded = batch->files_decoded;
+    stats->bytes_read = batch->bytes_read;
+    pthread_mutex_unlock(&batch->lock);
+
+    pthread_mutex_lock(&batch->pool.lock);
+    stats->buffer_bytes = batch->pool.allocated;
+    pthread_mutex_unlock(&batch->pool.lock);
+}
+
+void raw_batch_cancel(RawBatch* batch) {
+    if (!batch) return;
+    pthread_mutex_lock(&batch->lock);
+    __atomic_store_n(&batch->cancelled, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&batch->read_ready);
+    pthread_cond_broadcast(&batch->result_ready);
+    pthread_cond_broadcast(&batch->result_space);
+    pthread_mutex_unlock(&batch->lock);
+    pool_cancel(&batch->pool);
+}
+
+void raw_batch_destroy(RawBatch* batch) {
+    if (!batch) return;
+
+    raw_batch_cancel(batch);
+    for (int i = 0; i < batch->thread_count; i++) {
+        pthread_join(batch->threads[i], NULL);
+    }
+
+    while (batch->read_head) {
+        ReadItem* item = batch->read_head;
+        batch->read_head = item->next;
+        pool_release(&batch->pool, item->buffer);
+        free(item);
+    }
+    while (batch->result_head) {
+        BatchResult* result = batch->result_head;
+        batch->result_head = result->next;
+        raw_batch_free_result(&result->result);
+    }
+
+    free_batch(batch);
+}
@@ -0,0 +1,78 @@
+#ifndef RAW_BATCH_H
+#define RAW_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Read backends
+#define RAW_BATCH_BACKEND_AUTO 0      // io_uring when the kernel allows it, else pread
+#define RAW_BATCH_BACKEND_IO_URING 1
+#define RAW_BATCH_BACKEND_PREAD 2
+
+// Batch decoder: a read-ahead engine keeps several files in flight into
+// pooled buffers while a pool of workers decodes completed buffers with
+// libraw_open_buffer, so I/O and demosaicing overlap.
+typedef struct RawBatch RawBatch;
+
+typedef struct {
+    int32_t files_in_flight;    // Files being read at once (0 = 8)
+    int32_t decode_threads;     // Decode workers (0 = number of cores)
+    int32_t backend;            // RAW_BATCH_BACKEND_*
+    int32_t half_size;          // Demosaic at half resolution (thumbnails, culling)
+    int64_t buffer_budget;      // Max bytes held in read buffers (0 = 1 GiB)
+    int32_t job_class;          // JOB_CLASS_* the decodes are scheduled as
+} RawBatchOptions;
+
+typedef struct {
+    int32_t index;              // Position in the path list
+    int32_t status;             // 0 on success, LibRaw error code or -errno
+    int32_t width;
+    int32_t height;
+    int32_t colors;             // Always 3 for successful results
+    uint8_t* data;              // Packed 8-bit RGB
+    size_t size;
+    char error[128];
+} RawBatchResult;
+
+typedef struct {
+    int32_t backend;            // Backend actually in use
+    int32_t files_read;
+    int32_t files_decoded;
+    int64_t bytes_read;
+    int64_t buffer_bytes;       // Bytes currently allocated by the buffer pool
+} RawBatchStats;
+
+// Fill options with defaults
+void raw_batch_default_options(RawBatchOptions* options);
+
+// Start reading and decoding. Paths are copied. options may be NULL.
+// Returns NULL if out of memory or no reader or decode thread could start.
+RawBatch* raw_batch_start(const char** paths, int count, const RawBatchOptions* options);
+
+// Wait up to timeout_ms (-1 = forever) for the next finished file, in
+// completion order. Returns NULL on timeout or once every file was returned.
+RawBatchResult* raw_batch_next(RawBatch* batch, int timeout_ms);
+
+// 1 once every result has been handed out
+int raw_batch_is_done(RawBatch* batch);
+
+// Free a result returned by raw_batch_next
+void raw_batch_free_result(RawBatchResult* result);
+
+void raw_batch_get_stats(RawBatch* batch, RawBatchStats* stats);
+
+// Stop scheduling new files; in-flight work is dropped
+void raw_batch_cancel(RawBatch* batch);
+
+// Cancel if needed, join all threads and free pending results
+void raw_batch_destroy(RawBatch* batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_BATCH_H
@@ -0,0 +1,139 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Opaque native RawBatch handle
+final class NativeRawBatch extends Opaque {}
+
+/// Read backends, mirrors RAW_BATCH_BACKEND_* in raw_batch.h
+abstract class RawBatchBackend {
+  static const int auto = 0;
+  static const int ioUring = 1;
+  static const int pread = 2;
+}
+
+/// Scheduling classes, mirrors JOB_CLASS_* in job_scheduler.h
+abstract class JobClass {
+  static const int batch = 0;
+  static const int prefetch = 1;
+  static const int interactive = 2;
+}
+
+/// Mirrors RawBatchOptions in raw_batch.h
+final class RawBatchOptions extends Struct {
+  @Int32()
+  external int filesInFlight;
+  @Int32()
+  external int decodeThreads;
+  @Int32()
+  external int backend;
+  @Int32()
+  external int halfSize;
+  @Int64()
+  external int bufferBudget;
+  @Int32()
+  external int jobClass;
+}
+
+/// Mirrors RawBatchResult in raw_batch.h
+final class RawBatchResult extends Struct {
+  @Int32()
+  external int index;
+  @Int32()
+  external int status;
+  @Int32()
+  external int width;
+  @Int32()
+  external int height;
+  @Int32()
+  external int colors;
+  external Pointer<Uint8> data;
+  @Size()
+  external int size;
+  @Array(128)
+  external Array<Char> error;
+}
+
+/// Mirrors RawBatchStats in raw_batch.h
+final class RawBatchStats extends Struct {
+  @Int32()
+  external int backend;
+  @Int32()
+  external int filesRead;
+  @Int32()
+  external int filesDecoded;
+  @Int64()
+  external int bytesRead;
+  @Int64()
+  external int bufferBytes;
+}
+
+// Bindings for the batch decode entry points of libraw_processor
+class RawBatchBindings {
+  final DynamicLibrary _lib;
+
+  RawBatchBindings(this._lib);
+
+  late final _raw_batch_default_options = _lib.lookupFunction<
+      Void Function(Pointer<RawBatchOptions>),
+      void Function(Pointer<RawBatchOptions>)>('raw_batch_default_options');
+
+  late final _raw_batch_start = _lib.lookupFunction<
+      Pointer<NativeRawBatch> Function(Pointer<Pointer<Utf8>>, Int32, Pointer<RawBatchOptions>),
+      Pointer<NativeRawBatch> Function(Pointer<Pointer<Utf8>>, int, Pointer<RawBatchOptions>)>('raw_batch_start');
+
+  late final _raw_batch_next = _lib.lookupFunction<
+      Pointer<RawBatchResult> Function(Pointer<NativeRawBatch>, Int32),
+      Pointer<RawBatchResult> Function(Pointer<NativeRawBatch>, int)>('raw_batch_next');
+
+  late final _raw_batch_is_done = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeRawBatch>),
+      int Function(Pointer<NativeRawBatch>)>('raw_batch_is_done');
+
+  late final _raw_batch_free_result = _lib.lookupFunction<
+      Void Function(Pointer<RawBatchResult>),
+      void Function(Pointer<RawBatchResult>)>('raw_batch_free_result');
+
+  late final _raw_batch_get_stats = _lib.lookupFunction<
+      Void Function(Pointer<NativeRawBatch>, Pointer<RawBatchStats>),
+      void Function(Pointer<NativeRawBatch>, Pointer<RawBatchStats>)>('raw_batch_get_stats');
+
+  late final _raw_batch_cancel = _lib.lookupFunction<
+      Void Function(Pointer<NativeRawBatch>),
+      void Function(Pointer<NativeRawBatch>)>('raw_batch_cancel');
+
+  late final _raw_batch_destroy = _lib.lookupFunction<
+      Void Function(Pointer<NativeRawBatch>),
+      void Function(Pointer<NativeRawBatch>)>('raw_batch_destroy');
+
+  void rawBatchDefaultOptions(Pointer<RawBatchOptions> options) {
+    _raw_batch_default_options(options);
+  }
+
+  Pointer<NativeRawBatch> rawBatchStart(Pointer<Pointer<Utf8>> paths, int count, Pointer<RawBatchOptions> options) {
+    return _raw_batch_start(paths, count, options);
+  }
+
+  Pointer<RawBatchResult> rawBatchNext(Pointer<NativeRawBatch> batch, int timeoutMs) {
+    return _raw_batch_next(batch, timeoutMs);
+  }
+
+  bool rawBatchIsDone(Pointer<NativeRawBatch> batch) {
+    return _raw_batch_is_done(batch) != 0;
+  }
+
+  void rawBatchFreeResult(Pointer<RawBatchResult> result) {
+    _raw_batch_free_result(result);
+  }
+
+  void rawBatchGetStats(Pointer<NativeRawBatch> batch, Pointer<RawBatchStats> stats) {
+    _raw_batch_get_stats(batch, stats);
+  }
+
+  void rawBatchCancel(Pointer<NativeRawBatch> batch) {
+    _raw_batch_cancel(batch);
+  }
+
+  void rawBatchDestroy(Pointer<NativeRawBatch> batch) {
+    _raw_batch_destroy(batch);
+  }
+}
@@ -0,0 +1,406 @@
+#include "raw_cull.h"
+#include "../common/job_scheduler.h"
+#include "../common/cpu_dispatch.h"
+#include "raw_processor_internal.h"
+#include <libraw/libraw.h>
+#include <turbojpeg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define RAW_CULL_DEFAULT_ANALYSIS_SIZE 1024
+#define RAW_CULL_DEFAULT_PREVIEW_MIN 640
+#define RAW_CULL_GRID 4
+
+// 8-bit BT.601 luma, as used by the other analysis code
+static inline int luma(const uint8_t* p) {
+    return (77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8;
+}
+
+// Box filter RGB down to a luma plane of out_w x out_h, counting clipped
+// source pixels on the way
+AKS_MULTIVERSION
+static void downscale_luma(const uint8_t* pixels, int width, int height, int channels,
+                           size_t stride, uint8_t* plane, int out_w, int out_h,
+                           int64_t* shadows, int64_t* highlights) {
+    int* x_start = malloc(sizeof(int) * (out_w + 1));
+    if (!x_start) return;
+    for (int ox = 0; ox <= out_w; ox++) {
+        x_start[ox] = (int)((int64_t)ox * width / out_w);
+    }
+    uint32_t* sums = calloc(out_w, sizeof(uint32_t));
+    if (!sums) {
+        free(x_start);
+        return;
+    }
+
+    int64_t dark = 0, bright = 0;
+    for (int oy = 0; oy < out_h; oy++) {
+        int y0 = (int)((int64_t)oy * height / out_h);
+        int y1 = (int)((int64_t)(oy + 1) * height / out_h);
+        memset(sums, 0, sizeof(uint32_t) * out_w);
+
+        for (int y = y0; y < y1; y++) {
+            const uint8_t* row = pixels + (size_t)y * stride;
+            for (int ox = 0; ox < out_w; ox++) {
+                uint32_t sum = 0;
+                for (int x = x_start[ox]; x < x_start[ox + 1]; x++) {
+                    const uint8_t* p = row + (size_t)x * channels;
+                    sum += (uint32_t)luma(p);
+                    int hi = p[0] > p[1] ? p[0] : p[1];
+                    if (p[2] > hi) hi = p[2];
+                    dark += hi <= 2;
+                    bright += hi >= 253;
+                }
+                sums[ox] += sum;
+            }
+        }
+
+        uint8_t* out = plane + (size_t)oy * out_w;
+        for (int ox = 0; ox < out_w; ox++) {
+            uint32_t area = (uint32_t)(x_start[ox + 1] - x_start[ox]) * (uint32_t)(y1 - y0);
+            out[ox] = (uint8_t)(area ? (sums[ox] + area / 2) / area : 0);
+        }
+    }
+
+    *shadows = dark;
+    *highlights = bright;
+    free(sums);
+    free(x_start);
+}
+
+typedef struct {
+    int64_t sum;
+    int64_t square_sum;
+    int64_t count;
+} Moments;
+
+static double variance(const Moments* m) {
+    if (m->count == 0) return 0.0;
+    double mean = (double)m->sum / m->count;
+    return (double)m->square_sum / m->count - mean * mean;
+}
+
+int raw_cull_score_pixels(const uint8_t* pixels, int width, int height, int channels,
+                          size_t stride, int analysis_size, RawCullScore* score) {
+    if (!pixels || !score || width < 3 || height < 3) return 0;
+    if (channels != 3 && channels != 4) return 0;
+    if (stride == 0) stride = (size_t)width * channels;
+    if (analysis_size <= 0) analysis_size = RAW_CULL_DEFAULT_ANALYSIS_SIZE;
+
+    // Never upscale; a small source is scored as it is
+    int long_edge = width > height ? width : height;
+    int out_w = width, out_h = height;
+    if (long_edge > analysis_size) {
+        out_w = (int)((int64_t)width * analysis_size / long_edge);
+        out_h = (int)((int64_t)height * analysis_size / long_edge);
+        if (out_w < 3) out_w = 3;
+        if (out_h < 3) out_h = 3;
+    }
+
+    uint8_t* plane = malloc((size_t)out_w * out_h);
+    if (!plane) return 0;
+    int64_t shadows = 0, highlights = 0;
+    downscale_luma(pixels, width, height, channels, stride, plane, out_w, out_h,
+                   &shadows, &highlights);
+
+    // Laplacian and Sobel over the interior, with Laplacian moments kept
+    // per grid cell so a sharp subject against a soft background still
+    // scores high. Integer loops over one row at a time vectorize well.
+    Moments cells[RAW_CULL_GRID][RAW_CULL_GRID];
+    memset(cells, 0, sizeof(cells));
+    int64_t luma_sum = 0;
+    double gradient_sum = 0.0;
+
+    for (int y = 0; y < out_h; y++) {
+        const uint8_t* row = plane + (size_t)y * out_w;
+        for (int x = 0; x < out_w; x++) luma_sum += row[x];
+    }
+
+    for (int y = 1; y < out_h - 1; y++) {
+        const uint8_t* up = plane + (size_t)(y - 1) * out_w;
+        const uint8_t* row = up + out_w;
+        const uint8_t* down = row + out_w;
+        int cell_y = y * RAW_CULL_GRID / out_h;
+
+        int64_t row_gradient = 0;
+        for (int cell_x = 0; cell_x < RAW_CULL_GRID; cell_x++) {
+            int x0 = cell_x * out_w / RAW_CULL_GRID;
+            int x1 = (cell_x + 1) * out_w / RAW_CULL_GRID;
+            if (x0 < 1) x0 = 1;
+            if (x1 > out_w - 1) x1 = out_w - 1;
+
+            int64_t sum = 0, square_sum = 0;
+            for (int x = x0; x < x1; x++) {
+                int lap = 4 * row[x] - up[x] - down[x] - row[x - 1] - row[x + 1];
+                int gx = (up[x + 1] + 2 * row[x + 1] + down[x + 1]) - (up[x - 1] + 2 * row[x - 1] + down[x - 1]);
+                int gy = (down[x - 1] + 2 * down[x] + down[x + 1]) - (up[x - 1] + 2 * up[x] + up[x + 1]);
+                sum += lap;
+                square_sum += lap * lap;
+                row_gradient += gx * gx + gy * gy;
+            }
+            Moments* cell = &cells[cell_y][cell_x];
+            cell->sum += sum;
+            cell->square_sum += square_sum;
+            cell->count += x1 > x0 ? x1 - x0 : 0;
+        }
+        gradient_sum += (double)row_gradient;
+    }
+
+    Moments total = {0, 0, 0};
+    double peak = 0.0;
+    for (int cy = 0; cy < RAW_CULL_GRID; cy++) {
+        for (int cx = 0; cx < RAW_CULL_GRID; cx++) {
+            const Moments* cell = &cells[cy][cx];
+            total.sum += cell->sum;
+            total.square_sum += cell->square_sum;
+            total.count += cell->count;
+            double v = variance(cell);
+            if (v > peak) peak = v;
+        }
+    }
+
+    double source_pixels = (double)width * height;
+    score->status = 0;
+    score->width = out_w;
+    score->height = out_h;
+    score->sharpness = (float)variance(&total);
+    score->peak_sharpness = (float)peak;
+    score->tenengrad = total.count ? (float)(gradient_sum / total.count) : 0.0f;
+    score->mean_luma = (float)((double)luma_sum / ((double)out_w * out_h) / 255.0);
+    score->shadows_clipped = (float)(shadows / source_pixels);
+    score->highlights_clipped = (float)(highlights / source_pixels);
+    score->error[0] = '\0';
+
+    free(plane);
+    return 1;
+}
+
+// Decode a JPEG preview at the smallest libjpeg-turbo scale that still
+// covers target_size. Returns packed RGB or NULL.
+static uint8_t* decode_preview_jpeg(tjhandle handle, const uint8_t* jpeg, unsigned long size,
+                                    int min_size, int target_size, int* width, int* height) {
+    int w, h, subsampling, colorspace;
+    if (tjDecompressHeader3(handle, jpeg, size, &w, &h, &subsampling, &colorspace) != 0) {
+        return NULL;
+    }
+    if ((w > h ? w : h) < min_size) return NULL;
+
+    int factor_count = 0;
+    tjscalingfactor* factors = tjGetScalingFactors(&factor_count);
+    int best_w = w, best_h = h;
+    for (int i = 0; factors && i < factor_count; i++) {
+        int sw = TJSCALED(w, factors[i]);
+        int sh = TJSCALED(h, factors[i]);
+        int edge = sw > sh ? sw : sh;
+        if (edge >= target_size && sw * sh < best_w * best_h) {
+            best_w = sw;
+            best_h = sh;
+        }
+    }
+
+    uint8_t* rgb = malloc((size_t)best_w * best_h * 3);
+    if (!rgb) return NULL;
+    if (tjDecompress2(handle, jpeg, size, rgb, best_w, 0, best_h, TJPF_RGB, TJFLAG_FASTDCT) != 0) {
+        free(rgb);
+        return NULL;
+    }
+    *width = best_w;
+    *height = best_h;
+    return rgb;
+}
+
+int raw_preview_rgb(libraw_data_t* lr, void* jpeg, int min_size, int target_size,
+                    RawRgbImage* out) {
+    memset(out, 0, sizeof(*out));
+    if (libraw_unpack_thumb(lr) != LIBRAW_SUCCESS) return 0;
+
+    int err = 0;
+    libraw_processed_image_t* thumb = libraw_dcraw_make_mem_thumb(lr, &err);
+    if (!thumb) return 0;
+
+    if (thumb->type == LIBRAW_IMAGE_JPEG && jpeg) {
+        out->buffer = decode_preview_jpeg((tjhandle)jpeg, thumb->data, thumb->data_size,
+                                          min_size, target_size, &out->width, &out->height);
+        out->pixels = out->buffer;
+        libraw_dcraw_clear_mem(thumb);
+    } else if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->colors == 3 && thumb->bits == 8 &&
+               (thumb->width > thumb->height ? thumb->width : thumb->height) >= min_size) {
+        out->image = thumb;
+        out->pixels = thumb->data;
+        out->width = thumb->width;
+        out->height = thumb->height;
+    } else {
+        libraw_dcraw_clear_mem(thumb);
+    }
+    return out->pixels != NULL;
+}
+
+int raw_half_size_rgb(libraw_data_t* lr, RawRgbImage* out) {
+    memset(out, 0, sizeof(*out));
+
+    // Same rendering as raw_processor_init, at half size
+    lr->params.output_bps = 8;
+    lr->params.output_color = 1;
+    lr->params.use_camera_wb = 1;
+    lr->params.use_auto_wb = 0;
+    lr->params.no_auto_bright = 1;
+    lr->params.half_size = 1;
+
+    int ret = libraw_unpack(lr);
+    raw_memory_update(lr);
+    if (ret == LIBRAW_SUCCESS) {
+        ret = libraw_dcraw_process(lr);
+        raw_memory_update(lr);
+    }
+    if (ret != LIBRAW_SUCCESS) return ret;
+
+    libraw_processed_image_t* image = libraw_dcraw_make_mem_image(lr, &ret);
+    if (!image) return ret != LIBRAW_SUCCESS ? ret : LIBRAW_UNSPECIFIED_ERROR;
+    if (image->colors != 3 || image->bits != 8) {
+        libraw_dcraw_clear_mem(image);
+        return LIBRAW_UNSPECIFIED_ERROR;
+    }
+
+    out->image = image;
+    out->pixels = image->data;
+    out->width = image->width;
+    out->height = image->height;
+    return LIBRAW_SUCCESS;
+}
+
+void raw_rgb_image_free(RawRgbImage* image) {
+    if (!image) return;
+    free(image->buffer);
+    if (image->image) libraw_dcraw_clear_mem(image->image);
+    memset(image, 0, sizeof(*image));
+}
+
+// Embedded preview first, then a half-size decode
+static void score_file(const char* path, const RawCullOptions* options, tjhandle jpeg,
+                       RawCullScore* score) {
+    libraw_data_t* lr = libraw_init(0);
+    if (!lr) {
+        score->status = -ENOMEM;
+        snprintf(score->error, sizeof(score->error), "Failed to initialize LibRaw");
+        return;
+    }
+
+    int ret = libraw_open_file(lr, path);
+    if (ret != LIBRAW_SUCCESS) {
+        score->status = ret;
+        snprintf(score->error, sizeof(score->error), "%s", libraw_strerror(ret));
+        libraw_close(lr);
+        return;
+    }
+    raw_memory_update(lr);
+
+    RawRgbImage rgb;
+    if (raw_preview_rgb(lr, jpeg, options->preview_min_size, options->analysis_size, &rgb)) {
+        score->source = RAW_CULL_SOURCE_PREVIEW;
+    } else {
+        ret = raw_half_size_rgb(lr, &rgb);
+        score->source = RAW_CULL_SOURCE_HALF_SIZE;
+    }
+
+    if (ret != LIBRAW_SUCCESS) {
+        score->status = ret;
+        snprintf(score->error, sizeof(score->error), "%s", libraw_strerror(ret));
+    } else if (!raw_cull_score_pixels(rgb.pixels, rgb.width, rgb.height, 3, 0,
+                                      options->analysis_size, score)) {
+        score->status = -ENOMEM;
+        snprintf(score->error, sizeof(score->error), "Failed to score image");
+    }
+
+    raw_rgb_image_free(&rgb);
+    raw_memory_release(lr);
+    libraw_close(lr);
+}
+
+typedef struct {
+    const char** paths;
+    int count;
+    RawCullOptions options;
+    RawCullScore* scores;
+    int next;
+    int scored;
+    pthread_mutex_t lock;
+} CullRun;
+
+static void* cull_worker(void* arg) {
+    CullRun* run = (CullRun*)arg;
+    tjhandle jpeg = tjInitDecompress();
+
+    for (;;) {
+        pthread_mutex_lock(&run->lock);
+        int index = run->next++;
+        pthread_mutex_unlock(&run->lock);
+        if (index >= run->count) break;
+
+        RawCullScore* score = &run->scores[index];
+        memset(score, 0, sizeof(*score));
+        score->index = index;
+
+        job_begin(run->options.job_class);
+        score_file(run->paths[index] ? run->paths[index] : "", &run->options, jpeg, score);
+        job_end(run->options.job_class);
+
+        if (score->status == 0) {
+            pthread_mutex_lock(&run->lock);
+            run->scored++;
+            pthread_mutex_unlock(&run->lock);
+        }
+    }
+
+    if (jpeg) tjDestroy(jpeg);
+    return NULL;
+}
+
+void raw_cull_default_options(RawCullOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->analysis_size = RAW_CULL_DEFAULT_ANALYSIS_SIZE;
+    options->preview_min_size = RAW_CULL_DEFAULT_PREVIEW_MIN;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    options->threads = cores > 0 ? (int32_t)cores : 1;
+    options->job_class = JOB_CLASS_BATCH;
+}
+
+int raw_cull_run(const char** paths, int count, const RawCullOptions* options,
+                 RawCullScore* scores) {
+    if (!paths || !scores || count <= 0) return 0;
+
+    CullRun run = {
+        .paths = paths,
+        .count = count,
+        .scores = scores
+    };
+    raw_cull_default_options(&run.options);
+    if (options) {
+        if (options->analysis_size > 0) run.options.analysis_size = options->analysis_size;
+        if (options->preview_min_size > 0) run.options.preview_min_size = options->preview_min_size;
+        if (options->threads > 0) run.options.threads = options->threads;
+        run.options.job_class = options->job_class;
+    }
+    pthread_mutex_init(&run.lock, NULL);
+
+    int thread_count = run.options.threads < count ? run.options.threads : count;
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, cull_worker, &run) != 0) break;
+            started++;
+        }
+    }
+    cull_worker(&run);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&run.lock);
+    return run.scored;
+}
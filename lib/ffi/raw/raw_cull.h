@@ -0,0 +1,58 @@
+#ifndef RAW_CULL_H
+#define RAW_CULL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Focus and exposure scores for culling a folder. Each file is scored from
+// its embedded preview, decoded at reduced scale, or from a half-size
+// decode when the preview is missing or too small. Scoring happens on a
+// luma plane resized to a fixed long edge, so scores from either source and
+// from different cameras are comparable.
+
+#define RAW_CULL_SOURCE_PREVIEW 0
+#define RAW_CULL_SOURCE_HALF_SIZE 1
+
+typedef struct {
+    int32_t analysis_size;      // Long edge of the scored image (0 = 1024)
+    int32_t preview_min_size;   // Previews with a shorter long edge are not used (0 = 640)
+    int32_t threads;            // Worker threads (0 = number of cores)
+    int32_t job_class;          // JOB_CLASS_* the files are scheduled as
+} RawCullOptions;
+
+typedef struct {
+    int32_t index;              // Position in the path list
+    int32_t status;             // 0 on success, LibRaw error code or -errno
+    int32_t source;             // RAW_CULL_SOURCE_*
+    int32_t width;              // Size of the scored image
+    int32_t height;
+    float sharpness;            // Variance of the Laplacian over the frame
+    float peak_sharpness;       // Highest variance of the Laplacian in a 4x4 grid
+    float tenengrad;            // Mean squared Sobel gradient
+    float mean_luma;            // 0-1
+    float shadows_clipped;      // Fraction of pixels with every channel <= 2
+    float highlights_clipped;   // Fraction of pixels with a channel >= 253
+    char error[128];
+} RawCullScore;
+
+void raw_cull_default_options(RawCullOptions* options);
+
+// Score packed 8-bit RGB or RGBA pixels. stride 0 means tightly packed.
+// Sets everything but index and source.
+int raw_cull_score_pixels(const uint8_t* pixels, int width, int height, int channels,
+                          size_t stride, int analysis_size, RawCullScore* score);
+
+// Score count files into scores[count], in path order. Blocks until done;
+// returns the number of files scored successfully.
+int raw_cull_run(const char** paths, int count, const RawCullOptions* options,
+                 RawCullScore* scores);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_CULL_H
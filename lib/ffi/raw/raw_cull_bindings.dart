@@ -0,0 +1,81 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Where a score came from, mirrors RAW_CULL_SOURCE_* in raw_cull.h
+abstract class RawCullSource {
+  static const int preview = 0;
+  static const int halfSize = 1;
+}
+
+/// Mirrors RawCullOptions in raw_cull.h
+final class RawCullOptions extends Struct {
+  @Int32()
+  external int analysisSize;
+  @Int32()
+  external int previewMinSize;
+  @Int32()
+  external int threads;
+  @Int32()
+  external int jobClass;
+}
+
+/// Mirrors RawCullScore in raw_cull.h
+final class RawCullScore extends Struct {
+  @Int32()
+  external int index;
+  @Int32()
+  external int status;
+  @Int32()
+  external int source;
+  @Int32()
+  external int width;
+  @Int32()
+  external int height;
+  @Float()
+  external double sharpness;
+  @Float()
+  external double peakSharpness;
+  @Float()
+  external double tenengrad;
+  @Float()
+  external double meanLuma;
+  @Float()
+  external double shadowsClipped;
+  @Float()
+  external double highlightsClipped;
+  @Array(128)
+  external Array<Char> error;
+}
+
+// Bindings for the culling entry points of libraw_processor
+class RawCullBindings {
+  final DynamicLibrary _lib;
+
+  RawCullBindings(this._lib);
+
+  late final _raw_cull_default_options = _lib.lookupFunction<
+      Void Function(Pointer<RawCullOptions>),
+      void Function(Pointer<RawCullOptions>)>('raw_cull_default_options');
+
+  late final _raw_cull_score_pixels = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Int32, Size, Int32, Pointer<RawCullScore>),
+      int Function(Pointer<Uint8>, int, int, int, int, int, Pointer<RawCullScore>)>('raw_cull_score_pixels');
+
+  late final _raw_cull_run = _lib.lookupFunction<
+      Int32 Function(Pointer<Pointer<Utf8>>, Int32, Pointer<RawCullOptions>, Pointer<RawCullScore>),
+      int Function(Pointer<Pointer<Utf8>>, int, Pointer<RawCullOptions>, Pointer<RawCullScore>)>('raw_cull_run');
+
+  void rawCullDefaultOptions(Pointer<RawCullOptions> options) {
+    _raw_cull_default_options(options);
+  }
+
+  int rawCullScorePixels(Pointer<Uint8> pixels, int width, int height, int channels,
+      int stride, int analysisSize, Pointer<RawCullScore> score) {
+    return _raw_cull_score_pixels(pixels, width, height, channels, stride, analysisSize, score);
+  }
+
+  int rawCullRun(Pointer<Pointer<Utf8>> paths, int count, Pointer<RawCullOptions> options,
+      Pointer<RawCullScore> scores) {
+    return _raw_cull_run(paths, count, options, scores);
+  }
+}
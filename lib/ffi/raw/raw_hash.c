@@ -0,0 +1,376 @@
+#include "raw_hash.h"
+#include "../common/job_scheduler.h"
+#include "../common/cpu_dispatch.h"
+#include "raw_processor_internal.h"
+#include <libraw/libraw.h>
+#include <turbojpeg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define RAW_HASH_DCT_SIZE 32
+#define RAW_HASH_BITS 8
+#define RAW_HASH_PREVIEW_SIZE 64    // Smallest preview decode, twice the DCT size
+#define RAW_HASH_DEFAULT_DISTANCE 10
+#define RAW_HASH_MAX_DISTANCE 15
+#define RAW_HASH_CHUNKS 4           // 16-bit chunks of the pHash for multi-index lookup
+#define RAW_HASH_CHUNK_VALUES 65536
+
+// Box filter RGB down to an out_w x out_h luma plane
+AKS_MULTIVERSION
+static void box_luma(const uint8_t* pixels, int width, int height, int channels, size_t stride,
+                     float* plane, int out_w, int out_h) {
+    for (int oy = 0; oy < out_h; oy++) {
+        int y0 = (int)((int64_t)oy * height / out_h);
+        int y1 = (int)((int64_t)(oy + 1) * height / out_h);
+        if (y1 <= y0) y1 = y0 + 1;
+
+        for (int ox = 0; ox < out_w; ox++) {
+            int x0 = (int)((int64_t)ox * width / out_w);
+            int x1 = (int)((int64_t)(ox + 1) * width / out_w);
+            if (x1 <= x0) x1 = x0 + 1;
+
+            uint32_t sum = 0;
+            for (int y = y0; y < y1; y++) {
+                const uint8_t* p = pixels + (size_t)y * stride + (size_t)x0 * channels;
+                for (int x = x0; x < x1; x++, p += channels) {
+                    sum += 77u * p[0] + 150u * p[1] + 29u * p[2];
+                }
+            }
+            plane[oy * out_w + ox] = (float)sum / (256.0f * (x1 - x0) * (y1 - y0));
+        }
+    }
+}
+
+static int compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// DCT-II basis for the frequencies that are hashed
+static float dct_basis[RAW_HASH_BITS][RAW_HASH_DCT_SIZE];
+static pthread_once_t dct_basis_once = PTHREAD_ONCE_INIT;
+
+static void init_dct_basis(void) {
+    for (int u = 0; u < RAW_HASH_BITS; u++) {
+        for (int x = 0; x < RAW_HASH_DCT_SIZE; x++) {
+            dct_basis[u][x] = (float)cos(M_PI * (2 * x + 1) * u / (2.0 * RAW_HASH_DCT_SIZE));
+        }
+    }
+}
+
+// Low 8x8 frequencies of a 32x32 DCT-II against their median, DC excluded
+static uint64_t phash_plane(const float* plane) {
+    pthread_once(&dct_basis_once, init_dct_basis);
+
+    // Rows first, keeping only the frequencies that are hashed
+    float rows[RAW_HASH_DCT_SIZE][RAW_HASH_BITS];
+    for (int y = 0; y < RAW_HASH_DCT_SIZE; y++) {
+        const float* row = plane + y * RAW_HASH_DCT_SIZE;
+        for (int u = 0; u < RAW_HASH_BITS; u++) {
+            float sum = 0.0f;
+            for (int x = 0; x < RAW_HASH_DCT_SIZE; x++) sum += dct_basis[u][x] * row[x];
+            rows[y][u] = sum;
+        }
+    }
+
+    float coefficients[RAW_HASH_BITS * RAW_HASH_BITS];
+    for (int v = 0; v < RAW_HASH_BITS; v++) {
+        for (int u = 0; u < RAW_HASH_BITS; u++) {
+            float sum = 0.0f;
+            for (int y = 0; y < RAW_HASH_DCT_SIZE; y++) sum += dct_basis[v][y] * rows[y][u];
+            coefficients[v * RAW_HASH_BITS + u] = sum;
+        }
+    }
+
+    float sorted[RAW_HASH_BITS * RAW_HASH_BITS - 1];
+    memcpy(sorted, coefficients + 1, sizeof(sorted));
+    qsort(sorted, RAW_HASH_BITS * RAW_HASH_BITS - 1, sizeof(float), compare_floats);
+    float median = sorted[(RAW_HASH_BITS * RAW_HASH_BITS - 1) / 2];
+
+    uint64_t hash = 0;
+    for (int i = 1; i < RAW_HASH_BITS * RAW_HASH_BITS; i++) {
+        if (coefficients[i] > median) hash |= 1ull << i;
+    }
+    return hash;
+}
+
+// One bit per horizontal neighbour pair of a 9x8 plane
+static uint64_t dhash_plane(const float* plane) {
+    uint64_t hash = 0;
+    for (int y = 0; y < RAW_HASH_BITS; y++) {
+        const float* row = plane + y * (RAW_HASH_BITS + 1);
+        for (int x = 0; x < RAW_HASH_BITS; x++) {
+            if (row[x] > row[x + 1]) hash |= 1ull << (y * RAW_HASH_BITS + x);
+        }
+    }
+    return hash;
+}
+
+int raw_hash_pixels(const uint8_t* pixels, int width, int height, int channels, size_t stride,
+                    uint64_t* phash, uint64_t* dhash) {
+    if (!pixels || width <= 0 || height <= 0) return 0;
+    if (channels != 3 && channels != 4) return 0;
+    if (stride == 0) stride = (size_t)width * channels;
+
+    float plane[RAW_HASH_DCT_SIZE * RAW_HASH_DCT_SIZE];
+    if (phash) {
+        box_luma(pixels, width, height, channels, stride, plane, RAW_HASH_DCT_SIZE, RAW_HASH_DCT_SIZE);
+        *phash = phash_plane(plane);
+    }
+    if (dhash) {
+        box_luma(pixels, width, height, channels, stride, plane, RAW_HASH_BITS + 1, RAW_HASH_BITS);
+        *dhash = dhash_plane(plane);
+    }
+    return 1;
+}
+
+// Embedded preview first, then a half-size decode
+static void hash_file(const char* path, tjhandle jpeg, RawHash* hash) {
+    libraw_data_t* lr = libraw_init(0);
+    if (!lr) {
+        hash->status = -ENOMEM;
+        snprintf(hash->error, sizeof(hash->error), "Failed to initialize LibRaw");
+        return;
+    }
+
+    int ret = libraw_open_file(lr, path);
+    if (ret != LIBRAW_SUCCESS) {
+        hash->status = ret;
+        snprintf(hash->error, sizeof(hash->error), "%s", libraw_strerror(ret));
+        libraw_close(lr);
+        return;
+    }
+    raw_memory_update(lr);
+    hash->timestamp = (int64_t)lr->other.timestamp;
+
+    RawRgbImage rgb;
+    hash->from_preview = raw_preview_rgb(lr, jpeg, RAW_HASH_PREVIEW_SIZE, RAW_HASH_PREVIEW_SIZE, &rgb);
+    if (!hash->from_preview) {
+        ret = raw_half_size_rgb(lr, &rgb);
+    }
+
+    if (ret != LIBRAW_SUCCESS) {
+        hash->status = ret;
+        snprintf(hash->error, sizeof(hash->error), "%s", libraw_strerror(ret));
+    } else {
+        raw_hash_pixels(rgb.pixels, rgb.width, rgb.height, 3, 0, &hash->phash, &hash->dhash);
+    }
+
+    raw_rgb_image_free(&rgb);
+    raw_memory_release(lr);
+    libraw_close(lr);
+}
+
+typedef struct {
+    const char** paths;
+    int count;
+    RawHashOptions options;
+    RawHash* hashes;
+    int next;
+    int hashed;
+    pthread_mutex_t lock;
+} HashRun;
+
+static void* hash_worker(void* arg) {
+    HashRun* run = (HashRun*)arg;
+    tjhandle jpeg = tjInitDecompress();
+
+    for (;;) {
+        pthread_mutex_lock(&run->lock);
+        int index = run->next++;
+        pthread_mutex_unlock(&run->lock);
+        if (index >= run->count) break;
+
+        RawHash* hash = &run->hashes[index];
+        memset(hash, 0, sizeof(*hash));
+        hash->index = index;
+
+        job_begin(run->options.job_class);
+        hash_file(run->paths[index] ? run->paths[index] : "", jpeg, hash);
+        job_end(run->options.job_class);
+
+        if (hash->status == 0) {
+            pthread_mutex_lock(&run->lock);
+            run->hashed++;
+            pthread_mutex_unlock(&run->lock);
+        }
+    }
+
+    if (jpeg) tjDestroy(jpeg);
+    return NULL;
+}
+
+void raw_hash_default_options(RawHashOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    options->threads = cores > 0 ? (int32_t)cores : 1;
+    options->job_class = JOB_CLASS_BATCH;
+}
+
+void raw_hash_default_group_options(RawHashGroupOptions* options) {
+    if (!options) return;
+    memset(options, 0, sizeof(*options));
+    options->max_phash_distance = RAW_HASH_DEFAULT_DISTANCE;
+}
+
+int raw_hash_run(const char** paths, int count, const RawHashOptions* options, RawHash* hashes) {
+    if (!paths || !hashes || count <= 0) return 0;
+
+    HashRun run = {
+        .paths = paths,
+        .count = count,
+        .hashes = hashes
+    };
+    raw_hash_default_options(&run.options);
+    if (options) {
+        if (options->threads > 0) run.options.threads = options->threads;
+        run.options.job_class = options->job_class;
+    }
+    pthread_mutex_init(&run.lock, NULL);
+
+    int thread_count = run.options.threads < count ? run.options.threads : count;
+    pthread_t* threads = thread_count > 1 ? malloc(sizeof(pthread_t) * (thread_count - 1)) : NULL;
+    int started = 0;
+    if (threads) {
+        for (int i = 0; i < thread_count - 1; i++) {
+            if (pthread_create(&threads[i], NULL, hash_worker, &run) != 0) break;
+            started++;
+        }
+    }
+    hash_worker(&run);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&run.lock);
+    return run.hashed;
+}
+
+// Union-find over the groups array, with the lowest index as the root
+static int32_t find_root(int32_t* parent, int32_t i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+static void unite(int32_t* parent, int32_t a, int32_t b) {
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a < b) parent[b] = a;
+    else if (b < a) parent[a] = b;
+}
+
+typedef struct {
+    const RawHash* hashes;
+    const RawHashGroupOptions* options;
+    const int32_t* offsets;     // Per chunk value, into order
+    const int32_t* order;       // Indices sorted by chunk value
+    int32_t* parent;
+} GroupContext;
+
+static int hashes_match(const GroupContext* ctx, const RawHash* a, const RawHash* b) {
+    if (raw_hash_distance(a->phash, b->phash) > ctx->options->max_phash_distance) return 0;
+    if (ctx->options->max_dhash_distance > 0 &&
+        raw_hash_distance(a->dhash, b->dhash) > ctx->options->max_dhash_distance) return 0;
+    if (ctx->options->max_seconds > 0 && a->timestamp && b->timestamp) {
+        int64_t seconds = a->timestamp - b->timestamp;
+        if (seconds < 0) seconds = -seconds;
+        if (seconds > ctx->options->max_seconds) return 0;
+    }
+    return 1;
+}
+
+// Compare i with every later hash whose chunk equals value
+static void probe(GroupContext* ctx, int32_t i, uint32_t value) {
+    const RawHash* a = &ctx->hashes[i];
+    for (int32_t k = ctx->offsets[value]; k < ctx->offsets[value + 1]; k++) {
+        int32_t j = ctx->order[k];
+        if (j > i && hashes_match(ctx, a, &ctx->hashes[j])) unite(ctx->parent, i, j);
+    }
+}
+
+int raw_hash_group(const RawHash* hashes, int count, const RawHashGroupOptions* options,
+                   int32_t* groups) {
+    if (!hashes || !groups || count <= 0) return 0;
+
+    RawHashGroupOptions resolved;
+    raw_hash_default_group_options(&resolved);
+    if (options) {
+        resolved = *options;
+        if (resolved.max_phash_distance <= 0) resolved.max_phash_distance = RAW_HASH_DEFAULT_DISTANCE;
+        if (resolved.max_phash_distance > RAW_HASH_MAX_DISTANCE) resolved.max_phash_distance = RAW_HASH_MAX_DISTANCE;
+    }
+
+    // Multi-index hashing: hashes within d bits agree to within d / 4 bits
+    // on at least one of the four 16-bit chunks, so only the buckets near
+    // each chunk value need comparing instead of every pair
+    int32_t* offsets = calloc((size_t)RAW_HASH_CHUNK_VALUES + 1, sizeof(int32_t));
+    int32_t* cursor = malloc(sizeof(int32_t) * RAW_HASH_CHUNK_VALUES);
+    int32_t* order = malloc(sizeof(int32_t) * count);
+    if (!offsets || !cursor || !order) {
+        free(offsets);
+        free(cursor);
+        free(order);
+        return -1;
+    }
+
+    for (int32_t i = 0; i < count; i++) groups[i] = i;
+
+    GroupContext ctx = {
+        .hashes = hashes,
+        .options = &resolved,
+        .offsets = offsets,
+        .order = order,
+        .parent = groups
+    };
+    int radius = resolved.max_phash_distance / RAW_HASH_CHUNKS;
+
+    for (int chunk = 0; chunk < RAW_HASH_CHUNKS; chunk++) {
+        int shift = chunk * 16;
+
+        // Counting sort of the valid hashes by this chunk
+        memset(offsets, 0, sizeof(int32_t) * (RAW_HASH_CHUNK_VALUES + 1));
+        for (int32_t i = 0; i < count; i++) {
+            if (hashes[i].status == 0) offsets[((hashes[i].phash >> shift) & 0xffff) + 1]++;
+        }
+        for (int v = 0; v < RAW_HASH_CHUNK_VALUES; v++) offsets[v + 1] += offsets[v];
+        memcpy(cursor, offsets, sizeof(int32_t) * RAW_HASH_CHUNK_VALUES);
+        for (int32_t i = 0; i < count; i++) {
+            if (hashes[i].status == 0) order[cursor[(hashes[i].phash >> shift) & 0xffff]++] = i;
+        }
+
+        for (int32_t i = 0; i < count; i++) {
+            if (hashes[i].status != 0) continue;
+            uint32_t value = (uint32_t)((hashes[i].phash >> shift) & 0xffff);
+            probe(&ctx, i, value);
+            for (int a = 0; a < 16 && radius >= 1; a++) {
+                probe(&ctx, i, value ^ (1u << a));
+                for (int b = a + 1; b < 16 && radius >= 2; b++) {
+                    probe(&ctx, i, value ^ (1u << a) ^ (1u << b));
+                    for (int c = b + 1; c < 16 && radius >= 3; c++) {
+                        probe(&ctx, i, value ^ (1u << a) ^ (1u << b) ^ (1u << c));
+                    }
+                }
+            }
+        }
+    }
+
+    int group_count = 0;
+    for (int32_t i = 0; i < count; i++) {
+        groups[i] = find_root(groups, i);
+        if (groups[i] == i) group_count++;
+    }
+
+    free(offsets);
+    free(cursor);
+    free(order);
+    return group_count;
+}
@@ -0,0 +1,65 @@
+#ifndef RAW_HASH_H
+#define RAW_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Perceptual hashes for grouping bursts and duplicates. Files are hashed
+// from their embedded preview, decoded at the smallest JPEG scale, so a
+// card of several thousand files hashes in seconds. Grouping compares
+// hashes by Hamming distance, optionally within a capture time window.
+
+typedef struct {
+    int32_t threads;            // Worker threads (0 = number of cores)
+    int32_t job_class;          // JOB_CLASS_* the files are scheduled as
+} RawHashOptions;
+
+typedef struct {
+    int32_t index;              // Position in the path list
+    int32_t status;             // 0 on success, LibRaw error code or -errno
+    int32_t from_preview;       // 0 when a half-size decode was hashed
+    int32_t reserved;
+    int64_t timestamp;          // Capture time in seconds, 0 when unknown
+    uint64_t phash;             // 8x8 low frequencies of a 32x32 DCT
+    uint64_t dhash;             // Horizontal gradients of a 9x8 image
+    char error[128];
+} RawHash;
+
+typedef struct {
+    int32_t max_phash_distance; // Hamming distance to group at (0 = 10, at most 15)
+    int32_t max_dhash_distance; // Also required when > 0
+    int32_t max_seconds;        // Capture time window, 0 to ignore capture times
+    int32_t reserved;
+} RawHashGroupOptions;
+
+void raw_hash_default_options(RawHashOptions* options);
+void raw_hash_default_group_options(RawHashGroupOptions* options);
+
+// Hash packed 8-bit RGB or RGBA pixels. stride 0 means tightly packed.
+int raw_hash_pixels(const uint8_t* pixels, int width, int height, int channels, size_t stride,
+                    uint64_t* phash, uint64_t* dhash);
+
+// Hash count files into hashes[count], in path order. Blocks until done;
+// returns the number of files hashed successfully.
+int raw_hash_run(const char** paths, int count, const RawHashOptions* options, RawHash* hashes);
+
+// Group hashes that are within the distances of each other, transitively.
+// groups[i] receives the lowest index of the group hashes[i] belongs to;
+// failed hashes are groups of their own. Returns the number of groups, or
+// -1 when out of memory.
+int raw_hash_group(const RawHash* hashes, int count, const RawHashGroupOptions* options,
+                   int32_t* groups);
+
+static inline int raw_hash_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_HASH_H
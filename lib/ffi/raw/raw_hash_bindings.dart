@@ -0,0 +1,92 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Mirrors RawHashOptions in raw_hash.h
+final class RawHashOptions extends Struct {
+  @Int32()
+  external int threads;
+  @Int32()
+  external int jobClass;
+}
+
+/// Mirrors RawHash in raw_hash.h
+final class RawHash extends Struct {
+  @Int32()
+  external int index;
+  @Int32()
+  external int status;
+  @Int32()
+  external int fromPreview;
+  @Int32()
+  external int reserved;
+  @Int64()
+  external int timestamp;
+  @Uint64()
+  external int phash;
+  @Uint64()
+  external int dhash;
+  @Array(128)
+  external Array<Char> error;
+}
+
+/// Mirrors RawHashGroupOptions in raw_hash.h
+final class RawHashGroupOptions extends Struct {
+  @Int32()
+  external int maxPhashDistance;
+  @Int32()
+  external int maxDhashDistance;
+  @Int32()
+  external int maxSeconds;
+  @Int32()
+  external int reserved;
+}
+
+// Bindings for the perceptual hash entry points of libraw_processor
+class RawHashBindings {
+  final DynamicLibrary _lib;
+
+  RawHashBindings(this._lib);
+
+  late final _raw_hash_default_options = _lib.lookupFunction<
+      Void Function(Pointer<RawHashOptions>),
+      void Function(Pointer<RawHashOptions>)>('raw_hash_default_options');
+
+  late final _raw_hash_default_group_options = _lib.lookupFunction<
+      Void Function(Pointer<RawHashGroupOptions>),
+      void Function(Pointer<RawHashGroupOptions>)>('raw_hash_default_group_options');
+
+  late final _raw_hash_pixels = _lib.lookupFunction<
+      Int32 Function(Pointer<Uint8>, Int32, Int32, Int32, Size, Pointer<Uint64>, Pointer<Uint64>),
+      int Function(Pointer<Uint8>, int, int, int, int, Pointer<Uint64>, Pointer<Uint64>)>('raw_hash_pixels');
+
+  late final _raw_hash_run = _lib.lookupFunction<
+      Int32 Function(Pointer<Pointer<Utf8>>, Int32, Pointer<RawHashOptions>, Pointer<RawHash>),
+      int Function(Pointer<Pointer<Utf8>>, int, Pointer<RawHashOptions>, Pointer<RawHash>)>('raw_hash_run');
+
+  late final _raw_hash_group = _lib.lookupFunction<
+      Int32 Function(Pointer<RawHash>, Int32, Pointer<RawHashGroupOptions>, Pointer<Int32>),
+      int Function(Pointer<RawHash>, int, Pointer<RawHashGroupOptions>, Pointer<Int32>)>('raw_hash_group');
+
+  void rawHashDefaultOptions(Pointer<RawHashOptions> options) {
+    _raw_hash_default_options(options);
+  }
+
+  void rawHashDefaultGroupOptions(Pointer<RawHashGroupOptions> options) {
+    _raw_hash_default_group_options(options);
+  }
+
+  int rawHashPixels(Pointer<Uint8> pixels, int width, int height, int channels, int stride,
+      Pointer<Uint64> phash, Pointer<Uint64> dhash) {
+    return _raw_hash_pixels(pixels, width, height, channels, stride, phash, dhash);
+  }
+
+  int rawHashRun(Pointer<Pointer<Utf8>> paths, int count, Pointer<RawHashOptions> options,
+      Pointer<RawHash> hashes) {
+    return _raw_hash_run(paths, count, options, hashes);
+  }
+
+  int rawHashGroup(Pointer<RawHash> hashes, int count, Pointer<RawHashGroupOptions> options,
+      Pointer<Int32> groups) {
+    return _raw_hash_group(hashes, count, options, groups);
+  }
+}
@@ -0,0 +1,61 @@
+#ifndef RAW_PROCESSOR_INTERNAL_H
+#define RAW_PROCESSOR_INTERNAL_H
+
+// Helpers shared between the raw_processor translation units.
+// Not part of the FFI surface.
+
+#include <libraw/libraw.h>
+#include "../common/mem_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Set the message returned by raw_processor_get_error
+void raw_processor_set_error(const char* format, ...);
+
+// Report what a LibRaw handle holds now: the handle itself, the unpacked
+// raw data and the image being demosaiced. Call again after each stage.
+static inline void raw_memory_update(const libraw_data_t* lr) {
+    int64_t bytes = (int64_t)sizeof(libraw_data_t);
+    if (lr->rawdata.raw_alloc) {
+        bytes += (int64_t)lr->rawdata.sizes.raw_pitch * lr->rawdata.sizes.raw_height;
+    }
+    if (lr->image) {
+        bytes += (int64_t)lr->sizes.iwidth * lr->sizes.iheight * sizeof(*lr->image);
+    }
+    mem_stats_set_owner(MEM_LIBRAW, lr, bytes);
+}
+
+// Before libraw_close
+static inline void raw_memory_release(const libraw_data_t* lr) {
+    mem_stats_set_owner(MEM_LIBRAW, lr, 0);
+}
+
+// 8-bit RGB taken from a LibRaw handle, owned either by malloc or by LibRaw
+typedef struct {
+    const uint8_t* pixels;              // Packed RGB
+    int width;
+    int height;
+    uint8_t* buffer;
+    libraw_processed_image_t* image;
+} RawRgbImage;
+
+// Decode the embedded preview of an opened file at the smallest
+// libjpeg-turbo scale whose long edge still covers target_size. Fails when
+// there is no preview or its long edge is under min_size. jpeg is a
+// decompression tjhandle, or NULL to take bitmap previews only.
+int raw_preview_rgb(libraw_data_t* lr, void* jpeg, int min_size, int target_size,
+                    RawRgbImage* out);
+
+// Half-size decode of an opened file, rendered like raw_processor_init.
+// Returns a LibRaw status.
+int raw_half_size_rgb(libraw_data_t* lr, RawRgbImage* out);
+
+void raw_rgb_image_free(RawRgbImage* image);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_PROCESSOR_INTERNAL_H
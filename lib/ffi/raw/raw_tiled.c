@@ -0,0 +1,107 @@
+#include "raw_tiled.h"
+#include "raw_processor_internal.h"
+#include <libraw/libraw.h>
+#include <stdlib.h>
+#include <string.h>
+
+int raw_processor_probe(const char* filename, int* width, int* height) {
+    if (!filename || !width || !height) {
+        raw_processor_set_error("Invalid probe arguments");
+        return -1;
+    }
+
+    libraw_data_t* lr = libraw_init(0);
+    if (!lr) {
+        raw_processor_set_error("Failed to initialize LibRaw");
+        return -1;
+    }
+
+    int ret = libraw_open_file(lr, filename);
+    if (ret != LIBRAW_SUCCESS) {
+        raw_processor_set_error("Failed to open file: %s", libraw_strerror(ret));
+        libraw_close(lr);
+        return ret;
+    }
+
+    // Orientations 5/6 (flip & 4) swap the axes of the output image
+    *width = lr->sizes.width;
+    *height = lr->sizes.height;
+    if (lr->sizes.flip & 4) {
+        *width = lr->sizes.height;
+        *height = lr->sizes.width;
+    }
+
+    libraw_close(lr);
+    return LIBRAW_SUCCESS;
+}
+
+TiledImage* raw_processor_get_rgb_tiled(void* processor, const char* backing_path, int tile_size) {
+    if (!processor) {
+        raw_processor_set_error("Invalid processor");
+        return NULL;
+    }
+
+    libraw_data_t* lr = (libraw_data_t*)processor;
+    int error_code = 0;
+
+    libraw_processed_image_t* processed = libraw_dcraw_make_mem_image(lr, &error_code);
+    if (!processed || error_code != LIBRAW_SUCCESS) {
+        raw_processor_set_error("Failed to create RGB image: %s",
+                                error_code ? libraw_strerror(error_code) : "Unknown error");
+        return NULL;
+    }
+
+    // The demosaiced 16-bit working image is no longer needed; drop it before
+    // the tile file starts filling the page cache
+    libraw_recycle(lr);
+
+    if (processed->bits != 8 || (processed->colors != 3 && processed->colors != 1)) {
+        raw_processor_set_error("Unsupported output format: %d bits, %d colors",
+                                processed->bits, processed->colors);
+        libraw_dcraw_clear_mem(processed);
+        return NULL;
+    }
+
+    int width = processed->width;
+    int height = processed->height;
+    TiledImage* image = tiled_image_create(backing_path, width, height, 3, tile_size);
+    if (!image) {
+        raw_processor_set_error("Failed to create tiled image: %s", tiled_image_get_error());
+        libraw_dcraw_clear_mem(processed);
+        return NULL;
+    }
+
+    int ok = 1;
+    if (processed->colors == 3) {
+        ok = tiled_image_write_region(image, 0, 0, width, height,
+                                      processed->data, (size_t)width * 3);
+    } else {
+        // Expand grayscale one tile band at a time
+        int band_rows = tiled_image_tile_size(image);
+        uint8_t* band = (uint8_t*)malloc((size_t)width * 3 * band_rows);
+        if (!band) {
+            ok = 0;
+        }
+        for (int y = 0; ok && y < height; y += band_rows) {
+            int rows = y + band_rows <= height ? band_rows : height - y;
+            for (int r = 0; r < rows; r++) {
+                const uint8_t* src = processed->data + (size_t)(y + r) * width;
+                uint8_t* dst = band + (size_t)r * width * 3;
+                for (int x = 0; x < width; x++) {
+                    dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+                }
+            }
+            ok = tiled_image_write_region(image, 0, y, width, rows, band, (size_t)width * 3);
+        }
+        free(band);
+    }
+
+    libraw_dcraw_clear_mem(processed);
+
+    if (!ok) {
+        raw_processor_set_error("Failed to fill tiled image: %s", tiled_image_get_error());
+        tiled_image_close(image);
+        return NULL;
+    }
+    return image;
+}
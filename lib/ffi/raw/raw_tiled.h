@@ -0,0 +1,23 @@
+#ifndef RAW_TILED_H
+#define RAW_TILED_H
+
+#include "../tiles/tiled_image.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Read only the file header and report the output dimensions.
+// Cheap enough to decide between the in-memory and tiled paths.
+int raw_processor_probe(const char* filename, int* width, int* height);
+
+// Write the processed RGB image into a new tiled image instead of a packed
+// buffer, releasing LibRaw's working buffers as early as possible.
+// backing_path may be NULL for an anonymous temporary file.
+TiledImage* raw_processor_get_rgb_tiled(void* processor, const char* backing_path, int tile_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RAW_TILED_H
@@ -0,0 +1,27 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+import '../tiles/tiled_image_bindings.dart';
+
+// Bindings for the tiled entry points of libraw_processor.
+// Kept apart from the ffigen output in libraw_bindings.dart.
+class RawTiledBindings {
+  final DynamicLibrary _lib;
+  
+  RawTiledBindings(this._lib);
+  
+  late final _raw_processor_probe = _lib.lookupFunction<
+      Int32 Function(Pointer<Utf8>, Pointer<Int32>, Pointer<Int32>),
+      int Function(Pointer<Utf8>, Pointer<Int32>, Pointer<Int32>)>('raw_processor_probe');
+  
+  late final _raw_processor_get_rgb_tiled = _lib.lookupFunction<
+      Pointer<NativeTiledImage> Function(Pointer<Void>, Pointer<Utf8>, Int32),
+      Pointer<NativeTiledImage> Function(Pointer<Void>, Pointer<Utf8>, int)>('raw_processor_get_rgb_tiled');
+  
+  int rawProcessorProbe(Pointer<Utf8> filename, Pointer<Int32> width, Pointer<Int32> height) {
+    return _raw_processor_probe(filename, width, height);
+  }
+  
+  Pointer<NativeTiledImage> rawProcessorGetRgbTiled(Pointer<Void> processor, Pointer<Utf8> backingPath, int tileSize) {
+    return _raw_processor_get_rgb_tiled(processor, backingPath, tileSize);
+  }
+}
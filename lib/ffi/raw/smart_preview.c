@@ -0,0 +1,529 @@
+#include "smart_preview.h"
+#include "raw_processor_internal.h"
+#include "../common/cpu_dispatch.h"
+#include <libraw/libraw.h>
+#include <zstd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SMART_PREVIEW_MAGIC "AKSPRV01"
+#define SMART_PREVIEW_VERSION 1
+#define SMART_PREVIEW_BAND_ROWS 64
+
+enum {
+    SMART_PREVIEW_STORED = 0,
+    SMART_PREVIEW_ZSTD = 1,
+};
+
+// On-disk header, followed by band_count index entries and the band data
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t bits;
+    uint32_t original_width;
+    uint32_t original_height;
+    uint32_t band_rows;
+    uint32_t band_count;
+    uint32_t compression;
+    uint32_t reserved[3];  // Pads the header so the index is 8-byte aligned
+} SmartPreviewHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} SmartPreviewBand;
+
+struct SmartPreview {
+    uint8_t* map;
+    size_t map_size;
+    const SmartPreviewHeader* header;
+    const SmartPreviewBand* bands;
+};
+
+// 16-bit linear to 8-bit display values, matching LibRaw's default output
+// (BT.709 curve, gamm = 0.45 / 4.5, no auto-bright)
+static uint8_t output_curve[0x10000];
+static pthread_once_t output_curve_once = PTHREAD_ONCE_INIT;
+
+// Port of dcraw's gamma_curve() in forward mode with imax = 0x10000
+static void build_output_curve(void) {
+    double g[6], bnd[2] = {0, 0};
+    g[0] = 0.45;
+    g[1] = 4.5;
+    g[2] = g[3] = g[4] = 0;
+    bnd[g[1] >= 1] = 1;
+    if (g[1] && (g[1] - 1) * (g[0] - 1) <= 0) {
+        for (int i = 0; i < 48; i++) {
+            g[2] = (bnd[0] + bnd[1]) / 2;
+            bnd[(pow(g[2] / g[1], -g[0]) - 1) / g[0] - 1 / g[2] > -1] = g[2];
+        }
+        g[3] = g[2] / g[1];
+        g[4] = g[2] * (1 / g[0] - 1);
+    }
+
+    for (int i = 0; i < 0x10000; i++) {
+        double r = (double)i / 0x10000;
+        double v = r < g[3] ? r * g[1] : pow(r, g[0]) * (1 + g[4]) - g[4];
+        int curve = (int)(0x10000 * v);
+        if (curve > 0xffff) curve = 0xffff;
+        output_curve[i] = (uint8_t)(curve >> 8);
+    }
+}
+
+// Box-filter 16-bit pixels down to dst_width x dst_height RGB.
+// Grayscale sources are expanded to three channels.
+AKS_MULTIVERSION
+static void downsample_linear(
+    const uint16_t* src,
+    int src_width,
+    int src_height,
+    int colors,
+    uint16_t* dst,
+    int dst_width,
+    int dst_height
+) {
+    uint64_t* sums = (uint64_t*)malloc(sizeof(uint64_t) * dst_width * 3);
+    uint32_t* counts = (uint32_t*)malloc(sizeof(uint32_t) * dst_width);
+    if (!sums || !counts) {
+        free(sums);
+        free(counts);
+        memset(dst, 0, sizeof(uint16_t) * dst_width * dst_height * 3);
+        return;
+    }
+
+    for (int dy = 0; dy < dst_height; dy++) {
+        int y0 = (int)((int64_t)dy * src_height / dst_height);
+        int y1 = (int)((int64_t)(dy + 1) * src_height / dst_height);
+        if (y1 <= y0) y1 = y0 + 1;
+
+        memset(sums, 0, sizeof(uint64_t) * dst_width * 3);
+        memset(counts, 0, sizeof(uint32_t) * dst_width);
+
+        for (int y = y0; y < y1; y++) {
+            const uint16_t* row = src + (size_t)y * src_width * colors;
+            for (int dx = 0; dx < dst_width; dx++) {
+                int x0 = (int)((int64_t)dx * src_width / dst_width);
+                int x1 = (int)((int64_t)(dx + 1) * src_width / dst_width);
+                if (x1 <= x0) x1 = x0 + 1;
+                for (int x = x0; x < x1; x++) {
+                    const uint16_t* px = row + (size_t)x * colors;
+                    if (colors == 3) {
+                        sums[dx * 3] += px[0];
+                        sums[dx * 3 + 1] += px[1];
+                        sums[dx * 3 + 2] += px[2];
+                    } else {
+                        sums[dx * 3] += px[0];
+                        sums[dx * 3 + 1] += px[0];
+                        sums[dx * 3 + 2] += px[0];
+                    }
+                }
+                counts[dx] += x1 - x0;
+            }
+        }
+
+        uint16_t* out = dst + (size_t)dy * dst_width * 3;
+        for (int dx = 0; dx < dst_width; dx++) {
+            for (int c = 0; c < 3; c++) {
+                out[dx * 3 + c] = (uint16_t)(sums[dx * 3 + c] / counts[dx]);
+            }
+        }
+    }
+
+    free(sums);
+    free(counts);
+}
+
+static int write_all(int fd, const void* data, size_t size) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (size > 0) {
+        ssize_t written = write(fd, p, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += written;
+        size -= (size_t)written;
+    }
+    return 1;
+}
+
+// Write the proxy to a temporary file next to proxy_path, then rename it
+static int write_proxy(
+    const char* proxy_path,
+    const uint16_t* pixels,
+    int width,
+    int height,
+    int original_width,
+    int original_height,
+    int level
+) {
+    SmartPreviewHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SMART_PREVIEW_MAGIC, sizeof(header.magic));
+    header.version = SMART_PREVIEW_VERSION;
+    header.width = width;
+    header.height = height;
+    header.channels = 3;
+    header.bits = 16;
+    header.original_width = original_width;
+    header.original_height = original_height;
+    header.band_rows = SMART_PREVIEW_BAND_ROWS;
+    header.band_count = (height + SMART_PREVIEW_BAND_ROWS - 1) / SMART_PREVIEW_BAND_ROWS;
+    header.compression = level > 0 ? SMART_PREVIEW_ZSTD : SMART_PREVIEW_STORED;
+
+    size_t band_bytes = (size_t)width * SMART_PREVIEW_BAND_ROWS * 3 * sizeof(uint16_t);
+    size_t scratch_size = level > 0 ? ZSTD_compressBound(band_bytes) : 0;
+    SmartPreviewBand* bands = (SmartPreviewBand*)calloc(header.band_count, sizeof(SmartPreviewBand));
+    uint8_t* scratch = scratch_size ? (uint8_t*)malloc(scratch_size) : NULL;
+    if (!bands || (scratch_size && !scratch)) {
+        free(bands);
+        free(scratch);
+        raw_processor_set_error("Memory allocation failed");
+        return -1;
+    }
+
+    size_t path_length = strlen(proxy_path);
+    char* temp_path = (char*)malloc(path_length + 5);
+    if (!temp_path) {
+        free(bands);
+        free(scratch);
+        raw_processor_set_error("Memory allocation failed");
+        return -1;
+    }
+    snprintf(temp_path, path_length + 5, "%s.tmp", proxy_path);
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        raw_processor_set_error("Cannot create %s: %s", temp_path, strerror(errno));
+        free(temp_path);
+        free(bands);
+        free(scratch);
+        return -1;
+    }
+
+    // Header and index are rewritten once the band sizes are known
+    uint64_t offset = sizeof(header) + sizeof(SmartPreviewBand) * header.band_count;
+    int ok = lseek(fd, (off_t)offset, SEEK_SET) == (off_t)offset;
+    int reported = 0;
+
+    for (uint32_t b = 0; ok && b < header.band_count; b++) {
+        int y = (int)(b * SMART_PREVIEW_BAND_ROWS);
+        int rows = y + SMART_PREVIEW_BAND_ROWS <= height ? SMART_PREVIEW_BAND_ROWS : height - y;
+        const uint8_t* src = (const uint8_t*)(pixels + (size_t)y * width * 3);
+        size_t src_size = (size_t)width * rows * 3 * sizeof(uint16_t);
+
+        const uint8_t* data = src;
+        size_t size = src_size;
+        if (level > 0) {
+            size = ZSTD_compress(scratch, scratch_size, src, src_size, level);
+            if (ZSTD_isError(size)) {
+                raw_processor_set_error("zstd compression failed: %s", ZSTD_getErrorName(size));
+                reported = 1;
+                ok = 0;
+                break;
+            }
+            data = scratch;
+        }
+
+        bands[b].offset = offset;
+        bands[b].size = size;
+        offset += size;
+        ok = write_all(fd, data, size);
+    }
+
+    if (ok) {
+        ok = lseek(fd, 0, SEEK_SET) == 0 &&
+             write_all(fd, &header, sizeof(header)) &&
+             write_all(fd, bands, sizeof(SmartPreviewBand) * header.band_count);
+    }
+    if (ok) {
+        ok = fsync(fd) == 0;
+    }
+    if (close(fd) != 0) {
+        ok = 0;
+    }
+
+    if (ok && rename(temp_path, proxy_path) != 0) {
+        raw_processor_set_error("Cannot rename %s: %s", temp_path, strerror(errno));
+        ok = 0;
+    } else if (!ok && !reported) {
+        raw_processor_set_error("Failed to write %s: %s", temp_path, strerror(errno));
+    }
+    if (!ok) {
+        unlink(temp_path);
+    }
+
+    free(temp_path);
+    free(bands);
+    free(scratch);
+    return ok ? 0 : -1;
+}
+
+int smart_preview_generate(
+    const char* raw_path,
+    const char* proxy_path,
+    int max_dimension,
+    int compression_level
+) {
+    if (!raw_path || !proxy_path) {
+        raw_processor_set_error("Invalid smart preview arguments");
+        return -1;
+    }
+    if (max_dimension <= 0) {
+        max_dimension = SMART_PREVIEW_DEFAULT_SIZE;
+    }
+
+    libraw_data_t* lr = libraw_init(0);
+    if (!lr) {
+        raw_processor_set_error("Failed to initialize LibRaw");
+        return -1;
+    }
+
+    // Same rendering as raw_processor_init, but 16-bit and linear
+    lr->params.output_bps = 16;
+    lr->params.output_color = 1;
+    lr->params.use_camera_wb = 1;
+    lr->params.use_auto_wb = 0;
+    lr->params.no_auto_bright = 1;
+    lr->params.gamm[0] = 1.0;
+    lr->params.gamm[1] = 1.0;
+    lr->params.output_tiff = 0;
+
+    int ret = libraw_open_file(lr, raw_path);
+    if (ret != LIBRAW_SUCCESS) {
+        raw_processor_set_error("Failed to open file: %s", libraw_strerror(ret));
+        libraw_close(lr);
+        return ret;
+    }
+
+    int original_width = lr->sizes.width;
+    int original_height = lr->sizes.height;
+    if (lr->sizes.flip & 4) {
+        original_width = lr->sizes.height;
+        original_height = lr->sizes.width;
+    }
+
+    // Half-size demosaic is much cheaper and still larger than the proxy
+    int long_edge = original_width > original_height ? original_width : original_height;
+    if (long_edge / 2 >= max_dimension) {
+        lr->params.half_size = 1;
+    }
+
+    ret = libraw_unpack(lr);
+    if (ret == LIBRAW_SUCCESS) {
+        ret = libraw_dcraw_process(lr);
+    }
+    raw_memory_update(lr);
+    if (ret != LIBRAW_SUCCESS) {
+        raw_processor_set_error("Failed to process RAW: %s", libraw_strerror(ret));
+        raw_memory_release(lr);
+        libraw_close(lr);
+        return ret;
+    }
+
+    int error_code = 0;
+    libraw_processed_image_t* processed = libraw_dcraw_make_mem_image(lr, &error_code);
+    raw_memory_release(lr);
+    libraw_close(lr);
+    if (!processed || error_code != LIBRAW_SUCCESS) {
+        raw_processor_set_error("Failed to create RGB image: %s",
+                                error_code ? libraw_strerror(error_code) : "Unknown error");
+        return error_code ? error_code : -1;
+    }
+    if (processed->bits != 16 || (processed->colors != 3 && processed->colors != 1)) {
+        raw_processor_set_error("Unsupported output format: %d bits, %d colors",
+                                processed->bits, processed->colors);
+        libraw_dcraw_clear_mem(processed);
+        return -1;
+    }
+
+    int src_width = processed->width;
+    int src_height = processed->height;
+    int src_long = src_width > src_height ? src_width : src_height;
+    int width = src_width;
+    int height = src_height;
+    if (src_long > max_dimension) {
+        width = (int)((int64_t)src_width * max_dimension / src_long);
+        height = (int)((int64_t)src_height * max_dimension / src_long);
+        if (width < 1) width = 1;
+        if (height < 1) height = 1;
+    }
+
+    uint16_t* pixels = (uint16_t*)malloc(sizeof(uint16_t) * width * height * 3);
+    if (!pixels) {
+        raw_processor_set_error("Memory allocation failed");
+        libraw_dcraw_clear_mem(processed);
+        return -1;
+    }
+    downsample_linear((const uint16_t*)processed->data, src_width, src_height,
+                      processed->colors, pixels, width, height);
+    libraw_dcraw_clear_mem(processed);
+
+    ret = write_proxy(proxy_path, pixels, width, height,
+                      original_width, original_height, compression_level);
+    free(pixels);
+    return ret;
+}
+
+SmartPreview* smart_preview_open(const char* proxy_path) {
+    if (!proxy_path) {
+        raw_processor_set_error("Invalid path");
+        return NULL;
+    }
+
+    int fd = open(proxy_path, O_RDONLY);
+    if (fd < 0) {
+        raw_processor_set_error("Cannot open %s: %s", proxy_path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SmartPreviewHeader)) {
+        close(fd);
+        raw_processor_set_error("Not a smart preview: %s", proxy_path);
+        return NULL;
+    }
+
+    uint8_t* map = (uint8_t*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        raw_processor_set_error("mmap failed: %s", strerror(errno));
+        return NULL;
+    }
+
+    const SmartPreviewHeader* header = (const SmartPreviewHeader*)map;
+    size_t index_end = sizeof(SmartPreviewHeader) + sizeof(SmartPreviewBand) * (size_t)header->band_count;
+    if (memcmp(header->magic, SMART_PREVIEW_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SMART_PREVIEW_VERSION ||
+        header->channels != 3 || header->bits != 16 || header->band_rows == 0 ||
+        header->band_count != (header->height + header->band_rows - 1) / header->band_rows ||
+        index_end > (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        raw_processor_set_error("Not a smart preview: %s", proxy_path);
+        return NULL;
+    }
+
+    const SmartPreviewBand* bands = (const SmartPreviewBand*)(map + sizeof(SmartPreviewHeader));
+    for (uint32_t b = 0; b < header->band_count; b++) {
+        if (bands[b].offset + bands[b].size > (uint64_t)st.st_size) {
+            munmap(map, st.st_size);
+            raw_processor_set_error("Truncated smart preview: %s", proxy_path);
+            return NULL;
+        }
+    }
+
+    SmartPreview* preview = (SmartPreview*)calloc(1, sizeof(SmartPreview));
+    if (!preview) {
+        munmap(map, st.st_size);
+        raw_processor_set_error("Memory allocation failed");
+        return NULL;
+    }
+    preview->map = map;
+    preview->map_size = st.st_size;
+    preview->header = header;
+    preview->bands = bands;
+    return preview;
+}
+
+int smart_preview_get_info(const SmartPreview* preview, SmartPreviewInfo* info) {
+    if (!preview || !info) return 0;
+    info->width = preview->header->width;
+    info->height = preview->header->height;
+    info->original_width = preview->header->original_width;
+    info->original_height = preview->header->original_height;
+    return 1;
+}
+
+// Decode one band into output (rows * width * 3 values)
+static int read_band(SmartPreview* preview, uint32_t band, uint16_t* output, size_t expected) {
+    const SmartPreviewBand* entry = &preview->bands[band];
+    const uint8_t* data = preview->map + entry->offset;
+
+    if (preview->header->compression == SMART_PREVIEW_STORED) {
+        if (entry->size != expected) return 0;
+        memcpy(output, data, expected);
+        return 1;
+    }
+
+    size_t size = ZSTD_decompress(output, expected, data, entry->size);
+    if (ZSTD_isError(size) || size != expected) {
+        raw_processor_set_error("Corrupt smart preview band %u", band);
+        return 0;
+    }
+    return 1;
+}
+
+int smart_preview_read_linear(SmartPreview* preview, uint16_t* output) {
+    if (!preview || !output) return 0;
+
+    const SmartPreviewHeader* header = preview->header;
+    for (uint32_t b = 0; b < header->band_count; b++) {
+        uint32_t y = b * header->band_rows;
+        uint32_t rows = y + header->band_rows <= header->height ? header->band_rows : header->height - y;
+        size_t expected = (size_t)header->width * rows * 3 * sizeof(uint16_t);
+        if (!read_band(preview, b, output + (size_t)y * header->width * 3, expected)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int smart_preview_read_rgb(SmartPreview* preview, uint8_t** output, int* width, int* height) {
+    if (!preview || !output || !width || !height) return 0;
+
+    pthread_once(&output_curve_once, build_output_curve);
+
+    const SmartPreviewHeader* header = preview->header;
+    size_t band_values = (size_t)header->width * header->band_rows * 3;
+    uint16_t* band = (uint16_t*)malloc(band_values * sizeof(uint16_t));
+    uint8_t* rgb = (uint8_t*)malloc((size_t)header->width * header->height * 3);
+    if (!band || !rgb) {
+        free(band);
+        free(rgb);
+        raw_processor_set_error("Memory allocation failed");
+        return 0;
+    }
+
+    for (uint32_t b = 0; b < header->band_count; b++) {
+        uint32_t y = b * header->band_rows;
+        uint32_t rows = y + header->band_rows <= header->height ? header->band_rows : header->height - y;
+        size_t values = (size_t)header->width * rows * 3;
+        if (!read_band(preview, b, band, values * sizeof(uint16_t))) {
+            free(band);
+            free(rgb);
+            return 0;
+        }
+
+        uint8_t* out = rgb + (size_t)y * header->width * 3;
+        for (size_t i = 0; i < values; i++) {
+            out[i] = output_curve[band[i]];
+        }
+    }
+
+    free(band);
+    *output = rgb;
+    *width = header->width;
+    *height = header->height;
+    return 1;
+}
+
+void smart_preview_free_buffer(uint8_t* buffer) {
+    free(buffer);
+}
+
+void smart_preview_close(SmartPreview* preview) {
+    if (!preview) return;
+    munmap(preview->map, preview->map_size);
+    free(preview);
+}
@@ -0,0 +1,61 @@
+#ifndef SMART_PREVIEW_H
+#define SMART_PREVIEW_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default long edge of a smart preview in pixels
+#define SMART_PREVIEW_DEFAULT_SIZE 2560
+
+// Default zstd level; 0 stores bands uncompressed so they map in place
+#define SMART_PREVIEW_DEFAULT_LEVEL 3
+
+// Compact proxy of a RAW file: 16-bit linear RGB at reduced size, stored in
+// independently compressed row bands behind a small index so the file can
+// be memory-mapped and decoded without reading the original.
+typedef struct SmartPreview SmartPreview;
+
+typedef struct {
+    int32_t width;             // Proxy dimensions
+    int32_t height;
+    int32_t original_width;    // Full-resolution output dimensions
+    int32_t original_height;
+} SmartPreviewInfo;
+
+// Decode a RAW file and write its proxy to proxy_path (written atomically).
+// Returns 0 on success, a LibRaw error code or -1 on failure.
+int smart_preview_generate(
+    const char* raw_path,
+    const char* proxy_path,
+    int max_dimension,
+    int compression_level
+);
+
+// Map a proxy file
+SmartPreview* smart_preview_open(const char* proxy_path);
+
+// Proxy and original dimensions
+int smart_preview_get_info(const SmartPreview* preview, SmartPreviewInfo* info);
+
+// Decode into 16-bit linear RGB (width * height * 3 values, caller-owned)
+int smart_preview_read_linear(SmartPreview* preview, uint16_t* output);
+
+// Decode into 8-bit RGB with the same output curve as raw_processor_get_rgb.
+// The buffer is released with smart_preview_free_buffer.
+int smart_preview_read_rgb(SmartPreview* preview, uint8_t** output, int* width, int* height);
+
+// Free a buffer returned by smart_preview_read_rgb
+void smart_preview_free_buffer(uint8_t* buffer);
+
+// Unmap the proxy
+void smart_preview_close(SmartPreview* preview);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SMART_PREVIEW_H
@@ -0,0 +1,73 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Opaque native SmartPreview handle
+final class NativeSmartPreview extends Opaque {}
+
+/// Mirrors SmartPreviewInfo in smart_preview.h
+final class SmartPreviewInfo extends Struct {
+  @Int32()
+  external int width;
+  @Int32()
+  external int height;
+  @Int32()
+  external int originalWidth;
+  @Int32()
+  external int originalHeight;
+}
+
+// Bindings for the smart preview entry points of libraw_processor
+class SmartPreviewBindings {
+  final DynamicLibrary _lib;
+  
+  SmartPreviewBindings(this._lib);
+  
+  late final _smart_preview_generate = _lib.lookupFunction<
+      Int32 Function(Pointer<Utf8>, Pointer<Utf8>, Int32, Int32),
+      int Function(Pointer<Utf8>, Pointer<Utf8>, int, int)>('smart_preview_generate');
+  
+  late final _smart_preview_open = _lib.lookupFunction<
+      Pointer<NativeSmartPreview> Function(Pointer<Utf8>),
+      Pointer<NativeSmartPreview> Function(Pointer<Utf8>)>('smart_preview_open');
+  
+  late final _smart_preview_get_info = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSmartPreview>, Pointer<SmartPreviewInfo>),
+      int Function(Pointer<NativeSmartPreview>, Pointer<SmartPreviewInfo>)>('smart_preview_get_info');
+  
+  late final _smart_preview_read_rgb = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeSmartPreview>, Pointer<Pointer<Uint8>>, Pointer<Int32>, Pointer<Int32>),
+      int Function(Pointer<NativeSmartPreview>, Pointer<Pointer<Uint8>>, Pointer<Int32>, Pointer<Int32>)>('smart_preview_read_rgb');
+  
+  late final _smart_preview_free_buffer = _lib.lookupFunction<
+      Void Function(Pointer<Uint8>),
+      void Function(Pointer<Uint8>)>('smart_preview_free_buffer');
+  
+  late final _smart_preview_close = _lib.lookupFunction<
+      Void Function(Pointer<NativeSmartPreview>),
+      void Function(Pointer<NativeSmartPreview>)>('smart_preview_close');
+  
+  int smartPreviewGenerate(Pointer<Utf8> rawPath, Pointer<Utf8> proxyPath, int maxDimension, int compressionLevel) {
+    return _smart_preview_generate(rawPath, proxyPath, maxDimension, compressionLevel);
+  }
+  
+  Pointer<NativeSmartPreview> smartPreviewOpen(Pointer<Utf8> proxyPath) {
+    return _smart_preview_open(proxyPath);
+  }
+  
+  int smartPreviewGetInfo(Pointer<NativeSmartPreview> preview, Pointer<SmartPreviewInfo> info) {
+    return _smart_preview_get_info(preview, info);
+  }
+  
+  int smartPreviewReadRgb(Pointer<NativeSmartPreview> preview, Pointer<Pointer<Uint8>> output,
+      Pointer<Int32> width, Pointer<Int32> height) {
+    return _smart_preview_read_rgb(preview, output, width, height);
+  }
+  
+  void smartPreviewFreeBuffer(Pointer<Uint8> buffer) {
+    _smart_preview_free_buffer(buffer);
+  }
+  
+  void smartPreviewClose(Pointer<NativeSmartPreview> preview) {
+    _smart_preview_close(preview);
+  }
+}
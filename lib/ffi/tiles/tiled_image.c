@@ -0,0 +1,546 @@
+#include "tiled_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TILED_IMAGE_MAGIC "AKSTILE1"
+#define TILED_IMAGE_VERSION 1
+#define TILED_IMAGE_HEADER_SIZE 4096
+
+// On-disk header, padded to TILED_IMAGE_HEADER_SIZE
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t tile_size;
+} TiledImageHeader;
+
+// Per-tile residency bookkeeping
+typedef struct {
+    int pins;
+    uint8_t resident;
+    uint8_t dirty;
+    uint64_t last_use;
+} TileState;
+
+struct TiledImage {
+    int fd;
+    uint8_t* map;
+    size_t map_size;
+
+    int width;
+    int height;
+    int channels;
+    int tile_size;
+    int tiles_x;
+    int tiles_y;
+    size_t tile_bytes;   // Pixel bytes in one tile
+    size_t tile_stride;  // Tile bytes rounded up to a page
+
+    TileState* tiles;
+    int resident_count;
+    int max_resident;
+    uint64_t clock;
+    pthread_mutex_t lock;
+};
+
+static char last_error[256] = {0};
+
+static size_t page_round_up(size_t size) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return ((size + page - 1) / page) * page;
+}
+
+static uint8_t* tile_pointer(TiledImage* image, int tile_x, int tile_y) {
+    size_t index = (size_t)tile_y * image->tiles_x + tile_x;
+    return image->map + TILED_IMAGE_HEADER_SIZE + index * image->tile_stride;
+}
+
+// Check the geometry fields and derive the tile layout from them. Fails on
+// values a file header could hold but no image has, and on sizes that
+// overflow.
+static int layout_image(TiledImage* image) {
+    if (image->width <= 0 || image->height <= 0 || image->channels <= 0 || image->channels > 4 ||
+        image->tile_size <= 0) {
+        snprintf(last_error, sizeof(last_error), "Invalid image geometry %dx%dx%d, tile size %d",
+                 image->width, image->height, image->channels, image->tile_size);
+        return 0;
+    }
+
+    image->tiles_x = (int)(((int64_t)image->width + image->tile_size - 1) / image->tile_size);
+    image->tiles_y = (int)(((int64_t)image->height + image->tile_size - 1) / image->tile_size);
+
+    size_t tile_count, tile_bytes, pixels_size;
+    if (__builtin_mul_overflow((size_t)image->tiles_x, (size_t)image->tiles_y, &tile_count) ||
+        __builtin_mul_overflow((size_t)image->tile_size, (size_t)image->tile_size, &tile_bytes) ||
+        __builtin_mul_overflow(tile_bytes, (size_t)image->channels, &tile_bytes) ||
+        tile_bytes > SIZE_MAX / 2 ||
+        __builtin_mul_overflow(tile_count, page_round_up(tile_bytes), &pixels_size) ||
+        pixels_size > (size_t)LLONG_MAX - TILED_IMAGE_HEADER_SIZE) {
+        snprintf(last_error, sizeof(last_error), "Image too large: %dx%dx%d, tile size %d",
+                 image->width, image->height, image->channels, image->tile_size);
+        return 0;
+    }
+
+    image->tile_bytes = tile_bytes;
+    image->tile_stride = page_round_up(tile_bytes);
+    image->map_size = TILED_IMAGE_HEADER_SIZE + pixels_size;
+    return 1;
+}
+
+// Map the file and set up tile bookkeeping (layout_image must have run). A
+// new file is grown to the mapping size; an existing one must already hold
+// every tile.
+static int map_image(TiledImage* image, int grow) {
+    struct stat st;
+    if (fstat(image->fd, &st) != 0) {
+        snprintf(last_error, sizeof(last_error), "fstat failed: %s", strerror(errno));
+        return 0;
+    }
+    if ((size_t)st.st_size < image->map_size) {
+        if (!grow) {
+            snprintf(last_error, sizeof(last_error), "Tile file is truncated: %lld of %zu bytes",
+                     (long long)st.st_size, image->map_size);
+            return 0;
+        }
+        if (ftruncate(image->fd, (off_t)image->map_size) != 0) {
+            snprintf(last_error, sizeof(last_error), "Failed to size tile file: %s", strerror(errno));
+            return 0;
+        }
+    }
+
+    void* map = mmap(NULL, image->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, image->fd, 0);
+    if (map == MAP_FAILED) {
+        snprintf(last_error, sizeof(last_error), "mmap failed: %s", strerror(errno));
+        return 0;
+    }
+    image->map = (uint8_t*)map;
+
+    // Tiles are accessed in arbitrary order, don't let the kernel read ahead
+    madvise(image->map, image->map_size, MADV_RANDOM);
+
+    image->tiles = (TileState*)calloc((size_t)image->tiles_x * image->tiles_y, sizeof(TileState));
+    if (!image->tiles) {
+        snprintf(last_error, sizeof(last_error), "Memory allocation failed for tile table");
+        munmap(image->map, image->map_size);
+        image->map = NULL;
+        return 0;
+    }
+
+    pthread_mutex_init(&image->lock, NULL);
+    image->max_resident = TILED_IMAGE_DEFAULT_MAX_RESIDENT;
+    return 1;
+}
+
+TiledImage* tiled_image_create(
+    const char* backing_path,
+    int width,
+    int height,
+    int channels,
+    int tile_size
+) {
+    if (width <= 0 || height <= 0 || channels <= 0 || channels > 4) {
+        snprintf(last_error, sizeof(last_error), "Invalid image geometry %dx%dx%d", width, height, channels);
+        return NULL;
+    }
+    if (tile_size <= 0) {
+        tile_size = TILED_IMAGE_DEFAULT_TILE_SIZE;
+    }
+
+    int fd;
+    if (backing_path) {
+        fd = open(backing_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    } else {
+        const char* tmpdir = getenv("TMPDIR");
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/aks-tiles-XXXXXX", tmpdir ? tmpdir : "/tmp");
+        fd = mkstemp(path);
+        if (fd >= 0) {
+            // The mapping keeps the data alive; nothing is left behind on exit
+            unlink(path);
+        }
+    }
+    if (fd < 0) {
+        snprintf(last_error, sizeof(last_error), "Failed to create tile file: %s", strerror(errno));
+        return NULL;
+    }
+
+    TiledImage* image = (TiledImage*)calloc(1, sizeof(TiledImage));
+    if (!image) {
+        close(fd);
+        snprintf(last_error, sizeof(last_error), "Memory allocation failed");
+        return NULL;
+    }
+    image->fd = fd;
+    image->width = width;
+    image->height = height;
+    image->channels = channels;
+    image->tile_size = tile_size;
+
+    if (!layout_image(image) || !map_image(image, 1)) {
+        close(fd);
+        free(image);
+        return NULL;
+    }
+
+    TiledImageHeader header = {0};
+    memcpy(header.magic, TILED_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = TILED_IMAGE_VERSION;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.channels = (uint32_t)channels;
+    header.tile_size = (uint32_t)tile_size;
+    memcpy(image->map, &header, sizeof(header));
+
+    return image;
+}
+
+TiledImage* tiled_image_open(const char* path) {
+    if (!path) {
+        snprintf(last_error, sizeof(last_error), "Invalid path");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) {
+        snprintf(last_error, sizeof(last_error), "Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    TiledImageHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+        memcmp(header.magic, TILED_IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TILED_IMAGE_VERSION) {
+        close(fd);
+        snprintf(last_error, sizeof(last_error), "Not a tiled image file: %s", path);
+        return NULL;
+    }
+
+    TiledImage* image = (TiledImage*)calloc(1, sizeof(TiledImage));
+    if (!image) {
+        close(fd);
+        snprintf(last_error, sizeof(last_error), "Memory allocation failed");
+        return NULL;
+    }
+    image->fd = fd;
+    // The header is untrusted input; values past INT_MAX become negative and
+    // are rejected with the rest
+    image->width = (int)header.width;
+    image->height = (int)header.height;
+    image->channels = (int)header.channels;
+    image->tile_size = (int)header.tile_size;
+
+    if (!layout_image(image) || !map_image(image, 0)) {
+        close(fd);
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+int tiled_image_width(const TiledImage* image) { return image ? image->width : 0; }
+int tiled_image_height(const TiledImage* image) { return image ? image->height : 0; }
+int tiled_image_channels(const TiledImage* image) { return image ? image->channels : 0; }
+int tiled_image_tile_size(const TiledImage* image) { return image ? image->tile_size : 0; }
+int tiled_image_tiles_x(const TiledImage* image) { return image ? image->tiles_x : 0; }
+int tiled_image_tiles_y(const TiledImage* image) { return image ? image->tiles_y : 0; }
+
+void tiled_image_set_max_resident(TiledImage* image, int max_tiles) {
+    if (!image) return;
+    pthread_mutex_lock(&image->lock);
+    image->max_resident = max_tiles < 0 ? 0 : max_tiles;
+    pthread_mutex_unlock(&image->lock);
+}
+
+int tiled_image_resident_tiles(const TiledImage* image) {
+    return image ? image->resident_count : 0;
+}
+
+// Drop one tile's pages from memory, writing them back first if dirty.
+// Called with the lock held.
+static void evict_tile(TiledImage* image, size_t index) {
+    TileState* state = &image->tiles[index];
+    uint8_t* pixels = image->map + TILED_IMAGE_HEADER_SIZE + index * image->tile_stride;
+
+    if (state->dirty) {
+        msync(pixels, image->tile_stride, MS_SYNC);
+        state->dirty = 0;
+    }
+    madvise(pixels, image->tile_stride, MADV_DONTNEED);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(image->fd,
+        (off_t)(TILED_IMAGE_HEADER_SIZE + index * image->tile_stride),
+        (off_t)image->tile_stride, POSIX_FADV_DONTNEED);
+#endif
+    state->resident = 0;
+    image->resident_count--;
+}
+
+// Evict least recently used unpinned tiles until under the residency limit.
+// Called with the lock held.
+static void enforce_residency(TiledImage* image) {
+    if (image->max_resident == 0) return;
+
+    size_t tile_count = (size_t)image->tiles_x * image->tiles_y;
+    while (image->resident_count > image->max_resident) {
+        size_t victim = tile_count;
+        uint64_t oldest = UINT64_MAX;
+        for (size_t i = 0; i < tile_count; i++) {
+            TileState* state = &image->tiles[i];
+            if (state->resident && state->pins == 0 && state->last_use < oldest) {
+                oldest = state->last_use;
+                victim = i;
+            }
+        }
+        if (victim == tile_count) {
+            // Everything resident is pinned; the limit is exceeded until release
+            return;
+        }
+        evict_tile(image, victim);
+    }
+}
+
+uint8_t* tiled_image_acquire_tile(TiledImage* image, int tile_x, int tile_y) {
+    if (!image || tile_x < 0 || tile_y < 0 ||
+        tile_x >= image->tiles_x || tile_y >= image->tiles_y) {
+        snprintf(last_error, sizeof(last_error), "Tile (%d,%d) out of range", tile_x, tile_y);
+        return NULL;
+    }
+
+    size_t index = (size_t)tile_y * image->tiles_x + tile_x;
+    uint8_t* pixels = tile_pointer(image, tile_x, tile_y);
+
+    pthread_mutex_lock(&image->lock);
+    TileState* state = &image->tiles[index];
+    if (!state->resident) {
+        state->resident = 1;
+        image->resident_count++;
+        madvise(pixels, image->tile_stride, MADV_WILLNEED);
+    }
+    state->pins++;
+    state->last_use = ++image->clock;
+    enforce_residency(image);
+    pthread_mutex_unlock(&image->lock);
+
+    return pixels;
+}
+
+void tiled_image_release_tile(TiledImage* image, int tile_x, int tile_y, int dirty) {
+    if (!image || tile_x < 0 || tile_y < 0 ||
+        tile_x >= image->tiles_x || tile_y >= image->tiles_y) {
+        return;
+    }
+
+    size_t index = (size_t)tile_y * image->tiles_x + tile_x;
+    pthread_mutex_lock(&image->lock);
+    TileState* state = &image->tiles[index];
+    if (state->pins > 0) {
+        state->pins--;
+    }
+    if (dirty) {
+        state->dirty = 1;
+    }
+    enforce_residency(image);
+    pthread_mutex_unlock(&image->lock);
+}
+
+// Shared implementation of region read/write, walking the covered tiles
+static int copy_region(
+    TiledImage* image,
+    int x,
+    int y,
+    int width,
+    int height,
+    uint8_t* buffer,
+    size_t stride,
+    int writing
+) {
+    if (!image || !buffer || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        x + width > image->width || y + height > image->height) {
+        snprintf(last_error, sizeof(last_error), "Region %dx%d+%d+%d out of bounds", width, height, x, y);
+        return 0;
+    }
+
+    int ts = image->tile_size;
+    int ch = image->channels;
+    size_t tile_row_bytes = (size_t)ts * ch;
+
+    for (int ty = y / ts; ty <= (y + height - 1) / ts; ty++) {
+        for (int tx = x / ts; tx <= (x + width - 1) / ts; tx++) {
+            uint8_t* tile = tiled_image_acquire_tile(image, tx, ty);
+            if (!tile) return 0;
+
+            // Intersection of the region with this tile, in image coordinates
+            int x0 = tx * ts > x ? tx * ts : x;
+            int y0 = ty * ts > y ? ty * ts : y;
+            int x1 = (tx + 1) * ts < x + width ? (tx + 1) * ts : x + width;
+            int y1 = (ty + 1) * ts < y + height ? (ty + 1) * ts : y + height;
+            size_t span = (size_t)(x1 - x0) * ch;
+
+            for (int row = y0; row < y1; row++) {
+                uint8_t* tile_row = tile + (size_t)(row - ty * ts) * tile_row_bytes + (size_t)(x0 - tx * ts) * ch;
+                uint8_t* buffer_row = buffer + (size_t)(row - y) * stride + (size_t)(x0 - x) * ch;
+                if (writing) {
+                    memcpy(tile_row, buffer_row, span);
+                } else {
+                    memcpy(buffer_row, tile_row, span);
+                }
+            }
+
+            tiled_image_release_tile(image, tx, ty, writing);
+        }
+    }
+    return 1;
+}
+
+int tiled_image_write_region(
+    TiledImage* image,
+    int x,
+    int y,
+    int width,
+    int height,
+    const uint8_t* src,
+    size_t src_stride
+) {
+    return copy_region(image, x, y, width, height, (uint8_t*)src, src_stride, 1);
+}
+
+int tiled_image_read_region(
+    TiledImage* image,
+    int x,
+    int y,
+    int width,
+    int height,
+    uint8_t* dst,
+    size_t dst_stride
+) {
+    return copy_region(image, x, y, width, height, dst, dst_stride, 0);
+}
+
+int tiled_image_downsample(
+    TiledImage* image,
+    int max_dimension,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    if (!image || !output_pixels || !output_width || !output_height || max_dimension <= 0) {
+        snprintf(last_error, sizeof(last_error), "Invalid downsample arguments");
+        return 0;
+    }
+
+    int long_edge = image->width > image->height ? image->width : image->height;
+    int factor = (long_edge + max_dimension - 1) / max_dimension;
+    if (factor < 1) factor = 1;
+
+    int out_w = (image->width + factor - 1) / factor;
+    int out_h = (image->height + factor - 1) / factor;
+    int ch = image->channels;
+
+    uint8_t* out = (uint8_t*)malloc((size_t)out_w * out_h * ch);
+    uint32_t* sums = (uint32_t*)calloc((size_t)out_w * ch, sizeof(uint32_t));
+    uint32_t* counts = (uint32_t*)calloc((size_t)out_w, sizeof(uint32_t));
+    uint8_t* band = (uint8_t*)malloc((size_t)image->width * ch * factor);
+    if (!out || !sums || !counts || !band) {
+        free(out);
+        free(sums);
+        free(counts);
+        free(band);
+        snprintf(last_error, sizeof(last_error), "Memory allocation failed for downsample");
+        return 0;
+    }
+
+    // Read one band of `factor` source rows per output row so residency stays bounded
+    for (int oy = 0; oy < out_h; oy++) {
+        int y0 = oy * factor;
+        int rows = y0 + factor <= image->height ? factor : image->height - y0;
+        size_t band_stride = (size_t)image->width * ch;
+
+        if (!tiled_image_read_region(image, 0, y0, image->width, rows, band, band_stride)) {
+            free(out);
+            free(sums);
+            free(counts);
+            free(band);
+            return 0;
+        }
+
+        memset(sums, 0, (size_t)out_w * ch * sizeof(uint32_t));
+        memset(counts, 0, (size_t)out_w * sizeof(uint32_t));
+        for (int r = 0; r < rows; r++) {
+            const uint8_t* src = band + (size_t)r * band_stride;
+            for (int x = 0; x < image->width; x++) {
+                int ox = x / factor;
+                for (int c = 0; c < ch; c++) {
+                    sums[ox * ch + c] += src[x * ch + c];
+                }
+                counts[ox]++;
+            }
+        }
+
+        uint8_t* dst = out + (size_t)oy * out_w * ch;
+        for (int ox = 0; ox < out_w; ox++) {
+            for (int c = 0; c < ch; c++) {
+                dst[ox * ch + c] = (uint8_t)((sums[ox * ch + c] + counts[ox] / 2) / counts[ox]);
+            }
+        }
+    }
+
+    free(sums);
+    free(counts);
+    free(band);
+
+    *output_pixels = out;
+    *output_width = out_w;
+    *output_height = out_h;
+    return 1;
+}
+
+void tiled_image_free_buffer(uint8_t* buffer) {
+    free(buffer);
+}
+
+int tiled_image_flush(TiledImage* image) {
+    if (!image) return 0;
+
+    pthread_mutex_lock(&image->lock);
+    int ok = msync(image->map, image->map_size, MS_SYNC) == 0;
+    size_t tile_count = (size_t)image->tiles_x * image->tiles_y;
+    for (size_t i = 0; i < tile_count; i++) {
+        image->tiles[i].dirty = 0;
+    }
+    pthread_mutex_unlock(&image->lock);
+
+    if (!ok) {
+        snprintf(last_error, sizeof(last_error), "msync failed: %s", strerror(errno));
+    }
+    return ok;
+}
+
+void tiled_image_close(TiledImage* image) {
+    if (!image) return;
+
+    if (image->map) {
+        munmap(image->map, image->map_size);
+    }
+    if (image->fd >= 0) {
+        close(image->fd);
+    }
+    if (image->tiles) {
+        pthread_mutex_destroy(&image->lock);
+        free(image->tiles);
+    }
+    free(image);
+}
+
+const char* tiled_image_get_error() {
+    return last_error;
+}
@@ -0,0 +1,190 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../common/ffi_base.dart';
+import '../common/platform_utils.dart';
+import '../../services/image_processor.dart';
+import 'tiled_image_bindings.dart';
+
+/// Out-of-core image stored as memory-mapped tiles.
+///
+/// Used for images too large to keep as a single in-memory buffer. Pixels
+/// stay in the backing file and are paged in a tile at a time by the native
+/// processors and the streaming encoder.
+class TiledImage {
+  static DynamicLibrary? _library;
+  static TiledImageBindings? _bindings;
+  
+  /// Edge length of a tile in pixels
+  static const int defaultTileSize = 512;
+  
+  final Pointer<NativeTiledImage> handle;
+  final int width;
+  final int height;
+  final int channels;
+  final int tileSize;
+  bool _closed = false;
+  
+  TiledImage._(this.handle, this.width, this.height, this.channels, this.tileSize);
+  
+  /// Initialize the tiled image library
+  static void initialize() {
+    if (_bindings != null) return;
+    
+    _library = FfiBase.loadLibrary(
+      'tiled_image',
+      linuxPaths: [
+        ...PlatformUtils.commonLibraryPaths,
+        '${Directory.current.path}/linux',
+        '${Directory.current.path}/build/linux/x64/debug/bundle/lib',
+      ],
+      macosPaths: PlatformUtils.commonLibraryPaths,
+      windowsPaths: PlatformUtils.commonLibraryPaths,
+    );
+    
+    _bindings = TiledImageBindings(_library!);
+  }
+  
+  /// Get the bindings instance
+  static TiledImageBindings get bindings {
+    if (_bindings == null) {
+      initialize();
+    }
+    return _bindings!;
+  }
+  
+  /// Wrap a native handle returned by another library
+  static TiledImage fromHandle(Pointer<NativeTiledImage> handle) {
+    final b = bindings;
+    return TiledImage._(
+      handle,
+      b.tiledImageWidth(handle),
+      b.tiledImageHeight(handle),
+      b.tiledImageChannels(handle),
+      b.tiledImageTileSize(handle),
+    );
+  }
+  
+  /// Create an empty image backed by an anonymous temporary file
+  static TiledImage create(int width, int height, int channels, {int tileSize = defaultTileSize}) {
+    final handle = bindings.tiledImageCreate(nullptr, width, height, channels, tileSize);
+    if (handle == nullptr) {
+      throw Exception('Failed to create tiled image: ${bindings.tiledImageGetError()}');
+    }
+    return fromHandle(handle);
+  }
+  
+  /// Copy an in-memory image into tiles, so it can go through the tiled
+  /// processors and the streaming encoder
+  static TiledImage fromPixels(RawPixelData data, {int tileSize = defaultTileSize}) {
+    final image = create(data.width, data.height, 3, tileSize: tileSize);
+    try {
+      // A band of tiles at a time, to keep the staging copy small
+      final stride = data.width * 3;
+      for (int y = 0; y < data.height; y += tileSize) {
+        final rows = y + tileSize <= data.height ? tileSize : data.height - y;
+        image.writeRegion(0, y, data.width, rows,
+            Uint8List.sublistView(data.pixels, y * stride, (y + rows) * stride));
+      }
+      return image;
+    } catch (_) {
+      image.close();
+      rethrow;
+    }
+  }
+  
+  /// Limit the number of tiles mapped in at once
+  void setMaxResidentTiles(int maxTiles) {
+    _checkOpen();
+    bindings.tiledImageSetMaxResident(handle, maxTiles);
+  }
+  
+  /// Copy packed pixels into a region of the tiles
+  void writeRegion(int x, int y, int regionWidth, int regionHeight, Uint8List pixels) {
+    _checkOpen();
+    final stride = regionWidth * channels;
+    final size = stride * regionHeight;
+    if (pixels.length != size) {
+      throw ArgumentError('Expected $size bytes for a ${regionWidth}x$regionHeight region, got ${pixels.length}');
+    }
+    final buffer = malloc<Uint8>(size);
+    try {
+      buffer.asTypedList(size).setAll(0, pixels);
+      if (bindings.tiledImageWriteRegion(handle, x, y, regionWidth, regionHeight, buffer, stride) != 1) {
+        throw Exception('Failed to write tiled region: ${bindings.tiledImageGetError()}');
+      }
+    } finally {
+      malloc.free(buffer);
+    }
+  }
+  
+  /// Copy a packed region out of the tiles
+  Uint8List readRegion(int x, int y, int regionWidth, int regionHeight) {
+    _checkOpen();
+    final stride = regionWidth * channels;
+    final size = stride * regionHeight;
+    final buffer = malloc<Uint8>(size);
+    try {
+      if (bindings.tiledImageReadRegion(handle, x, y, regionWidth, regionHeight, buffer, stride) != 1) {
+        throw Exception('Failed to read tiled region: ${bindings.tiledImageGetError()}');
+      }
+      return Uint8List.fromList(buffer.asTypedList(size));
+    } finally {
+      malloc.free(buffer);
+    }
+  }
+  
+  /// Build an RGB preview whose long edge is at most maxDimension.
+  /// Reads every tile, so it runs on a background isolate.
+  Future<RawPixelData> downsample(int maxDimension) {
+    _checkOpen();
+    if (channels != 3) {
+      throw StateError('Preview generation expects an RGB tiled image');
+    }
+    
+    final address = handle.address;
+    return Isolate.run(() => _downsample(address, maxDimension));
+  }
+  
+  static RawPixelData _downsample(int address, int maxDimension) {
+    final handle = Pointer<NativeTiledImage>.fromAddress(address);
+    final outputPtr = calloc<Pointer<Uint8>>();
+    final widthPtr = calloc<Int32>();
+    final heightPtr = calloc<Int32>();
+    try {
+      if (bindings.tiledImageDownsample(handle, maxDimension, outputPtr, widthPtr, heightPtr) != 1) {
+        throw Exception('Failed to downsample tiled image: ${bindings.tiledImageGetError()}');
+      }
+      final previewWidth = widthPtr.value;
+      final previewHeight = heightPtr.value;
+      final pixels = Uint8List.fromList(
+        outputPtr.value.asTypedList(previewWidth * previewHeight * 3),
+      );
+      return RawPixelData(pixels: pixels, width: previewWidth, height: previewHeight);
+    } finally {
+      if (outputPtr.value != nullptr) {
+        bindings.tiledImageFreeBuffer(outputPtr.value);
+      }
+      calloc.free(outputPtr);
+      calloc.free(widthPtr);
+      calloc.free(heightPtr);
+    }
+  }
+  
+  /// Unmap the tiles and close the backing file
+  void close() {
+    if (_closed) return;
+    _closed = true;
+    bindings.tiledImageClose(handle);
+  }
+  
+  bool get isClosed => _closed;
+  
+  void _checkOpen() {
+    if (_closed) {
+      throw StateError('Tiled image has been closed');
+    }
+  }
+}
@@ -0,0 +1,104 @@
+#ifndef TILED_IMAGE_H
+#define TILED_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Default edge length of a square tile in pixels
+#define TILED_IMAGE_DEFAULT_TILE_SIZE 512
+
+// Default number of tiles kept mapped in at once (~96 MB of RGB tiles)
+#define TILED_IMAGE_DEFAULT_MAX_RESIDENT 128
+
+// Out-of-core image split into square tiles stored in a memory-mapped file.
+// Edge tiles are padded to the full tile size so every tile has the same
+// layout: tile_size rows of tile_size * channels bytes.
+typedef struct TiledImage TiledImage;
+
+// Create an empty tiled image backed by a file.
+// backing_path may be NULL to use an unlinked temporary file in $TMPDIR.
+TiledImage* tiled_image_create(
+    const char* backing_path,
+    int width,
+    int height,
+    int channels,
+    int tile_size
+);
+
+// Open a tiled image file previously written by tiled_image_create
+TiledImage* tiled_image_open(const char* path);
+
+// Image geometry
+int tiled_image_width(const TiledImage* image);
+int tiled_image_height(const TiledImage* image);
+int tiled_image_channels(const TiledImage* image);
+int tiled_image_tile_size(const TiledImage* image);
+int tiled_image_tiles_x(const TiledImage* image);
+int tiled_image_tiles_y(const TiledImage* image);
+
+// Limit how many tiles may be mapped in at once (0 = unlimited)
+void tiled_image_set_max_resident(TiledImage* image, int max_tiles);
+
+// Number of tiles currently mapped in
+int tiled_image_resident_tiles(const TiledImage* image);
+
+// Pin a tile in memory and return a pointer to its pixels.
+// Row stride is tile_size * channels bytes. Safe to call from several threads.
+uint8_t* tiled_image_acquire_tile(TiledImage* image, int tile_x, int tile_y);
+
+// Unpin a tile. Pass dirty = 1 if it was written so it is flushed on eviction.
+void tiled_image_release_tile(TiledImage* image, int tile_x, int tile_y, int dirty);
+
+// Copy a rectangle of pixels into the tiles (stride in bytes)
+int tiled_image_write_region(
+    TiledImage* image,
+    int x,
+    int y,
+    int width,
+    int height,
+    const uint8_t* src,
+    size_t src_stride
+);
+
+// Copy a rectangle of pixels out of the tiles (stride in bytes)
+int tiled_image_read_region(
+    TiledImage* image,
+    int x,
+    int y,
+    int width,
+    int height,
+    uint8_t* dst,
+    size_t dst_stride
+);
+
+// Box-filter the whole image down so its long edge is at most max_dimension.
+// The result is a packed buffer to be released with tiled_image_free_buffer.
+int tiled_image_downsample(
+    TiledImage* image,
+    int max_dimension,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+);
+
+// Free a buffer returned by tiled_image_downsample
+void tiled_image_free_buffer(uint8_t* buffer);
+
+// Flush dirty tiles to the backing file
+int tiled_image_flush(TiledImage* image);
+
+// Unmap and close the image
+void tiled_image_close(TiledImage* image);
+
+// Get last error message
+const char* tiled_image_get_error();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TILED_IMAGE_H
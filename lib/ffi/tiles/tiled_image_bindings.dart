@@ -0,0 +1,109 @@
+import 'dart:ffi';
+import 'package:ffi/ffi.dart';
+
+/// Opaque native TiledImage handle
+final class NativeTiledImage extends Opaque {}
+
+// Tiled image FFI bindings
+class TiledImageBindings {
+  final DynamicLibrary _lib;
+  
+  TiledImageBindings(this._lib);
+  
+  late final _tiled_image_create = _lib.lookupFunction<
+      Pointer<NativeTiledImage> Function(Pointer<Utf8>, Int32, Int32, Int32, Int32),
+      Pointer<NativeTiledImage> Function(Pointer<Utf8>, int, int, int, int)>('tiled_image_create');
+  
+  late final _tiled_image_open = _lib.lookupFunction<
+      Pointer<NativeTiledImage> Function(Pointer<Utf8>),
+      Pointer<NativeTiledImage> Function(Pointer<Utf8>)>('tiled_image_open');
+  
+  late final _tiled_image_width = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>),
+      int Function(Pointer<NativeTiledImage>)>('tiled_image_width');
+  
+  late final _tiled_image_height = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>),
+      int Function(Pointer<NativeTiledImage>)>('tiled_image_height');
+  
+  late final _tiled_image_channels = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>),
+      int Function(Pointer<NativeTiledImage>)>('tiled_image_channels');
+  
+  late final _tiled_image_tile_size = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>),
+      int Function(Pointer<NativeTiledImage>)>('tiled_image_tile_size');
+  
+  late final _tiled_image_set_max_resident = _lib.lookupFunction<
+      Void Function(Pointer<NativeTiledImage>, Int32),
+      void Function(Pointer<NativeTiledImage>, int)>('tiled_image_set_max_resident');
+  
+  late final _tiled_image_write_region = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>, Int32, Int32, Int32, Int32, Pointer<Uint8>, Size),
+      int Function(Pointer<NativeTiledImage>, int, int, int, int, Pointer<Uint8>, int)>('tiled_image_write_region');
+  
+  late final _tiled_image_read_region = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>, Int32, Int32, Int32, Int32, Pointer<Uint8>, Size),
+      int Function(Pointer<NativeTiledImage>, int, int, int, int, Pointer<Uint8>, int)>('tiled_image_read_region');
+  
+  late final _tiled_image_downsample = _lib.lookupFunction<
+      Int32 Function(Pointer<NativeTiledImage>, Int32, Pointer<Pointer<Uint8>>, Pointer<Int32>, Pointer<Int32>),
+      int Function(Pointer<NativeTiledImage>, int, Pointer<Pointer<Uint8>>, Pointer<Int32>, Pointer<Int32>)>('tiled_image_downsample');
+  
+  late final _tiled_image_free_buffer = _lib.lookupFunction<
+      Void Function(Pointer<Uint8>),
+      void Function(Pointer<Uint8>)>('tiled_image_free_buffer');
+  
+  late final _tiled_image_close = _lib.lookupFunction<
+      Void Function(Pointer<NativeTiledImage>),
+      void Function(Pointer<NativeTiledImage>)>('tiled_image_close');
+  
+  late final _tiled_image_get_error = _lib.lookupFunction<
+      Pointer<Utf8> Function(),
+      Pointer<Utf8> Function()>('tiled_image_get_error');
+  
+  Pointer<NativeTiledImage> tiledImageCreate(Pointer<Utf8> backingPath, int width, int height, int channels, int tileSize) {
+    return _tiled_image_create(backingPath, width, height, channels, tileSize);
+  }
+  
+  Pointer<NativeTiledImage> tiledImageOpen(Pointer<Utf8> path) {
+    return _tiled_image_open(path);
+  }
+  
+  int tiledImageWidth(Pointer<NativeTiledImage> image) => _tiled_image_width(image);
+  
+  int tiledImageHeight(Pointer<NativeTiledImage> image) => _tiled_image_height(image);
+  
+  int tiledImageChannels(Pointer<NativeTiledImage> image) => _tiled_image_channels(image);
+  
+  int tiledImageTileSize(Pointer<NativeTiledImage> image) => _tiled_image_tile_size(image);
+  
+  void tiledImageSetMaxResident(Pointer<NativeTiledImage> image, int maxTiles) {
+    _tiled_image_set_max_resident(image, maxTiles);
+  }
+  
+  int tiledImageWriteRegion(Pointer<NativeTiledImage> image, int x, int y, int width, int height,
+      Pointer<Uint8> src, int srcStride) {
+    return _tiled_image_write_region(image, x, y, width, height, src, srcStride);
+  }
+  
+  int tiledImageReadRegion(Pointer<NativeTiledImage> image, int x, int y, int width, int height,
+      Pointer<Uint8> dst, int dstStride) {
+    return _tiled_image_read_region(image, x, y, width, height, dst, dstStride);
+  }
+  
+  int tiledImageDownsample(Pointer<NativeTiledImage> image, int maxDimension,
+      Pointer<Pointer<Uint8>> output, Pointer<Int32> outputWidth, Pointer<Int32> outputHeight) {
+    return _tiled_image_downsample(image, maxDimension, output, outputWidth, outputHeight);
+  }
+  
+  void tiledImageFreeBuffer(Pointer<Uint8> buffer) {
+    _tiled_image_free_buffer(buffer);
+  }
+  
+  void tiledImageClose(Pointer<NativeTiledImage> image) {
+    _tiled_image_close(image);
+  }
+  
+  String tiledImageGetError() => _tiled_image_get_error().toDartString();
+}
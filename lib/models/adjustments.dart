@@ -26,6 +26,8 @@ abstract class Adjustment {
         return BlacksWhitesAdjustment.fromJson(json);
       case 'tone_curve':
         return ToneCurveAdjustment.fromJson(json);
+      case 'lut_3d':
+        return LutAdjustment.fromJson(json);
       default:
         throw Exception('Unknown adjustment type: ${json['type']}');
     }
@@ -369,4 +371,48 @@ class BlacksWhitesAdjustment extends Adjustment {
   BlacksWhitesAdjustment reset() {
     return BlacksWhitesAdjustment();
   }
-}
\ No newline at end of file
+}
+
+/// 3D LUT ("look") from a .cube file, applied after the other adjustments
+class LutAdjustment extends Adjustment {
+  final String? path;     // .cube file, null for none
+  final double opacity;   // 0 to 100 (percentage blend over the unmapped image)
+  
+  LutAdjustment({
+    this.path,
+    this.opacity = 100.0,
+  }) : super('lut_3d');
+  
+  @override
+  Map<String, dynamic> toJson() => {
+    'type': type,
+    'path': path,
+    'opacity': opacity,
+  };
+  
+  factory LutAdjustment.fromJson(Map<String, dynamic> json) {
+    return LutAdjustment(
+      path: json['path'] as String?,
+      opacity: (json['opacity'] ?? 100.0).toDouble(),
+    );
+  }
+  
+  @override
+  LutAdjustment copyWith({
+    String? path,
+    double? opacity,
+  }) {
+    return LutAdjustment(
+      path: path ?? this.path,
+      opacity: opacity ?? this.opacity,
+    );
+  }
+  
+  @override
+  LutAdjustment reset() {
+    return LutAdjustment();
+  }
+  
+  /// Check if no LUT is applied
+  bool get isDefault => path == null || opacity == 0;
+}
@@ -39,6 +39,8 @@ class EditPipeline extends ChangeNotifier {
         return adj.saturation != 0 || adj.vibrance != 0;
       } else if (adj is ToneCurveAdjustment) {
         return !adj.isDefault;
+      } else if (adj is LutAdjustment) {
+        return !adj.isDefault;
       }
       return false;
     });
@@ -64,6 +66,7 @@ class EditPipeline extends ChangeNotifier {
       BlacksWhitesAdjustment(),
       SaturationVibranceAdjustment(),
       ToneCurveAdjustment(),
+      LutAdjustment(),
     ]);
     
     notifyListeners();
@@ -129,6 +132,7 @@ class EditPipeline extends ChangeNotifier {
       BlacksWhitesAdjustment(),
       SaturationVibranceAdjustment(),
       ToneCurveAdjustment(),
+      LutAdjustment(),
     ]);
     
     // Override with values from JSON if present
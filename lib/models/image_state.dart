@@ -8,6 +8,11 @@ import '../services/processors/processor_factory.dart';
 import '../services/processors/image_processor_interface.dart';
 import '../services/preview_generator.dart';
 import '../services/export_service.dart';
+import '../services/tiled_image_service.dart';
+import '../services/smart_preview_service.dart';
+import '../services/lut_library.dart';
+import '../ffi/tiles/tiled_image.dart';
+import '../ffi/encode/image_encoder.dart';
 import 'edit_pipeline.dart';
 import 'history_manager.dart';
 import 'adjustments.dart';
@@ -22,6 +27,8 @@ class ImageState extends ChangeNotifier {
   RawPixelData? _previewData;
   RawPixelData? _originalRawData;  // Keep original uncropped raw data
   RawPixelData? _originalPreviewData;  // Keep original uncropped preview data
+  TiledImage? _tiledImage;  // Full resolution kept out of core for very large files
+  bool _usingSmartPreview = false;  // Editing a local proxy; original is read on export
   int? _originalWidth;  // Original image width for precise crop calculations
   int? _originalHeight;  // Original image height for precise crop calculations
   String? _currentFilePath;
@@ -29,6 +36,7 @@ class ImageState extends ChangeNotifier {
   bool _isProcessing = false;
   bool _isProcessingFull = false;
   String? _error;
+  String? _exportError;  // Why the last export was refused, if it was
   bool _showOriginal = false;
   bool _hasCrop = false;  // Track if image has been cropped
   final EditPipeline _pipeline = EditPipeline();
@@ -62,11 +70,14 @@ class ImageState extends ChangeNotifier {
   bool get isLoading => _isLoading;
   bool get isProcessing => _isProcessing || _isProcessingFull;
   String? get error => _error;
+  String? get exportError => _exportError;
   bool get hasImage => _currentImage != null || _previewImage != null || _fullImage != null;
   EditPipeline get pipeline => _pipeline;
   HistoryManager get historyManager => _historyManager;
   bool get showOriginal => _showOriginal;
   bool get hasCrop => _hasCrop;
+  bool get isTiled => _tiledImage != null;
+  bool get usingSmartPreview => _usingSmartPreview;
   int? get originalWidth => _originalWidth;
   int? get originalHeight => _originalHeight;
   
@@ -97,6 +108,7 @@ class ImageState extends ChangeNotifier {
   
   // Get dimensions of the image that will be exported (accounting for crop)
   int? get exportImageWidth {
+    if (_tiledImage != null || _usingSmartPreview) return actualCurrentWidth;
     final img = _fullImage ?? _previewImage;
     if (img == null) return null;
     if (_pipeline.cropRect == null) return img.width;
@@ -107,6 +119,7 @@ class ImageState extends ChangeNotifier {
   }
   
   int? get exportImageHeight {
+    if (_tiledImage != null || _usingSmartPreview) return actualCurrentHeight;
     final img = _fullImage ?? _previewImage;
     if (img == null) return null;
     if (_pipeline.cropRect == null) return img.height;
@@ -208,6 +221,8 @@ class ImageState extends ChangeNotifier {
       } else if (adj is SaturationVibranceAdjustment && (adj.saturation != 0 || adj.vibrance != 0)) {
         if (adj.saturation != 0) adjustments.add('Saturation');
         if (adj.vibrance != 0) adjustments.add('Vibrance');
+      } else if (adj is LutAdjustment && !adj.isDefault) {
+        adjustments.add('Look');
       }
     }
     
@@ -223,13 +238,42 @@ class ImageState extends ChangeNotifier {
   Future<void> loadImage(String filePath) async {
     setLoading(true);
     try {
-      // Load raw data
-      final rawData = await RawProcessor.loadRawFile(filePath);
+      _closeTiledImage();
+      _usingSmartPreview = false;
+      
+      RawPixelData? rawData;
+      int? originalWidth;
+      int? originalHeight;
+      
+      // Prefer a local proxy so opening doesn't wait on slow storage
+      if (SmartPreviewService.isEnabled) {
+        final entry = await SmartPreviewService.lookup(filePath);
+        if (entry != null) {
+          rawData = SmartPreviewService.loadPixels(entry);
+          originalWidth = entry.originalWidth;
+          originalHeight = entry.originalHeight;
+          _usingSmartPreview = true;
+        }
+      }
+      
+      if (rawData == null) {
+        // Very large files are kept as tiles and only a preview is held in memory
+        final dimensions = RawProcessor.probeDimensions(filePath);
+        if (dimensions != null &&
+            TiledImageService.shouldUseTiles(dimensions.width, dimensions.height)) {
+          await _loadTiledImage(filePath);
+          return;
+        }
+        
+        // Load raw data
+        rawData = await RawProcessor.loadRawFile(filePath);
+      }
+      
       if (rawData != null) {
         _rawData = rawData;
         _originalRawData = rawData;  // Keep the original
-        _originalWidth = rawData.width;  // Store original dimensions
-        _originalHeight = rawData.height;
+        _originalWidth = originalWidth ?? rawData.width;  // Store original dimensions
+        _originalHeight = originalHeight ?? rawData.height;
         _currentFilePath = filePath;
         
         // Generate preview data
@@ -261,12 +305,56 @@ class ImageState extends ChangeNotifier {
         
         // Save the last opened image path
         PreferencesService.saveLastImagePath(filePath);
+        
+        // Build the proxy in the background for the next open
+        if (SmartPreviewService.isEnabled && !_usingSmartPreview) {
+          SmartPreviewService.generate(filePath);
+        }
       }
     } catch (e) {
       setError(e.toString());
     }
   }
   
+  Future<void> _loadTiledImage(String filePath) async {
+    final tiled = await RawProcessor.loadRawFileTiled(filePath);
+    _tiledImage = tiled;
+    _rawData = null;
+    _originalRawData = null;
+    _originalWidth = tiled.width;
+    _originalHeight = tiled.height;
+    _currentFilePath = filePath;
+    
+    print('ImageState: Loaded ${tiled.width}x${tiled.height} image as tiles');
+    
+    // The preview doubles as the display image; there is no full-res pass
+    _previewData = await tiled.downsample(TiledImageService.previewSize);
+    _originalPreviewData = _previewData;
+    
+    _pipeline.initialize(filePath);
+    await _pipeline.loadFromSidecar();
+    
+    _hasCrop = _pipeline.cropRect != null && 
+               (_pipeline.cropRect!.left != 0 || _pipeline.cropRect!.top != 0 ||
+                _pipeline.cropRect!.right != 1 || _pipeline.cropRect!.bottom != 1);
+    
+    _historyManager.initialize(_pipeline);
+    
+    await _processOriginalImages();
+    await _processPreview();
+    
+    PreferencesService.saveLastImagePath(filePath);
+    
+    if (SmartPreviewService.isEnabled) {
+      SmartPreviewService.generate(filePath);
+    }
+  }
+  
+  void _closeTiledImage() {
+    _tiledImage?.close();
+    _tiledImage = null;
+  }
+  
   Future<void> _processPreview() async {
     if (_previewData == null) return;
     
@@ -410,6 +498,8 @@ class ImageState extends ChangeNotifier {
 
   void clear() {
     _fullResTimer?.cancel();
+    _closeTiledImage();
+    _usingSmartPreview = false;
     _currentImage?.dispose();
     _previewImage?.dispose();
     _fullImage?.dispose();
@@ -449,6 +539,28 @@ class ImageState extends ChangeNotifier {
     }
   }
   
+  /// Apply the .cube file at [path] as the look. Returns null on success,
+  /// otherwise why the file can't be used.
+  String? loadLut(String path) {
+    try {
+      LutLibrary.load(path);
+    } on FormatException catch (e) {
+      return e.message;
+    } catch (e) {
+      return 'Could not load LUT: $e';
+    }
+    final current = _pipeline.getAdjustment<LutAdjustment>('lut_3d') ?? LutAdjustment();
+    _pipeline.updateAdjustment(current.copyWith(path: path));
+    return null;
+  }
+  
+  /// Remove the look, keeping its opacity for the next one
+  void clearLut() {
+    final current = _pipeline.getAdjustment<LutAdjustment>('lut_3d');
+    if (current == null || current.path == null) return;
+    _pipeline.updateAdjustment(LutAdjustment(opacity: current.opacity));
+  }
+  
   Future<void> resetAllAdjustments() async {
     _pipeline.resetAll();
     // Save the reset state to sidecar (clears the sidecar if no adjustments remain)
@@ -480,11 +592,38 @@ class ImageState extends ChangeNotifier {
   Future<bool> exportImage({
     required ExportFormat format,
     int jpegQuality = 90,
+    EncodePreset preset = EncodePreset.balanced,
+    int? maxFileSize,
     double? resizePercentage,
     String frameType = 'none',
     String frameColor = 'black',
     int borderWidth = 20,
   }) async {
+    _exportError = null;
+    
+    // Edits were made on a proxy; fetch the original for a full-quality export
+    if (_usingSmartPreview && !await _fetchOriginalForExport()) {
+      return false;
+    }
+    
+    // Out-of-core images are processed and encoded tile by tile, at full
+    // size and fixed quality. Refuse rather than write something else than
+    // what was asked for.
+    if (_tiledImage != null) {
+      if (resizePercentage != null || frameType != 'none' || maxFileSize != null) {
+        _exportError = 'Resizing, frames and file size targets are not available '
+            'for images this large; export at full size instead';
+        return false;
+      }
+      return await ExportService.exportTiled(
+        source: _tiledImage!,
+        pipeline: _pipeline,
+        originalPath: _currentFilePath,
+        format: format,
+        jpegQuality: jpegQuality,
+      );
+    }
+    
     // Make sure full resolution is processed before export
     if (_rawData != null && _fullImage == null) {
       await _processFullResolution();
@@ -506,13 +645,73 @@ class ImageState extends ChangeNotifier {
       cropRect: _pipeline.cropRect,  // Pass the crop rect for export
       format: format,
       jpegQuality: jpegQuality,
+      preset: preset,
+      maxFileSize: maxFileSize,
       resizePercentage: resizePercentage,
       frameType: frameType,
       frameColor: frameColor,
       borderWidth: borderWidth,
+      rawData: _rawData,
+      pipeline: _pipeline,
     );
   }
 
+  /// Export several sizes and formats with one full resolution render.
+  /// Returns whether each output was written.
+  Future<List<bool>> exportOutputs(List<ExportOutput> outputs) async {
+    _exportError = null;
+    if (_usingSmartPreview && !await _fetchOriginalForExport()) {
+      return List.filled(outputs.length, false);
+    }
+    
+    if (_tiledImage != null) {
+      _exportError = 'Multi-output export is not available for images this large';
+      return List.filled(outputs.length, false);
+    }
+    
+    if (_rawData != null && _fullImage == null) {
+      await _processFullResolution();
+    }
+    
+    return await ExportService.exportMultiple(
+      previewImage: _previewImage,
+      fullImage: _fullImage,
+      cropRect: _pipeline.cropRect,
+      outputs: outputs,
+    );
+  }
+
+  /// Replace the smart preview with the decoded original before export
+  Future<bool> _fetchOriginalForExport() async {
+    final filePath = _currentFilePath;
+    if (filePath == null) return false;
+    
+    try {
+      print('ImageState: Fetching original for export: $filePath');
+      
+      final dimensions = RawProcessor.probeDimensions(filePath);
+      if (dimensions != null &&
+          TiledImageService.shouldUseTiles(dimensions.width, dimensions.height)) {
+        _tiledImage = await RawProcessor.loadRawFileTiled(filePath);
+        _rawData = null;
+      } else {
+        final original = await RawProcessor.loadRawFile(filePath);
+        if (original == null) return false;
+        _rawData = original;
+        _originalRawData = original;
+        _fullImage?.dispose();
+        _fullImage = null;
+      }
+      
+      _usingSmartPreview = false;
+      return true;
+    } catch (e) {
+      print('Error fetching original for export: $e');
+      setError('Original file is not available for export: $e');
+      return false;
+    }
+  }
+
   @override
   void dispose() {
     _fullResTimer?.cancel();
@@ -524,6 +723,7 @@ class ImageState extends ChangeNotifier {
     _fullImage?.dispose();
     _originalPreviewImage?.dispose();
     _originalFullImage?.dispose();
+    _closeTiledImage();
     ProcessorFactory.dispose();
     super.dispose();
   }
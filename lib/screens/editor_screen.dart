@@ -7,6 +7,7 @@ import '../models/image_state.dart';
 import '../models/crop_state.dart';
 import '../services/file_service.dart';
 import '../services/export_service.dart';
+import '../ffi/encode/image_encoder.dart';
 import '../widgets/toolbar.dart';
 import '../widgets/image_viewer.dart';
 import '../widgets/editing_panel.dart';
@@ -408,6 +409,8 @@ class _EditorScreenState extends State<EditorScreen> {
       final success = await imageState.exportImage(
         format: result['format'],
         jpegQuality: result['quality'],
+        preset: result['preset'] ?? EncodePreset.balanced,
+        maxFileSize: result['maxFileSize'],
         resizePercentage: result['resizePercentage'],
         frameType: result['frameType'] ?? 'none',
         frameColor: result['frameColor'] ?? 'black',
@@ -422,12 +425,12 @@ class _EditorScreenState extends State<EditorScreen> {
             content: Text(
               success 
                 ? 'Image exported successfully'
-                : 'Failed to export image',
+                : imageState.exportError ?? 'Failed to export image',
             ),
             backgroundColor: success 
               ? const Color(0xFF10B981)
               : const Color(0xFFEF4444),
-            duration: const Duration(seconds: 2),
+            duration: Duration(seconds: imageState.exportError != null ? 5 : 2),
           ),
         );
       }
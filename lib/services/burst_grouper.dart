@@ -0,0 +1,89 @@
+import 'dart:ffi';
+import 'dart:isolate';
+import 'package:ffi/ffi.dart';
+import '../ffi/raw/raw_batch_bindings.dart';
+import '../ffi/raw/raw_hash_bindings.dart';
+import 'raw_processor.dart';
+
+/// Near-identical frames, e.g. a burst or a duplicate import
+class BurstGroup {
+  final List<String> paths;   // In the order they were requested
+
+  BurstGroup(this.paths);
+
+  /// The frame that stands in for the group; the others need no full
+  /// decode until the group is opened
+  String get representative => paths.first;
+
+  bool get isBurst => paths.length > 1;
+}
+
+/// Groups bursts and duplicates by perceptual hash. Hashes come from the
+/// embedded previews on a native thread pool and grouping uses
+/// multi-index lookup, so a card's worth of files groups in seconds.
+class BurstGrouper {
+  /// Group [paths]. Frames whose pHashes differ by at most [maxDistance]
+  /// bits join the same group, transitively. [maxSeconds] also requires
+  /// capture times to be that close, when both are known.
+  static Future<List<BurstGroup>> group(
+    List<String> paths, {
+    int maxDistance = 10,
+    int maxDhashDistance = 0,
+    int maxSeconds = 0,
+    int threads = 0,
+    int jobClass = JobClass.batch,
+  }) async {
+    if (paths.isEmpty) return [];
+    RawProcessor.initialize();
+
+    final groupIds = await Isolate.run(() => _hashAndGroup(
+        paths, maxDistance, maxDhashDistance, maxSeconds, threads, jobClass));
+
+    // Group ids are the lowest index of each group, so groups come out in
+    // the order of their first frame
+    final byId = <int, List<String>>{};
+    for (int i = 0; i < paths.length; i++) {
+      byId.putIfAbsent(groupIds[i], () => []).add(paths[i]);
+    }
+    return byId.values.map(BurstGroup.new).toList();
+  }
+
+  static List<int> _hashAndGroup(List<String> paths, int maxDistance, int maxDhashDistance,
+      int maxSeconds, int threads, int jobClass) {
+    final bindings = RawProcessor.hashBindings;
+    final pathPtrs = calloc<Pointer<Utf8>>(paths.length);
+    final options = calloc<RawHashOptions>();
+    final groupOptions = calloc<RawHashGroupOptions>();
+    final hashes = calloc<RawHash>(paths.length);
+    final groups = calloc<Int32>(paths.length);
+    try {
+      for (int i = 0; i < paths.length; i++) {
+        pathPtrs[i] = paths[i].toNativeUtf8();
+      }
+      bindings.rawHashDefaultOptions(options);
+      options.ref
+        ..threads = threads
+        ..jobClass = jobClass;
+      bindings.rawHashRun(pathPtrs, paths.length, options, hashes);
+
+      bindings.rawHashDefaultGroupOptions(groupOptions);
+      groupOptions.ref
+        ..maxPhashDistance = maxDistance
+        ..maxDhashDistance = maxDhashDistance
+        ..maxSeconds = maxSeconds;
+      if (bindings.rawHashGroup(hashes, paths.length, groupOptions, groups) < 0) {
+        throw Exception('Out of memory grouping ${paths.length} hashes');
+      }
+      return List<int>.from(groups.asTypedList(paths.length));
+    } finally {
+      for (int i = 0; i < paths.length; i++) {
+        if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+      }
+      calloc.free(pathPtrs);
+      calloc.free(options);
+      calloc.free(groupOptions);
+      calloc.free(hashes);
+      calloc.free(groups);
+    }
+  }
+}
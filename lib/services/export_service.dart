@@ -8,18 +8,82 @@ import 'image_manipulation_service.dart';
 import 'image_processor.dart';
 import 'preferences_service.dart';
 import '../models/crop_state.dart';
+import '../models/edit_pipeline.dart';
 import '../ffi/jpeg/jpeg_processor.dart';
+import '../ffi/encode/image_encoder.dart';
+import '../ffi/tiles/tiled_image.dart';
+import 'tiled_image_service.dart';
+import 'processors/processor_factory.dart';
+import 'processors/vulkan_processor.dart';
 
 /// Export formats supported
 enum ExportFormat {
   jpeg,
   png,
+  jxl,
+  avif,
+  webp,
+}
+
+/// One file of a multi-output export
+class ExportOutput {
+  final ExportFormat format;
+  
+  /// Long edge in pixels; null keeps the full size
+  final int? maxDimension;
+  final int quality;
+  final EncodePreset preset;
+  final String path;
+  
+  const ExportOutput({
+    required this.format,
+    this.maxDimension,
+    this.quality = 90,
+    this.preset = EncodePreset.balanced,
+    required this.path,
+  });
 }
 
 /// Service for exporting edited images to various formats
 class ExportService {
   static XdgDesktopPortalClient? _portalClient;
   
+  /// Formats encoded by the native image_encoder library
+  static const Map<ExportFormat, ImageCodec> _codecs = {
+    ExportFormat.jxl: ImageCodec.jxl,
+    ExportFormat.avif: ImageCodec.avif,
+    ExportFormat.webp: ImageCodec.webp,
+  };
+  
+  /// Formats the multi-output export encodes natively
+  static const Map<ExportFormat, ImageCodec> _planCodecs = {
+    ExportFormat.jpeg: ImageCodec.jpeg,
+    ..._codecs,
+  };
+  
+  static const Map<ExportFormat, String> _extensions = {
+    ExportFormat.jpeg: 'jpg',
+    ExportFormat.png: 'png',
+    ExportFormat.jxl: 'jxl',
+    ExportFormat.avif: 'avif',
+    ExportFormat.webp: 'webp',
+  };
+  
+  static const Map<ExportFormat, String> _typeNames = {
+    ExportFormat.jpeg: 'JPEG',
+    ExportFormat.png: 'PNG',
+    ExportFormat.jxl: 'JPEG XL',
+    ExportFormat.avif: 'AVIF',
+    ExportFormat.webp: 'WebP',
+  };
+  
+  /// Whether a format can be exported on this system. JPEG and PNG always
+  /// can; the others depend on the codecs the encoder library was built with.
+  static bool isFormatAvailable(ExportFormat format) {
+    final codec = _codecs[format];
+    return codec == null || ImageEncoder.isSupported(codec);
+  }
+  
   /// Generate a smart filename with _aks suffix and counter if needed
   static String generateExportFilename(String? originalPath, String extension) {
     if (originalPath == null) {
@@ -49,19 +113,27 @@ class ExportService {
     return filename;
   }
   
-  /// Export the image to JPEG format
+  /// Export the image to JPEG format. With maxBytes, quality is the
+  /// ceiling and the highest quality that fits the budget is used.
   static Future<bool> exportJpeg({
     required ui.Image image,
     required String outputPath,
     int quality = 90,
+    int? maxBytes,
   }) async {
     try {
       
       // Compress image to JPEG
-      final jpegData = await JpegProcessor.compressImage(
-        image: image,
-        quality: quality,
-      );
+      final jpegData = maxBytes != null
+          ? await JpegProcessor.compressToSize(
+              image: image,
+              maxBytes: maxBytes,
+              maxQuality: quality,
+            )
+          : await JpegProcessor.compressImage(
+              image: image,
+              quality: quality,
+            );
       
       // Write to file
       final file = File(outputPath);
@@ -74,6 +146,64 @@ class ExportService {
     }
   }
   
+  /// Encode straight from the source pixels, skipping the ui.Image round
+  /// trip. The pixels are copied into tiles and rendered like a tiled export,
+  /// split between the GPU and the native CPU kernel, then streamed to the
+  /// encoder. Returns false if the active processor isn't the GPU one, so
+  /// callers can fall back.
+  static Future<bool> exportJpegFromRaw({
+    required RawPixelData rawData,
+    required EditPipeline pipeline,
+    required String outputPath,
+    int quality = 90,
+  }) async {
+    TiledImage? source;
+    try {
+      final processor = await ProcessorFactory.getProcessor();
+      if (processor is! VulkanProcessor) return false;
+      
+      source = TiledImage.fromPixels(rawData);
+      return await TiledImageService.exportJpeg(
+        source: source,
+        pipeline: pipeline,
+        outputPath: outputPath,
+        quality: quality,
+      );
+    } catch (e) {
+      print('Error exporting JPEG from the source pixels: $e');
+      return false;
+    } finally {
+      source?.close();
+    }
+  }
+  
+  /// Export the image to JPEG XL, AVIF or WebP
+  static Future<bool> exportEncoded({
+    required ui.Image image,
+    required String outputPath,
+    required ExportFormat format,
+    int quality = 90,
+    EncodePreset preset = EncodePreset.balanced,
+  }) async {
+    final codec = _codecs[format];
+    if (codec == null) return false;
+    
+    try {
+      final data = await ImageEncoder.encodeImage(
+        image: image,
+        codec: codec,
+        quality: quality,
+        preset: preset,
+      );
+      
+      await File(outputPath).writeAsBytes(data);
+      return true;
+    } catch (e) {
+      print('Error exporting ${_typeNames[format]}: $e');
+      return false;
+    }
+  }
+  
   /// Export the image to PNG format
   static Future<bool> exportPng({
     required ui.Image image,
@@ -102,125 +232,109 @@ class ExportService {
     }
   }
   
-  /// Show export dialog and export the image with transformations
-  static Future<bool> showExportDialog({
-    required ui.Image image,
+  /// Ask the user where to save the export.
+  /// Returns the chosen path with the proper extension, or null if cancelled.
+  static Future<String?> chooseOutputPath({
     required String? originalPath,
     ExportFormat format = ExportFormat.jpeg,
-    int jpegQuality = 90,
-    double? resizePercentage,
-    String frameType = 'none',
-    String frameColor = 'black',
-    int borderWidth = 20,
   }) async {
-    try {
-      // Determine file extension and type
-      final String extension = format == ExportFormat.jpeg ? 'jpg' : 'png';
-      final String typeName = format == ExportFormat.jpeg ? 'JPEG' : 'PNG';
-      
-      // Generate smart filename (just the filename, not the full path)
-      String smartFilename = generateExportFilename(originalPath, extension);
-      
-      String? outputFile;
-      
-      // Get last export directory if available
-      final lastExportDir = await PreferencesService.getLastExportDirectory();
-      String? initialDirectory;
+    // Determine file extension and type
+    final String extension = _extensions[format]!;
+    final String typeName = _typeNames[format]!;
+    
+    // Generate smart filename (just the filename, not the full path)
+    String smartFilename = generateExportFilename(originalPath, extension);
+    
+    String? outputFile;
+    
+    // Get last export directory if available
+    final lastExportDir = await PreferencesService.getLastExportDirectory();
+    String? initialDirectory;
+    
+    // Determine the directory to use
+    if (lastExportDir != null) {
+      initialDirectory = lastExportDir;
+      print('Using last export directory: $initialDirectory');
+    } else {
+      // Try to get the Downloads directory from environment
+      final home = Platform.environment['HOME'];
+      final xdgDownload = Platform.environment['XDG_DOWNLOAD_DIR'];
       
-      // Determine the directory to use
-      if (lastExportDir != null) {
-        initialDirectory = lastExportDir;
-        print('Using last export directory: $initialDirectory');
-      } else {
-        // Try to get the Downloads directory from environment
-        final home = Platform.environment['HOME'];
-        final xdgDownload = Platform.environment['XDG_DOWNLOAD_DIR'];
-        
-        if (xdgDownload != null && await Directory(xdgDownload).exists()) {
-          initialDirectory = xdgDownload;
-          print('Using XDG Downloads directory: $initialDirectory');
-        } else if (home != null) {
-          // Fall back to ~/Downloads if XDG_DOWNLOAD_DIR is not set
-          final downloadsPath = path.join(home, 'Downloads');
-          if (await Directory(downloadsPath).exists()) {
-            initialDirectory = downloadsPath;
-            print('Using ~/Downloads directory: $initialDirectory');
-          } else {
-            // Fall back to home directory
-            initialDirectory = home;
-            print('Using home directory: $initialDirectory');
-          }
-        } else if (originalPath != null) {
-          // Last resort: use the directory of the original image
-          initialDirectory = path.dirname(originalPath);
-          print('Using original image directory: $initialDirectory');
+      if (xdgDownload != null && await Directory(xdgDownload).exists()) {
+        initialDirectory = xdgDownload;
+        print('Using XDG Downloads directory: $initialDirectory');
+      } else if (home != null) {
+        // Fall back to ~/Downloads if XDG_DOWNLOAD_DIR is not set
+        final downloadsPath = path.join(home, 'Downloads');
+        if (await Directory(downloadsPath).exists()) {
+          initialDirectory = downloadsPath;
+          print('Using ~/Downloads directory: $initialDirectory');
         } else {
-          print('No initial directory available');
+          // Fall back to home directory
+          initialDirectory = home;
+          print('Using home directory: $initialDirectory');
         }
+      } else if (originalPath != null) {
+        // Last resort: use the directory of the original image
+        initialDirectory = path.dirname(originalPath);
+        print('Using original image directory: $initialDirectory');
+      } else {
+        print('No initial directory available');
       }
-      
-      // Try to use XDG Desktop Portal on Linux
-      if (Platform.isLinux) {
-        try {
-          print('Trying XDG Desktop Portal for file save...');
-          
-          // Create or reuse XDG portal client
-          _portalClient ??= XdgDesktopPortalClient();
-          
-          // Create filter for the chosen format
-          final filters = [
-            XdgFileChooserFilter(
-              '$typeName Images',
-              [XdgFileChooserGlobPattern('*.$extension')],
-            ),
-            XdgFileChooserFilter(
-              'All Files',
-              [XdgFileChooserGlobPattern('*')],
-            ),
-          ];
-          
-          // Show native save dialog - returns a Stream
-          // Note: XDG Portal doesn't support setting initial directory with a string path
-          // We can try to suggest a full path as the filename
-          String suggestedName = smartFilename;
-          if (initialDirectory != null && lastExportDir == null) {
-            // Only suggest full path if we're using a default directory (not last export)
-            suggestedName = path.join(initialDirectory, smartFilename);
-            print('Suggesting full path to XDG Portal: $suggestedName');
-          }
-          
-          final resultStream = _portalClient!.fileChooser.saveFile(
-            title: 'Export as $typeName',
-            acceptLabel: 'Export',
-            currentName: suggestedName,
-            filters: filters,
-          );
-          
-          // Get first result from stream
-          final result = await resultStream.first;
-          
-          // Handle result
-          if (result.uris.isNotEmpty) {
-            final uri = Uri.parse(result.uris.first);
-            outputFile = uri.toFilePath();
-            print('Save location via XDG Portal: $outputFile');
-          } else {
-            print('No save location selected via XDG Portal');
-            return false;
-          }
-        } catch (e) {
-          print('XDG Portal failed, falling back to file_picker: $e');
-          // Fall back to file_picker if XDG portal fails
-          outputFile = await FilePicker.platform.saveFile(
-            dialogTitle: 'Export as $typeName',
-            fileName: smartFilename,  // Just use filename, not full path
-            initialDirectory: initialDirectory,  // Try with initialDirectory
-            type: FileType.custom,
-            allowedExtensions: [extension],
-          );
+    }
+    
+    // Try to use XDG Desktop Portal on Linux
+    if (Platform.isLinux) {
+      try {
+        print('Trying XDG Desktop Portal for file save...');
+        
+        // Create or reuse XDG portal client
+        _portalClient ??= XdgDesktopPortalClient();
+        
+        // Create filter for the chosen format
+        final filters = [
+          XdgFileChooserFilter(
+            '$typeName Images',
+            [XdgFileChooserGlobPattern('*.$extension')],
+          ),
+          XdgFileChooserFilter(
+            'All Files',
+            [XdgFileChooserGlobPattern('*')],
+          ),
+        ];
+        
+        // Show native save dialog - returns a Stream
+        // Note: XDG Portal doesn't support setting initial directory with a string path
+        // We can try to suggest a full path as the filename
+        String suggestedName = smartFilename;
+        if (initialDirectory != null && lastExportDir == null) {
+          // Only suggest full path if we're using a default directory (not last export)
+          suggestedName = path.join(initialDirectory, smartFilename);
+          print('Suggesting full path to XDG Portal: $suggestedName');
         }
-      } else {
-        // Use file_picker on other platforms
+        
+        final resultStream = _portalClient!.fileChooser.saveFile(
+          title: 'Export as $typeName',
+          acceptLabel: 'Export',
+          currentName: suggestedName,
+          filters: filters,
+        );
+        
+        // Get first result from stream
+        final result = await resultStream.first;
+        
+        // Handle result
+        if (result.uris.isNotEmpty) {
+          final uri = Uri.parse(result.uris.first);
+          outputFile = uri.toFilePath();
+          print('Save location via XDG Portal: $outputFile');
+        } else {
+          print('No save location selected via XDG Portal');
+          return null;
+        }
+      } catch (e) {
+        print('XDG Portal failed, falling back to file_picker: $e');
+        // Fall back to file_picker if XDG portal fails
         outputFile = await FilePicker.platform.saveFile(
           dialogTitle: 'Export as $typeName',
           fileName: smartFilename,  // Just use filename, not full path
@@ -229,16 +343,53 @@ class ExportService {
           allowedExtensions: [extension],
         );
       }
+    } else {
+      // Use file_picker on other platforms
+      outputFile = await FilePicker.platform.saveFile(
+        dialogTitle: 'Export as $typeName',
+        fileName: smartFilename,  // Just use filename, not full path
+        initialDirectory: initialDirectory,  // Try with initialDirectory
+        type: FileType.custom,
+        allowedExtensions: [extension],
+      );
+    }
+    
+    if (outputFile == null) {
+      return null; // User cancelled
+    }
+    
+    // Ensure proper extension
+    if (!outputFile.toLowerCase().endsWith('.$extension')) {
+      outputFile = '$outputFile.$extension';
+    }
+    
+    return outputFile;
+  }
+  
+  /// Show export dialog and export the image with transformations
+  static Future<bool> showExportDialog({
+    required ui.Image image,
+    required String? originalPath,
+    ExportFormat format = ExportFormat.jpeg,
+    int jpegQuality = 90,
+    EncodePreset preset = EncodePreset.balanced,
+    int? maxFileSize,
+    double? resizePercentage,
+    String frameType = 'none',
+    String frameColor = 'black',
+    int borderWidth = 20,
+    Future<bool> Function(String outputPath)? encodeFromSource,
+  }) async {
+    try {
+      final outputFile = await chooseOutputPath(
+        originalPath: originalPath,
+        format: format,
+      );
       
       if (outputFile == null) {
         return false; // User cancelled
       }
       
-      // Ensure proper extension
-      if (!outputFile.toLowerCase().endsWith('.$extension')) {
-        outputFile = '$outputFile.$extension';
-      }
-      
       // Apply transformations if needed
       ui.Image imageToExport = image;
       if (resizePercentage != null || frameType != 'none') {
@@ -260,15 +411,31 @@ class ExportService {
       // Export based on format
       bool success = false;
       if (format == ExportFormat.jpeg) {
-        success = await exportJpeg(
+        // Untransformed exports can be encoded from the source pixels;
+        // size targets need the CPU encoder's quality search
+        if (imageToExport == image && encodeFromSource != null && maxFileSize == null) {
+          success = await encodeFromSource(outputFile);
+        }
+        if (!success) {
+          success = await exportJpeg(
+            image: imageToExport,
+            outputPath: outputFile,
+            quality: jpegQuality,
+            maxBytes: maxFileSize,
+          );
+        }
+      } else if (format == ExportFormat.png) {
+        success = await exportPng(
           image: imageToExport,
           outputPath: outputFile,
-          quality: jpegQuality,
         );
       } else {
-        success = await exportPng(
+        success = await exportEncoded(
           image: imageToExport,
           outputPath: outputFile,
+          format: format,
+          quality: jpegQuality,
+          preset: preset,
         );
       }
       
@@ -301,10 +468,14 @@ class ExportService {
     CropRect? cropRect,
     ExportFormat format = ExportFormat.jpeg,
     int jpegQuality = 90,
+    EncodePreset preset = EncodePreset.balanced,
+    int? maxFileSize,
     double? resizePercentage,
     String frameType = 'none',
     String frameColor = 'black',
     int borderWidth = 20,
+    RawPixelData? rawData,
+    EditPipeline? pipeline,
   }) async {
     // Use full resolution if available, otherwise use preview
     var imageToExport = fullImage ?? previewImage;
@@ -327,13 +498,145 @@ class ExportService {
       originalPath: originalPath,
       format: format,
       jpegQuality: jpegQuality,
+      preset: preset,
+      maxFileSize: maxFileSize,
       resizePercentage: resizePercentage,
       frameType: frameType,
       frameColor: frameColor,
       borderWidth: borderWidth,
+      encodeFromSource: rawData != null && pipeline != null
+          ? (outputPath) => exportJpegFromRaw(
+                rawData: rawData,
+                pipeline: pipeline,
+                outputPath: outputPath,
+                quality: jpegQuality,
+              )
+          : null,
     );
   }
   
+  /// Export several sizes and formats from a single render, e.g. a full
+  /// size JPEG, a 2048 px web version and a thumbnail. The image is cropped
+  /// once; native outputs share one resize pyramid and are encoded in
+  /// parallel. Returns whether each output was written.
+  static Future<List<bool>> exportMultiple({
+    required ui.Image? previewImage,
+    required ui.Image? fullImage,
+    CropRect? cropRect,
+    required List<ExportOutput> outputs,
+  }) async {
+    var imageToExport = fullImage ?? previewImage;
+    if (imageToExport == null) {
+      print('No image available for export');
+      return List.filled(outputs.length, false);
+    }
+    
+    if (cropRect != null) {
+      imageToExport = await ImageProcessor.applyCropToImage(imageToExport, cropRect);
+    }
+    
+    final results = List.filled(outputs.length, false);
+    try {
+      final planned = [
+        for (int i = 0; i < outputs.length; i++)
+          if (_planCodecs.containsKey(outputs[i].format) &&
+              isFormatAvailable(outputs[i].format))
+            i,
+      ];
+      
+      if (planned.isNotEmpty) {
+        final written = await ImageEncoder.exportAll(
+          image: imageToExport,
+          targets: [
+            for (final i in planned)
+              ExportTarget(
+                maxDimension: outputs[i].maxDimension,
+                codec: _planCodecs[outputs[i].format]!,
+                quality: outputs[i].quality,
+                preset: outputs[i].preset,
+                path: outputs[i].path,
+              ),
+          ],
+        );
+        for (int j = 0; j < planned.length; j++) {
+          results[planned[j]] = written[j];
+        }
+      }
+      
+      // PNG goes through the ui.Image encoder, resized on its own
+      for (int i = 0; i < outputs.length; i++) {
+        final output = outputs[i];
+        if (output.format != ExportFormat.png) continue;
+        
+        final longEdge = imageToExport.width > imageToExport.height
+            ? imageToExport.width
+            : imageToExport.height;
+        final maxDimension = output.maxDimension;
+        final resized = maxDimension != null && maxDimension < longEdge
+            ? await ImageManipulationService.applyTransformations(
+                imageToExport,
+                resizePercentage: maxDimension / longEdge,
+              )
+            : imageToExport;
+        results[i] = await exportPng(image: resized, outputPath: output.path);
+        if (resized != imageToExport) resized.dispose();
+      }
+    } catch (e) {
+      print('Error in multi-output export: $e');
+    } finally {
+      if (imageToExport != fullImage && imageToExport != previewImage) {
+        imageToExport.dispose();
+      }
+    }
+    
+    for (int i = 0; i < outputs.length; i++) {
+      if (!results[i]) print('Failed to export ${outputs[i].path}');
+    }
+    return results;
+  }
+  
+  /// Export an out-of-core image by streaming its tiles to the encoder
+  static Future<bool> exportTiled({
+    required TiledImage source,
+    required EditPipeline pipeline,
+    required String? originalPath,
+    ExportFormat format = ExportFormat.jpeg,
+    int jpegQuality = 90,
+  }) async {
+    if (format != ExportFormat.jpeg) {
+      // PNG export goes through ui.Image, which needs the whole image in memory
+      print('Tiled export only supports JPEG');
+      return false;
+    }
+    
+    try {
+      final outputFile = await chooseOutputPath(
+        originalPath: originalPath,
+        format: format,
+      );
+      
+      if (outputFile == null) {
+        return false; // User cancelled
+      }
+      
+      final success = await TiledImageService.exportJpeg(
+        source: source,
+        pipeline: pipeline,
+        outputPath: outputFile,
+        quality: jpegQuality,
+      );
+      
+      if (success) {
+        await PreferencesService.saveLastExportDirectory(path.dirname(outputFile));
+      }
+      
+      return success;
+    } catch (e) {
+      print('Error in tiled export: $e');
+      return false;
+    }
+  }
+  
   /// Clean up the portal client
   static void dispose() {
     _portalClient?.close();
@@ -107,6 +107,46 @@ class FileService {
     }
   }
   
+  /// Pick a .cube 3D LUT
+  static Future<String?> pickCubeLut() async {
+    if (Platform.isLinux) {
+      try {
+        _portalClient ??= XdgDesktopPortalClient();
+        final result = await _portalClient!.fileChooser.openFile(
+          title: 'Choose LUT',
+          acceptLabel: 'Apply',
+          filters: [
+            XdgFileChooserFilter('Cube LUTs', [
+              XdgFileChooserGlobPattern('*.cube'),
+              XdgFileChooserGlobPattern('*.CUBE'),
+            ]),
+          ],
+          multiple: false,
+        ).first;
+        if (result.uris.isEmpty) return null;
+        return Uri.parse(result.uris.first).toFilePath();
+      } catch (e) {
+        // Cancelling closes the request with an error; see pickRawImage
+        print('LUT selection cancelled or failed: $e');
+        return null;
+      }
+    }
+    
+    try {
+      final result = await FilePicker.platform.pickFiles(
+        type: FileType.custom,
+        allowedExtensions: ['cube', 'CUBE'],
+        dialogTitle: 'Choose LUT',
+        withData: false,
+        withReadStream: false,
+      );
+      return result?.files.single.path;
+    } catch (e) {
+      print('Error picking LUT: $e');
+      return null;
+    }
+  }
+  
   static void dispose() {
     _portalClient?.close();
     _portalClient = null;
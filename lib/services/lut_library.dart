@@ -0,0 +1,41 @@
+import '../ffi/lut/cube_lut.dart';
+import '../models/adjustments.dart';
+
+/// .cube LUTs referenced by edit pipelines. Each file is loaded once and
+/// stays registered with the native engines for the rest of the session, so
+/// pipelines only carry the path.
+class LutLibrary {
+  static final Map<String, CubeLut?> _luts = {};
+
+  /// The registered LUT for [path], or null if it can't be loaded. Failures
+  /// are remembered so a missing file isn't re-read on every preview.
+  static CubeLut? lookup(String path) {
+    if (_luts.containsKey(path)) return _luts[path];
+    try {
+      return load(path);
+    } catch (e) {
+      print('LutLibrary: $e');
+      _luts[path] = null;
+      return null;
+    }
+  }
+
+  /// Load [path], replacing what was cached for it. Throws a FormatException
+  /// if it isn't a usable .cube file.
+  static CubeLut load(String path) {
+    final lut = CubeLut.load(path);
+    _luts[path]?.dispose();
+    _luts[path] = lut;
+    return lut;
+  }
+
+  /// Id and blend of the LUT in [adjustment] for AdjustmentParams, or null
+  /// if there is none or it can't be loaded
+  static ({int id, double opacity})? resolve(LutAdjustment adjustment) {
+    final path = adjustment.path;
+    if (path == null || adjustment.opacity <= 0) return null;
+    final lut = lookup(path);
+    if (lut == null || lut.id == 0) return null;
+    return (id: lut.id, opacity: (adjustment.opacity / 100).clamp(0.0, 1.0).toDouble());
+  }
+}
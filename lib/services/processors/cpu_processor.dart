@@ -1,9 +1,15 @@
+import 'dart:ffi';
 import 'dart:isolate';
 import 'dart:typed_data';
 import 'dart:ui' as ui;
+import 'package:ffi/ffi.dart';
+import '../../ffi/common/adjustment_params.dart';
+import '../../ffi/cpu/cpu_kernel.dart';
+import '../../ffi/cpu/cpu_kernel_bindings.dart';
 import '../../models/adjustments.dart';
 import '../../models/edit_pipeline.dart';
 import '../image_processor.dart';
+import '../lut_library.dart';
 import '../optimized_processor.dart';
 import 'image_processor_interface.dart';
 
@@ -31,12 +37,18 @@ class CpuProcessor extends BaseImageProcessor {
   ) async {
     final responsePort = ReceivePort();
     
+    // LUTs are registered natively, so only the id crosses to the isolate
+    final lutAdjustment = adjustments.whereType<LutAdjustment>().firstOrNull;
+    final lut = lutAdjustment != null ? LutLibrary.resolve(lutAdjustment) : null;
+    
     // Send processing request to isolate
     _sendPort!.send(ProcessingRequest(
       pixels: pixels,
       width: width,
       height: height,
       adjustments: adjustments,
+      lutId: lut?.id ?? 0,
+      lutOpacity: lut?.opacity ?? 1.0,
       responsePort: responsePort.sendPort,
     ));
     
@@ -73,6 +85,8 @@ class CpuProcessor extends BaseImageProcessor {
             message.width,
             message.height,
             message.adjustments,
+            lutId: message.lutId,
+            lutOpacity: message.lutOpacity,
           );
           
           // Send response back
@@ -94,10 +108,21 @@ class CpuProcessor extends BaseImageProcessor {
     int width,
     int height,
     List<Adjustment> adjustments,
+    {int lutId = 0,
+     double lutOpacity = 1.0}
   ) {
     // Create working copy
     final workingPixels = Uint8List.fromList(pixels);
     
+    // The 3D LUT goes last, through the native kernel, which also writes RGBA
+    if (lutId != 0) {
+      for (final adjustment in adjustments) {
+        _applyAdjustment(workingPixels, adjustment);
+      }
+      return _applyCubeLut(workingPixels, width, height, lutId, lutOpacity) ??
+          _convertToRGBA(workingPixels, width, height);
+    }
+    
     // Check if we have adjustments to apply
     if (adjustments.isEmpty) {
       return _convertToRGBA(workingPixels, width, height);
@@ -105,22 +130,7 @@ class CpuProcessor extends BaseImageProcessor {
     
     // Apply all adjustments except the last one
     for (int i = 0; i < adjustments.length - 1; i++) {
-      final adjustment = adjustments[i];
-      if (adjustment is WhiteBalanceAdjustment) {
-        _applyWhiteBalance(workingPixels, adjustment);
-      } else if (adjustment is ExposureAdjustment) {
-        _applyExposure(workingPixels, adjustment);
-      } else if (adjustment is ContrastAdjustment) {
-        _applyContrast(workingPixels, adjustment);
-      } else if (adjustment is HighlightsShadowsAdjustment) {
-        _applyHighlightsShadows(workingPixels, adjustment);
-      } else if (adjustment is BlacksWhitesAdjustment) {
-        _applyBlacksWhites(workingPixels, adjustment);
-      } else if (adjustment is ToneCurveAdjustment) {
-        _applyToneCurve(workingPixels, adjustment);
-      } else if (adjustment is SaturationVibranceAdjustment) {
-        _applySaturationVibrance(workingPixels, adjustment);
-      }
+      _applyAdjustment(workingPixels, adjustments[i]);
     }
     
     // Apply last adjustment while converting to RGBA
@@ -130,6 +140,63 @@ class CpuProcessor extends BaseImageProcessor {
   
   // ===== Processing methods (run in isolate) =====
   
+  /// Apply one adjustment in place; 3D LUTs are handled by _applyCubeLut
+  static void _applyAdjustment(Uint8List pixels, Adjustment adjustment) {
+    if (adjustment is WhiteBalanceAdjustment) {
+      _applyWhiteBalance(pixels, adjustment);
+    } else if (adjustment is ExposureAdjustment) {
+      _applyExposure(pixels, adjustment);
+    } else if (adjustment is ContrastAdjustment) {
+      _applyContrast(pixels, adjustment);
+    } else if (adjustment is HighlightsShadowsAdjustment) {
+      _applyHighlightsShadows(pixels, adjustment);
+    } else if (adjustment is BlacksWhitesAdjustment) {
+      _applyBlacksWhites(pixels, adjustment);
+    } else if (adjustment is ToneCurveAdjustment) {
+      _applyToneCurve(pixels, adjustment);
+    } else if (adjustment is SaturationVibranceAdjustment) {
+      _applySaturationVibrance(pixels, adjustment);
+    }
+  }
+  
+  /// Map RGB pixels through a registered 3D LUT with the native CPU kernel.
+  /// Returns RGBA, or null if the kernel isn't available.
+  static Uint8List? _applyCubeLut(Uint8List rgb, int width, int height, int lutId, double opacity) {
+    final CpuKernelBindings kernel;
+    try {
+      kernel = CpuKernel.bindings;
+    } catch (e) {
+      print('CpuProcessor: 3D LUT skipped, CPU kernel unavailable: $e');
+      return null;
+    }
+    
+    final input = malloc<Uint8>(rgb.length);
+    final params = calloc<AdjustmentParams>();
+    final output = calloc<Pointer<Uint8>>();
+    final outputWidth = calloc<Int32>();
+    final outputHeight = calloc<Int32>();
+    try {
+      input.asTypedList(rgb.length).setAll(0, rgb);
+      params.ref.reset();
+      params.ref.stages = AdjustmentStage.lut3d;
+      params.ref.lutId = lutId;
+      params.ref.lutOpacity = opacity;
+      
+      final ok = kernel.cpuProcessImageParams(input, width, height, params,
+          nullptr, nullptr, nullptr, nullptr, output, outputWidth, outputHeight);
+      if (ok != 1) return null;
+      final rgba = Uint8List.fromList(output.value.asTypedList(width * height * 4));
+      kernel.cpuFreeBuffer(output.value);
+      return rgba;
+    } finally {
+      malloc.free(input);
+      calloc.free(params);
+      calloc.free(output);
+      calloc.free(outputWidth);
+      calloc.free(outputHeight);
+    }
+  }
+  
   static void _applyWhiteBalance(Uint8List pixels, WhiteBalanceAdjustment adj) {
     OptimizedProcessor.applyWhiteBalanceFast(pixels, adj.temperature, adj.tint);
   }
@@ -308,17 +375,7 @@ class CpuProcessor extends BaseImageProcessor {
       return rgba;
     } else {
       // For complex adjustments, apply them first then convert
-      if (lastAdjustment is WhiteBalanceAdjustment) {
-        _applyWhiteBalance(rgb, lastAdjustment);
-      } else if (lastAdjustment is HighlightsShadowsAdjustment) {
-        _applyHighlightsShadows(rgb, lastAdjustment);
-      } else if (lastAdjustment is BlacksWhitesAdjustment) {
-        _applyBlacksWhites(rgb, lastAdjustment);
-      } else if (lastAdjustment is ToneCurveAdjustment) {
-        _applyToneCurve(rgb, lastAdjustment);
-      } else if (lastAdjustment is SaturationVibranceAdjustment) {
-        _applySaturationVibrance(rgb, lastAdjustment);
-      }
+      _applyAdjustment(rgb, lastAdjustment);
       
       // Now do simple conversion
       return _convertToRGBA(rgb, width, height);
@@ -348,6 +405,8 @@ class ProcessingRequest {
   final int width;
   final int height;
   final List<Adjustment> adjustments;
+  final int lutId;          // Registered 3D LUT, 0 for none
+  final double lutOpacity;
   final SendPort responsePort;
   
   ProcessingRequest({
@@ -355,6 +414,8 @@ class ProcessingRequest {
     required this.width,
     required this.height,
     required this.adjustments,
+    this.lutId = 0,
+    this.lutOpacity = 1.0,
     required this.responsePort,
   });
 }
@@ -2,6 +2,9 @@ import 'dart:ffi';
 import 'dart:io';
 import 'dart:typed_data';
 import 'package:ffi/ffi.dart';
+import '../../../ffi/common/adjustment_params.dart';
+import '../../../ffi/raw/raw_batch_bindings.dart';
+import '../../../ffi/tiles/tiled_image_bindings.dart';
 
 /// Container for processed image data with dimensions
 class ProcessedImageData {
@@ -16,7 +19,39 @@ class ProcessedImageData {
   });
 }
 
-/// Vulkan FFI bindings for image processing
+/// Chroma subsampling of GPU encoded JPEGs, mirrors JPEG_SUBSAMPLING_* in
+/// jpeg_entropy.h
+abstract class JpegSubsampling {
+  static const int s444 = 0;
+  static const int s422 = 1;
+  static const int s420 = 2;
+}
+
+/// A native VkProcessorContext: its own command pool, fence and working
+/// buffers on the shared device, so work on it runs alongside work on other
+/// contexts. Use one from a single isolate at a time and dispose it when done.
+/// Contexts other than [JobClass.interactive] submit to a lower priority
+/// queue where the device has one.
+class VulkanContext {
+  final Pointer<Void> handle;
+  
+  VulkanContext._(this.handle);
+  
+  /// Create a context, or null if Vulkan is not initialized
+  static VulkanContext? create({int jobClass = JobClass.batch}) {
+    if (!VulkanBindings._initialized) return null;
+    final handle = VulkanBindings._native.vk_context_create(jobClass);
+    return handle == nullptr ? null : VulkanContext._(handle);
+  }
+  
+  void dispose() {
+    VulkanBindings._native.vk_context_destroy(handle);
+  }
+}
+
+/// Vulkan FFI bindings for image processing. Calls without a [VulkanContext]
+/// share the default interactive one, and are skipped (returning null or
+/// false) while another isolate is using it.
 class VulkanBindings {
   static const String _libName = 'vulkan_processor';
   static late final DynamicLibrary _lib;
@@ -69,143 +104,190 @@ class VulkanBindings {
     return _native.vk_is_available() == 1;
   }
   
-  /// Process image with Vulkan (with tone curve support)
-  static Uint8List? processImage(
+  /// Capabilities of the loaded processor (EngineCapability bits)
+  static int get capabilities {
+    if (!_initialized) return 0;
+    return _native.vk_get_capabilities(nullptr);
+  }
+  
+  /// Process image with Vulkan. The crop in [params] selects the output
+  /// region; null LUTs are identity.
+  static ProcessedImageData? processImage(
     Uint8List pixels,
     int width,
     int height,
-    Float32List adjustments, // Packed adjustment values
+    Pointer<AdjustmentParams> params,
     {Uint8List? rgbLut,
      Uint8List? redLut,
      Uint8List? greenLut,
-     Uint8List? blueLut}
+     Uint8List? blueLut,
+     VulkanContext? context}
   ) {
     if (!_initialized) return null;
     
-    // Create identity LUTs if not provided
-    final identityLut = Uint8List(256);
-    for (int i = 0; i < 256; i++) {
-      identityLut[i] = i;
-    }
-    
-    rgbLut ??= identityLut;
-    redLut ??= identityLut;
-    greenLut ??= identityLut;
-    blueLut ??= identityLut;
-    
     final pixelsPtr = calloc<Uint8>(pixels.length);
-    final adjustmentsPtr = calloc<Float>(adjustments.length);
-    final rgbLutPtr = calloc<Uint8>(256);
-    final redLutPtr = calloc<Uint8>(256);
-    final greenLutPtr = calloc<Uint8>(256);
-    final blueLutPtr = calloc<Uint8>(256);
+    final luts = _copyLuts([rgbLut, redLut, greenLut, blueLut]);
     final outputPtr = calloc<Pointer<Uint8>>();
+    final outputWidthPtr = calloc<Int32>();
+    final outputHeightPtr = calloc<Int32>();
     
     try {
-      // Copy input data
       pixelsPtr.asTypedList(pixels.length).setAll(0, pixels);
-      adjustmentsPtr.asTypedList(adjustments.length).setAll(0, adjustments);
-      rgbLutPtr.asTypedList(256).setAll(0, rgbLut);
-      redLutPtr.asTypedList(256).setAll(0, redLut);
-      greenLutPtr.asTypedList(256).setAll(0, greenLut);
-      blueLutPtr.asTypedList(256).setAll(0, blueLut);
       
-      // Process with Vulkan (using tone curves version)
-      final result = _native.vk_process_image_with_curves(
+      final result = _native.vk_context_process_image_params(
+        context?.handle ?? nullptr,
         pixelsPtr,
         width,
         height,
-        adjustmentsPtr,
-        adjustments.length,
-        rgbLutPtr,
-        redLutPtr,
-        greenLutPtr,
-        blueLutPtr,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
         outputPtr,
+        outputWidthPtr,
+        outputHeightPtr,
       );
       
       if (result != 1) return null;
       
+      // Get output dimensions
+      final outputWidth = outputWidthPtr.value;
+      final outputHeight = outputHeightPtr.value;
+      
       // Copy output data
-      final outputSize = width * height * 4; // RGBA
+      final outputSize = outputWidth * outputHeight * 4; // RGBA
       final output = outputPtr.value.asTypedList(outputSize);
-      return Uint8List.fromList(output);
+      return ProcessedImageData(
+        pixels: Uint8List.fromList(output),
+        width: outputWidth,
+        height: outputHeight,
+      );
     } finally {
       calloc.free(pixelsPtr);
-      calloc.free(adjustmentsPtr);
-      calloc.free(rgbLutPtr);
-      calloc.free(redLutPtr);
-      calloc.free(greenLutPtr);
-      calloc.free(blueLutPtr);
+      _freeLuts(luts);
       if (outputPtr.value != nullptr) {
         _native.vk_free_buffer(outputPtr.value);
       }
       calloc.free(outputPtr);
+      calloc.free(outputWidthPtr);
+      calloc.free(outputHeightPtr);
     }
   }
   
-  /// Process image with Vulkan including cropping (with tone curve support)
-  static ProcessedImageData? processImageWithCrop(
-    Uint8List pixels,
-    int width,
-    int height,
-    Float32List adjustments, // Packed adjustment values
-    double cropLeft,
-    double cropTop,
-    double cropRight,
-    double cropBottom,
+  /// Stream an RGB tiled image through the GPU into an RGBA tiled image.
+  /// The crop in [params] is ignored.
+  static bool processTiled(
+    Pointer<NativeTiledImage> source,
+    Pointer<NativeTiledImage> destination,
+    Pointer<AdjustmentParams> params,
     {Uint8List? rgbLut,
      Uint8List? redLut,
      Uint8List? greenLut,
-     Uint8List? blueLut}
+     Uint8List? blueLut,
+     VulkanContext? context}
   ) {
-    if (!_initialized) return null;
+    if (!_initialized) return false;
     
-    // Create identity LUTs if not provided
-    final identityLut = Uint8List(256);
-    for (int i = 0; i < 256; i++) {
-      identityLut[i] = i;
+    final luts = _copyLuts([rgbLut, redLut, greenLut, blueLut]);
+    try {
+      return _native.vk_context_process_tiled_params(
+        context?.handle ?? nullptr,
+        source,
+        destination,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
+      ) == 1;
+    } finally {
+      _freeLuts(luts);
     }
+  }
+  
+  /// [processTiled] with the native CPU kernel taking tiles from the same
+  /// queue as the GPU. [cpuThreads] <= 0 uses all cores but one. Falls back
+  /// to the GPU alone if the two engines disagree on sampled tiles.
+  static bool processTiledHybrid(
+    Pointer<NativeTiledImage> source,
+    Pointer<NativeTiledImage> destination,
+    Pointer<AdjustmentParams> params,
+    {Uint8List? rgbLut,
+     Uint8List? redLut,
+     Uint8List? greenLut,
+     Uint8List? blueLut,
+     int cpuThreads = 0,
+     VulkanContext? context}
+  ) {
+    if (!_initialized) return false;
     
-    rgbLut ??= identityLut;
-    redLut ??= identityLut;
-    greenLut ??= identityLut;
-    blueLut ??= identityLut;
+    final luts = _copyLuts([rgbLut, redLut, greenLut, blueLut]);
+    try {
+      return _native.vk_context_process_tiled_hybrid_params(
+        context?.handle ?? nullptr,
+        source,
+        destination,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
+        cpuThreads,
+      ) == 1;
+    } finally {
+      _freeLuts(luts);
+    }
+  }
+  
+  /// Keep [pixels] resident on the GPU under [imageId]. Returns false if it
+  /// does not fit the VRAM budget.
+  static bool uploadResident(int imageId, Uint8List pixels, int width, int height,
+      {VulkanContext? context}) {
+    if (!_initialized) return false;
     
     final pixelsPtr = calloc<Uint8>(pixels.length);
-    final adjustmentsPtr = calloc<Float>(adjustments.length);
-    final rgbLutPtr = calloc<Uint8>(256);
-    final redLutPtr = calloc<Uint8>(256);
-    final greenLutPtr = calloc<Uint8>(256);
-    final blueLutPtr = calloc<Uint8>(256);
+    try {
+      pixelsPtr.asTypedList(pixels.length).setAll(0, pixels);
+      return _native.vk_context_resident_upload(
+          context?.handle ?? nullptr, imageId, pixelsPtr, width, height) == 1;
+    } finally {
+      calloc.free(pixelsPtr);
+    }
+  }
+  
+  /// Whether [imageId] is resident on the GPU
+  static bool isResident(int imageId) {
+    if (!_initialized) return false;
+    return _native.vk_resident_contains(imageId) == 1;
+  }
+  
+  /// Process a resident image. Returns null if it is no longer resident.
+  static ProcessedImageData? processResident(
+    int imageId,
+    Pointer<AdjustmentParams> params,
+    {Uint8List? rgbLut,
+     Uint8List? redLut,
+     Uint8List? greenLut,
+     Uint8List? blueLut,
+     VulkanContext? context}
+  ) {
+    if (!_initialized) return null;
+    
+    final luts = _copyLuts([rgbLut, redLut, greenLut, blueLut]);
     final outputPtr = calloc<Pointer<Uint8>>();
     final outputWidthPtr = calloc<Int32>();
     final outputHeightPtr = calloc<Int32>();
     
     try {
-      // Copy input data
-      pixelsPtr.asTypedList(pixels.length).setAll(0, pixels);
-      adjustmentsPtr.asTypedList(adjustments.length).setAll(0, adjustments);
-      rgbLutPtr.asTypedList(256).setAll(0, rgbLut);
-      redLutPtr.asTypedList(256).setAll(0, redLut);
-      greenLutPtr.asTypedList(256).setAll(0, greenLut);
-      blueLutPtr.asTypedList(256).setAll(0, blueLut);
-      
-      // Process with Vulkan (using tone curves and crop version)
-      final result = _native.vk_process_image_with_curves_and_crop(
-        pixelsPtr,
-        width,
-        height,
-        adjustmentsPtr,
-        adjustments.length,
-        cropLeft,
-        cropTop,
-        cropRight,
-        cropBottom,
-        rgbLutPtr,
-        redLutPtr,
-        greenLutPtr,
-        blueLutPtr,
+      final result = _native.vk_context_process_resident_params(
+        context?.handle ?? nullptr,
+        imageId,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
         outputPtr,
         outputWidthPtr,
         outputHeightPtr,
@@ -213,25 +295,16 @@ class VulkanBindings {
       
       if (result != 1) return null;
       
-      // Get output dimensions
       final outputWidth = outputWidthPtr.value;
       final outputHeight = outputHeightPtr.value;
-      
-      // Copy output data
-      final outputSize = outputWidth * outputHeight * 4; // RGBA
-      final output = outputPtr.value.asTypedList(outputSize);
+      final output = outputPtr.value.asTypedList(outputWidth * outputHeight * 4);
       return ProcessedImageData(
         pixels: Uint8List.fromList(output),
         width: outputWidth,
         height: outputHeight,
       );
     } finally {
-      calloc.free(pixelsPtr);
-      calloc.free(adjustmentsPtr);
-      calloc.free(rgbLutPtr);
-      calloc.free(redLutPtr);
-      calloc.free(greenLutPtr);
-      calloc.free(blueLutPtr);
+      _freeLuts(luts);
       if (outputPtr.value != nullptr) {
         _native.vk_free_buffer(outputPtr.value);
       }
@@ -241,7 +314,85 @@ class VulkanBindings {
     }
   }
   
-  /// Cleanup Vulkan resources
+  /// Drop a resident image
+  static void evictResident(int imageId) {
+    if (_initialized) _native.vk_resident_evict(imageId);
+  }
+  
+  /// Drop all resident images
+  static void clearResident() {
+    if (_initialized) _native.vk_resident_clear();
+  }
+  
+  /// Process an image and encode it as JPEG. The DCT and quantization run on
+  /// the GPU, Huffman coding on the CPU. [pixels] is packed RGB in native
+  /// memory, so a background isolate can encode from the caller's copy.
+  /// Returns null if the GPU encoder is not available.
+  static Uint8List? encodeJpeg(
+    Pointer<Uint8> pixels,
+    int width,
+    int height,
+    Pointer<AdjustmentParams> params,
+    {Uint8List? rgbLut,
+     Uint8List? redLut,
+     Uint8List? greenLut,
+     Uint8List? blueLut,
+     int quality = 90,
+     int subsampling = JpegSubsampling.s420,
+     VulkanContext? context}
+  ) {
+    if (!_initialized) return null;
+    
+    final luts = _copyLuts([rgbLut, redLut, greenLut, blueLut]);
+    final jpegPtr = calloc<Pointer<Uint8>>();
+    final sizePtr = calloc<Size>();
+    
+    try {
+      final result = _native.vk_context_encode_jpeg_params(
+        context?.handle ?? nullptr,
+        pixels,
+        width,
+        height,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
+        quality,
+        subsampling,
+        jpegPtr,
+        sizePtr,
+      );
+      
+      if (result != 1) return null;
+      return Uint8List.fromList(jpegPtr.value.asTypedList(sizePtr.value));
+    } finally {
+      _freeLuts(luts);
+      if (jpegPtr.value != nullptr) {
+        _native.vk_free_buffer(jpegPtr.value);
+      }
+      calloc.free(jpegPtr);
+      calloc.free(sizePtr);
+    }
+  }
+  
+  /// Copy LUTs to native memory; NULL LUTs fall back to identity natively
+  static List<Pointer<Uint8>> _copyLuts(List<Uint8List?> luts) {
+    return luts.map((lut) {
+      if (lut == null) return nullptr.cast<Uint8>();
+      final ptr = calloc<Uint8>(256);
+      ptr.asTypedList(256).setAll(0, lut);
+      return ptr;
+    }).toList();
+  }
+  
+  static void _freeLuts(List<Pointer<Uint8>> luts) {
+    for (final lut in luts) {
+      if (lut != nullptr) calloc.free(lut);
+    }
+  }
+  
+  /// Cleanup Vulkan resources. Dispose contexts first.
   static void dispose() {
     if (_initialized) {
       _native.vk_cleanup();
@@ -351,6 +502,338 @@ class VulkanNative {
         Pointer<Int32>,
       )>();
   
+  /// Process a tiled image tile by tile
+  late final vk_process_tiled = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<NativeTiledImage>,  // source (RGB)
+        Pointer<NativeTiledImage>,  // destination (RGBA)
+        Pointer<Float>,  // adjustments
+        Int32,           // adjustment count
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+      )>>('vk_process_tiled')
+      .asFunction<int Function(
+        Pointer<NativeTiledImage>,
+        Pointer<NativeTiledImage>,
+        Pointer<Float>,
+        int,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+      )>();
+  
+  /// Engine capabilities (AKS_CAP_* bits)
+  late final vk_get_capabilities = _lib
+      .lookup<NativeFunction<Uint32 Function(Pointer<Uint32>)>>('vk_get_capabilities')
+      .asFunction<int Function(Pointer<Uint32>)>();
+  
+  /// Process image with a versioned parameter struct
+  late final vk_process_image_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Uint8>,  // input pixels
+        Int32,           // width
+        Int32,           // height
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Pointer<Pointer<Uint8>>, // output pixels
+        Pointer<Int32>,  // output_width
+        Pointer<Int32>,  // output_height
+      )>>('vk_process_image_params')
+      .asFunction<int Function(
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Int32>,
+        Pointer<Int32>,
+      )>();
+  
+  /// Process a tiled image tile by tile with a versioned parameter struct
+  late final vk_process_tiled_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<NativeTiledImage>,  // source (RGB)
+        Pointer<NativeTiledImage>,  // destination (RGBA)
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+      )>>('vk_process_tiled_params')
+      .asFunction<int Function(
+        Pointer<NativeTiledImage>,
+        Pointer<NativeTiledImage>,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+      )>();
+  
+  /// Process a tiled image on the GPU and the CPU kernel together
+  late final vk_process_tiled_hybrid_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<NativeTiledImage>,  // source (RGB)
+        Pointer<NativeTiledImage>,  // destination (RGBA)
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Int32,           // cpu_threads
+      )>>('vk_process_tiled_hybrid_params')
+      .asFunction<int Function(
+        Pointer<NativeTiledImage>,
+        Pointer<NativeTiledImage>,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        int,
+      )>();
+  
+  /// Upload an image to stay resident on the GPU
+  late final vk_resident_upload = _lib
+      .lookup<NativeFunction<Int32 Function(Uint64, Pointer<Uint8>, Int32, Int32)>>('vk_resident_upload')
+      .asFunction<int Function(int, Pointer<Uint8>, int, int)>();
+  
+  /// Check whether an image is resident
+  late final vk_resident_contains = _lib
+      .lookup<NativeFunction<Int32 Function(Uint64)>>('vk_resident_contains')
+      .asFunction<int Function(int)>();
+  
+  /// Process a resident image with a versioned parameter struct
+  late final vk_process_resident_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Uint64,          // image id
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Pointer<Pointer<Uint8>>, // output pixels
+        Pointer<Int32>,  // output_width
+        Pointer<Int32>,  // output_height
+      )>>('vk_process_resident_params')
+      .asFunction<int Function(
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Int32>,
+        Pointer<Int32>,
+      )>();
+  
+  /// Evict one resident image
+  late final vk_resident_evict = _lib
+      .lookup<NativeFunction<Void Function(Uint64)>>('vk_resident_evict')
+      .asFunction<void Function(int)>();
+  
+  /// Evict all resident images
+  late final vk_resident_clear = _lib
+      .lookup<NativeFunction<Void Function()>>('vk_resident_clear')
+      .asFunction<void Function()>();
+  
+  /// Process an image and encode it as JPEG
+  late final vk_encode_jpeg_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Uint8>,  // input pixels
+        Int32,           // width
+        Int32,           // height
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Int32,           // quality
+        Int32,           // subsampling
+        Pointer<Pointer<Uint8>>, // jpeg data
+        Pointer<Size>,   // jpeg size
+      )>>('vk_encode_jpeg_params')
+      .asFunction<int Function(
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Size>,
+      )>();
+  
+  /// Create a context for one caller
+  late final vk_context_create = _lib
+      .lookup<NativeFunction<Pointer<Void> Function(Int32)>>('vk_context_create')
+      .asFunction<Pointer<Void> Function(int)>();
+  
+  /// Destroy a context
+  late final vk_context_destroy = _lib
+      .lookup<NativeFunction<Void Function(Pointer<Void>)>>('vk_context_destroy')
+      .asFunction<void Function(Pointer<Void>)>();
+  
+  /// vk_process_image_params on a context
+  late final vk_context_process_image_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Void>,   // context
+        Pointer<Uint8>,  // input pixels
+        Int32,           // width
+        Int32,           // height
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Pointer<Pointer<Uint8>>, // output pixels
+        Pointer<Int32>,  // output_width
+        Pointer<Int32>,  // output_height
+      )>>('vk_context_process_image_params')
+      .asFunction<int Function(
+        Pointer<Void>,
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Int32>,
+        Pointer<Int32>,
+      )>();
+  
+  /// vk_process_tiled_params on a context
+  late final vk_context_process_tiled_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Void>,   // context
+        Pointer<NativeTiledImage>,  // source (RGB)
+        Pointer<NativeTiledImage>,  // destination (RGBA)
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+      )>>('vk_context_process_tiled_params')
+      .asFunction<int Function(
+        Pointer<Void>,
+        Pointer<NativeTiledImage>,
+        Pointer<NativeTiledImage>,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+      )>();
+  
+  /// vk_process_tiled_hybrid_params on a context
+  late final vk_context_process_tiled_hybrid_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Void>,   // context
+        Pointer<NativeTiledImage>,  // source (RGB)
+        Pointer<NativeTiledImage>,  // destination (RGBA)
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Int32,           // cpu_threads
+      )>>('vk_context_process_tiled_hybrid_params')
+      .asFunction<int Function(
+        Pointer<Void>,
+        Pointer<NativeTiledImage>,
+        Pointer<NativeTiledImage>,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        int,
+      )>();
+  
+  /// vk_resident_upload on a context
+  late final vk_context_resident_upload = _lib
+      .lookup<NativeFunction<Int32 Function(Pointer<Void>, Uint64, Pointer<Uint8>, Int32, Int32)>>(
+          'vk_context_resident_upload')
+      .asFunction<int Function(Pointer<Void>, int, Pointer<Uint8>, int, int)>();
+  
+  /// vk_process_resident_params on a context
+  late final vk_context_process_resident_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Void>,   // context
+        Uint64,          // image id
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Pointer<Pointer<Uint8>>, // output pixels
+        Pointer<Int32>,  // output_width
+        Pointer<Int32>,  // output_height
+      )>>('vk_context_process_resident_params')
+      .asFunction<int Function(
+        Pointer<Void>,
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Int32>,
+        Pointer<Int32>,
+      )>();
+  
+  /// vk_encode_jpeg_params on a context
+  late final vk_context_encode_jpeg_params = _lib
+      .lookup<NativeFunction<Int32 Function(
+        Pointer<Void>,   // context
+        Pointer<Uint8>,  // input pixels
+        Int32,           // width
+        Int32,           // height
+        Pointer<AdjustmentParams>,  // params
+        Pointer<Uint8>,  // rgb_lut
+        Pointer<Uint8>,  // red_lut
+        Pointer<Uint8>,  // green_lut
+        Pointer<Uint8>,  // blue_lut
+        Int32,           // quality
+        Int32,           // subsampling
+        Pointer<Pointer<Uint8>>, // jpeg data
+        Pointer<Size>,   // jpeg size
+      )>>('vk_context_encode_jpeg_params')
+      .asFunction<int Function(
+        Pointer<Void>,
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<AdjustmentParams>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        Pointer<Uint8>,
+        int,
+        int,
+        Pointer<Pointer<Uint8>>,
+        Pointer<Size>,
+      )>();
+  
   /// Free allocated buffer
   late final vk_free_buffer = _lib
       .lookup<NativeFunction<Void Function(Pointer<Uint8>)>>('vk_free_buffer')
@@ -1,10 +1,16 @@
+import 'dart:ffi';
 import 'dart:typed_data';
 import 'dart:io';
+import 'dart:isolate';
 import 'dart:ui' as ui;
+import 'package:ffi/ffi.dart';
+import '../../ffi/common/adjustment_params.dart';
+import '../../ffi/raw/raw_batch_bindings.dart';
 import '../../models/adjustments.dart';
 import '../../models/edit_pipeline.dart';
 import '../../models/crop_state.dart';
 import '../image_processor.dart';
+import '../lut_library.dart';
 import 'image_processor_interface.dart';
 import 'vulkan/vulkan_bindings.dart';
 import 'cpu_processor.dart';
@@ -14,6 +20,11 @@ class VulkanProcessor extends BaseImageProcessor {
   static bool? _isAvailable;
   bool _initialized = false;
   
+  /// Ids of source buffers kept resident on the GPU, so re-rendering the same
+  /// image (or switching back to it) skips the upload
+  static final Expando<int> _residentIds = Expando('vulkanResidentId');
+  static int _nextResidentId = 1;
+  
   @override
   String get name => 'Vulkan GPU Processor';
   
@@ -47,96 +58,26 @@ class VulkanProcessor extends BaseImageProcessor {
       await initialize();
     }
     
-    // Check if we have a crop to apply
-    final hasCrop = pipeline.cropRect != null && 
-        (pipeline.cropRect!.left != 0 || pipeline.cropRect!.top != 0 || 
-         pipeline.cropRect!.right != 1 || pipeline.cropRect!.bottom != 1);
+    final result = _process(
+      rawData.pixels,
+      rawData.width,
+      rawData.height,
+      pipeline.adjustments.toList(),
+      pipeline.cropRect,
+      residentId: _residentIds[rawData.pixels] ??= _nextResidentId++,
+    );
     
-    // If we have crop, use the GPU cropping version
-    if (hasCrop) {
-      // Generate tone curve LUTs if present
-      Uint8List? rgbLut;
-      Uint8List? redLut;
-      Uint8List? greenLut;
-      Uint8List? blueLut;
-      
-      // Check for tone curve adjustments
-      for (final adjustment in pipeline.adjustments) {
-        if (adjustment is ToneCurveAdjustment) {
-          rgbLut = _generateCurveLookupTable(adjustment.rgbCurve);
-          redLut = _generateCurveLookupTable(adjustment.redCurve);
-          greenLut = _generateCurveLookupTable(adjustment.greenCurve);
-          blueLut = _generateCurveLookupTable(adjustment.blueCurve);
-          break;
-        }
-      }
-      
-      // Pack adjustments with crop parameters
-      final packedAdjustments = _packAdjustmentsWithCrop(
-        pipeline.adjustments.toList(), 
-        pipeline.cropRect!,
-        rawData.width.toDouble(),
-        rawData.height.toDouble(),
-        hasToneCurves: rgbLut != null,
-      );
-      
-      // Process on GPU with cropping
-      print('VulkanProcessor: Processing with crop: ${pipeline.cropRect!.left}, ${pipeline.cropRect!.top}, ${pipeline.cropRect!.right}, ${pipeline.cropRect!.bottom}');
-      print('VulkanProcessor: Input dimensions: ${rawData.width}x${rawData.height}');
-      
-      final result = VulkanBindings.processImageWithCrop(
-        Uint8List.fromList(rawData.pixels),
-        rawData.width,
-        rawData.height,
-        packedAdjustments,
-        pipeline.cropRect!.left,
-        pipeline.cropRect!.top,
-        pipeline.cropRect!.right,
-        pipeline.cropRect!.bottom,
-        rgbLut: rgbLut,
-        redLut: redLut,
-        greenLut: greenLut,
-        blueLut: blueLut,
-      );
-      
-      if (result == null) {
-        throw Exception('Vulkan processing with crop failed');
-      }
-      
-      print('VulkanProcessor: Output dimensions: ${result.width}x${result.height}');
-      
-      // Convert to Flutter image
-      final buffer = await ui.ImmutableBuffer.fromUint8List(result.pixels);
-      final descriptor = ui.ImageDescriptor.raw(
-        buffer,
-        width: result.width,
-        height: result.height,
-        pixelFormat: ui.PixelFormat.rgba8888,
-      );
-      final codec = await descriptor.instantiateCodec();
-      final frameInfo = await codec.getNextFrame();
-      return frameInfo.image;
-    } else {
-      // No crop, use regular processing
-      final processedPixels = await processPixels(
-        Uint8List.fromList(rawData.pixels),
-        rawData.width,
-        rawData.height,
-        pipeline.adjustments.toList(),
-      );
-      
-      // Convert to Flutter image
-      final buffer = await ui.ImmutableBuffer.fromUint8List(processedPixels);
-      final descriptor = ui.ImageDescriptor.raw(
-        buffer,
-        width: rawData.width,
-        height: rawData.height,
-        pixelFormat: ui.PixelFormat.rgba8888,
-      );
-      final codec = await descriptor.instantiateCodec();
-      final frameInfo = await codec.getNextFrame();
-      return frameInfo.image;
-    }
+    // Convert to Flutter image
+    final buffer = await ui.ImmutableBuffer.fromUint8List(result.pixels);
+    final descriptor = ui.ImageDescriptor.raw(
+      buffer,
+      width: result.width,
+      height: result.height,
+      pixelFormat: ui.PixelFormat.rgba8888,
+    );
+    final codec = await descriptor.instantiateCodec();
+    final frameInfo = await codec.getNextFrame();
+    return frameInfo.image;
   }
   
   @override
@@ -146,47 +87,147 @@ class VulkanProcessor extends BaseImageProcessor {
     int height,
     List<Adjustment> adjustments,
   ) async {
-    // Generate tone curve LUTs if present
-    Uint8List? rgbLut;
-    Uint8List? redLut;
-    Uint8List? greenLut;
-    Uint8List? blueLut;
+    return _process(pixels, width, height, adjustments, null).pixels;
+  }
+  
+  /// Process [rawData] and encode it as JPEG on the GPU. Returns null if the
+  /// GPU encoder is unavailable.
+  Future<Uint8List?> encodeJpeg(
+    RawPixelData rawData,
+    EditPipeline pipeline,
+    {int quality = 90,
+     int subsampling = JpegSubsampling.s420}
+  ) async {
+    if (!_initialized) {
+      await initialize();
+    }
+    
+    final adjustments = pipeline.adjustments.toList();
+    final luts = _curveLuts(adjustments);
+    final params = calloc<AdjustmentParams>();
+    final pixels = malloc<Uint8>(rawData.pixels.length);
+    try {
+      fillParams(params.ref, adjustments, cropRect: pipeline.cropRect, hasToneCurves: luts != null);
+      pixels.asTypedList(rawData.pixels.length).setAll(0, rawData.pixels);
+      
+      final pixelsAddress = pixels.address;
+      final paramsAddress = params.address;
+      final width = rawData.width;
+      final height = rawData.height;
+      return await Isolate.run(() => _encodeJpeg(
+            pixelsAddress,
+            width,
+            height,
+            paramsAddress,
+            luts,
+            quality,
+            subsampling,
+          ));
+    } finally {
+      malloc.free(pixels);
+      calloc.free(params);
+    }
+  }
+  
+  /// Runs on a background isolate with a batch context of its own, so the
+  /// UI isolate keeps rendering previews on the default context meanwhile
+  static Uint8List? _encodeJpeg(int pixelsAddress, int width, int height,
+      int paramsAddress, List<Uint8List>? luts, int quality, int subsampling) {
+    if (!VulkanBindings.initialize()) return null;
     
-    // Check for tone curve adjustments
+    final context = VulkanContext.create(jobClass: JobClass.batch);
+    try {
+      return VulkanBindings.encodeJpeg(
+        Pointer<Uint8>.fromAddress(pixelsAddress),
+        width,
+        height,
+        Pointer<AdjustmentParams>.fromAddress(paramsAddress),
+        rgbLut: luts?[0],
+        redLut: luts?[1],
+        greenLut: luts?[2],
+        blueLut: luts?[3],
+        quality: quality,
+        subsampling: subsampling,
+        context: context,
+      );
+    } finally {
+      context?.dispose();
+    }
+  }
+  
+  /// RGB, red, green and blue LUTs of the first tone curve, if any
+  static List<Uint8List>? _curveLuts(List<Adjustment> adjustments) {
     for (final adjustment in adjustments) {
       if (adjustment is ToneCurveAdjustment) {
-        rgbLut = _generateCurveLookupTable(adjustment.rgbCurve);
-        redLut = _generateCurveLookupTable(adjustment.redCurve);
-        greenLut = _generateCurveLookupTable(adjustment.greenCurve);
-        blueLut = _generateCurveLookupTable(adjustment.blueCurve);
-        break;
+        return [
+          generateCurveLookupTable(adjustment.rgbCurve),
+          generateCurveLookupTable(adjustment.redCurve),
+          generateCurveLookupTable(adjustment.greenCurve),
+          generateCurveLookupTable(adjustment.blueCurve),
+        ];
       }
     }
+    return null;
+  }
+  
+  ProcessedImageData _process(
+    Uint8List pixels,
+    int width,
+    int height,
+    List<Adjustment> adjustments,
+    CropRect? cropRect,
+    {int? residentId}
+  ) {
+    // Generate tone curve LUTs if present
+    final luts = _curveLuts(adjustments);
+    final rgbLut = luts?[0];
+    final redLut = luts?[1];
+    final greenLut = luts?[2];
+    final blueLut = luts?[3];
     
-    // Pack adjustments into a float array for GPU
-    final packedAdjustments = _packAdjustments(adjustments, hasToneCurves: rgbLut != null);
-    
-    // Process on GPU with tone curves
-    final result = VulkanBindings.processImage(
-      pixels,
-      width,
-      height,
-      packedAdjustments,
-      rgbLut: rgbLut,
-      redLut: redLut,
-      greenLut: greenLut,
-      blueLut: blueLut,
-    );
-    
-    if (result == null) {
-      throw Exception('Vulkan processing failed');
+    final params = calloc<AdjustmentParams>();
+    try {
+      fillParams(params.ref, adjustments, cropRect: cropRect, hasToneCurves: rgbLut != null);
+      
+      // Process on GPU; the crop in params selects the output region.
+      // Resident sources are used in place, anything that doesn't fit the
+      // VRAM budget is uploaded for this call only.
+      ProcessedImageData? result;
+      if (residentId != null &&
+          (VulkanBindings.isResident(residentId) ||
+           VulkanBindings.uploadResident(residentId, pixels, width, height))) {
+        result = VulkanBindings.processResident(
+          residentId,
+          params,
+          rgbLut: rgbLut,
+          redLut: redLut,
+          greenLut: greenLut,
+          blueLut: blueLut,
+        );
+      }
+      result ??= VulkanBindings.processImage(
+        pixels,
+        width,
+        height,
+        params,
+        rgbLut: rgbLut,
+        redLut: redLut,
+        greenLut: greenLut,
+        blueLut: blueLut,
+      );
+      
+      if (result == null) {
+        throw Exception('Vulkan processing failed');
+      }
+      
+      return result;
+    } finally {
+      calloc.free(params);
     }
-    
-    return result;
   }
   
   /// Generate tone curve lookup table from control points
-  static Uint8List _generateCurveLookupTable(List<CurvePoint> points) {
+  static Uint8List generateCurveLookupTable(List<CurvePoint> points) {
     final lut = Uint8List(256);
     
     // Handle empty or insufficient points - return identity
@@ -245,128 +286,52 @@ class VulkanProcessor extends BaseImageProcessor {
     return lut;
   }
   
-  /// Pack adjustments into a float array for shader uniforms
-  Float32List _packAdjustments(List<Adjustment> adjustments, {bool hasToneCurves = false}) {
-    // Pack adjustment parameters to match shader uniform structure
-    // The C code expects exactly these parameters in this order:
-    // temperature, tint, exposure, contrast, highlights, shadows,
-    // blacks, whites, saturation, vibrance, toneCurveEnabled, padding[3]
-    
-    double temperature = 5500.0;  // Default neutral temperature
-    double tint = 0.0;
-    double exposure = 0.0;
-    double contrast = 0.0;
-    double highlights = 0.0;
-    double shadows = 0.0;
-    double blacks = 0.0;
-    double whites = 0.0;
-    double saturation = 0.0;
-    double vibrance = 0.0;
-    
-    // Extract values from adjustments
-    for (final adjustment in adjustments) {
-      if (adjustment is WhiteBalanceAdjustment) {
-        temperature = adjustment.temperature;
-        tint = adjustment.tint;
-      } else if (adjustment is ExposureAdjustment) {
-        exposure = adjustment.value;
-      } else if (adjustment is ContrastAdjustment) {
-        contrast = adjustment.value;
-      } else if (adjustment is HighlightsShadowsAdjustment) {
-        highlights = adjustment.highlights;
-        shadows = adjustment.shadows;
-      } else if (adjustment is BlacksWhitesAdjustment) {
-        blacks = adjustment.blacks;
-        whites = adjustment.whites;
-      } else if (adjustment is SaturationVibranceAdjustment) {
-        saturation = adjustment.saturation;
-        vibrance = adjustment.vibrance;
-      }
-    }
-    
-    // Pack into array matching shader uniform structure (must be 16 floats)
-    return Float32List.fromList([
-      temperature,
-      tint,
-      exposure,
-      contrast,
-      highlights,
-      shadows,
-      blacks,
-      whites,
-      saturation,
-      vibrance,
-      hasToneCurves ? 1.0 : 0.0,  // toneCurveEnabled
-      0.0,  // padding
-      0.0,  // padding
-      0.0,  // padding
-      0.0,  // padding
-      0.0,  // padding to make 16 floats (64 bytes)
-    ]);
-  }
-  
-  /// Pack adjustments with crop parameters for GPU processing
-  Float32List _packAdjustmentsWithCrop(
+  /// Fill the parameter struct shared with the native engines
+  static void fillParams(
+    AdjustmentParams params,
     List<Adjustment> adjustments,
-    CropRect cropRect,
-    double imageWidth,
-    double imageHeight,
-    {bool hasToneCurves = false}
+    {CropRect? cropRect,
+     bool hasToneCurves = false}
   ) {
-    // Pack adjustment parameters to match shader uniform structure with crop
-    double temperature = 5500.0;  // Default neutral temperature
-    double tint = 0.0;
-    double exposure = 0.0;
-    double contrast = 0.0;
-    double highlights = 0.0;
-    double shadows = 0.0;
-    double blacks = 0.0;
-    double whites = 0.0;
-    double saturation = 0.0;
-    double vibrance = 0.0;
+    params.reset();
     
-    // Extract values from adjustments
     for (final adjustment in adjustments) {
       if (adjustment is WhiteBalanceAdjustment) {
-        temperature = adjustment.temperature;
-        tint = adjustment.tint;
+        params.temperature = adjustment.temperature;
+        params.tint = adjustment.tint;
       } else if (adjustment is ExposureAdjustment) {
-        exposure = adjustment.value;
+        params.exposure = adjustment.value;
       } else if (adjustment is ContrastAdjustment) {
-        contrast = adjustment.value;
+        params.contrast = adjustment.value;
       } else if (adjustment is HighlightsShadowsAdjustment) {
-        highlights = adjustment.highlights;
-        shadows = adjustment.shadows;
+        params.highlights = adjustment.highlights;
+        params.shadows = adjustment.shadows;
       } else if (adjustment is BlacksWhitesAdjustment) {
-        blacks = adjustment.blacks;
-        whites = adjustment.whites;
+        params.blacks = adjustment.blacks;
+        params.whites = adjustment.whites;
       } else if (adjustment is SaturationVibranceAdjustment) {
-        saturation = adjustment.saturation;
-        vibrance = adjustment.vibrance;
+        params.saturation = adjustment.saturation;
+        params.vibrance = adjustment.vibrance;
+      } else if (adjustment is LutAdjustment) {
+        final lut = LutLibrary.resolve(adjustment);
+        if (lut != null) {
+          params.stages |= AdjustmentStage.lut3d;
+          params.lutId = lut.id;
+          params.lutOpacity = lut.opacity;
+        }
       }
     }
     
-    // Pack into array matching shader uniform structure with crop (18 floats)
-    return Float32List.fromList([
-      temperature,
-      tint,
-      exposure,
-      contrast,
-      highlights,
-      shadows,
-      blacks,
-      whites,
-      saturation,
-      vibrance,
-      hasToneCurves ? 1.0 : 0.0,  // toneCurveEnabled
-      imageWidth,
-      imageHeight,
-      0.0,  // padding
-      cropRect.left,
-      cropRect.top,
-      cropRect.right,
-      cropRect.bottom,
-    ]);
+    if (hasToneCurves) {
+      params.stages |= AdjustmentStage.toneCurve;
+    }
+    
+    if (cropRect != null) {
+      params.cropLeft = cropRect.left;
+      params.cropTop = cropRect.top;
+      params.cropRight = cropRect.right;
+      params.cropBottom = cropRect.bottom;
+    }
   }
   
   @override
@@ -0,0 +1,326 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../ffi/async/native_async.dart';
+import '../ffi/async/native_async_bindings.dart';
+import '../ffi/raw/raw_batch_bindings.dart';
+import 'image_processor.dart';
+import 'raw_processor.dart';
+
+/// One decoded file from a batch
+class RawBatchImage {
+  final int index;          // Position in the requested path list
+  final String path;
+  final RawPixelData? data; // null when the file failed
+  final String? error;
+
+  RawBatchImage({
+    required this.index,
+    required this.path,
+    this.data,
+    this.error,
+  });
+}
+
+/// Decodes many RAW files at once for imports, thumbnails and culling.
+///
+/// The native side keeps several files reading ahead (io_uring, or a pread
+/// thread pool when io_uring is unavailable) into a bounded buffer pool and
+/// hands finished buffers to LibRaw workers, so disk and CPU stay busy
+/// together. Results arrive in completion order, not request order.
+///
+/// When libnative_async is available, results are posted from native threads
+/// straight to a ReceivePort with the pixels as external typed data, so there
+/// is no isolate and no copy. Otherwise a worker isolate polls the batch.
+class RawBatchDecoder {
+  /// How long the worker isolate waits on the native queue per poll
+  static const int _pollTimeoutMs = 100;
+
+  /// Decode [paths] in the background. Cancel the subscription to stop the
+  /// batch; files already in flight are dropped. [jobClass] is how the
+  /// native scheduler ranks the decodes against other work.
+  static Stream<RawBatchImage> decode(
+    List<String> paths, {
+    bool halfSize = false,
+    int filesInFlight = 0,
+    int decodeThreads = 0,
+    int bufferBudget = 0,
+    int jobClass = JobClass.batch,
+  }) {
+    final request = _BatchRequest(
+      paths: paths,
+      halfSize: halfSize,
+      filesInFlight: filesInFlight,
+      decodeThreads: decodeThreads,
+      bufferBudget: bufferBudget,
+      jobClass: jobClass,
+    );
+    if (NativeAsync.isAvailable) {
+      return _decodeWithPorts(request);
+    }
+    return _decodeInIsolate(request);
+  }
+
+  static Stream<RawBatchImage> _decodeWithPorts(_BatchRequest request) {
+    late StreamController<RawBatchImage> controller;
+    final port = ReceivePort();
+    final requestId = NativeAsync.nextRequestId();
+    Pointer<NativeRawBatchAsync> handle = nullptr;
+
+    void finish() {
+      if (handle != nullptr) {
+        NativeAsync.bindings.rawBatchAsyncRelease(handle);
+        handle = nullptr;
+      }
+      port.close();
+    }
+
+    controller = StreamController<RawBatchImage>(
+      onListen: () {
+        if (request.paths.isEmpty) {
+          port.close();
+          controller.close();
+          return;
+        }
+
+        port.listen((message) {
+          final fields = message as List<Object?>;
+          if (fields[0] != requestId) return;
+          final index = fields[1] as int;
+          if (index == nativeAsyncDoneIndex) {
+            finish();
+            controller.close();
+            return;
+          }
+
+          final status = fields[2] as int;
+          controller.add(RawBatchImage(
+            index: index,
+            path: request.paths[index],
+            data: status == 0
+                ? RawPixelData(
+                    pixels: fields[5] as Uint8List,
+                    width: fields[3] as int,
+                    height: fields[4] as int,
+                  )
+                : null,
+            error: status == 0 ? null : fields[3] as String,
+          ));
+        });
+
+        final pathPtrs = calloc<Pointer<Utf8>>(request.paths.length);
+        final options = calloc<RawBatchOptions>();
+        try {
+          for (int i = 0; i < request.paths.length; i++) {
+            pathPtrs[i] = request.paths[i].toNativeUtf8();
+          }
+          request.fillOptions(options.ref);
+
+          // Paths are copied on the native side
+          handle = NativeAsync.bindings.rawBatchStartAsync(
+              pathPtrs, request.paths.length, options, port.sendPort.nativePort, requestId);
+          if (handle == nullptr) {
+            port.close();
+            controller.addError(Exception('Failed to start batch decode'));
+            controller.close();
+          }
+        } finally {
+          for (int i = 0; i < request.paths.length; i++) {
+            if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+          }
+          calloc.free(pathPtrs);
+          calloc.free(options);
+        }
+      },
+      onCancel: () {
+        if (handle != nullptr) {
+          NativeAsync.bindings.rawBatchAsyncCancel(handle);
+        }
+        finish();
+      },
+    );
+
+    return controller.stream;
+  }
+
+  static Stream<RawBatchImage> _decodeInIsolate(_BatchRequest request) {
+    final paths = request.paths;
+    late StreamController<RawBatchImage> controller;
+    ReceivePort? receivePort;
+    SendPort? commandPort;
+
+    controller = StreamController<RawBatchImage>(
+      onListen: () async {
+        if (paths.isEmpty) {
+          await controller.close();
+          return;
+        }
+
+        final port = ReceivePort();
+        receivePort = port;
+        port.listen((message) {
+          if (message is SendPort) {
+            commandPort = message;
+          } else if (message is _BatchMessage) {
+            final pixels = message.pixels?.materialize().asUint8List();
+            controller.add(RawBatchImage(
+              index: message.index,
+              path: paths[message.index],
+              data: pixels != null
+                  ? RawPixelData(pixels: pixels, width: message.width, height: message.height)
+                  : null,
+              error: message.error,
+            ));
+          } else if (message == null) {
+            port.close();
+            controller.close();
+          }
+        });
+
+        try {
+          await Isolate.spawn(
+            _decodeEntryPoint,
+            (request, port.sendPort),
+            onExit: port.sendPort,
+          );
+        } catch (e) {
+          port.close();
+          controller.addError(e);
+          await controller.close();
+        }
+      },
+      onCancel: () {
+        commandPort?.send('cancel');
+        receivePort?.close();
+        receivePort = null;
+      },
+    );
+
+    return controller.stream;
+  }
+
+  static Future<void> _decodeEntryPoint((_BatchRequest, SendPort) args) async {
+    final (request, replyPort) = args;
+    final commands = ReceivePort();
+    replyPort.send(commands.sendPort);
+
+    var cancelled = false;
+    commands.listen((message) {
+      if (message == 'cancel') cancelled = true;
+    });
+
+    final bindings = RawProcessor.batchBindings;
+    final pathPtrs = calloc<Pointer<Utf8>>(request.paths.length);
+    final options = calloc<RawBatchOptions>();
+    Pointer<NativeRawBatch> batch = nullptr;
+
+    try {
+      for (int i = 0; i < request.paths.length; i++) {
+        pathPtrs[i] = request.paths[i].toNativeUtf8();
+      }
+
+      request.fillOptions(options.ref);
+
+      batch = bindings.rawBatchStart(pathPtrs, request.paths.length, options);
+      if (batch == nullptr) {
+        throw Exception('Failed to start batch decode');
+      }
+
+      while (!cancelled && !bindings.rawBatchIsDone(batch)) {
+        final result = bindings.rawBatchNext(batch, _pollTimeoutMs);
+        if (result != nullptr) {
+          final ref = result.ref;
+          if (ref.status == 0) {
+            replyPort.send(_BatchMessage(
+              index: ref.index,
+              width: ref.width,
+              height: ref.height,
+              pixels: TransferableTypedData.fromList([ref.data.asTypedList(ref.size)]),
+            ));
+          } else {
+            replyPort.send(_BatchMessage(
+              index: ref.index,
+              error: _readError(ref),
+            ));
+          }
+          bindings.rawBatchFreeResult(result);
+        }
+
+        // Let the cancel message through
+        await Future<void>.delayed(Duration.zero);
+      }
+    } finally {
+      if (batch != nullptr) {
+        final stats = calloc<RawBatchStats>();
+        bindings.rawBatchGetStats(batch, stats);
+        final backend = stats.ref.backend == RawBatchBackend.ioUring ? 'io_uring' : 'pread';
+        print('Batch decode ($backend): ${stats.ref.filesDecoded}/${request.paths.length} files, '
+            '${(stats.ref.bytesRead / (1024 * 1024)).toStringAsFixed(1)} MB read');
+        calloc.free(stats);
+        bindings.rawBatchDestroy(batch);
+      }
+      for (int i = 0; i < request.paths.length; i++) {
+        if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+      }
+      calloc.free(pathPtrs);
+      calloc.free(options);
+      commands.close();
+    }
+  }
+
+  static String _readError(RawBatchResult result) {
+    final bytes = <int>[];
+    for (int i = 0; i < 128; i++) {
+      final c = result.error[i];
+      if (c == 0) break;
+      bytes.add(c);
+    }
+    return String.fromCharCodes(bytes);
+  }
+}
+
+class _BatchRequest {
+  final List<String> paths;
+  final bool halfSize;
+  final int filesInFlight;
+  final int decodeThreads;
+  final int bufferBudget;
+  final int jobClass;
+
+  _BatchRequest({
+    required this.paths,
+    required this.halfSize,
+    required this.filesInFlight,
+    required this.decodeThreads,
+    required this.bufferBudget,
+    required this.jobClass,
+  });
+
+  /// Zero fields keep the native defaults (see raw_batch_default_options)
+  void fillOptions(RawBatchOptions options) {
+    options.filesInFlight = filesInFlight;
+    options.decodeThreads = decodeThreads;
+    options.backend = RawBatchBackend.auto;
+    options.halfSize = halfSize ? 1 : 0;
+    options.bufferBudget = bufferBudget;
+    options.jobClass = jobClass;
+  }
+}
+
+class _BatchMessage {
+  final int index;
+  final int width;
+  final int height;
+  final TransferableTypedData? pixels;
+  final String? error;
+
+  _BatchMessage({
+    required this.index,
+    this.width = 0,
+    this.height = 0,
+    this.pixels,
+    this.error,
+  });
+}
@@ -0,0 +1,131 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:isolate';
+import 'package:ffi/ffi.dart';
+import '../ffi/raw/raw_batch_bindings.dart';
+import '../ffi/raw/raw_cull_bindings.dart';
+import 'raw_processor.dart';
+
+/// Focus and exposure scores of one file
+class CullScore {
+  final int index;              // Position in the requested path list
+  final String path;
+  final bool fromPreview;       // false when a half-size decode was scored
+  final double sharpness;       // Variance of the Laplacian over the frame
+  final double peakSharpness;   // Sharpest region, catches subjects on soft backgrounds
+  final double tenengrad;
+  final double meanLuma;        // 0-1
+  final double shadowsClipped;  // Fractions of the frame
+  final double highlightsClipped;
+  final String? error;
+
+  CullScore({
+    required this.index,
+    required this.path,
+    this.fromPreview = false,
+    this.sharpness = 0,
+    this.peakSharpness = 0,
+    this.tenengrad = 0,
+    this.meanLuma = 0,
+    this.shadowsClipped = 0,
+    this.highlightsClipped = 0,
+    this.error,
+  });
+
+  bool get isValid => error == null;
+
+  /// Likely out of focus or shaken, relative to the sharpest file of the
+  /// set. Scores only compare well within a shoot, not across scenes.
+  bool isBlurry(double referenceSharpness, {double ratio = 0.2}) =>
+      isValid && peakSharpness < referenceSharpness * ratio;
+}
+
+/// Scores whole folders for culling. Files are scored from their embedded
+/// previews when those are large enough, so a thousand files take seconds
+/// rather than the minutes full decodes would.
+class RawCuller {
+  /// Files per native call. Results stream back per chunk and cancelling
+  /// stops before the next one.
+  static const int chunkSize = 64;
+
+  static Stream<CullScore> score(
+    List<String> paths, {
+    int analysisSize = 0,
+    int threads = 0,
+    int jobClass = JobClass.batch,
+  }) async* {
+    RawProcessor.initialize();
+    for (int start = 0; start < paths.length; start += chunkSize) {
+      final chunk = paths.sublist(start, (start + chunkSize).clamp(0, paths.length));
+      final scores = await Isolate.run(
+          () => _scoreChunk(chunk, start, analysisSize, threads, jobClass));
+      for (final score in scores) {
+        yield score;
+      }
+    }
+  }
+
+  /// Scores for every path, in path order
+  static Future<List<CullScore>> scoreAll(List<String> paths, {int threads = 0}) {
+    return score(paths, threads: threads).toList();
+  }
+
+  static List<CullScore> _scoreChunk(
+      List<String> paths, int offset, int analysisSize, int threads, int jobClass) {
+    final bindings = RawProcessor.cullBindings;
+    final pathPtrs = calloc<Pointer<Utf8>>(paths.length);
+    final options = calloc<RawCullOptions>();
+    final scores = calloc<RawCullScore>(paths.length);
+    try {
+      for (int i = 0; i < paths.length; i++) {
+        pathPtrs[i] = paths[i].toNativeUtf8();
+      }
+      bindings.rawCullDefaultOptions(options);
+      options.ref
+        ..analysisSize = analysisSize
+        ..threads = threads
+        ..jobClass = jobClass;
+
+      bindings.rawCullRun(pathPtrs, paths.length, options, scores);
+
+      return List.generate(paths.length, (i) {
+        final score = scores[i];
+        if (score.status != 0) {
+          return CullScore(
+            index: offset + i,
+            path: paths[i],
+            error: _readError(score),
+          );
+        }
+        return CullScore(
+          index: offset + i,
+          path: paths[i],
+          fromPreview: score.source == RawCullSource.preview,
+          sharpness: score.sharpness,
+          peakSharpness: score.peakSharpness,
+          tenengrad: score.tenengrad,
+          meanLuma: score.meanLuma,
+          shadowsClipped: score.shadowsClipped,
+          highlightsClipped: score.highlightsClipped,
+        );
+      });
+    } finally {
+      for (int i = 0; i < paths.length; i++) {
+        if (pathPtrs[i] != nullptr) calloc.free(pathPtrs[i]);
+      }
+      calloc.free(pathPtrs);
+      calloc.free(options);
+      calloc.free(scores);
+    }
+  }
+
+  static String _readError(RawCullScore score) {
+    final codes = <int>[];
+    for (int i = 0; i < 128; i++) {
+      final c = score.error[i];
+      if (c == 0) break;
+      codes.add(c);
+    }
+    return codes.isEmpty ? 'error ${score.status}' : String.fromCharCodes(codes);
+  }
+}
@@ -1,13 +1,30 @@
 import 'dart:ffi';
 import 'dart:io';
+import 'dart:isolate';
 import 'dart:typed_data';
 import 'dart:ui' as ui;
 import 'package:ffi/ffi.dart';
+import '../ffi/async/native_async.dart';
+import '../ffi/raw/dng_tiles_bindings.dart';
 import '../ffi/raw/libraw_bindings.dart';
+import '../ffi/raw/raw_batch_bindings.dart';
+import '../ffi/raw/raw_cull_bindings.dart';
+import '../ffi/raw/raw_hash_bindings.dart';
+import '../ffi/raw/raw_tiled_bindings.dart';
+import '../ffi/raw/smart_preview_bindings.dart';
+import '../ffi/tiles/tiled_image.dart';
+import '../ffi/tiles/tiled_image_bindings.dart';
 import 'image_processor.dart' as img_proc;
+import 'raw_batch_decoder.dart';
 
 class RawProcessor {
   static late LibRawBindings _bindings;
+  static late RawTiledBindings _tiledBindings;
+  static late SmartPreviewBindings _smartPreviewBindings;
+  static late RawBatchBindings _batchBindings;
+  static late RawCullBindings _cullBindings;
+  static late RawHashBindings _hashBindings;
+  static late DngTilesBindings _dngTilesBindings;
   static bool _initialized = false;
 
   static void initialize() {
@@ -38,6 +55,12 @@ class RawProcessor {
       try {
         final dylib = DynamicLibrary.open(path);
         _bindings = LibRawBindings(dylib);
+        _tiledBindings = RawTiledBindings(dylib);
+        _smartPreviewBindings = SmartPreviewBindings(dylib);
+        _batchBindings = RawBatchBindings(dylib);
+        _cullBindings = RawCullBindings(dylib);
+        _hashBindings = RawHashBindings(dylib);
+        _dngTilesBindings = DngTilesBindings(dylib);
         _initialized = true;
         print('Successfully loaded libraw_processor from: $path');
         return;
@@ -71,10 +94,143 @@ class RawProcessor {
       throw Exception('Not a RAW file: $filePath');
     }
 
+    // Decode on native threads and receive the pixels through a port
+    if (NativeAsync.isAvailable) {
+      return await _processWithNativePort(filePath);
+    }
+
     // Process in isolate to avoid blocking UI
     return await _processInBackground(filePath);
   }
 
+  /// Bindings for the smart preview functions in libraw_processor
+  static SmartPreviewBindings get smartPreviewBindings {
+    if (!_initialized) {
+      initialize();
+    }
+    return _smartPreviewBindings;
+  }
+
+  /// Bindings for the batch decoder in libraw_processor
+  static RawBatchBindings get batchBindings {
+    if (!_initialized) {
+      initialize();
+    }
+    return _batchBindings;
+  }
+
+  /// Bindings for culling scores in libraw_processor
+  static RawCullBindings get cullBindings {
+    if (!_initialized) {
+      initialize();
+    }
+    return _cullBindings;
+  }
+
+  /// Bindings for perceptual hashing in libraw_processor
+  static RawHashBindings get hashBindings {
+    if (!_initialized) {
+      initialize();
+    }
+    return _hashBindings;
+  }
+
+  /// Bindings for the parallel tiled DNG decode in libraw_processor
+  static DngTilesBindings get dngTilesBindings {
+    if (!_initialized) {
+      initialize();
+    }
+    return _dngTilesBindings;
+  }
+
+  /// Read the output dimensions from the file header without decoding
+  static ({int width, int height})? probeDimensions(String filePath) {
+    if (!_initialized) {
+      initialize();
+    }
+
+    final pathPtr = filePath.toNativeUtf8();
+    final widthPtr = calloc<Int32>();
+    final heightPtr = calloc<Int32>();
+    try {
+      final result = _tiledBindings.rawProcessorProbe(pathPtr, widthPtr, heightPtr);
+      if (result != 0) return null;
+      return (width: widthPtr.value, height: heightPtr.value);
+    } catch (e) {
+      // Older builds of libraw_processor lack the probe entry point
+      print('Failed to probe RAW file: $e');
+      return null;
+    } finally {
+      calloc.free(pathPtr);
+      calloc.free(widthPtr);
+      calloc.free(heightPtr);
+    }
+  }
+
+  /// Decode a RAW file straight into a memory-mapped tiled image.
+  /// Used for files whose full-resolution buffer would not fit in memory.
+  static Future<TiledImage> loadRawFileTiled(String filePath, {int tileSize = TiledImage.defaultTileSize}) async {
+    // LibRaw and the tile fill run for seconds on files this size, so keep
+    // them off the UI isolate; the handle is process-wide and comes back
+    // as an address
+    final address = await Isolate.run(() => _decodeTiled(filePath, tileSize));
+    return TiledImage.fromHandle(Pointer<NativeTiledImage>.fromAddress(address));
+  }
+
+  static int _decodeTiled(String filePath, int tileSize) {
+    initialize();
+
+    Pointer<Void> processor = nullptr;
+    try {
+      processor = _bindings.raw_processor_init();
+      if (processor == nullptr) {
+        final error = _bindings.raw_processor_get_error().cast<Utf8>().toDartString();
+        throw Exception('Failed to initialize processor: $error');
+      }
+
+      final pathPtr = filePath.toNativeUtf8();
+      final result = _bindings.raw_processor_open(processor, pathPtr.cast<Char>());
+      calloc.free(pathPtr);
+
+      if (result != 0) {
+        final error = _bindings.raw_processor_get_error().cast<Utf8>().toDartString();
+        throw Exception('Failed to open RAW file: $error');
+      }
+
+      final processResult = _bindings.raw_processor_process(processor);
+      if (processResult != 0) {
+        final error = _bindings.raw_processor_get_error().cast<Utf8>().toDartString();
+        throw Exception('Failed to process RAW: $error');
+      }
+
+      // Backed by an unlinked temporary file
+      final handle = _tiledBindings.rawProcessorGetRgbTiled(processor, nullptr, tileSize);
+      if (handle == nullptr) {
+        final error = _bindings.raw_processor_get_error().cast<Utf8>().toDartString();
+        throw Exception('Failed to get tiled RGB data: $error');
+      }
+
+      return handle.address;
+    } finally {
+      if (processor != nullptr) {
+        _bindings.raw_processor_cleanup(processor);
+      }
+    }
+  }
+
+  static Future<img_proc.RawPixelData?> _processWithNativePort(String filePath) async {
+    final image = await RawBatchDecoder.decode(
+      [filePath],
+      filesInFlight: 1,
+      decodeThreads: 1,
+      jobClass: JobClass.interactive,
+    ).first;
+    if (image.data == null) {
+      throw Exception('Failed to process RAW: ${image.error}');
+    }
+    return image.data;
+  }
+
   static Future<img_proc.RawPixelData?> _processInBackground(String filePath) async {
     Pointer<Void> processor = nullptr;
     Pointer<RawImageData> imageData = nullptr;
@@ -0,0 +1,285 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import 'package:path/path.dart' as path;
+import '../ffi/raw/smart_preview_bindings.dart';
+import 'image_processor.dart';
+import 'raw_processor.dart';
+
+/// Catalog entry describing one smart preview
+class SmartPreviewEntry {
+  final String originalPath;
+  final String proxyPath;
+  final int originalSize;
+  final int originalModified;  // milliseconds since epoch
+  final int width;
+  final int height;
+  final int originalWidth;
+  final int originalHeight;
+  
+  SmartPreviewEntry({
+    required this.originalPath,
+    required this.proxyPath,
+    required this.originalSize,
+    required this.originalModified,
+    required this.width,
+    required this.height,
+    required this.originalWidth,
+    required this.originalHeight,
+  });
+  
+  Map<String, dynamic> toJson() => {
+    'originalPath': originalPath,
+    'proxyPath': proxyPath,
+    'originalSize': originalSize,
+    'originalModified': originalModified,
+    'width': width,
+    'height': height,
+    'originalWidth': originalWidth,
+    'originalHeight': originalHeight,
+  };
+  
+  factory SmartPreviewEntry.fromJson(Map<String, dynamic> json) {
+    return SmartPreviewEntry(
+      originalPath: json['originalPath'] as String,
+      proxyPath: json['proxyPath'] as String,
+      originalSize: json['originalSize'] as int,
+      originalModified: json['originalModified'] as int,
+      width: json['width'] as int,
+      height: json['height'] as int,
+      originalWidth: json['originalWidth'] as int,
+      originalHeight: json['originalHeight'] as int,
+    );
+  }
+}
+
+/// Local proxies for RAW files on slow or offline storage.
+///
+/// A smart preview is a 2560 px, 16-bit linear, zstd-compressed copy of the
+/// decoded RAW kept in the user's cache directory. Editing runs on the proxy;
+/// the original is only read again for export.
+class SmartPreviewService {
+  static const int previewSize = 2560;
+  static const int compressionLevel = 3;
+  static const String _catalogName = 'catalog.json';
+  
+  /// How long to wait on the original before treating it as offline
+  static const Duration _statTimeout = Duration(seconds: 2);
+  
+  static Map<String, SmartPreviewEntry>? _catalog;
+  static final Map<String, Future<SmartPreviewEntry?>> _pending = {};
+  
+  /// Smart previews are opt-in (AKS_SMART_PREVIEWS=true)
+  static bool get isEnabled {
+    final value = Platform.environment['AKS_SMART_PREVIEWS']?.toLowerCase();
+    return value == 'true' || value == '1';
+  }
+  
+  /// Cache directory holding the catalog and proxy files
+  static Directory get cacheDirectory {
+    final xdgCache = Platform.environment['XDG_CACHE_HOME'];
+    final home = Platform.environment['HOME'] ?? Directory.systemTemp.path;
+    final base = xdgCache ?? path.join(home, '.cache');
+    return Directory(path.join(base, 'aks', 'smart_previews'));
+  }
+  
+  /// Find a usable proxy for the original.
+  /// Returns null if there is none or the original changed since it was made.
+  static Future<SmartPreviewEntry?> lookup(String originalPath) async {
+    final catalog = await _loadCatalog();
+    final entry = catalog[originalPath];
+    if (entry == null) return null;
+    
+    if (!await File(entry.proxyPath).exists()) {
+      catalog.remove(originalPath);
+      await _saveCatalog();
+      return null;
+    }
+    
+    // An unreachable original is the case proxies exist for
+    final stat = await _statOriginal(originalPath);
+    if (stat == null) {
+      print('SmartPreviewService: Original unavailable, using proxy for $originalPath');
+      return entry;
+    }
+    
+    if (stat.size != entry.originalSize ||
+        stat.modified.millisecondsSinceEpoch != entry.originalModified) {
+      print('SmartPreviewService: Proxy is stale for $originalPath');
+      return null;
+    }
+    
+    return entry;
+  }
+  
+  /// Build (or rebuild) the proxy for an original in a background isolate
+  static Future<SmartPreviewEntry?> generate(String originalPath) {
+    return _pending[originalPath] ??= _generate(originalPath)
+        .whenComplete(() => _pending.remove(originalPath));
+  }
+  
+  static Future<SmartPreviewEntry?> _generate(String originalPath) async {
+    final stat = await _statOriginal(originalPath);
+    if (stat == null) return null;
+    
+    final directory = cacheDirectory;
+    await directory.create(recursive: true);
+    final proxyPath = path.join(directory.path, '${_hashPath(originalPath)}.aksp');
+    
+    try {
+      final info = await Isolate.run(
+        () => _generateProxy(originalPath, proxyPath),
+      );
+      
+      final entry = SmartPreviewEntry(
+        originalPath: originalPath,
+        proxyPath: proxyPath,
+        originalSize: stat.size,
+        originalModified: stat.modified.millisecondsSinceEpoch,
+        width: info[0],
+        height: info[1],
+        originalWidth: info[2],
+        originalHeight: info[3],
+      );
+      
+      final catalog = await _loadCatalog();
+      catalog[originalPath] = entry;
+      await _saveCatalog();
+      
+      print('SmartPreviewService: Created ${entry.width}x${entry.height} proxy for $originalPath');
+      return entry;
+    } catch (e) {
+      print('SmartPreviewService: Failed to create proxy: $e');
+      return null;
+    }
+  }
+  
+  /// Decode the proxy to 8-bit RGB for the editing pipeline
+  static RawPixelData loadPixels(SmartPreviewEntry entry) {
+    final bindings = RawProcessor.smartPreviewBindings;
+    final pathPtr = entry.proxyPath.toNativeUtf8();
+    final preview = bindings.smartPreviewOpen(pathPtr);
+    calloc.free(pathPtr);
+    
+    if (preview == nullptr) {
+      throw Exception('Failed to open smart preview: ${entry.proxyPath}');
+    }
+    
+    final outputPtr = calloc<Pointer<Uint8>>();
+    final widthPtr = calloc<Int32>();
+    final heightPtr = calloc<Int32>();
+    try {
+      if (bindings.smartPreviewReadRgb(preview, outputPtr, widthPtr, heightPtr) != 1) {
+        throw Exception('Failed to decode smart preview: ${entry.proxyPath}');
+      }
+      final width = widthPtr.value;
+      final height = heightPtr.value;
+      return RawPixelData(
+        pixels: Uint8List.fromList(outputPtr.value.asTypedList(width * height * 3)),
+        width: width,
+        height: height,
+      );
+    } finally {
+      if (outputPtr.value != nullptr) {
+        bindings.smartPreviewFreeBuffer(outputPtr.value);
+      }
+      calloc.free(outputPtr);
+      calloc.free(widthPtr);
+      calloc.free(heightPtr);
+      bindings.smartPreviewClose(preview);
+    }
+  }
+  
+  /// Runs inside the background isolate; returns proxy and original dimensions
+  static List<int> _generateProxy(String originalPath, String proxyPath) {
+    RawProcessor.initialize();
+    final bindings = RawProcessor.smartPreviewBindings;
+    
+    final rawPathPtr = originalPath.toNativeUtf8();
+    final proxyPathPtr = proxyPath.toNativeUtf8();
+    final infoPtr = calloc<SmartPreviewInfo>();
+    try {
+      final result = bindings.smartPreviewGenerate(
+        rawPathPtr,
+        proxyPathPtr,
+        previewSize,
+        compressionLevel,
+      );
+      if (result != 0) {
+        throw Exception('smart_preview_generate failed ($result)');
+      }
+      
+      final preview = bindings.smartPreviewOpen(proxyPathPtr);
+      if (preview == nullptr) {
+        throw Exception('Generated proxy could not be opened');
+      }
+      bindings.smartPreviewGetInfo(preview, infoPtr);
+      bindings.smartPreviewClose(preview);
+      
+      final info = infoPtr.ref;
+      return [info.width, info.height, info.originalWidth, info.originalHeight];
+    } finally {
+      calloc.free(rawPathPtr);
+      calloc.free(proxyPathPtr);
+      calloc.free(infoPtr);
+    }
+  }
+  
+  static Future<FileStat?> _statOriginal(String originalPath) async {
+    try {
+      final stat = await FileStat.stat(originalPath).timeout(_statTimeout);
+      return stat.type == FileSystemEntityType.notFound ? null : stat;
+    } on TimeoutException {
+      return null;
+    }
+  }
+  
+  static Future<Map<String, SmartPreviewEntry>> _loadCatalog() async {
+    if (_catalog != null) return _catalog!;
+    
+    _catalog = {};
+    final file = File(path.join(cacheDirectory.path, _catalogName));
+    if (await file.exists()) {
+      try {
+        final json = jsonDecode(await file.readAsString()) as Map<String, dynamic>;
+        for (final item in (json['previews'] as List<dynamic>)) {
+          final entry = SmartPreviewEntry.fromJson(item as Map<String, dynamic>);
+          _catalog![entry.originalPath] = entry;
+        }
+      } catch (e) {
+        print('SmartPreviewService: Ignoring unreadable catalog: $e');
+      }
+    }
+    return _catalog!;
+  }
+  
+  static Future<void> _saveCatalog() async {
+    final directory = cacheDirectory;
+    await directory.create(recursive: true);
+    
+    final json = {
+      'version': 1,
+      'previews': _catalog!.values.map((e) => e.toJson()).toList(),
+    };
+    
+    // Write then rename so a crash never leaves a truncated catalog
+    final file = File(path.join(directory.path, _catalogName));
+    final temp = File('${file.path}.tmp');
+    await temp.writeAsString(const JsonEncoder.withIndent('  ').convert(json));
+    await temp.rename(file.path);
+  }
+  
+  /// 64-bit FNV-1a of the path, used as the proxy file name
+  static String _hashPath(String value) {
+    var hash = 0xcbf29ce484222325;
+    for (final byte in utf8.encode(value)) {
+      hash ^= byte;
+      hash *= 0x100000001b3;
+    }
+    return hash.toUnsigned(64).toRadixString(16).padLeft(16, '0');
+  }
+}
@@ -0,0 +1,218 @@
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import '../ffi/common/adjustment_params.dart';
+import '../ffi/cpu/cpu_kernel.dart';
+import '../ffi/jpeg/jpeg_processor.dart';
+import '../ffi/raw/raw_batch_bindings.dart';
+import '../ffi/tiles/tiled_image.dart';
+import '../ffi/tiles/tiled_image_bindings.dart';
+import '../models/adjustments.dart';
+import '../models/crop_state.dart';
+import '../models/edit_pipeline.dart';
+import 'processors/vulkan/vulkan_bindings.dart';
+import 'processors/vulkan_processor.dart';
+
+/// Processing and export for images kept out of core in a TiledImage.
+///
+/// Large files never exist as one full-resolution buffer: the editor works on
+/// a downsampled preview and export streams tiles through the GPU and the
+/// native CPU kernel straight into the encoder.
+class TiledImageService {
+  /// Images above this many pixels are loaded as tiles (~100 MP)
+  static const int tiledPixelThreshold = 100 * 1000 * 1000;
+  
+  /// Long edge of the preview generated from a tiled image
+  static const int previewSize = 2048;
+  
+  /// Whether an image of the given size should bypass the in-memory path
+  static bool shouldUseTiles(int width, int height) {
+    return width * height > tiledPixelThreshold;
+  }
+  
+  /// Apply the pipeline to every tile and stream the (cropped) result to a JPEG
+  static Future<bool> exportJpeg({
+    required TiledImage source,
+    required EditPipeline pipeline,
+    required String outputPath,
+    int quality = 90,
+  }) async {
+    // Tone curve LUTs, if any
+    Uint8List? rgbLut;
+    Uint8List? redLut;
+    Uint8List? greenLut;
+    Uint8List? blueLut;
+    for (final adjustment in pipeline.adjustments) {
+      if (adjustment is ToneCurveAdjustment) {
+        rgbLut = VulkanProcessor.generateCurveLookupTable(adjustment.rgbCurve);
+        redLut = VulkanProcessor.generateCurveLookupTable(adjustment.redCurve);
+        greenLut = VulkanProcessor.generateCurveLookupTable(adjustment.greenCurve);
+        blueLut = VulkanProcessor.generateCurveLookupTable(adjustment.blueCurve);
+        break;
+      }
+    }
+    
+    // Tiles are processed whole; the crop is applied when encoding
+    final params = calloc<AdjustmentParams>();
+    VulkanProcessor.fillParams(
+      params.ref,
+      pipeline.adjustments.toList(),
+      hasToneCurves: rgbLut != null,
+    );
+    
+    final processed = TiledImage.create(
+      source.width,
+      source.height,
+      4,
+      tileSize: source.tileSize,
+    );
+    
+    try {
+      final useGpu = await VulkanProcessor.isAvailable();
+      final region = _cropRegion(pipeline.cropRect, source.width, source.height);
+      final sourceAddress = source.handle.address;
+      final processedAddress = processed.handle.address;
+      final paramsAddress = params.address;
+      final luts = [rgbLut, redLut, greenLut, blueLut];
+      
+      // Every tile is read, processed and encoded, so the whole pass runs
+      // on a background isolate
+      return await Isolate.run(() => _processAndEncode(
+            sourceAddress,
+            processedAddress,
+            paramsAddress,
+            luts,
+            useGpu,
+            region,
+            outputPath,
+            quality,
+          ));
+    } finally {
+      processed.close();
+      calloc.free(params);
+    }
+  }
+  
+  static bool _processAndEncode(
+    int sourceAddress,
+    int processedAddress,
+    int paramsAddress,
+    List<Uint8List?> luts,
+    bool useGpu,
+    ({int x, int y, int width, int height}) region,
+    String outputPath,
+    int quality,
+  ) {
+    final source = Pointer<NativeTiledImage>.fromAddress(sourceAddress);
+    final processed = Pointer<NativeTiledImage>.fromAddress(processedAddress);
+    final params = Pointer<AdjustmentParams>.fromAddress(paramsAddress);
+    
+    bool success = false;
+    if (useGpu && VulkanBindings.initialize()) {
+      // The CPU kernel takes tiles alongside the GPU. A context of its own
+      // keeps previews rendering on the default one meanwhile.
+      final context = VulkanContext.create(jobClass: JobClass.batch);
+      try {
+        success = VulkanBindings.processTiledHybrid(
+          source,
+          processed,
+          params,
+          rgbLut: luts[0],
+          redLut: luts[1],
+          greenLut: luts[2],
+          blueLut: luts[3],
+          context: context,
+        );
+      } finally {
+        context?.dispose();
+      }
+      if (!success) {
+        print('TiledImageService: GPU tile processing failed, using CPU kernel');
+      }
+    }
+    
+    if (!success) {
+      success = _processTiledOnCpu(
+        source,
+        processed,
+        params,
+        rgbLut: luts[0],
+        redLut: luts[1],
+        greenLut: luts[2],
+        blueLut: luts[3],
+      );
+    }
+    
+    if (!success) {
+      print('TiledImageService: tile processing failed');
+      return false;
+    }
+    
+    // Crop is applied by encoding only the selected region
+    final pathPtr = outputPath.toNativeUtf8();
+    try {
+      return JpegProcessor.bindings.jpegWriteTiled(
+        pathPtr,
+        processed,
+        region.x,
+        region.y,
+        region.width,
+        region.height,
+        quality,
+      ) == 1;
+    } finally {
+      malloc.free(pathPtr);
+    }
+  }
+  
+  static bool _processTiledOnCpu(
+    Pointer<NativeTiledImage> source,
+    Pointer<NativeTiledImage> destination,
+    Pointer<AdjustmentParams> params,
+    {Uint8List? rgbLut,
+     Uint8List? redLut,
+     Uint8List? greenLut,
+     Uint8List? blueLut}
+  ) {
+    final luts = [rgbLut, redLut, greenLut, blueLut].map((lut) {
+      if (lut == null) return nullptr.cast<Uint8>();
+      final ptr = calloc<Uint8>(256);
+      ptr.asTypedList(256).setAll(0, lut);
+      return ptr;
+    }).toList();
+    
+    try {
+      return CpuKernel.bindings.cpuProcessTiledParams(
+        source,
+        destination,
+        params,
+        luts[0],
+        luts[1],
+        luts[2],
+        luts[3],
+        0,  // all cores
+      ) == 1;
+    } finally {
+      for (final lut in luts) {
+        if (lut != nullptr) calloc.free(lut);
+      }
+    }
+  }
+  
+  static ({int x, int y, int width, int height}) _cropRegion(
+    CropRect? cropRect,
+    int width,
+    int height,
+  ) {
+    if (cropRect == null) {
+      return (x: 0, y: 0, width: width, height: height);
+    }
+    
+    final left = (cropRect.left * width).round().clamp(0, width - 1);
+    final top = (cropRect.top * height).round().clamp(0, height - 1);
+    final right = (cropRect.right * width).round().clamp(left + 1, width);
+    final bottom = (cropRect.bottom * height).round().clamp(top + 1, height);
+    return (x: left, y: top, width: right - left, height: bottom - top);
+  }
+}
@@ -1,9 +1,11 @@
+import 'dart:io';
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
 import '../theme/text_styles.dart';
 import '../models/image_state.dart';
 import '../models/adjustments.dart';
 import '../services/export_service.dart';
+import '../services/file_service.dart';
 import 'adjustment_slider.dart';
 import 'tone_curve_widget.dart';
 
@@ -26,6 +28,7 @@ class EditingPanel extends StatelessWidget {
         final blacksWhites = pipeline.getAdjustment<BlacksWhitesAdjustment>('blacks_whites');
         final satVibrance = pipeline.getAdjustment<SaturationVibranceAdjustment>('saturation_vibrance');
         final toneCurve = pipeline.getAdjustment<ToneCurveAdjustment>('tone_curve');
+        final look = pipeline.getAdjustment<LutAdjustment>('lut_3d');
         
         // Debug: Check if tone curve is loaded
         print('ToneCurve adjustment: ${toneCurve != null ? "loaded" : "null"}');
@@ -314,6 +317,35 @@ class EditingPanel extends StatelessWidget {
                         ],
                       ],
                     ),
+                    
+                    // Look Section (3D LUT)
+                    _buildSection(
+                      'Look',
+                      [
+                        if (look != null) ...[
+                          _buildLutPicker(context, imageState, look),
+                          if (look.path != null)
+                            AdjustmentSlider(
+                              label: 'Opacity',
+                              value: look.opacity,
+                              min: 0,
+                              max: 100,
+                              suffix: '%',
+                              neutralValue: 100,
+                              onChanged: (value) {
+                                pipeline.updateAdjustment(
+                                  look.copyWith(opacity: value),
+                                );
+                              },
+                              onReset: () {
+                                pipeline.updateAdjustment(
+                                  look.copyWith(opacity: 100),
+                                );
+                              },
+                            ),
+                        ],
+                      ],
+                    ),
                   ],
                 ),
               ),
@@ -372,6 +404,56 @@ class EditingPanel extends StatelessWidget {
     );
   }
   
+  /// The current .cube file with buttons to choose another or remove it
+  Widget _buildLutPicker(BuildContext context, ImageState imageState, LutAdjustment look) {
+    final path = look.path;
+    final name = path?.split(Platform.pathSeparator).last;
+    return Padding(
+      padding: const EdgeInsets.symmetric(horizontal: 16, vertical: 4),
+      child: Row(
+        children: [
+          Expanded(
+            child: Text(
+              name ?? 'None',
+              overflow: TextOverflow.ellipsis,
+              style: AppTextStyles.inter(
+                color: name != null ? Colors.white70 : Colors.white38,
+                fontSize: 12,
+              ),
+            ),
+          ),
+          TextButton(
+            onPressed: () async {
+              final selected = await FileService.pickCubeLut();
+              if (selected == null) return;
+              final error = imageState.loadLut(selected);
+              if (error != null && context.mounted) {
+                ScaffoldMessenger.of(context).showSnackBar(
+                  SnackBar(
+                    content: Text(error),
+                    backgroundColor: const Color(0xFFEF4444),
+                    duration: const Duration(seconds: 4),
+                  ),
+                );
+              }
+            },
+            child: Text(
+              path != null ? 'Change' : 'Choose .cube',
+              style: AppTextStyles.inter(color: Colors.white54, fontSize: 12),
+            ),
+          ),
+          if (path != null)
+            IconButton(
+              icon: const Icon(Icons.close, size: 16),
+              color: Colors.white38,
+              tooltip: 'Remove LUT',
+              onPressed: imageState.clearLut,
+            ),
+        ],
+      ),
+    );
+  }
+  
   Widget _buildSection(String title, List<Widget> children) {
     return Column(
       crossAxisAlignment: CrossAxisAlignment.start,
@@ -1,6 +1,7 @@
 import 'package:flutter/material.dart';
 import '../theme/text_styles.dart';
 import '../services/export_service.dart';
+import '../ffi/encode/image_encoder.dart';
 
 class ExportDialog extends StatefulWidget {
   final int? imageWidth;
@@ -19,6 +20,18 @@ class ExportDialog extends StatefulWidget {
 class _ExportDialogState extends State<ExportDialog> {
   ExportFormat _selectedFormat = ExportFormat.jpeg;
   double _jpegQuality = 90;
+  EncodePreset _preset = EncodePreset.balanced;
+  int? _maxFileSizeKb; // JPEG size budget; null means quality is fixed
+  
+  static const _fileSizeOptions = [500, 1024, 2048, 5120];
+  
+  // Formats from the native encoder library: (format, title, subtitle)
+  static const _encodedFormats = [
+    (ExportFormat.jxl, 'JPEG XL', 'Smallest files, lossless at 100%'),
+    (ExportFormat.avif, 'AVIF', 'Small files, widely supported by browsers'),
+    (ExportFormat.webp, 'WebP', 'Small files for the web, lossless at 100%'),
+  ];
+  List<(ExportFormat, String, String)> _availableFormats = const [];
   
   // Size options
   String _sizeOption = 'original'; // original, half, quarter, custom
@@ -71,6 +84,9 @@ class _ExportDialogState extends State<ExportDialog> {
   @override
   void initState() {
     super.initState();
+    _availableFormats = _encodedFormats
+        .where((option) => ExportService.isFormatAvailable(option.$1))
+        .toList();
     // Initialize custom max dimension to half of the largest dimension
     if (widget.imageWidth != null && widget.imageHeight != null) {
       final maxDim = widget.imageWidth! > widget.imageHeight! ? widget.imageWidth! : widget.imageHeight!;
@@ -186,12 +202,43 @@ class _ExportDialogState extends State<ExportDialog> {
                       });
                     },
                   ),
+                  for (final option in _availableFormats) ...[
+                    const Divider(
+                      color: Color(0xFF2A2A2A),
+                      height: 1,
+                    ),
+                    RadioListTile<ExportFormat>(
+                      title: Text(
+                        option.$2,
+                        style: AppTextStyles.inter(
+                          color: Colors.white,
+                          fontSize: 14,
+                          fontWeight: FontWeight.w500,
+                        ),
+                      ),
+                      subtitle: Text(
+                        option.$3,
+                        style: AppTextStyles.inter(
+                          color: Colors.white54,
+                          fontSize: 12,
+                        ),
+                      ),
+                      value: option.$1,
+                      groupValue: _selectedFormat,
+                      activeColor: const Color(0xFF6366F1),
+                      onChanged: (value) {
+                        setState(() {
+                          _selectedFormat = value!;
+                        });
+                      },
+                    ),
+                  ],
                 ],
               ),
             ),
             
-            // Quality slider (only for JPEG)
-            if (_selectedFormat == ExportFormat.jpeg) ...[
+            // Quality slider (lossy formats)
+            if (_selectedFormat != ExportFormat.png) ...[
               const SizedBox(height: 24),
               Text(
                 'QUALITY',
@@ -215,7 +262,9 @@ class _ExportDialogState extends State<ExportDialog> {
                       mainAxisAlignment: MainAxisAlignment.spaceBetween,
                       children: [
                         Text(
-                          'JPEG Quality',
+                          _selectedFormat == ExportFormat.jpeg
+                              ? (_maxFileSizeKb != null ? 'Max JPEG Quality' : 'JPEG Quality')
+                              : 'Quality',
                           style: AppTextStyles.inter(
                             color: Colors.white70,
                             fontSize: 14,
@@ -223,7 +272,11 @@ class _ExportDialogState extends State<ExportDialog> {
                           ),
                         ),
                         Text(
-                          '${_jpegQuality.round()}%',
+                          _jpegQuality.round() == 100 &&
+                                  (_selectedFormat == ExportFormat.jxl ||
+                                      _selectedFormat == ExportFormat.webp)
+                              ? 'Lossless'
+                              : '${_jpegQuality.round()}%',
                           style: AppTextStyles.inter(
                             color: Colors.white,
                             fontSize: 14,
@@ -278,6 +331,94 @@ class _ExportDialogState extends State<ExportDialog> {
                         ),
                       ],
                     ),
+                    
+                    // Size budget for JPEG: the slider becomes the ceiling
+                    if (_selectedFormat == ExportFormat.jpeg) ...[
+                      const SizedBox(height: 16),
+                      Wrap(
+                        crossAxisAlignment: WrapCrossAlignment.center,
+                        runSpacing: 8,
+                        children: [
+                          Text(
+                            'Max size:',
+                            style: AppTextStyles.inter(
+                              color: Colors.white70,
+                              fontSize: 14,
+                            ),
+                          ),
+                          const SizedBox(width: 16),
+                          for (final sizeKb in [null, ..._fileSizeOptions]) ...[
+                            ChoiceChip(
+                              label: Text(
+                                sizeKb == null
+                                    ? 'Off'
+                                    : sizeKb < 1024
+                                        ? '$sizeKb KB'
+                                        : '${sizeKb ~/ 1024} MB',
+                                style: AppTextStyles.inter(
+                                  fontSize: 12,
+                                  fontWeight: FontWeight.w500,
+                                ),
+                              ),
+                              selected: _maxFileSizeKb == sizeKb,
+                              selectedColor: const Color(0xFF6366F1),
+                              backgroundColor: const Color(0xFF2A2A2A),
+                              onSelected: (selected) {
+                                if (selected) {
+                                  setState(() {
+                                    _maxFileSizeKb = sizeKb;
+                                  });
+                                }
+                              },
+                            ),
+                            const SizedBox(width: 8),
+                          ],
+                        ],
+                      ),
+                    ],
+                    
+                    // Encoder effort for the modern formats
+                    if (_selectedFormat != ExportFormat.jpeg) ...[
+                      const SizedBox(height: 16),
+                      Row(
+                        children: [
+                          Text(
+                            'Speed:',
+                            style: AppTextStyles.inter(
+                              color: Colors.white70,
+                              fontSize: 14,
+                            ),
+                          ),
+                          const SizedBox(width: 16),
+                          for (final preset in EncodePreset.values) ...[
+                            ChoiceChip(
+                              label: Text(
+                                switch (preset) {
+                                  EncodePreset.fast => 'Fast',
+                                  EncodePreset.balanced => 'Balanced',
+                                  EncodePreset.smallest => 'Smallest',
+                                },
+                                style: AppTextStyles.inter(
+                                  fontSize: 12,
+                                  fontWeight: FontWeight.w500,
+                                ),
+                              ),
+                              selected: _preset == preset,
+                              selectedColor: const Color(0xFF6366F1),
+                              backgroundColor: const Color(0xFF2A2A2A),
+                              onSelected: (selected) {
+                                if (selected) {
+                                  setState(() {
+                                    _preset = preset;
+                                  });
+                                }
+                              },
+                            ),
+                            const SizedBox(width: 8),
+                          ],
+                        ],
+                      ),
+                    ],
                   ],
                 ),
               ),
@@ -767,6 +908,10 @@ class _ExportDialogState extends State<ExportDialog> {
                     Navigator.of(context).pop({
                       'format': _selectedFormat,
                       'quality': _jpegQuality.round(),
+                      'preset': _preset,
+                      'maxFileSize': _selectedFormat == ExportFormat.jpeg && _maxFileSizeKb != null
+                          ? _maxFileSizeKb! * 1024
+                          : null,
                       'resizePercentage': resizePercentage,
                       'frameType': _frameType,
                       'frameColor': _frameColor,
@@ -1,4 +1,7 @@
+import 'dart:async';
 import 'package:flutter/material.dart';
+import '../ffi/common/mem_stats.dart';
+import '../ffi/common/mem_stats_bindings.dart';
 import '../services/processors/processor_factory.dart';
 import '../theme/text_styles.dart';
 
@@ -13,11 +16,53 @@ class ProcessorStatus extends StatefulWidget {
 class _ProcessorStatusState extends State<ProcessorStatus> {
   String _processorName = 'Initializing...';
   bool _gpuAvailable = false;
+  MemorySnapshot? _memory;
+  Timer? _memoryTimer;
   
   @override
   void initState() {
     super.initState();
     _updateStatus();
+    _pollMemory();
+    if (MemoryTelemetry.isAvailable) {
+      _memoryTimer = Timer.periodic(const Duration(seconds: 2), (_) => _pollMemory());
+    }
+  }
+  
+  @override
+  void dispose() {
+    _memoryTimer?.cancel();
+    super.dispose();
+  }
+  
+  void _pollMemory() {
+    final snapshot = MemoryTelemetry.poll();
+    if (snapshot != null && mounted) {
+      setState(() {
+        _memory = snapshot;
+      });
+    }
+  }
+  
+  String _memoryBreakdown(MemorySnapshot memory) {
+    final format = MemoryTelemetry.formatBytes;
+    final lines = <String>[
+      'Native: ${format(memory.totalCurrent)} (peak ${format(memory.totalPeak)})',
+    ];
+    for (int i = 0; i < MemComponent.count; i++) {
+      if (memory.peak[i] == 0) continue;
+      lines.add('${MemComponent.names[i]}: ${format(memory.current[i])} '
+          '(peak ${format(memory.peak[i])}, ${memory.allocations[i]} allocs)');
+    }
+    for (int i = 0; i < memory.heaps.length; i++) {
+      final heap = memory.heaps[i];
+      final kind = heap.deviceLocal ? 'device' : 'host';
+      final usage = heap.budget > 0
+          ? '${format(heap.usage)} of ${format(heap.budget)} budget'
+          : format(heap.size);
+      lines.add('Heap $i ($kind): $usage');
+    }
+    return lines.join('\n');
   }
   
   Future<void> _updateStatus() async {
@@ -71,6 +116,22 @@ class _ProcessorStatusState extends State<ProcessorStatus> {
               color: Colors.white70,
             ),
           ),
+          if (_memory != null) ...[
+            const SizedBox(width: 8),
+            Tooltip(
+              message: _memoryBreakdown(_memory!),
+              child: Text(
+                _memory!.deviceUsage != null
+                    ? '${MemoryTelemetry.formatBytes(_memory!.totalCurrent)} · '
+                      'GPU ${MemoryTelemetry.formatBytes(_memory!.deviceUsage!)}'
+                    : MemoryTelemetry.formatBytes(_memory!.totalCurrent),
+                style: AppTextStyles.inter(
+                  fontSize: 11,
+                  color: Colors.white38,
+                ),
+              ),
+            ),
+          ],
           if (_gpuAvailable && _processorName.contains('CPU')) ...[
             const SizedBox(width: 6),
             Tooltip(
@@ -1,8 +1,11 @@
 #include "raw_processor.h"
+#include "dng_tiles.h"
+#include "raw_processor_internal.h"
 #include <libraw/libraw.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdarg.h>
 
 static char last_error[256] = {0};
 
@@ -21,6 +24,7 @@ void* raw_processor_init() {
     processor->params.no_auto_bright = 1; // Disable auto-brightening to preserve RAW data
     processor->params.output_tiff = 0;
     
+    raw_memory_update(processor);
     return processor;
 }
 
@@ -31,14 +35,20 @@ int raw_processor_open(void* processor, const char* filename) {
     }
     
     libraw_data_t* lr = (libraw_data_t*)processor;
-    int ret = libraw_open_file(lr, filename);
+    // Tiled lossless JPEG DNGs get their tiles decoded in parallel first;
+    // LibRaw reads from the decoded copy until the unpack is done
+    uint8_t* decoded = NULL;
+    int ret = dng_tiles_open(lr, filename, 0, &decoded);
     
     if (ret != LIBRAW_SUCCESS) {
+        free(decoded);
         snprintf(last_error, sizeof(last_error), "Failed to open file: %s", libraw_strerror(ret));
         return ret;
     }
     
     ret = libraw_unpack(lr);
+    free(decoded);
+    raw_memory_update(lr);
     if (ret != LIBRAW_SUCCESS) {
         snprintf(last_error, sizeof(last_error), "Failed to unpack RAW: %s", libraw_strerror(ret));
         return ret;
@@ -55,6 +65,7 @@ int raw_processor_process(void* processor) {
     
     libraw_data_t* lr = (libraw_data_t*)processor;
     int ret = libraw_dcraw_process(lr);
+    raw_memory_update(lr);
     
     if (ret != LIBRAW_SUCCESS) {
         snprintf(last_error, sizeof(last_error), "Failed to process RAW: %s", libraw_strerror(ret));
@@ -101,6 +112,7 @@ RawImageData* raw_processor_get_rgb(void* processor) {
     
     memcpy(image->data, processed->data, data_size);
     image->size = data_size;
+    mem_stats_add(MEM_DECODED, data_size);
     
     // Fill image info
     image->info.width = processed->width;
@@ -115,6 +127,7 @@ RawImageData* raw_processor_get_rgb(void* processor) {
 void raw_processor_free_image(RawImageData* image) {
     if (image) {
         if (image->data) {
+            mem_stats_add(MEM_DECODED, -(int64_t)image->size);
             free(image->data);
         }
         free(image);
@@ -123,10 +136,19 @@ void raw_processor_free_image(RawImageData* image) {
 
 void raw_processor_cleanup(void* processor) {
     if (processor) {
+        raw_memory_release((libraw_data_t*)processor);
         libraw_close((libraw_data_t*)processor);
     }
 }
 
 const char* raw_processor_get_error() {
     return last_error;
+}
+
+// Set the error message from the other raw_processor translation units
+void raw_processor_set_error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(last_error, sizeof(last_error), format, args);
+    va_end(args);
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+# Turn compiled shaders into a C source with one const array per shader and
+# the embedded_shader() lookup from embedded_shaders.h.
+#
+#   cmake -DOUTPUT=embedded_shaders.c -DSHADERS="a.spv|b.spv" -P embed_spirv.cmake
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(CONTENT "// Generated by embed_spirv.cmake, do not edit\n#include \"embedded_shaders.h\"\n#include <string.h>\n\n")
+set(TABLE "")
+
+foreach(SPV ${SHADERS})
+  get_filename_component(NAME ${SPV} NAME_WE)
+  file(READ ${SPV} HEX HEX)
+  # SPIR-V is a stream of little-endian words
+  string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+  # Eight words per line (no {n} in CMake regexes)
+  set(WORD "0x........, ")
+  string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n    " WORDS "${WORDS}")
+  string(APPEND CONTENT "static const uint32_t ${NAME}_spv[] = {\n    ${WORDS}\n};\n\n")
+  string(APPEND TABLE "    { \"${NAME}\", ${NAME}_spv, sizeof(${NAME}_spv) },\n")
+endforeach()
+
+string(APPEND CONTENT "static const struct {\n    const char* name;\n    const uint32_t* code;\n    size_t size;\n} shaders[] = {\n${TABLE}    { NULL, NULL, 0 }\n};\n\n")
+string(APPEND CONTENT "const uint32_t* embedded_shader(const char* name, size_t* size) {\n    for (int i = 0; shaders[i].name != NULL; i++) {\n        if (strcmp(shaders[i].name, name) == 0) {\n            *size = shaders[i].size;\n            return shaders[i].code;\n        }\n    }\n    return NULL;\n}\n")
+
+file(WRITE ${OUTPUT} "${CONTENT}")
@@ -0,0 +1,22 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// SPIR-V compiled into libvulkan_processor at build time. The definition is
+// generated from shaders/*.comp (embed_spirv.cmake or build_test_libs.sh) and
+// the library is built with AKS_EMBEDDED_SHADERS when it is present.
+
+// Code and size in bytes of shaders/<name>.comp, or NULL if not embedded
+const uint32_t* embedded_shader(const char* name, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMBEDDED_SHADERS_H
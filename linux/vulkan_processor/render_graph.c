@@ -0,0 +1,388 @@
+#include "render_graph.h"
+#include "mem_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RG_NO_SLOT -1
+
+typedef struct {
+    const char* name;
+    VkBuffer buffer;
+    int imported;
+    VkDeviceSize size;
+    VkBufferUsageFlags usage;
+    VkMemoryRequirements requirements;
+    int first_pass;         // Lifetime, -1 if never used
+    int last_pass;
+    int slot;               // Memory slot of a transient
+} RgResource;
+
+typedef struct {
+    int resource;
+    RgAccess access;
+} RgUse;
+
+typedef struct {
+    const char* name;
+    RgRecordFn record;
+    void* user_data;
+    RgUse uses[RG_MAX_PASS_USES];
+    int use_count;
+} RgPass;
+
+// Transients sharing one allocation
+typedef struct {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t type_bits;
+} RgSlot;
+
+// What last touched a piece of memory, for barriers
+typedef struct {
+    int has_write;
+    VkPipelineStageFlags write_stage;
+    VkAccessFlags write_access;
+    VkPipelineStageFlags read_stages;     // Reads since the last write
+    VkPipelineStageFlags visible_stages;  // Stages the last write was made visible to
+} RgHazard;
+
+struct RenderGraph {
+    VkDevice device;
+    VkPhysicalDevice physical_device;
+    RgResource resources[RG_MAX_RESOURCES];
+    int resource_count;
+    RgPass passes[RG_MAX_PASSES];
+    int pass_count;
+    RgSlot slots[RG_MAX_RESOURCES];
+    int slot_count;
+    int compiled;
+};
+
+static void access_flags(RgAccess access, VkPipelineStageFlags* stage, VkAccessFlags* flags, int* write) {
+    switch (access) {
+        case RG_ACCESS_SHADER_READ:
+            *stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            *flags = VK_ACCESS_SHADER_READ_BIT;
+            *write = 0;
+            break;
+        case RG_ACCESS_SHADER_WRITE:
+            *stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            *flags = VK_ACCESS_SHADER_WRITE_BIT;
+            *write = 1;
+            break;
+        case RG_ACCESS_TRANSFER_READ:
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *flags = VK_ACCESS_TRANSFER_READ_BIT;
+            *write = 0;
+            break;
+        case RG_ACCESS_TRANSFER_WRITE:
+        default:
+            *stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            *flags = VK_ACCESS_TRANSFER_WRITE_BIT;
+            *write = 1;
+            break;
+    }
+}
+
+static uint32_t find_device_memory_type(VkPhysicalDevice physical_device, uint32_t type_bits) {
+    VkPhysicalDeviceMemoryProperties properties;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &properties);
+
+    for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+        if ((type_bits & (1u << i)) &&
+            (properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            return i;
+        }
+    }
+    // Any compatible type rather than failing on unusual heaps
+    for (uint32_t i = 0; i < properties.memoryTypeCount; i++) {
+        if (type_bits & (1u << i)) return i;
+    }
+    return UINT32_MAX;
+}
+
+RenderGraph* rg_create(VkDevice device, VkPhysicalDevice physical_device) {
+    RenderGraph* graph = calloc(1, sizeof(RenderGraph));
+    if (!graph) return NULL;
+    graph->device = device;
+    graph->physical_device = physical_device;
+    return graph;
+}
+
+void rg_destroy(RenderGraph* graph) {
+    if (!graph) return;
+    for (int i = 0; i < graph->resource_count; i++) {
+        RgResource* resource = &graph->resources[i];
+        if (!resource->imported && resource->buffer != VK_NULL_HANDLE) {
+            vkDestroyBuffer(graph->device, resource->buffer, NULL);
+        }
+    }
+    for (int i = 0; i < graph->slot_count; i++) {
+        if (graph->slots[i].memory != VK_NULL_HANDLE) {
+            vkFreeMemory(graph->device, graph->slots[i].memory, NULL);
+            mem_stats_add(MEM_VK_TRANSIENT, -(int64_t)graph->slots[i].size);
+        }
+    }
+    free(graph);
+}
+
+static int add_resource(RenderGraph* graph, const char* name) {
+    if (graph->compiled || graph->resource_count >= RG_MAX_RESOURCES) {
+        fprintf(stderr, "render graph: cannot add resource %s\n", name);
+        return -1;
+    }
+    int id = graph->resource_count++;
+    RgResource* resource = &graph->resources[id];
+    memset(resource, 0, sizeof(*resource));
+    resource->name = name;
+    resource->first_pass = -1;
+    resource->last_pass = -1;
+    resource->slot = RG_NO_SLOT;
+    return id;
+}
+
+int rg_import_buffer(RenderGraph* graph, const char* name, VkBuffer buffer) {
+    int id = add_resource(graph, name);
+    if (id < 0) return -1;
+    graph->resources[id].buffer = buffer;
+    graph->resources[id].imported = 1;
+    return id;
+}
+
+int rg_create_buffer(RenderGraph* graph, const char* name, VkDeviceSize size, VkBufferUsageFlags usage) {
+    int id = add_resource(graph, name);
+    if (id < 0) return -1;
+    graph->resources[id].size = size;
+    graph->resources[id].usage = usage;
+    return id;
+}
+
+int rg_add_pass(RenderGraph* graph, const char* name, RgRecordFn record, void* user_data) {
+    if (graph->compiled || graph->pass_count >= RG_MAX_PASSES) {
+        fprintf(stderr, "render graph: cannot add pass %s\n", name);
+        return -1;
+    }
+    int id = graph->pass_count++;
+    RgPass* pass = &graph->passes[id];
+    memset(pass, 0, sizeof(*pass));
+    pass->name = name;
+    pass->record = record;
+    pass->user_data = user_data;
+    return id;
+}
+
+int rg_use(RenderGraph* graph, int pass, int resource, RgAccess access) {
+    if (graph->compiled || pass < 0 || pass >= graph->pass_count ||
+        resource < 0 || resource >= graph->resource_count) {
+        return 0;
+    }
+    RgPass* p = &graph->passes[pass];
+    if (p->use_count >= RG_MAX_PASS_USES) {
+        fprintf(stderr, "render graph: too many resources in pass %s\n", p->name);
+        return 0;
+    }
+    p->uses[p->use_count++] = (RgUse){ .resource = resource, .access = access };
+
+    RgResource* r = &graph->resources[resource];
+    if (r->first_pass < 0 || pass < r->first_pass) r->first_pass = pass;
+    if (pass > r->last_pass) r->last_pass = pass;
+    return 1;
+}
+
+static int lifetimes_overlap(const RgResource* a, const RgResource* b) {
+    return !(a->last_pass < b->first_pass || b->last_pass < a->first_pass);
+}
+
+// Greedy placement: largest transients first, each into the first slot whose
+// members are all dead while it is alive
+static void assign_slots(RenderGraph* graph) {
+    int order[RG_MAX_RESOURCES];
+    int count = 0;
+    for (int i = 0; i < graph->resource_count; i++) {
+        RgResource* resource = &graph->resources[i];
+        if (!resource->imported && resource->first_pass >= 0) order[count++] = i;
+    }
+
+    for (int i = 1; i < count; i++) {
+        int id = order[i];
+        int j = i - 1;
+        while (j >= 0 && graph->resources[order[j]].requirements.size < graph->resources[id].requirements.size) {
+            order[j + 1] = order[j];
+            j--;
+        }
+        order[j + 1] = id;
+    }
+
+    for (int i = 0; i < count; i++) {
+        RgResource* resource = &graph->resources[order[i]];
+        for (int s = 0; s < graph->slot_count && resource->slot == RG_NO_SLOT; s++) {
+            if (!(graph->slots[s].type_bits & resource->requirements.memoryTypeBits)) continue;
+
+            int free = 1;
+            for (int j = 0; j < i && free; j++) {
+                RgResource* other = &graph->resources[order[j]];
+                if (other->slot == s && lifetimes_overlap(resource, other)) free = 0;
+            }
+            if (free) resource->slot = s;
+        }
+
+        if (resource->slot == RG_NO_SLOT) {
+            resource->slot = graph->slot_count++;
+            graph->slots[resource->slot].type_bits = resource->requirements.memoryTypeBits;
+        }
+
+        RgSlot* slot = &graph->slots[resource->slot];
+        slot->type_bits &= resource->requirements.memoryTypeBits;
+        if (resource->requirements.size > slot->size) slot->size = resource->requirements.size;
+    }
+}
+
+int rg_compile(RenderGraph* graph) {
+    if (graph->compiled) return 1;
+
+    for (int i = 0; i < graph->resource_count; i++) {
+        RgResource* resource = &graph->resources[i];
+        if (resource->imported || resource->first_pass < 0) continue;
+
+        VkBufferCreateInfo buffer_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size = resource->size,
+            .usage = resource->usage,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+        };
+        VkResult result = vkCreateBuffer(graph->device, &buffer_info, NULL, &resource->buffer);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "render graph: vkCreateBuffer (%s) failed: %d\n", resource->name, result);
+            resource->buffer = VK_NULL_HANDLE;
+            return 0;
+        }
+        vkGetBufferMemoryRequirements(graph->device, resource->buffer, &resource->requirements);
+    }
+
+    assign_slots(graph);
+
+    for (int s = 0; s < graph->slot_count; s++) {
+        RgSlot* slot = &graph->slots[s];
+        uint32_t type = find_device_memory_type(graph->physical_device, slot->type_bits);
+        if (type == UINT32_MAX) {
+            fprintf(stderr, "render graph: no memory type for slot %d\n", s);
+            return 0;
+        }
+
+        VkMemoryAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize = slot->size,
+            .memoryTypeIndex = type
+        };
+        VkResult result = vkAllocateMemory(graph->device, &alloc_info, NULL, &slot->memory);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "render graph: vkAllocateMemory (%llu bytes) failed: %d\n",
+                    (unsigned long long)slot->size, result);
+            slot->memory = VK_NULL_HANDLE;
+            return 0;
+        }
+        mem_stats_add(MEM_VK_TRANSIENT, (int64_t)slot->size);
+    }
+
+    for (int i = 0; i < graph->resource_count; i++) {
+        RgResource* resource = &graph->resources[i];
+        if (resource->imported || resource->slot == RG_NO_SLOT) continue;
+        vkBindBufferMemory(graph->device, resource->buffer, graph->slots[resource->slot].memory, 0);
+    }
+
+    graph->compiled = 1;
+    return 1;
+}
+
+void rg_execute(RenderGraph* graph, VkCommandBuffer cmd) {
+    if (!graph->compiled) return;
+
+    // Imported buffers are tracked per resource, transients per slot so
+    // aliased buffers wait for the previous occupant
+    RgHazard hazards[RG_MAX_RESOURCES * 2];
+    memset(hazards, 0, sizeof(hazards));
+
+    for (int p = 0; p < graph->pass_count; p++) {
+        RgPass* pass = &graph->passes[p];
+        VkPipelineStageFlags src_stages = 0, dst_stages = 0;
+        VkAccessFlags src_access = 0, dst_access = 0;
+
+        for (int u = 0; u < pass->use_count; u++) {
+            RgResource* resource = &graph->resources[pass->uses[u].resource];
+            RgHazard* hazard = resource->imported
+                ? &hazards[pass->uses[u].resource]
+                : &hazards[RG_MAX_RESOURCES + resource->slot];
+
+            VkPipelineStageFlags stage;
+            VkAccessFlags access;
+            int write;
+            access_flags(pass->uses[u].access, &stage, &access, &write);
+
+            if (!write) {
+                // Read after write
+                if (hazard->has_write && !(hazard->visible_stages & stage)) {
+                    src_stages |= hazard->write_stage;
+                    src_access |= hazard->write_access;
+                    dst_stages |= stage;
+                    dst_access |= access;
+                    hazard->visible_stages |= stage;
+                }
+                hazard->read_stages |= stage;
+            } else {
+                // Write after write, write after read
+                if (hazard->has_write) {
+                    src_stages |= hazard->write_stage;
+                    src_access |= hazard->write_access;
+                    dst_stages |= stage;
+                    dst_access |= access;
+                }
+                if (hazard->read_stages) {
+                    src_stages |= hazard->read_stages;
+                    dst_stages |= stage;
+                }
+                hazard->has_write = 1;
+                hazard->write_stage = stage;
+                hazard->write_access = access;
+                hazard->read_stages = 0;
+                hazard->visible_stages = 0;
+            }
+        }
+
+        if (src_stages) {
+            VkMemoryBarrier barrier = {
+                .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+                .srcAccessMask = src_access,
+                .dstAccessMask = dst_access
+            };
+            vkCmdPipelineBarrier(cmd, src_stages, dst_stages, 0, 1, &barrier, 0, NULL, 0, NULL);
+        }
+
+        if (pass->record) {
+            pass->record(cmd, graph, pass->user_data);
+        }
+    }
+}
+
+VkBuffer rg_buffer(const RenderGraph* graph, int resource) {
+    if (resource < 0 || resource >= graph->resource_count) return VK_NULL_HANDLE;
+    return graph->resources[resource].buffer;
+}
+
+VkDeviceSize rg_transient_bytes(const RenderGraph* graph, VkDeviceSize* unaliased_bytes) {
+    VkDeviceSize total = 0;
+    for (int s = 0; s < graph->slot_count; s++) {
+        total += graph->slots[s].size;
+    }
+    if (unaliased_bytes) {
+        VkDeviceSize unaliased = 0;
+        for (int i = 0; i < graph->resource_count; i++) {
+            const RgResource* resource = &graph->resources[i];
+            if (!resource->imported && resource->slot != RG_NO_SLOT) {
+                unaliased += resource->requirements.size;
+            }
+        }
+        *unaliased_bytes = unaliased;
+    }
+    return total;
+}
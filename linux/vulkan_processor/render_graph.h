@@ -0,0 +1,69 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Small render graph for multi-pass GPU work. Passes declare which buffers
+// they read and write; the graph records them in order with the barriers the
+// declared accesses need, and places transient buffers whose lifetimes don't
+// overlap on the same device memory.
+//
+// Usage: rg_create, import/create resources, add passes and their uses,
+// rg_compile, rg_execute into a command buffer, submit, rg_destroy.
+
+#define RG_MAX_RESOURCES 32
+#define RG_MAX_PASSES 16
+#define RG_MAX_PASS_USES 8
+
+typedef enum {
+    RG_ACCESS_SHADER_READ,
+    RG_ACCESS_SHADER_WRITE,
+    RG_ACCESS_TRANSFER_READ,
+    RG_ACCESS_TRANSFER_WRITE
+} RgAccess;
+
+typedef struct RenderGraph RenderGraph;
+
+// Records the commands of one pass. Barriers are already in place.
+typedef void (*RgRecordFn)(VkCommandBuffer cmd, const RenderGraph* graph, void* user_data);
+
+RenderGraph* rg_create(VkDevice device, VkPhysicalDevice physical_device);
+void rg_destroy(RenderGraph* graph);
+
+// A buffer owned by the caller (pooled or host visible). Returns the
+// resource id or -1.
+int rg_import_buffer(RenderGraph* graph, const char* name, VkBuffer buffer);
+
+// A device-local buffer that only lives while the graph runs. Its memory may
+// be shared with other transients. Returns the resource id or -1.
+int rg_create_buffer(RenderGraph* graph, const char* name, VkDeviceSize size, VkBufferUsageFlags usage);
+
+// Add a pass; returns its id or -1
+int rg_add_pass(RenderGraph* graph, const char* name, RgRecordFn record, void* user_data);
+
+// Declare that a pass accesses a resource
+int rg_use(RenderGraph* graph, int pass, int resource, RgAccess access);
+
+// Compute lifetimes, alias transients and allocate their memory
+int rg_compile(RenderGraph* graph);
+
+// Record every pass with its barriers. The graph must be compiled.
+void rg_execute(RenderGraph* graph, VkCommandBuffer cmd);
+
+// Buffer behind a resource (valid after rg_compile for transients)
+VkBuffer rg_buffer(const RenderGraph* graph, int resource);
+
+// Device memory allocated for transients, and what it would have been
+// without aliasing
+VkDeviceSize rg_transient_bytes(const RenderGraph* graph, VkDeviceSize* unaliased_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RENDER_GRAPH_H
@@ -1,35 +1,186 @@
 #include "vulkan_processor.h"
+#include "jpeg_entropy.h"
+#include "render_graph.h"
+#include "cpu_kernel.h"
+#include "job_scheduler.h"
+#include "mem_stats.h"
+#include "cube_lut.h"
+#ifdef AKS_EMBEDDED_SHADERS
+#include "embedded_shaders.h"
+#endif
 #include <vulkan/vulkan.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <math.h>
+#include <pthread.h>
+#include <unistd.h>
 
 // Verbose logging flag - set via environment variable VULKAN_VERBOSE=1
 static int verbose_logging = 0;
 
 #define VLOG(...) do { if (verbose_logging) printf(__VA_ARGS__); } while(0)
 
-// Vulkan state
+// Device state, shared by every context. Created by vk_init and only read
+// until vk_cleanup.
 static VkInstance instance = VK_NULL_HANDLE;
 static VkPhysicalDevice physical_device = VK_NULL_HANDLE;
 static VkDevice device = VK_NULL_HANDLE;
-static VkQueue compute_queue = VK_NULL_HANDLE;
-static VkCommandPool command_pool = VK_NULL_HANDLE;
-static VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
 static VkPipeline compute_pipeline = VK_NULL_HANDLE;
 static VkPipelineLayout pipeline_layout = VK_NULL_HANDLE;
 static VkDescriptorSetLayout descriptor_set_layout = VK_NULL_HANDLE;
 static uint32_t queue_family_index = 0;
 static VkShaderModule compute_shader_module = VK_NULL_HANDLE;
 
-// Buffer management
-static VkBuffer staging_buffer = VK_NULL_HANDLE;
-static VkDeviceMemory staging_memory = VK_NULL_HANDLE;
-static VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+// Submitting to a queue must be externally synchronized, so each queue has
+// a lock held only around vkQueueSubmit. When the family offers two queues,
+// interactive contexts get the first at a higher priority and background
+// contexts the second, so previews don't wait behind export dispatches.
+typedef struct {
+    VkQueue queue;
+    pthread_mutex_t lock;
+} SubmitQueue;
 
+#define SUBMIT_QUEUE_INTERACTIVE 0
+#define SUBMIT_QUEUE_BACKGROUND 1
+
+static SubmitQueue submit_queues[2] = {
+    { VK_NULL_HANDLE, PTHREAD_MUTEX_INITIALIZER },
+    { VK_NULL_HANDLE, PTHREAD_MUTEX_INITIALIZER }
+};
+
+// Buffer management. Buffers are kept across calls and only replaced when a
+// larger image comes along, so the descriptors pointing at them rarely change.
+typedef struct {
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkDeviceSize capacity;
+    VkDeviceSize allocated; // Memory size, as reported to mem_stats
+    int purpose;            // MEM_VK_* component
+    void* mapped;           // Persistently mapped when host visible
+} PooledBuffer;
+
+// Image buffers above this size are released after each call instead of
+// being kept for the next one (full resolution exports)
+#define POOL_RETAIN_BYTES (64 * 1024 * 1024)
+
+#define LUT_SIZE 256
+#define DESCRIPTOR_BUFFER_COUNT 7      // Bindings 0-6
+#define DESCRIPTOR_BINDING_COUNT 8     // And the 3D LUT at 7
+
+// Descriptor data for bindings 0-7, laid out for the update template
+typedef struct {
+    VkDescriptorBufferInfo buffers[DESCRIPTOR_BUFFER_COUNT];
+    VkDescriptorImageInfo lut3d;
+} DescriptorData;
+
+// With VK_KHR_push_descriptor the descriptors are recorded straight into the
+// command buffer from a template. Otherwise each context keeps one
+// persistent set, rewritten only when a pooled buffer was replaced.
+static int use_push_descriptors = 0;
+static VkDescriptorUpdateTemplate descriptor_template = VK_NULL_HANDLE;
+static PFN_vkCmdPushDescriptorSetWithTemplateKHR push_descriptor_set_with_template = NULL;
+static uint32_t buffer_generation = 1;  // Bumped whenever any pooled buffer or LUT texture is replaced
+
+// Resident images: decoded sources kept on the GPU between calls so
+// switching back to a recently viewed image needs no upload. Slots are
+// evicted least recently used first to stay inside the VRAM budget. They
+// are shared by all contexts; images being read are not evicted.
+typedef struct {
+    uint64_t image_id;      // Chosen by the caller, one per image and level
+    PooledBuffer pixels;    // Packed RGB, device local
+    int width;
+    int height;
+    uint64_t last_use;
+    int users;              // Dispatches reading it right now
+} ResidentImage;
+
+#define RESIDENT_MAX_IMAGES 16
+
+static ResidentImage resident_images[RESIDENT_MAX_IMAGES];
+static uint64_t resident_clock = 0;
+static pthread_mutex_t resident_lock = PTHREAD_MUTEX_INITIALIZER;
+static int has_memory_properties2 = 0;  // Device is Vulkan 1.1 or newer
+static int has_memory_budget = 0;   // VK_EXT_memory_budget enabled
+
+// 3D LUTs from cube_lut.h, uploaded as RGBA32F textures the first time a
+// call uses them and cached by id (ids are never reused). Shared by all
+// contexts like the resident images; a context pins the one it binds until
+// context_leave. Calls without a LUT bind a 2x2x2 identity.
+typedef struct {
+    uint32_t lut_id;
+    VkImage image;
+    VkDeviceMemory memory;
+    VkImageView view;
+    VkDeviceSize allocated; // Memory size, as reported to mem_stats
+    uint64_t last_use;
+    int users;              // Contexts binding it right now
+} LutTexture;
+
+#define LUT_TEXTURE_CACHE 4
+
+static LutTexture lut_textures[LUT_TEXTURE_CACHE];
+static LutTexture identity_lut_texture;
+static uint64_t lut_clock = 0;
+static pthread_mutex_t lut_lock = PTHREAD_MUTEX_INITIALIZER;
+static VkSampler lut_sampler = VK_NULL_HANDLE;     // Nearest, the shader uses texelFetch
+
+// JPEG encoding: jpeg_dct.comp turns the processed image into quantized
+// coefficients, jpeg_entropy.c does the Huffman coding. Created on first use
+// and run as a render graph so the intermediates share device memory.
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t component;
+    uint32_t sample_x;
+    uint32_t sample_y;
+    uint32_t blocks_wide;
+    uint32_t offset;
+} JpegDctConstants;     // Mirrors the push constant block in jpeg_dct.comp
+
+static int jpeg_state = 0;      // 0 = not created yet, 1 = ready, -1 = unavailable
+static VkShaderModule jpeg_shader_module = VK_NULL_HANDLE;
+static VkDescriptorSetLayout jpeg_set_layout = VK_NULL_HANDLE;
+static VkPipelineLayout jpeg_pipeline_layout = VK_NULL_HANDLE;
+static VkPipeline jpeg_pipeline = VK_NULL_HANDLE;
+
+// Everything a caller records and submits with. One thread uses a context
+// at a time; different contexts run concurrently.
+struct VkProcessorContext {
+    int job_class;              // JOB_CLASS_* its calls are scheduled as
+    SubmitQueue* queue;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+
+    PooledBuffer input_pool;
+    PooledBuffer output_pool;
+    PooledBuffer staging_in_pool;
+    PooledBuffer staging_out_pool;
+    PooledBuffer uniform_pool;
+    PooledBuffer lut_pool;      // rgb, red, green, blue LUTs back to back
+
+    VkDescriptorPool descriptor_pool;
+    VkDescriptorSet persistent_descriptor_set;
+    uint32_t descriptor_generation;     // buffer_generation the set was written for
+    VkBuffer descriptor_input;          // Buffers the set points at
+    VkBuffer descriptor_output;
+    VkImageView descriptor_lut;         // And the 3D LUT
+
+    LutTexture* lut_texture;    // Pinned 3D LUT of the current call, NULL for none
+
+    VkDescriptorPool jpeg_descriptor_pool;
+    VkDescriptorSet jpeg_descriptor_set;
+    PooledBuffer coefficient_staging_pool;
+    PooledBuffer quant_pool;
+
+    int busy;                   // Guards against two threads sharing it
+};
+
+static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;   // vk_init, vk_cleanup, JPEG setup
 static int initialized = 0;
-static int processing = 0; // Guard against concurrent processing
+static VkProcessorContext* default_context = NULL;     // Behind the functions without a context
 
 // Check for verbose logging on first call
 static void check_verbose_logging() {
@@ -73,253 +224,1091 @@ static int check_vk_result(VkResult result, const char* operation) {
     return 1;
 }
 
-int vk_init() {
-    check_verbose_logging();
-    if (initialized) return 1;
-    
-    // Create Vulkan instance
-    VkApplicationInfo app_info = {
-        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
-        .pApplicationName = "aks Image Processor",
-        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
-        .pEngineName = "No Engine",
-        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_2
-    };
-    
-    VkInstanceCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
-        .pApplicationInfo = &app_info,
-        .enabledLayerCount = 0,
-        .enabledExtensionCount = 0
+static void pooled_buffer_release(PooledBuffer* pool) {
+    if (pool->buffer == VK_NULL_HANDLE) return;
+    if (pool->mapped) vkUnmapMemory(device, pool->memory);
+    vkDestroyBuffer(device, pool->buffer, NULL);
+    vkFreeMemory(device, pool->memory, NULL);
+    mem_stats_add(pool->purpose, -(int64_t)pool->allocated);
+    memset(pool, 0, sizeof(*pool));
+    __atomic_add_fetch(&buffer_generation, 1, __ATOMIC_RELAXED);
+}
+
+// Make sure the pooled buffer holds at least size bytes
+static int pooled_buffer_reserve(
+    PooledBuffer* pool,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags properties,
+    int purpose,
+    const char* name
+) {
+    if (pool->buffer != VK_NULL_HANDLE && pool->capacity >= size) return 1;
+    pooled_buffer_release(pool);
+
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
     };
-    
-    VkResult result = vkCreateInstance(&create_info, NULL, &instance);
-    if (!check_vk_result(result, "vkCreateInstance")) {
+
+    VkResult result = vkCreateBuffer(device, &buffer_info, NULL, &pool->buffer);
+    if (!check_vk_result(result, name)) {
+        pool->buffer = VK_NULL_HANDLE;
         return 0;
     }
-    
-    // Get physical device
-    uint32_t device_count = 0;
-    vkEnumeratePhysicalDevices(instance, &device_count, NULL);
-    if (device_count == 0) {
-        fprintf(stderr, "No Vulkan devices found\n");
+
+    VkMemoryRequirements mem_reqs;
+    vkGetBufferMemoryRequirements(device, pool->buffer, &mem_reqs);
+
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits, properties)
+    };
+
+    result = vkAllocateMemory(device, &alloc_info, NULL, &pool->memory);
+    if (!check_vk_result(result, name)) {
+        vkDestroyBuffer(device, pool->buffer, NULL);
+        memset(pool, 0, sizeof(*pool));
         return 0;
     }
-    
-    VkPhysicalDevice* devices = malloc(sizeof(VkPhysicalDevice) * device_count);
-    vkEnumeratePhysicalDevices(instance, &device_count, devices);
-    
-    // Pick first device with compute support
-    for (uint32_t i = 0; i < device_count; i++) {
-        uint32_t queue_family_count = 0;
-        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_family_count, NULL);
-        
-        VkQueueFamilyProperties* queue_families = malloc(sizeof(VkQueueFamilyProperties) * queue_family_count);
-        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_family_count, queue_families);
-        
-        for (uint32_t j = 0; j < queue_family_count; j++) {
-            if (queue_families[j].queueFlags & VK_QUEUE_COMPUTE_BIT) {
-                physical_device = devices[i];
-                queue_family_index = j;
-                break;
-            }
+
+    vkBindBufferMemory(device, pool->buffer, pool->memory, 0);
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(device, pool->memory, 0, VK_WHOLE_SIZE, 0, &pool->mapped);
+        if (!check_vk_result(result, name)) {
+            vkDestroyBuffer(device, pool->buffer, NULL);
+            vkFreeMemory(device, pool->memory, NULL);
+            memset(pool, 0, sizeof(*pool));
+            return 0;
         }
-        free(queue_families);
-        
-        if (physical_device != VK_NULL_HANDLE) break;
-    }
-    free(devices);
-    
-    if (physical_device == VK_NULL_HANDLE) {
-        fprintf(stderr, "No suitable Vulkan device found\n");
-        return 0;
     }
-    
-    // Create logical device
-    float queue_priority = 1.0f;
-    VkDeviceQueueCreateInfo queue_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-        .queueFamilyIndex = queue_family_index,
-        .queueCount = 1,
-        .pQueuePriorities = &queue_priority
-    };
-    
-    VkPhysicalDeviceFeatures device_features = {};
-    
-    VkDeviceCreateInfo device_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &queue_create_info,
-        .pEnabledFeatures = &device_features,
-        .enabledExtensionCount = 0,
-        .enabledLayerCount = 0
+
+    pool->capacity = size;
+    pool->allocated = mem_reqs.size;
+    pool->purpose = purpose;
+    mem_stats_add(purpose, (int64_t)mem_reqs.size);
+    __atomic_add_fetch(&buffer_generation, 1, __ATOMIC_RELAXED);
+    VLOG("Pooled buffer %s: %llu bytes\n", name, (unsigned long long)size);
+    return 1;
+}
+
+static int create_shader_module(const uint32_t* code, size_t size, VkShaderModule* module) {
+    VkShaderModuleCreateInfo shader_info = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = size,
+        .pCode = code
     };
     
-    result = vkCreateDevice(physical_device, &device_create_info, NULL, &device);
-    if (!check_vk_result(result, "vkCreateDevice")) {
+    VkResult result = vkCreateShaderModule(device, &shader_info, NULL, module);
+    return check_vk_result(result, "vkCreateShaderModule");
+}
+
+// Read <dir>/<name>.spv into a shader module
+static int load_shader_file(const char* dir, const char* name, VkShaderModule* module) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.spv", dir, name);
+    FILE* shader_file = fopen(path, "rb");
+    if (!shader_file) {
+        fprintf(stderr, "Failed to open shader file %s\n", path);
         return 0;
     }
     
-    // Get compute queue
-    vkGetDeviceQueue(device, queue_family_index, 0, &compute_queue);
-    
-    // Create command pool
-    VkCommandPoolCreateInfo pool_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-        .queueFamilyIndex = queue_family_index
-    };
-    
-    result = vkCreateCommandPool(device, &pool_info, NULL, &command_pool);
-    if (!check_vk_result(result, "vkCreateCommandPool")) {
+    fseek(shader_file, 0, SEEK_END);
+    long file_size = ftell(shader_file);
+    fseek(shader_file, 0, SEEK_SET);
+    if (file_size <= 0 || file_size % 4 != 0) {
+        fprintf(stderr, "Invalid shader file %s\n", path);
+        fclose(shader_file);
         return 0;
     }
+    size_t shader_size = (size_t)file_size;
     
-    // Create descriptor set layout
-    VkDescriptorSetLayoutBinding bindings[] = {
-        // Input image buffer
-        {
-            .binding = 0,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // Output image buffer
-        {
-            .binding = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // Uniform buffer for parameters
-        {
-            .binding = 2,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // RGB tone curve LUT
-        {
-            .binding = 3,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // Red tone curve LUT
-        {
-            .binding = 4,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // Green tone curve LUT
-        {
-            .binding = 5,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        },
-        // Blue tone curve LUT
-        {
-            .binding = 6,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .descriptorCount = 1,
-            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-            .pImmutableSamplers = NULL
-        }
-    };
-    
-    VkDescriptorSetLayoutCreateInfo layout_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-        .bindingCount = 7,
-        .pBindings = bindings
-    };
-    
-    result = vkCreateDescriptorSetLayout(device, &layout_info, NULL, &descriptor_set_layout);
-    if (!check_vk_result(result, "vkCreateDescriptorSetLayout")) {
-        vk_cleanup();
+    uint32_t* shader_code = (uint32_t*)malloc(shader_size);
+    if (!shader_code || fread(shader_code, 1, shader_size, shader_file) != shader_size) {
+        fprintf(stderr, "Failed to read shader file %s\n", path);
+        free(shader_code);
+        fclose(shader_file);
         return 0;
     }
+    fclose(shader_file);
     
-    // Create pipeline layout
-    VkPipelineLayoutCreateInfo pipeline_layout_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &descriptor_set_layout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = NULL
-    };
-    
-    result = vkCreatePipelineLayout(device, &pipeline_layout_info, NULL, &pipeline_layout);
-    if (!check_vk_result(result, "vkCreatePipelineLayout")) {
-        vk_cleanup();
-        return 0;
+    VLOG("Using shader override %s\n", path);
+    int ok = create_shader_module(shader_code, shader_size, module);
+    free(shader_code);
+    return ok;
+}
+
+// Shaders are the SPIR-V embedded at build time. AKS_SHADER_DIR=<dir> loads
+// <dir>/<name>.spv instead, for iterating on shaders without a rebuild;
+// nothing else is looked up on disk.
+static int load_shader_module(const char* name, VkShaderModule* module) {
+    const char* override_dir = getenv("AKS_SHADER_DIR");
+    if (override_dir && override_dir[0] != '\0') {
+        return load_shader_file(override_dir, name, module);
     }
     
-    // Load compute shader - try different paths
-    const char* shader_paths[] = {
-        "linux/vulkan_processor/shaders/image_process.spv",
-        "linux/build/shaders/image_process.spv",
-        "shaders/image_process.spv",
-        "../shaders/image_process.spv",
-        "build/shaders/image_process.spv",
-        "bundle/data/shaders/image_process.spv",
-        "build/linux/x64/debug/shaders/image_process.spv",
-        "build/linux/x64/debug/bundle/data/shaders/image_process.spv",
-        "/var/home/o/Projects/aks/build/linux/x64/debug/shaders/image_process.spv",
-        NULL
-    };
+#ifdef AKS_EMBEDDED_SHADERS
+    size_t embedded_size = 0;
+    const uint32_t* embedded = embedded_shader(name, &embedded_size);
+    if (embedded) {
+        VLOG("Using embedded shader %s (%zu bytes)\n", name, embedded_size);
+        return create_shader_module(embedded, embedded_size, module);
+    }
+#endif
     
-    FILE* shader_file = NULL;
-    for (int i = 0; shader_paths[i] != NULL; i++) {
-        shader_file = fopen(shader_paths[i], "rb");
-        if (shader_file) {
-            VLOG("Found shader at: %s\n", shader_paths[i]);
+    fprintf(stderr, "Shader %s is not embedded in this build; "
+            "rebuild with glslc or set AKS_SHADER_DIR\n", name);
+    return 0;
+}
+
+static int device_supports_extension(VkPhysicalDevice candidate, const char* name) {
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(candidate, NULL, &count, NULL);
+    if (count == 0) return 0;
+
+    VkExtensionProperties* extensions = malloc(sizeof(VkExtensionProperties) * count);
+    if (!extensions) return 0;
+    vkEnumerateDeviceExtensionProperties(candidate, NULL, &count, extensions);
+
+    int found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(extensions[i].extensionName, name) == 0) {
+            found = 1;
             break;
         }
     }
-    
-    if (!shader_file) {
-        fprintf(stderr, "Failed to find shader file\n");
-        vk_cleanup();
-        return 0;
+    free(extensions);
+    return found;
+}
+
+// Push descriptors with a template need the extension and Vulkan 1.1 for
+// descriptor update templates. VULKAN_NO_PUSH_DESCRIPTOR=1 forces the
+// persistent descriptor set path.
+static int want_push_descriptors(void) {
+    const char* env = getenv("VULKAN_NO_PUSH_DESCRIPTOR");
+    if (env && strcmp(env, "1") == 0) return 0;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    if (properties.apiVersion < VK_API_VERSION_1_1) return 0;
+
+    return device_supports_extension(physical_device, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+}
+
+static void fill_descriptor_data(VkProcessorContext* ctx, DescriptorData* data,
+                                 VkBuffer input_buffer, VkBuffer output_buffer) {
+    VkBuffer buffers[DESCRIPTOR_BUFFER_COUNT] = {
+        input_buffer, output_buffer, ctx->uniform_pool.buffer,
+        ctx->lut_pool.buffer, ctx->lut_pool.buffer, ctx->lut_pool.buffer, ctx->lut_pool.buffer
+    };
+    for (int i = 0; i < DESCRIPTOR_BUFFER_COUNT; i++) {
+        data->buffers[i].buffer = buffers[i];
+        data->buffers[i].offset = 0;
+        data->buffers[i].range = VK_WHOLE_SIZE;
     }
-    
-    fseek(shader_file, 0, SEEK_END);
-    size_t shader_size = ftell(shader_file);
-    fseek(shader_file, 0, SEEK_SET);
-    
-    uint32_t* shader_code = (uint32_t*)malloc(shader_size);
-    fread(shader_code, 1, shader_size, shader_file);
-    fclose(shader_file);
-    
-    VkShaderModuleCreateInfo shader_info = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = shader_size,
-        .pCode = shader_code
+    data->buffers[2].range = sizeof(AksAdjustmentParams);
+    for (int i = 0; i < 4; i++) {
+        data->buffers[3 + i].offset = (VkDeviceSize)i * LUT_SIZE;
+        data->buffers[3 + i].range = LUT_SIZE;
+    }
+    data->lut3d.sampler = lut_sampler;
+    data->lut3d.imageView = ctx->lut_texture ? ctx->lut_texture->view : identity_lut_texture.view;
+    data->lut3d.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+// Fallback path: point the persistent set at the current pooled buffers
+static void write_persistent_descriptor_set(VkProcessorContext* ctx, const DescriptorData* data,
+                                            uint32_t generation) {
+    VkWriteDescriptorSet writes[DESCRIPTOR_BINDING_COUNT];
+    for (int i = 0; i < DESCRIPTOR_BUFFER_COUNT; i++) {
+        writes[i] = (VkWriteDescriptorSet){
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = ctx->persistent_descriptor_set,
+            .dstBinding = i,
+            .descriptorCount = 1,
+            .descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &data->buffers[i]
+        };
+    }
+    writes[DESCRIPTOR_BUFFER_COUNT] = (VkWriteDescriptorSet){
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = ctx->persistent_descriptor_set,
+        .dstBinding = DESCRIPTOR_BUFFER_COUNT,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &data->lut3d
     };
-    
-    result = vkCreateShaderModule(device, &shader_info, NULL, &compute_shader_module);
-    free(shader_code);
-    
-    if (!check_vk_result(result, "vkCreateShaderModule")) {
-        vk_cleanup();
-        return 0;
+    vkUpdateDescriptorSets(device, DESCRIPTOR_BINDING_COUNT, writes, 0, NULL);
+    ctx->descriptor_generation = generation;
+    ctx->descriptor_input = data->buffers[0].buffer;
+    ctx->descriptor_output = data->buffers[1].buffer;
+    ctx->descriptor_lut = data->lut3d.imageView;
+    VLOG("Persistent descriptor set rewritten\n");
+}
+
+// Bind the adjustment pipeline and its descriptors for these buffers
+static void bind_adjustment_pipeline(VkProcessorContext* ctx, VkCommandBuffer cmd,
+                                     VkBuffer input_buffer, VkBuffer output_buffer) {
+    DescriptorData descriptors;
+    fill_descriptor_data(ctx, &descriptors, input_buffer, output_buffer);
+    
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline);
+    if (use_push_descriptors) {
+        push_descriptor_set_with_template(cmd, descriptor_template, pipeline_layout, 0, &descriptors);
+        return;
     }
     
-    // Create compute pipeline
-    VkPipelineShaderStageCreateInfo shader_stage_info = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-        .module = compute_shader_module,
-        .pName = "main"
+    uint32_t generation = __atomic_load_n(&buffer_generation, __ATOMIC_RELAXED);
+    if (ctx->descriptor_generation != generation ||
+        ctx->descriptor_input != input_buffer || ctx->descriptor_output != output_buffer ||
+        ctx->descriptor_lut != descriptors.lut3d.imageView) {
+        write_persistent_descriptor_set(ctx, &descriptors, generation);
+    }
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+        pipeline_layout, 0, 1, &ctx->persistent_descriptor_set, 0, NULL);
+}
+
+// Create the device side of the descriptor path the device supports
+static int create_descriptor_template(void) {
+    if (use_push_descriptors) {
+        push_descriptor_set_with_template = (PFN_vkCmdPushDescriptorSetWithTemplateKHR)
+            vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetWithTemplateKHR");
+        if (!push_descriptor_set_with_template) {
+            fprintf(stderr, "vkCmdPushDescriptorSetWithTemplateKHR not available\n");
+            return 0;
+        }
+
+        VkDescriptorUpdateTemplateEntry entries[DESCRIPTOR_BINDING_COUNT];
+        for (int i = 0; i < DESCRIPTOR_BUFFER_COUNT; i++) {
+            entries[i] = (VkDescriptorUpdateTemplateEntry){
+                .dstBinding = i,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = i == 2 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .offset = offsetof(DescriptorData, buffers) + i * sizeof(VkDescriptorBufferInfo),
+                .stride = sizeof(VkDescriptorBufferInfo)
+            };
+        }
+        entries[DESCRIPTOR_BUFFER_COUNT] = (VkDescriptorUpdateTemplateEntry){
+            .dstBinding = DESCRIPTOR_BUFFER_COUNT,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .offset = offsetof(DescriptorData, lut3d),
+            .stride = sizeof(VkDescriptorImageInfo)
+        };
+
+        VkDescriptorUpdateTemplateCreateInfo template_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO,
+            .descriptorUpdateEntryCount = DESCRIPTOR_BINDING_COUNT,
+            .pDescriptorUpdateEntries = entries,
+            .templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR,
+            .descriptorSetLayout = descriptor_set_layout,
+            .pipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE,
+            .pipelineLayout = pipeline_layout,
+            .set = 0
+        };
+
+        VkResult result = vkCreateDescriptorUpdateTemplate(device, &template_info, NULL, &descriptor_template);
+        return check_vk_result(result, "vkCreateDescriptorUpdateTemplate");
+    }
+    return 1;
+}
+
+// Without push descriptors, one set for the lifetime of the context
+static int create_context_descriptors(VkProcessorContext* ctx) {
+    if (use_push_descriptors) return 1;
+
+    VkDescriptorPoolSize pool_sizes[] = {
+        { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = DESCRIPTOR_BUFFER_COUNT - 1 },
+        { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 1 },
+        { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 }
+    };
+
+    VkDescriptorPoolCreateInfo desc_pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1,
+        .poolSizeCount = 3,
+        .pPoolSizes = pool_sizes
+    };
+
+    VkResult result = vkCreateDescriptorPool(device, &desc_pool_info, NULL, &ctx->descriptor_pool);
+    if (!check_vk_result(result, "vkCreateDescriptorPool")) {
+        return 0;
+    }
+
+    VkDescriptorSetAllocateInfo desc_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = ctx->descriptor_pool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &descriptor_set_layout
+    };
+
+    result = vkAllocateDescriptorSets(device, &desc_alloc_info, &ctx->persistent_descriptor_set);
+    return check_vk_result(result, "vkAllocateDescriptorSets");
+}
+
+// Buffers that do not depend on the image size
+static int create_static_buffers(VkProcessorContext* ctx) {
+    VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    return pooled_buffer_reserve(&ctx->uniform_pool, sizeof(AksAdjustmentParams),
+               VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, host, MEM_VK_LUT, "uniform") &&
+           pooled_buffer_reserve(&ctx->lut_pool, LUT_SIZE * 4,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host, MEM_VK_LUT, "lut");
+}
+
+// Grow the image buffers for this call. input_size 0 skips the input side
+// (resident source).
+static int reserve_image_buffers(VkProcessorContext* ctx, VkDeviceSize input_size, VkDeviceSize output_size) {
+    VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (input_size > 0 &&
+        !(pooled_buffer_reserve(&ctx->input_pool, input_size,
+              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEM_VK_INPUT, "input") &&
+          pooled_buffer_reserve(&ctx->staging_in_pool, input_size,
+              VK_BUFFER_USAGE_TRANSFER_SRC_BIT, host, MEM_VK_STAGING, "staging_in"))) {
+        return 0;
+    }
+    return pooled_buffer_reserve(&ctx->output_pool, output_size,
+               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEM_VK_OUTPUT, "output") &&
+           pooled_buffer_reserve(&ctx->staging_out_pool, output_size,
+               VK_BUFFER_USAGE_TRANSFER_DST_BIT, host, MEM_VK_STAGING, "staging_out");
+}
+
+static VkResult context_submit(VkProcessorContext* ctx);
+
+static void lut_texture_release(LutTexture* texture) {
+    if (texture->image == VK_NULL_HANDLE) return;
+    VLOG("3D LUT %u released\n", texture->lut_id);
+    if (texture->view != VK_NULL_HANDLE) vkDestroyImageView(device, texture->view, NULL);
+    vkDestroyImage(device, texture->image, NULL);
+    vkFreeMemory(device, texture->memory, NULL);
+    mem_stats_add(MEM_VK_LUT, -(int64_t)texture->allocated);
+    memset(texture, 0, sizeof(*texture));
+    __atomic_add_fetch(&buffer_generation, 1, __ATOMIC_RELAXED);
+}
+
+// Create the texture for a size^3 LUT of r, g, b, 0 entries and upload it
+// through a temporary staging buffer with the context's command buffer.
+// Runs before the caller starts recording.
+static int lut_texture_upload(VkProcessorContext* ctx, LutTexture* texture, int size, const float* data) {
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_3D,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .extent = { (uint32_t)size, (uint32_t)size, (uint32_t)size },
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    VkResult result = vkCreateImage(device, &image_info, NULL, &texture->image);
+    if (!check_vk_result(result, "vkCreateImage (3D LUT)")) {
+        texture->image = VK_NULL_HANDLE;
+        return 0;
+    }
+
+    VkMemoryRequirements mem_reqs;
+    vkGetImageMemoryRequirements(device, texture->image, &mem_reqs);
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = mem_reqs.size,
+        .memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    result = vkAllocateMemory(device, &alloc_info, NULL, &texture->memory);
+    if (!check_vk_result(result, "vkAllocateMemory (3D LUT)")) {
+        vkDestroyImage(device, texture->image, NULL);
+        memset(texture, 0, sizeof(*texture));
+        return 0;
+    }
+    vkBindImageMemory(device, texture->image, texture->memory, 0);
+    texture->allocated = mem_reqs.size;
+    mem_stats_add(MEM_VK_LUT, (int64_t)mem_reqs.size);
+
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = texture->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_3D,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+    };
+    result = vkCreateImageView(device, &view_info, NULL, &texture->view);
+    if (!check_vk_result(result, "vkCreateImageView (3D LUT)")) {
+        texture->view = VK_NULL_HANDLE;
+        lut_texture_release(texture);
+        return 0;
+    }
+
+    size_t bytes = (size_t)size * size * size * 4 * sizeof(float);
+    PooledBuffer staging = {0};
+    VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!pooled_buffer_reserve(&staging, bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, host,
+                               MEM_VK_STAGING, "lut_staging")) {
+        lut_texture_release(texture);
+        return 0;
+    }
+    memcpy(staging.mapped, data, bytes);
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    VkCommandBuffer command_buffer = ctx->command_buffer;
+    result = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (!check_vk_result(result, "vkBeginCommandBuffer")) {
+        pooled_buffer_release(&staging);
+        lut_texture_release(texture);
+        return 0;
+    }
+
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->image,
+        .subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 }
+    };
+    vkCmdPipelineBarrier(command_buffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, NULL, 0, NULL, 1, &barrier);
+
+    // Tightly packed, red along x
+    VkBufferImageCopy copy_region = {
+        .imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 },
+        .imageExtent = { (uint32_t)size, (uint32_t)size, (uint32_t)size }
+    };
+    vkCmdCopyBufferToImage(command_buffer, staging.buffer, texture->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy_region);
+
+    // Every later dispatch samples it
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, NULL, 0, NULL, 1, &barrier);
+
+    vkEndCommandBuffer(command_buffer);
+    result = context_submit(ctx);
+    pooled_buffer_release(&staging);
+    if (result != VK_SUCCESS) {
+        lut_texture_release(texture);
+        return 0;
+    }
+
+    VLOG("3D LUT uploaded (%d^3, %llu bytes)\n", size, (unsigned long long)mem_reqs.size);
+    return 1;
+}
+
+// Drop the context's pin on its 3D LUT
+static void lut_texture_unpin(VkProcessorContext* ctx) {
+    if (!ctx->lut_texture) return;
+    pthread_mutex_lock(&lut_lock);
+    ctx->lut_texture->users--;
+    pthread_mutex_unlock(&lut_lock);
+    ctx->lut_texture = NULL;
+}
+
+// Pin the texture of a registered LUT for the context, uploading it if it
+// isn't cached. Tiles of one call find it already pinned. Returns 0 if the
+// LUT is registered but can't be uploaded; ctx->lut_texture stays NULL when
+// the id isn't registered. Uploads are rare, so lut_lock is simply held
+// through them.
+static int lut_texture_pin(VkProcessorContext* ctx, uint32_t lut_id) {
+    if (ctx->lut_texture && ctx->lut_texture->lut_id == lut_id) return 1;
+    lut_texture_unpin(ctx);
+
+    // Unregistered LUTs are skipped like the CPU kernel does, even if cached
+    const CubeLut* lut = cube_lut_acquire(lut_id);
+    if (!lut) {
+        VLOG("3D LUT %u is not registered, stage skipped\n", lut_id);
+        return 1;
+    }
+
+    pthread_mutex_lock(&lut_lock);
+    LutTexture* texture = NULL;
+    LutTexture* free_slot = NULL;
+    LutTexture* oldest = NULL;
+    for (int i = 0; i < LUT_TEXTURE_CACHE; i++) {
+        LutTexture* candidate = &lut_textures[i];
+        if (candidate->image == VK_NULL_HANDLE) {
+            if (!free_slot) free_slot = candidate;
+        } else if (candidate->lut_id == lut_id) {
+            texture = candidate;
+            break;
+        } else if (candidate->users == 0 && (!oldest || candidate->last_use < oldest->last_use)) {
+            oldest = candidate;
+        }
+    }
+
+    int ok = 1;
+    if (!texture) {
+        LutTexture* slot = free_slot ? free_slot : oldest;
+        if (slot) {
+            lut_texture_release(slot);
+            if (lut_texture_upload(ctx, slot, lut->size, lut->data)) {
+                slot->lut_id = lut_id;
+                texture = slot;
+            }
+        }
+        if (!texture) {
+            fprintf(stderr, "3D LUT %u could not be uploaded\n", lut_id);
+            ok = 0;
+        }
+    }
+    if (texture) {
+        texture->users++;
+        texture->last_use = ++lut_clock;
+    }
+    pthread_mutex_unlock(&lut_lock);
+
+    cube_lut_release(lut);
+    ctx->lut_texture = texture;
+    return ok;
+}
+
+// Fill the uniform and LUT buffers and pin the 3D LUT. NULL LUTs are
+// identity. Called before the command buffer is begun, since a 3D LUT may
+// have to be uploaded first.
+static int write_adjustment_inputs(
+    VkProcessorContext* ctx,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    const uint8_t* luts[4] = { rgb_lut, red_lut, green_lut, blue_lut };
+    uint8_t* mapped_lut = (uint8_t*)ctx->lut_pool.mapped;
+    for (int i = 0; i < 4; i++) {
+        if (luts[i]) {
+            memcpy(mapped_lut + i * LUT_SIZE, luts[i], LUT_SIZE);
+        } else {
+            for (int j = 0; j < LUT_SIZE; j++) mapped_lut[i * LUT_SIZE + j] = (uint8_t)j;
+        }
+    }
+
+    AksAdjustmentParams* uniform = (AksAdjustmentParams*)ctx->uniform_pool.mapped;
+    memcpy(uniform, params, sizeof(*params));
+    if ((params->stages & AKS_STAGE_LUT_3D) != 0) {
+        if (!lut_texture_pin(ctx, params->lut_id)) return 0;
+        if (!ctx->lut_texture) uniform->stages &= ~AKS_STAGE_LUT_3D;
+    }
+    return 1;
+}
+
+// Drop image buffers too large to be worth keeping around
+static void trim_image_buffers(VkProcessorContext* ctx) {
+    PooledBuffer* pools[] = {
+        &ctx->input_pool, &ctx->output_pool, &ctx->staging_in_pool, &ctx->staging_out_pool,
+        &ctx->coefficient_staging_pool
+    };
+    for (int i = 0; i < 5; i++) {
+        if (pools[i]->capacity > POOL_RETAIN_BYTES) {
+            pooled_buffer_release(pools[i]);
+        }
+    }
+}
+
+// The resident_* helpers expect resident_lock to be held
+static uint64_t resident_bytes(void) {
+    uint64_t total = 0;
+    for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+        total += resident_images[i].pixels.capacity;
+    }
+    return total;
+}
+
+// Memory heaps of the device, plus the driver's budget and usage per heap
+// when VK_EXT_memory_budget is enabled. vkGetPhysicalDeviceMemoryProperties2
+// is core only from Vulkan 1.1, so older devices get the 1.0 query and no
+// budget. Returns 1 if budget was filled in.
+static int get_memory_properties(VkPhysicalDeviceMemoryProperties* properties,
+                                 VkPhysicalDeviceMemoryBudgetPropertiesEXT* budget) {
+    memset(budget, 0, sizeof(*budget));
+    budget->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    if (!has_memory_properties2) {
+        vkGetPhysicalDeviceMemoryProperties(physical_device, properties);
+        return 0;
+    }
+
+    VkPhysicalDeviceMemoryProperties2 properties2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = has_memory_budget ? budget : NULL
+    };
+    vkGetPhysicalDeviceMemoryProperties2(physical_device, &properties2);
+    *properties = properties2.memoryProperties;
+    return has_memory_budget;
+}
+
+// How many bytes resident images may occupy. With VK_EXT_memory_budget this
+// follows what the driver says is left for us, keeping half of it for the
+// working buffers of the current edit; without it a quarter of device local
+// memory is used. VULKAN_RESIDENT_BUDGET_MB overrides both.
+static uint64_t resident_budget(void) {
+    const char* env = getenv("VULKAN_RESIDENT_BUDGET_MB");
+    if (env && *env) {
+        return (uint64_t)strtoull(env, NULL, 10) * 1024 * 1024;
+    }
+
+    VkPhysicalDeviceMemoryProperties properties;
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget;
+    int with_budget = get_memory_properties(&properties, &budget);
+
+    uint64_t heap_size = 0, heap_budget = 0, heap_usage = 0;
+    const VkPhysicalDeviceMemoryProperties* memory = &properties;
+    for (uint32_t i = 0; i < memory->memoryHeapCount; i++) {
+        if (!(memory->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)) continue;
+        heap_size += memory->memoryHeaps[i].size;
+        heap_budget += budget.heapBudget[i];
+        heap_usage += budget.heapUsage[i];
+    }
+
+    if (!with_budget || heap_budget == 0) {
+        return heap_size / 4;
+    }
+
+    // Our own resident images count as usage but are ours to hand out again
+    uint64_t ours = resident_bytes();
+    uint64_t others = heap_usage > ours ? heap_usage - ours : 0;
+    uint64_t available = heap_budget > others ? heap_budget - others : 0;
+    return available / 2;
+}
+
+// Heap sizes for mem_stats_get, with the driver's budget and usage when
+// VK_EXT_memory_budget is there
+static void query_memory_heaps(MemStats* stats) {
+    VkPhysicalDeviceMemoryProperties properties;
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget;
+    int with_budget = get_memory_properties(&properties, &budget);
+
+    const VkPhysicalDeviceMemoryProperties* memory = &properties;
+    uint32_t count = memory->memoryHeapCount < MEM_MAX_HEAPS ? memory->memoryHeapCount : MEM_MAX_HEAPS;
+    stats->heap_count = (int32_t)count;
+    for (uint32_t i = 0; i < count; i++) {
+        stats->heap_device_local[i] = (memory->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        stats->heap_size[i] = (int64_t)memory->memoryHeaps[i].size;
+        stats->heap_budget[i] = with_budget ? (int64_t)budget.heapBudget[i] : 0;
+        stats->heap_usage[i] = with_budget ? (int64_t)budget.heapUsage[i] : 0;
+    }
+}
+
+static ResidentImage* resident_find(uint64_t image_id) {
+    for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+        ResidentImage* image = &resident_images[i];
+        if (image->pixels.buffer != VK_NULL_HANDLE && image->image_id == image_id) {
+            return image;
+        }
+    }
+    return NULL;
+}
+
+static void resident_release(ResidentImage* image) {
+    VLOG("Resident image %llu evicted\n", (unsigned long long)image->image_id);
+    pooled_buffer_release(&image->pixels);
+    memset(image, 0, sizeof(*image));
+}
+
+// Evict least recently used images until size more bytes fit the budget.
+// Returns a free slot, or NULL if the image can't fit now.
+static ResidentImage* resident_make_room(uint64_t size) {
+    uint64_t budget = resident_budget();
+    if (size > budget) return NULL;
+
+    for (;;) {
+        ResidentImage* free_slot = NULL;
+        ResidentImage* oldest = NULL;
+        for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+            ResidentImage* image = &resident_images[i];
+            if (image->pixels.buffer == VK_NULL_HANDLE) {
+                if (!free_slot) free_slot = image;
+            } else if (image->users == 0 && (!oldest || image->last_use < oldest->last_use)) {
+                oldest = image;
+            }
+        }
+
+        if (free_slot && resident_bytes() + size <= budget) return free_slot;
+        if (!oldest) return NULL;
+        resident_release(oldest);
+    }
+}
+
+// Take a context for one call; NULL means the default context. A context
+// may move between threads but is never used by two at once, and a call on
+// a busy one is skipped like a second call used to be.
+static VkProcessorContext* context_enter(VkProcessorContext* ctx, const char* caller) {
+    check_verbose_logging();
+    if (!initialized) {
+        fprintf(stderr, "%s: Vulkan not initialized\n", caller);
+        return NULL;
+    }
+    if (!ctx) ctx = default_context;
+    if (__atomic_exchange_n(&ctx->busy, 1, __ATOMIC_ACQUIRE)) {
+        VLOG("%s: Context busy, skipping\n", caller);
+        return NULL;
+    }
+    return ctx;
+}
+
+static void context_leave(VkProcessorContext* ctx) {
+    lut_texture_unpin(ctx);
+    __atomic_store_n(&ctx->busy, 0, __ATOMIC_RELEASE);
+}
+
+// Submit the recorded command buffer and wait on the context's own fence,
+// so work from other contexts keeps flowing meanwhile
+static VkResult context_submit(VkProcessorContext* ctx) {
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &ctx->command_buffer
+    };
+
+    pthread_mutex_lock(&ctx->queue->lock);
+    VkResult result = vkQueueSubmit(ctx->queue->queue, 1, &submit_info, ctx->fence);
+    pthread_mutex_unlock(&ctx->queue->lock);
+
+    if (check_vk_result(result, "vkQueueSubmit")) {
+        result = vkWaitForFences(device, 1, &ctx->fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(device, 1, &ctx->fence);
+    }
+    vkResetCommandBuffer(ctx->command_buffer, 0);
+    return result;
+}
+
+static void context_free(VkProcessorContext* ctx) {
+    if (!ctx) return;
+    // Submissions are waited for before returning, so nothing is in flight
+    if (ctx->fence != VK_NULL_HANDLE) {
+        vkDestroyFence(device, ctx->fence, NULL);
+    }
+    if (ctx->command_pool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(device, ctx->command_pool, NULL);
+    }
+    if (ctx->descriptor_pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, ctx->descriptor_pool, NULL);
+    }
+    if (ctx->jpeg_descriptor_pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, ctx->jpeg_descriptor_pool, NULL);
+    }
+    PooledBuffer* pools[] = {
+        &ctx->input_pool, &ctx->output_pool, &ctx->staging_in_pool, &ctx->staging_out_pool,
+        &ctx->uniform_pool, &ctx->lut_pool, &ctx->coefficient_staging_pool, &ctx->quant_pool
+    };
+    for (size_t i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+        pooled_buffer_release(pools[i]);
+    }
+    free(ctx);
+}
+
+// Command pool, fence, descriptors and small buffers of a new context. The
+// device must exist.
+static VkProcessorContext* context_new(int job_class) {
+    VkProcessorContext* ctx = calloc(1, sizeof(VkProcessorContext));
+    if (!ctx) return NULL;
+    ctx->job_class = job_class;
+    ctx->queue = &submit_queues[job_class == JOB_CLASS_INTERACTIVE ||
+                                submit_queues[SUBMIT_QUEUE_BACKGROUND].queue == VK_NULL_HANDLE
+                                ? SUBMIT_QUEUE_INTERACTIVE : SUBMIT_QUEUE_BACKGROUND];
+
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = queue_family_index
+    };
+    VkResult result = vkCreateCommandPool(device, &pool_info, NULL, &ctx->command_pool);
+    if (!check_vk_result(result, "vkCreateCommandPool")) {
+        context_free(ctx);
+        return NULL;
+    }
+
+    VkCommandBufferAllocateInfo cmd_alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = ctx->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1
+    };
+    result = vkAllocateCommandBuffers(device, &cmd_alloc_info, &ctx->command_buffer);
+    if (!check_vk_result(result, "vkAllocateCommandBuffers")) {
+        context_free(ctx);
+        return NULL;
+    }
+
+    VkFenceCreateInfo fence_info = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    result = vkCreateFence(device, &fence_info, NULL, &ctx->fence);
+    if (!check_vk_result(result, "vkCreateFence")) {
+        context_free(ctx);
+        return NULL;
+    }
+
+    if (!create_context_descriptors(ctx) || !create_static_buffers(ctx)) {
+        context_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static void cleanup_device(void);
+
+// Create the device, the pipelines and the default context. Called with
+// init_lock held.
+static int init_device(void) {
+    // Create Vulkan instance
+    VkApplicationInfo app_info = {
+        .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        .pApplicationName = "aks Image Processor",
+        .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+        .pEngineName = "No Engine",
+        .engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        .apiVersion = VK_API_VERSION_1_2
+    };
+    
+    VkInstanceCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        .pApplicationInfo = &app_info,
+        .enabledLayerCount = 0,
+        .enabledExtensionCount = 0
+    };
+    
+    VkResult result = vkCreateInstance(&create_info, NULL, &instance);
+    if (!check_vk_result(result, "vkCreateInstance")) {
+        return 0;
+    }
+    
+    // Get physical device
+    uint32_t device_count = 0;
+    vkEnumeratePhysicalDevices(instance, &device_count, NULL);
+    if (device_count == 0) {
+        fprintf(stderr, "No Vulkan devices found\n");
+        return 0;
+    }
+    
+    VkPhysicalDevice* devices = malloc(sizeof(VkPhysicalDevice) * device_count);
+    vkEnumeratePhysicalDevices(instance, &device_count, devices);
+    
+    // Pick first device with compute support
+    uint32_t family_queue_count = 1;
+    for (uint32_t i = 0; i < device_count; i++) {
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_family_count, NULL);
+        
+        VkQueueFamilyProperties* queue_families = malloc(sizeof(VkQueueFamilyProperties) * queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queue_family_count, queue_families);
+        
+        for (uint32_t j = 0; j < queue_family_count; j++) {
+            if (queue_families[j].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+                physical_device = devices[i];
+                queue_family_index = j;
+                family_queue_count = queue_families[j].queueCount;
+                break;
+            }
+        }
+        free(queue_families);
+        
+        if (physical_device != VK_NULL_HANDLE) break;
+    }
+    free(devices);
+    
+    if (physical_device == VK_NULL_HANDLE) {
+        fprintf(stderr, "No suitable Vulkan device found\n");
+        return 0;
+    }
+    
+    // Create logical device, with a second queue for background work when
+    // the family has one
+    float queue_priorities[2] = { 1.0f, 0.5f };
+    VkDeviceQueueCreateInfo queue_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        .queueFamilyIndex = queue_family_index,
+        .queueCount = family_queue_count > 1 ? 2 : 1,
+        .pQueuePriorities = queue_priorities
+    };
+    
+    VkPhysicalDeviceFeatures device_features = {};
+    
+    use_push_descriptors = want_push_descriptors();
+    // VK_EXT_memory_budget is read through vkGetPhysicalDeviceMemoryProperties2,
+    // so it is only used where that is core
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+    has_memory_properties2 = device_properties.apiVersion >= VK_API_VERSION_1_1;
+    has_memory_budget = has_memory_properties2 &&
+        device_supports_extension(physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    VLOG("Descriptors: %s\n", use_push_descriptors ? "push descriptors" : "persistent set");
+    VLOG("Memory budget: %s\n", has_memory_budget ? "VK_EXT_memory_budget" : "heap size");
+    
+    const char* device_extensions[2];
+    uint32_t device_extension_count = 0;
+    if (use_push_descriptors) {
+        device_extensions[device_extension_count++] = VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME;
+    }
+    if (has_memory_budget) {
+        device_extensions[device_extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    }
+    
+    VkDeviceCreateInfo device_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .queueCreateInfoCount = 1,
+        .pQueueCreateInfos = &queue_create_info,
+        .pEnabledFeatures = &device_features,
+        .enabledExtensionCount = device_extension_count,
+        .ppEnabledExtensionNames = device_extension_count ? device_extensions : NULL,
+        .enabledLayerCount = 0
+    };
+    
+    result = vkCreateDevice(physical_device, &device_create_info, NULL, &device);
+    if (!check_vk_result(result, "vkCreateDevice")) {
+        return 0;
+    }
+    
+    // Get compute queues
+    vkGetDeviceQueue(device, queue_family_index, 0, &submit_queues[SUBMIT_QUEUE_INTERACTIVE].queue);
+    if (queue_create_info.queueCount > 1) {
+        vkGetDeviceQueue(device, queue_family_index, 1, &submit_queues[SUBMIT_QUEUE_BACKGROUND].queue);
+    }
+    VLOG("Queues: %u\n", queue_create_info.queueCount);
+    
+    // The 3D LUT is read with texelFetch, the sampler only has to be valid
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod = 0.0f
+    };
+    
+    result = vkCreateSampler(device, &sampler_info, NULL, &lut_sampler);
+    if (!check_vk_result(result, "vkCreateSampler")) {
+        cleanup_device();
+        return 0;
+    }
+    
+    // Create descriptor set layout
+    VkDescriptorSetLayoutBinding bindings[] = {
+        // Input image buffer
+        {
+            .binding = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // Output image buffer
+        {
+            .binding = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // Uniform buffer for parameters
+        {
+            .binding = 2,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // RGB tone curve LUT
+        {
+            .binding = 3,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // Red tone curve LUT
+        {
+            .binding = 4,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // Green tone curve LUT
+        {
+            .binding = 5,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // Blue tone curve LUT
+        {
+            .binding = 6,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        },
+        // 3D LUT
+        {
+            .binding = 7,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+            .pImmutableSamplers = NULL
+        }
+    };
+    
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .flags = use_push_descriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0,
+        .bindingCount = DESCRIPTOR_BINDING_COUNT,
+        .pBindings = bindings
+    };
+    
+    result = vkCreateDescriptorSetLayout(device, &layout_info, NULL, &descriptor_set_layout);
+    if (!check_vk_result(result, "vkCreateDescriptorSetLayout")) {
+        cleanup_device();
+        return 0;
+    }
+    
+    // Create pipeline layout
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &descriptor_set_layout,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = NULL
+    };
+    
+    result = vkCreatePipelineLayout(device, &pipeline_layout_info, NULL, &pipeline_layout);
+    if (!check_vk_result(result, "vkCreatePipelineLayout")) {
+        cleanup_device();
+        return 0;
+    }
+    
+    if (!load_shader_module("image_process", &compute_shader_module)) {
+        cleanup_device();
+        return 0;
+    }
+    
+    // Create compute pipeline
+    VkPipelineShaderStageCreateInfo shader_stage_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+        .module = compute_shader_module,
+        .pName = "main"
     };
     
     VkComputePipelineCreateInfo pipeline_info = {
@@ -332,49 +1321,63 @@ int vk_init() {
     
     result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &compute_pipeline);
     if (!check_vk_result(result, "vkCreateComputePipelines")) {
-        vk_cleanup();
+        cleanup_device();
         return 0;
     }
     
-    // Create descriptor pool (allow multiple sets for reuse)
-    VkDescriptorPoolSize pool_sizes[] = {
-        { .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 30 },  // Increased for tone curve LUTs
-        { .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 10 }
-    };
-    
-    VkDescriptorPoolCreateInfo desc_pool_info = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
-        .maxSets = 10,
-        .poolSizeCount = 2,
-        .pPoolSizes = pool_sizes
-    };
-    
-    result = vkCreateDescriptorPool(device, &desc_pool_info, NULL, &descriptor_pool);
-    if (!check_vk_result(result, "vkCreateDescriptorPool")) {
-        vk_cleanup();
+    if (!create_descriptor_template()) {
+        cleanup_device();
         return 0;
     }
     
-    // Allocate command buffer
-    VkCommandBufferAllocateInfo cmd_alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1
-    };
+    // Previews and the other calls without a context of their own
+    default_context = context_new(JOB_CLASS_INTERACTIVE);
+    if (!default_context) {
+        cleanup_device();
+        return 0;
+    }
     
-    result = vkAllocateCommandBuffers(device, &cmd_alloc_info, &command_buffer);
-    if (!check_vk_result(result, "vkAllocateCommandBuffers")) {
-        vk_cleanup();
+    // Bound whenever a call has no 3D LUT
+    float identity[2 * 2 * 2 * 4];
+    for (int i = 0; i < 8; i++) {
+        identity[i * 4 + 0] = (float)(i & 1);
+        identity[i * 4 + 1] = (float)((i >> 1) & 1);
+        identity[i * 4 + 2] = (float)((i >> 2) & 1);
+        identity[i * 4 + 3] = 0.0f;
+    }
+    if (!lut_texture_upload(default_context, &identity_lut_texture, 2, identity)) {
+        cleanup_device();
         return 0;
     }
     
+    mem_stats_set_heap_query(query_memory_heaps);
     initialized = 1;
     VLOG("Vulkan initialized successfully\n");
     return 1;
 }
 
+int vk_init() {
+    check_verbose_logging();
+    pthread_mutex_lock(&init_lock);
+    int ok = initialized || init_device();
+    pthread_mutex_unlock(&init_lock);
+    return ok;
+}
+
+VkProcessorContext* vk_context_create(int job_class) {
+    if (!initialized) {
+        fprintf(stderr, "vk_context_create: Vulkan not initialized\n");
+        return NULL;
+    }
+    if (job_class < 0 || job_class >= JOB_CLASS_COUNT) job_class = JOB_CLASS_BATCH;
+    return context_new(job_class);
+}
+
+void vk_context_destroy(VkProcessorContext* context) {
+    if (!context || context == default_context) return;
+    context_free(context);
+}
+
 int vk_is_available() {
     // Try to create instance to check availability
     VkApplicationInfo app_info = {
@@ -387,778 +1390,1345 @@ int vk_is_available() {
         .pApplicationInfo = &app_info
     };
     
-    VkInstance test_instance;
-    VkResult result = vkCreateInstance(&create_info, NULL, &test_instance);
+    VkInstance test_instance;
+    VkResult result = vkCreateInstance(&create_info, NULL, &test_instance);
+    
+    if (result == VK_SUCCESS) {
+        vkDestroyInstance(test_instance, NULL);
+        return 1;
+    }
+    
+    return 0;
+}
+
+int vk_process_image(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const float* adjustments,
+    int adjustment_count,
+    uint8_t** output_pixels
+) {
+    // Create identity LUTs for backward compatibility
+    uint8_t identity_lut[256];
+    for (int i = 0; i < 256; i++) {
+        identity_lut[i] = i;
+    }
+    
+    // Call the curves version with identity LUTs
+    return vk_process_image_with_curves(
+        input_pixels, width, height,
+        adjustments, adjustment_count,
+        identity_lut, identity_lut, identity_lut, identity_lut,
+        output_pixels
+    );
+}
+
+// Original implementation moved to internal function. The crop in params must
+// already be clamped; image_width/image_height are filled in here. A non-NULL
+// resident image is used as the source instead of uploading input_pixels.
+// The caller holds the context.
+static int vk_process_image_internal(
+    VkProcessorContext* ctx,
+    const ResidentImage* resident,
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels
+) {
+    check_verbose_logging();
+    
+    VLOG("vk_process_image_internal: Processing %dx%d image (stages 0x%x)\n", width, height, adjustments->stages);
+    
+    VkResult result;
+    
+    // The shader reads the struct as-is, so it carries the source dimensions
+    AksAdjustmentParams params = *adjustments;
+    params.image_width = (float)width;
+    params.image_height = (float)height;
+    
+    // Calculate output dimensions based on crop parameters
+    // Match CPU's approach: round to pixels first, then subtract
+    int crop_x, crop_y, output_width, output_height;
+    aks_params_crop_rect(&params, width, height, &crop_x, &crop_y, &output_width, &output_height);
+    
+    if (output_width != width || output_height != height) {
+        VLOG("vk_process_image_internal: Cropping to %dx%d (from %.2f,%.2f to %.2f,%.2f)\n",
+             output_width, output_height, params.crop_left, params.crop_top,
+             params.crop_right, params.crop_bottom);
+    }
+    
+    // Calculate buffer sizes (ensure alignment for storage buffers)
+    size_t input_pixel_count = width * height;
+    size_t output_pixel_count = output_width * output_height;
+    size_t input_size = input_pixel_count * 3;  // RGB
+    size_t output_size = output_pixel_count * 4; // RGBA
+    
+    // Round up buffer sizes to multiple of 4 bytes for alignment
+    size_t input_buffer_size = ((input_size + 3) / 4) * 4;
+    size_t output_buffer_size = output_size; // Already aligned (4 bytes per pixel)
+    
+    if (!reserve_image_buffers(ctx, resident ? 0 : input_buffer_size, output_buffer_size)) {
+        return 0;
+    }
+    
+    // Upload through the persistently mapped buffers
+    VkBuffer input_buffer = resident ? resident->pixels.buffer : ctx->input_pool.buffer;
+    if (!resident) {
+        memcpy(ctx->staging_in_pool.mapped, input_pixels, input_size);
+    }
+    
+    VLOG("vk_process_image_internal: Params: temp=%.1f, exp=%.2f, width=%.0f, height=%.0f\n", 
+         params.temperature, params.exposure, params.image_width, params.image_height);
+    
+    if (!write_adjustment_inputs(ctx, &params, rgb_lut, red_lut, green_lut, blue_lut)) {
+        return 0;
+    }
+    
+    VLOG("vk_process_image_internal: Recording command buffer...\n");
+    VkCommandBuffer command_buffer = ctx->command_buffer;
+    
+    // Record and execute command buffer
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    
+    result = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (!check_vk_result(result, "vkBeginCommandBuffer")) {
+        return 0;
+    }
+    
+    // Copy input data from staging to device
+    VkBufferCopy copy_region = { .size = input_size };
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+    };
+    
+    if (!resident) {
+        vkCmdCopyBuffer(command_buffer, ctx->staging_in_pool.buffer, ctx->input_pool.buffer, 1, &copy_region);
+        
+        // Memory barrier before compute
+        vkCmdPipelineBarrier(command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0, 1, &barrier, 0, NULL, 0, NULL);
+    }
+    
+    // Bind pipeline and descriptors
+    bind_adjustment_pipeline(ctx, command_buffer, input_buffer, ctx->output_pool.buffer);
+    
+    // Dispatch compute shader (16x16 workgroups) based on output dimensions
+    uint32_t group_count_x = (output_width + 15) / 16;
+    uint32_t group_count_y = (output_height + 15) / 16;
+    vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+    
+    // Memory barrier after compute
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    
+    vkCmdPipelineBarrier(command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &barrier, 0, NULL, 0, NULL);
+    
+    // Copy output data from device to staging
+    copy_region.size = output_size;
+    vkCmdCopyBuffer(command_buffer, ctx->output_pool.buffer, ctx->staging_out_pool.buffer, 1, &copy_region);
+    
+    vkEndCommandBuffer(command_buffer);
+    
+    if (context_submit(ctx) != VK_SUCCESS) {
+        return 0;
+    }
     
-    if (result == VK_SUCCESS) {
-        vkDestroyInstance(test_instance, NULL);
-        return 1;
+    // Download output data
+    *output_pixels = (uint8_t*)malloc(output_size);
+    if (*output_pixels) {
+        memcpy(*output_pixels, ctx->staging_out_pool.mapped, output_size);
     }
     
-    return 0;
+    trim_image_buffers(ctx);
+    
+    VLOG("vk_process_image_internal: Complete\n");
+    return *output_pixels != NULL;
 }
 
-int vk_process_image(
+// Process image with tone curves support
+int vk_process_image_with_curves(
     const uint8_t* input_pixels,
     int width,
     int height,
     const float* adjustments,
     int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
     uint8_t** output_pixels
 ) {
-    // Create identity LUTs for backward compatibility
-    uint8_t identity_lut[256];
-    for (int i = 0; i < 256; i++) {
-        identity_lut[i] = i;
-    }
-    
-    // Call the curves version with identity LUTs
-    return vk_process_image_with_curves(
-        input_pixels, width, height,
-        adjustments, adjustment_count,
-        identity_lut, identity_lut, identity_lut, identity_lut,
+    VkProcessorContext* ctx = context_enter(NULL, "vk_process_image_with_curves");
+    if (!ctx) return 0;
+
+    AksAdjustmentParams params;
+    aks_params_from_floats(&params, adjustments, adjustment_count);
+    aks_params_clamp_crop(&params);
+    int ok = vk_process_image_internal(
+        ctx, NULL, input_pixels, width, height,
+        &params,
+        rgb_lut, red_lut, green_lut, blue_lut,
         output_pixels
     );
+    context_leave(ctx);
+    return ok;
 }
 
-// Original implementation moved to internal function
-static int vk_process_image_internal(
+int vk_process_image_with_curves_and_crop(
     const uint8_t* input_pixels,
     int width,
     int height,
     const float* adjustments,
     int adjustment_count,
+    float crop_left,
+    float crop_top,
+    float crop_right,
+    float crop_bottom,
     const uint8_t* rgb_lut,
     const uint8_t* red_lut,
     const uint8_t* green_lut,
     const uint8_t* blue_lut,
-    uint8_t** output_pixels
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
 ) {
-    check_verbose_logging();
-    
-    if (!initialized) {
-        fprintf(stderr, "Vulkan not initialized\n");
+    AksAdjustmentParams params;
+    aks_params_from_floats(&params, adjustments, adjustment_count);
+    params.crop_left = crop_left;
+    params.crop_top = crop_top;
+    params.crop_right = crop_right;
+    params.crop_bottom = crop_bottom;
+
+    return vk_process_image_params(
+        input_pixels, width, height,
+        &params,
+        rgb_lut, red_lut, green_lut, blue_lut,
+        output_pixels, output_width, output_height
+    );
+}
+
+uint32_t vk_get_capabilities(uint32_t* params_version) {
+    if (params_version) *params_version = AKS_PARAMS_VERSION;
+    return AKS_CAP_BASIC | AKS_CAP_CROP | AKS_CAP_TONE_CURVE | AKS_CAP_LUT_3D;
+}
+
+int vk_process_image_params(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    return vk_context_process_image_params(
+        NULL, input_pixels, width, height, adjustments,
+        rgb_lut, red_lut, green_lut, blue_lut,
+        output_pixels, output_width, output_height
+    );
+}
+
+int vk_context_process_image_params(
+    VkProcessorContext* context,
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    AksAdjustmentParams params;
+    if (!aks_params_load(&params, adjustments)) {
+        fprintf(stderr, "vk_process_image_params: invalid parameters\n");
         return 0;
     }
-    
-    // Guard against concurrent processing
-    if (processing) {
-        VLOG("vk_process_image_internal: Already processing, skipping\n");
+    aks_params_clamp_crop(&params);
+
+    int crop_x, crop_y;
+    aks_params_crop_rect(&params, width, height, &crop_x, &crop_y, output_width, output_height);
+
+    uint8_t identity_lut[256];
+    for (int i = 0; i < 256; i++) {
+        identity_lut[i] = i;
+    }
+
+    VkProcessorContext* ctx = context_enter(context, "vk_process_image_params");
+    if (!ctx) return 0;
+
+    // Previews: background workers step aside while this runs
+    job_begin(ctx->job_class);
+    int ok = vk_process_image_internal(
+        ctx, NULL, input_pixels, width, height,
+        &params,
+        rgb_lut ? rgb_lut : identity_lut,
+        red_lut ? red_lut : identity_lut,
+        green_lut ? green_lut : identity_lut,
+        blue_lut ? blue_lut : identity_lut,
+        output_pixels
+    );
+    job_end(ctx->job_class);
+    context_leave(ctx);
+    return ok;
+}
+
+int vk_process_tiled(
+    TiledImage* source,
+    TiledImage* destination,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    AksAdjustmentParams params;
+    aks_params_from_floats(&params, adjustments, adjustment_count);
+    return vk_process_tiled_params(source, destination, &params, rgb_lut, red_lut, green_lut, blue_lut);
+}
+
+// Check the geometry of a tiled call and load its parameters. Tiles are
+// processed whole (edge tiles include their padding), so the crop must not
+// reach either kernel.
+static int load_tiled_params(
+    const char* caller,
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    AksAdjustmentParams* params
+) {
+    if (!source || !destination ||
+        tiled_image_channels(source) != 3 || tiled_image_channels(destination) != 4 ||
+        tiled_image_width(source) != tiled_image_width(destination) ||
+        tiled_image_height(source) != tiled_image_height(destination) ||
+        tiled_image_tile_size(source) != tiled_image_tile_size(destination)) {
+        fprintf(stderr, "%s: source must be RGB and destination RGBA of the same geometry\n", caller);
         return 0;
     }
-    processing = 1;
-    
-    VLOG("vk_process_image_internal: Processing %dx%d image with %d adjustments\n", width, height, adjustment_count);
-    
-    VkResult result;
-    
-    // Calculate output dimensions based on crop parameters
-    int output_width = width;
-    int output_height = height;
-    float crop_left = 0.0f, crop_top = 0.0f, crop_right = 1.0f, crop_bottom = 1.0f;
-    
-    if (adjustment_count >= 18) {
-        // Extract crop parameters from indices 14-17
-        crop_left = adjustments[14];
-        crop_top = adjustments[15];
-        crop_right = adjustments[16];
-        crop_bottom = adjustments[17];
-        
-        // Calculate cropped dimensions
-        // Match CPU's approach: round to pixels first, then subtract
-        int crop_left_px = (int)round(crop_left * width);
-        int crop_top_px = (int)round(crop_top * height);
-        int crop_right_px = (int)round(crop_right * width);
-        int crop_bottom_px = (int)round(crop_bottom * height);
-        
-        output_width = crop_right_px - crop_left_px;
-        output_height = crop_bottom_px - crop_top_px;
-        
-        VLOG("vk_process_image_internal: Cropping to %dx%d (from %.2f,%.2f to %.2f,%.2f)\n",
-             output_width, output_height, crop_left, crop_top, crop_right, crop_bottom);
+
+    if (!aks_params_load(params, adjustments)) {
+        fprintf(stderr, "%s: invalid parameters\n", caller);
+        return 0;
     }
-    
-    // Calculate buffer sizes (ensure alignment for storage buffers)
-    size_t input_pixel_count = width * height;
-    size_t output_pixel_count = output_width * output_height;
-    size_t input_size = input_pixel_count * 3;  // RGB
-    size_t output_size = output_pixel_count * 4; // RGBA
-    
-    // Round up buffer sizes to multiple of 4 bytes for alignment
-    size_t input_buffer_size = ((input_size + 3) / 4) * 4;
-    size_t output_buffer_size = output_size; // Already aligned (4 bytes per pixel)
-    size_t uniform_size = sizeof(float) * 20; // Adjustment parameters with crop (80 bytes)
-    
-    // Create buffers
-    VkBuffer input_buffer, output_buffer, uniform_buffer;
-    VkBuffer rgb_lut_buffer, red_lut_buffer, green_lut_buffer, blue_lut_buffer;
-    VkDeviceMemory input_memory, output_memory, uniform_memory;
-    VkDeviceMemory rgb_lut_memory, red_lut_memory, green_lut_memory, blue_lut_memory;
-    
-    VLOG("vk_process_image_internal: Creating buffers...\n");
-    
-    // Create input buffer (device local)
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = input_buffer_size,
-        .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
-    };
-    
-    result = vkCreateBuffer(device, &buffer_info, NULL, &input_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (input)")) return 0;
-    
-    VLOG("vk_process_image_internal: Input buffer created\n");
-    
-    // Allocate memory for input buffer
-    VkMemoryRequirements mem_reqs;
-    vkGetBufferMemoryRequirements(device, input_buffer, &mem_reqs);
-    
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = mem_reqs.size,
-        .memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits, 
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+
+    params->crop_left = 0.0f;
+    params->crop_top = 0.0f;
+    params->crop_right = 1.0f;
+    params->crop_bottom = 1.0f;
+    return 1;
+}
+
+// Run one tile through the GPU into the destination
+static int gpu_process_tile(
+    VkProcessorContext* ctx,
+    TiledImage* source,
+    TiledImage* destination,
+    int tx,
+    int ty,
+    const AksAdjustmentParams* params,
+    const uint8_t* const luts[4]
+) {
+    int tile_size = tiled_image_tile_size(source);
+    uint8_t* in = tiled_image_acquire_tile(source, tx, ty);
+    if (!in) return 0;
+
+    uint8_t* processed = NULL;
+    int ok = vk_process_image_internal(
+        ctx, NULL, in, tile_size, tile_size, params,
+        luts[0], luts[1], luts[2], luts[3],
+        &processed
+    );
+    tiled_image_release_tile(source, tx, ty, 0);
+
+    if (!ok) {
+        fprintf(stderr, "vk_process_tiled: tile (%d,%d) failed\n", tx, ty);
+        return 0;
+    }
+
+    uint8_t* out = tiled_image_acquire_tile(destination, tx, ty);
+    if (out) {
+        memcpy(out, processed, (size_t)tile_size * tile_size * 4);
+        tiled_image_release_tile(destination, tx, ty, 1);
+    }
+    free(processed);
+    return out != NULL;
+}
+
+int vk_process_tiled_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    return vk_context_process_tiled_params(
+        NULL, source, destination, adjustments, rgb_lut, red_lut, green_lut, blue_lut);
+}
+
+int vk_context_process_tiled_params(
+    VkProcessorContext* context,
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+) {
+    AksAdjustmentParams params;
+    if (!load_tiled_params("vk_process_tiled", source, destination, adjustments, &params)) {
+        return 0;
+    }
+
+    VkProcessorContext* ctx = context_enter(context, "vk_process_tiled");
+    if (!ctx) return 0;
+
+    const uint8_t* luts[4] = { rgb_lut, red_lut, green_lut, blue_lut };
+    int tiles_x = tiled_image_tiles_x(source);
+    int tiles_y = tiled_image_tiles_y(source);
+
+    VLOG("vk_process_tiled: %dx%d tiles of %d px\n", tiles_x, tiles_y, tiled_image_tile_size(source));
+
+    int ok = 1;
+    for (int ty = 0; ty < tiles_y && ok; ty++) {
+        for (int tx = 0; tx < tiles_x && ok; tx++) {
+            ok = gpu_process_tile(ctx, source, destination, tx, ty, &params, luts);
+        }
+    }
+
+    context_leave(ctx);
+    return ok;
+}
+
+// Split rendering: the GPU and the CPU workers take tiles from one counter,
+// so each engine ends up with a share proportional to its speed
+typedef struct {
+    VkProcessorContext* context;
+    TiledImage* source;
+    TiledImage* destination;
+    const AksAdjustmentParams* params;
+    const uint8_t* luts[4];
+    int tiles_x;
+    int tile_count;
+    int next_tile;
+    int cpu_tiles;
+    int failed;
+    pthread_mutex_t mutex;
+} HybridJob;
+
+static int hybrid_next_tile(HybridJob* job) {
+    pthread_mutex_lock(&job->mutex);
+    int index = job->failed ? job->tile_count : job->next_tile++;
+    pthread_mutex_unlock(&job->mutex);
+    return index;
+}
+
+static void* hybrid_cpu_worker(void* arg) {
+    HybridJob* job = arg;
+    int tile_size = tiled_image_tile_size(job->source);
+
+    // Export work: previews get the cores back between tiles
+    job_begin(JOB_CLASS_BATCH);
+
+    for (int index = hybrid_next_tile(job); index < job->tile_count; index = hybrid_next_tile(job)) {
+        int tx = index % job->tiles_x;
+        int ty = index / job->tiles_x;
+        uint8_t* in = tiled_image_acquire_tile(job->source, tx, ty);
+        uint8_t* out = tiled_image_acquire_tile(job->destination, tx, ty);
+
+        int ok = in && out && cpu_process_region_params(
+            in, (size_t)tile_size * 3, tile_size, tile_size, job->params,
+            job->luts[0], job->luts[1], job->luts[2], job->luts[3],
+            out, (size_t)tile_size * 4);
+
+        if (in) tiled_image_release_tile(job->source, tx, ty, 0);
+        if (out) tiled_image_release_tile(job->destination, tx, ty, 1);
+
+        pthread_mutex_lock(&job->mutex);
+        if (ok) {
+            job->cpu_tiles++;
+        } else {
+            job->failed = 1;
+        }
+        pthread_mutex_unlock(&job->mutex);
+
+        job_yield(JOB_CLASS_BATCH);
+    }
+    job_end(JOB_CLASS_BATCH);
+    return NULL;
+}
+
+// Run one tile through both engines. Returns the largest difference in
+// levels (255 if the CPU kernel fails), or -1 if the GPU or the tile fails.
+static int hybrid_tile_error(HybridJob* job, int index) {
+    int tile_size = tiled_image_tile_size(job->source);
+    size_t pixel_count = (size_t)tile_size * tile_size;
+    int tx = index % job->tiles_x;
+    int ty = index / job->tiles_x;
+    uint8_t* cpu_out = malloc(pixel_count * 4);
+    uint8_t* in = tiled_image_acquire_tile(job->source, tx, ty);
+    if (!cpu_out || !in) {
+        free(cpu_out);
+        if (in) tiled_image_release_tile(job->source, tx, ty, 0);
+        return -1;
+    }
+
+    uint8_t* gpu_out = NULL;
+    int ok = vk_process_image_internal(
+        job->context, NULL, in, tile_size, tile_size, job->params,
+        job->luts[0], job->luts[1], job->luts[2], job->luts[3],
+        &gpu_out);
+    int cpu_ok = cpu_process_region_params(
+        in, (size_t)tile_size * 3, tile_size, tile_size, job->params,
+        job->luts[0], job->luts[1], job->luts[2], job->luts[3],
+        cpu_out, (size_t)tile_size * 4);
+    tiled_image_release_tile(job->source, tx, ty, 0);
+
+    int max_error = cpu_ok ? 0 : 255;
+    if (ok && cpu_ok) {
+        for (size_t i = 0; i < pixel_count * 4; i++) {
+            int error = abs((int)gpu_out[i] - (int)cpu_out[i]);
+            if (error > max_error) max_error = error;
+        }
+    }
+    free(gpu_out);
+    free(cpu_out);
+    return ok ? max_error : -1;
+}
+
+// Compare the engines on up to VK_HYBRID_SAMPLE_TILES tiles spread from the
+// first to the last, so edge tiles and the image body are both covered. The
+// samples are only compared; the tile loop renders them again. Returns 1 if
+// the engines agree, 0 if not, -1 on failure.
+static int hybrid_engines_agree(HybridJob* job) {
+    int samples = job->tile_count < VK_HYBRID_SAMPLE_TILES ? job->tile_count : VK_HYBRID_SAMPLE_TILES;
+    int max_error = 0;
+    for (int s = 0; s < samples; s++) {
+        int index = samples > 1 ? (int)((int64_t)s * (job->tile_count - 1) / (samples - 1)) : 0;
+        int error = hybrid_tile_error(job, index);
+        if (error < 0) return -1;
+        if (error > max_error) max_error = error;
+    }
+
+    if (max_error > VK_HYBRID_TOLERANCE) {
+        fprintf(stderr, "vk_process_tiled_hybrid: CPU kernel differs from GPU by %d levels, GPU only\n",
+                max_error);
+        return 0;
+    }
+    VLOG("vk_process_tiled_hybrid: engines agree within %d levels on %d tiles\n", max_error, samples);
+    return 1;
+}
+
+int vk_process_tiled_hybrid_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int cpu_threads
+) {
+    return vk_context_process_tiled_hybrid_params(
+        NULL, source, destination, adjustments, rgb_lut, red_lut, green_lut, blue_lut, cpu_threads);
+}
+
+int vk_context_process_tiled_hybrid_params(
+    VkProcessorContext* context,
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int cpu_threads
+) {
+    AksAdjustmentParams params;
+    if (!load_tiled_params("vk_process_tiled_hybrid", source, destination, adjustments, &params)) {
+        return 0;
+    }
+
+    VkProcessorContext* ctx = context_enter(context, "vk_process_tiled_hybrid");
+    if (!ctx) return 0;
+
+    HybridJob job = {
+        .context = ctx,
+        .source = source,
+        .destination = destination,
+        .params = &params,
+        .luts = { rgb_lut, red_lut, green_lut, blue_lut },
+        .tiles_x = tiled_image_tiles_x(source),
+        .tile_count = tiled_image_tiles_x(source) * tiled_image_tiles_y(source),
+        .next_tile = 0
     };
-    
-    result = vkAllocateMemory(device, &alloc_info, NULL, &input_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (input)")) {
-        vkDestroyBuffer(device, input_buffer, NULL);
+    if (job.tile_count == 0) {
+        context_leave(ctx);
+        return 1;
+    }
+
+    int agree = hybrid_engines_agree(&job);
+    if (agree < 0) {
+        context_leave(ctx);
         return 0;
     }
+
+    // One core stays with the GPU submissions
+    if (cpu_threads <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        cpu_threads = cores > 1 ? (int)cores - 1 : 1;
+    }
+    if (!agree) cpu_threads = 0;
+    if (cpu_threads > job.tile_count - 1) cpu_threads = job.tile_count - 1;
+
+    pthread_mutex_init(&job.mutex, NULL);
+    pthread_t* threads = cpu_threads > 0 ? malloc(sizeof(pthread_t) * cpu_threads) : NULL;
+    int started = 0;
+    if (threads) {
+        while (started < cpu_threads &&
+               pthread_create(&threads[started], NULL, hybrid_cpu_worker, &job) == 0) {
+            started++;
+        }
+    }
+
+    int gpu_tiles = 0;
+    for (int index = hybrid_next_tile(&job); index < job.tile_count; index = hybrid_next_tile(&job)) {
+        if (!gpu_process_tile(ctx, source, destination, index % job.tiles_x, index / job.tiles_x,
+                              &params, job.luts)) {
+            pthread_mutex_lock(&job.mutex);
+            job.failed = 1;
+            pthread_mutex_unlock(&job.mutex);
+            break;
+        }
+        gpu_tiles++;
+    }
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&job.mutex);
+    context_leave(ctx);
+
+    VLOG("vk_process_tiled_hybrid: %d tiles on the GPU, %d on %d CPU workers\n",
+         gpu_tiles, job.cpu_tiles, started);
+    return !job.failed;
+}
+
+int vk_resident_upload(uint64_t image_id, const uint8_t* pixels, int width, int height) {
+    return vk_context_resident_upload(NULL, image_id, pixels, width, height);
+}
+
+// Uploads happen once per opened image, so resident_lock is simply held
+// through the copy rather than publishing a half-uploaded slot
+int vk_context_resident_upload(VkProcessorContext* context, uint64_t image_id,
+                               const uint8_t* pixels, int width, int height) {
+    if (!pixels || width <= 0 || height <= 0) return 0;
+    VkProcessorContext* ctx = context_enter(context, "vk_resident_upload");
+    if (!ctx) return 0;
+    
+    pthread_mutex_lock(&resident_lock);
+    int ok = 0;
+    ResidentImage* image = NULL;
+    
+    ResidentImage* existing = resident_find(image_id);
+    if (existing && existing->width == width && existing->height == height) {
+        existing->last_use = ++resident_clock;
+        ok = 1;
+        goto done;
+    }
+    if (existing) {
+        if (existing->users > 0) goto done;
+        resident_release(existing);
+    }
     
-    vkBindBufferMemory(device, input_buffer, input_memory, 0);
+    size_t input_size = (size_t)width * height * 3;
+    size_t buffer_size = ((input_size + 3) / 4) * 4;
     
-    // Create output buffer
-    buffer_info.size = output_buffer_size;
-    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    image = resident_make_room(buffer_size);
+    if (!image) {
+        VLOG("vk_resident_upload: %dx%d does not fit the budget\n", width, height);
+        goto done;
+    }
     
-    result = vkCreateBuffer(device, &buffer_info, NULL, &output_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (output)")) {
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        return 0;
+    VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!pooled_buffer_reserve(&image->pixels, buffer_size,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MEM_VK_INPUT, "resident") ||
+        !pooled_buffer_reserve(&ctx->staging_in_pool, buffer_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, host, MEM_VK_STAGING, "staging_in")) {
+        goto done;
     }
     
-    vkGetBufferMemoryRequirements(device, output_buffer, &mem_reqs);
-    alloc_info.allocationSize = mem_reqs.size;
+    memcpy(ctx->staging_in_pool.mapped, pixels, input_size);
     
-    result = vkAllocateMemory(device, &alloc_info, NULL, &output_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (output)")) {
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        return 0;
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    
+    VkCommandBuffer command_buffer = ctx->command_buffer;
+    VkResult result = vkBeginCommandBuffer(command_buffer, &begin_info);
+    if (!check_vk_result(result, "vkBeginCommandBuffer")) {
+        goto done;
     }
     
-    vkBindBufferMemory(device, output_buffer, output_memory, 0);
+    VkBufferCopy copy_region = { .size = input_size };
+    vkCmdCopyBuffer(command_buffer, ctx->staging_in_pool.buffer, image->pixels.buffer, 1, &copy_region);
+    
+    // Make the upload visible to every later dispatch reading it
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+    };
+    vkCmdPipelineBarrier(command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &barrier, 0, NULL, 0, NULL);
     
-    // Create uniform buffer (host visible for parameters)
-    buffer_info.size = uniform_size;
-    buffer_info.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    vkEndCommandBuffer(command_buffer);
     
-    result = vkCreateBuffer(device, &buffer_info, NULL, &uniform_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (uniform)")) {
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        return 0;
+    result = context_submit(ctx);
+    trim_image_buffers(ctx);
+    if (result != VK_SUCCESS) {
+        goto done;
     }
     
-    vkGetBufferMemoryRequirements(device, uniform_buffer, &mem_reqs);
-    alloc_info.allocationSize = mem_reqs.size;
-    alloc_info.memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    image->image_id = image_id;
+    image->width = width;
+    image->height = height;
+    image->last_use = ++resident_clock;
+    ok = 1;
     
-    result = vkAllocateMemory(device, &alloc_info, NULL, &uniform_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (uniform)")) {
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
+    VLOG("vk_resident_upload: Image %llu resident (%dx%d, %llu of %llu bytes used)\n",
+         (unsigned long long)image_id, width, height,
+         (unsigned long long)resident_bytes(), (unsigned long long)resident_budget());
+
+done:
+    if (!ok && image) resident_release(image);
+    pthread_mutex_unlock(&resident_lock);
+    context_leave(ctx);
+    return ok;
+}
+
+int vk_resident_contains(uint64_t image_id) {
+    if (!initialized) return 0;
+    pthread_mutex_lock(&resident_lock);
+    int found = resident_find(image_id) != NULL;
+    pthread_mutex_unlock(&resident_lock);
+    return found;
+}
+
+int vk_process_resident_params(
+    uint64_t image_id,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    return vk_context_process_resident_params(
+        NULL, image_id, adjustments,
+        rgb_lut, red_lut, green_lut, blue_lut,
+        output_pixels, output_width, output_height
+    );
+}
+
+int vk_context_process_resident_params(
+    VkProcessorContext* context,
+    uint64_t image_id,
+    const AksAdjustmentParams* adjustments,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+) {
+    AksAdjustmentParams params;
+    if (!aks_params_load(&params, adjustments)) {
+        fprintf(stderr, "vk_process_resident_params: invalid parameters\n");
         return 0;
     }
+    aks_params_clamp_crop(&params);
     
-    vkBindBufferMemory(device, uniform_buffer, uniform_memory, 0);
+    VkProcessorContext* ctx = context_enter(context, "vk_process_resident_params");
+    if (!ctx) return 0;
     
-    // Create tone curve LUT buffers (256 bytes each, aligned to 4)
-    size_t lut_size = 256;
-    buffer_info.size = lut_size;
-    buffer_info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    
-    // RGB LUT buffer
-    result = vkCreateBuffer(device, &buffer_info, NULL, &rgb_lut_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (rgb_lut)")) {
-        processing = 0;
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
+    // Pin the image so another context can't evict it while it's read
+    pthread_mutex_lock(&resident_lock);
+    ResidentImage* image = resident_find(image_id);
+    if (image) {
+        image->users++;
+        image->last_use = ++resident_clock;
     }
-    
-    // Red LUT buffer
-    result = vkCreateBuffer(device, &buffer_info, NULL, &red_lut_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (red_lut)")) {
-        processing = 0;
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
+    pthread_mutex_unlock(&resident_lock);
+    if (!image) {
+        context_leave(ctx);
         return 0;
     }
     
-    // Green LUT buffer
-    result = vkCreateBuffer(device, &buffer_info, NULL, &green_lut_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (green_lut)")) {
-        processing = 0;
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
-    }
+    int crop_x, crop_y;
+    aks_params_crop_rect(&params, image->width, image->height, &crop_x, &crop_y, output_width, output_height);
     
-    // Blue LUT buffer
-    result = vkCreateBuffer(device, &buffer_info, NULL, &blue_lut_buffer);
-    if (!check_vk_result(result, "vkCreateBuffer (blue_lut)")) {
-        processing = 0;
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
-    }
+    job_begin(ctx->job_class);
+    int ok = vk_process_image_internal(
+        ctx, image, NULL, image->width, image->height,
+        &params,
+        rgb_lut, red_lut, green_lut, blue_lut,
+        output_pixels
+    );
+    job_end(ctx->job_class);
     
-    // Allocate memory for LUT buffers
-    vkGetBufferMemoryRequirements(device, rgb_lut_buffer, &mem_reqs);
-    alloc_info.allocationSize = mem_reqs.size;
-    alloc_info.memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    result = vkAllocateMemory(device, &alloc_info, NULL, &rgb_lut_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (rgb_lut)")) {
-        processing = 0;
-        vkDestroyBuffer(device, blue_lut_buffer, NULL);
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
-    }
-    vkBindBufferMemory(device, rgb_lut_buffer, rgb_lut_memory, 0);
-    
-    result = vkAllocateMemory(device, &alloc_info, NULL, &red_lut_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (red_lut)")) {
-        processing = 0;
-        vkFreeMemory(device, rgb_lut_memory, NULL);
-        vkDestroyBuffer(device, blue_lut_buffer, NULL);
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
+    pthread_mutex_lock(&resident_lock);
+    image->users--;
+    pthread_mutex_unlock(&resident_lock);
+    context_leave(ctx);
+    return ok;
+}
+
+// Images being processed stay; they are dropped by a later evict or by the
+// budget once unpinned
+void vk_resident_evict(uint64_t image_id) {
+    pthread_mutex_lock(&resident_lock);
+    ResidentImage* image = resident_find(image_id);
+    if (image && image->users == 0) resident_release(image);
+    pthread_mutex_unlock(&resident_lock);
+}
+
+void vk_resident_clear(void) {
+    pthread_mutex_lock(&resident_lock);
+    for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+        if (resident_images[i].pixels.buffer != VK_NULL_HANDLE && resident_images[i].users == 0) {
+            resident_release(&resident_images[i]);
+        }
     }
-    vkBindBufferMemory(device, red_lut_buffer, red_lut_memory, 0);
-    
-    result = vkAllocateMemory(device, &alloc_info, NULL, &green_lut_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (green_lut)")) {
-        processing = 0;
-        vkFreeMemory(device, red_lut_memory, NULL);
-        vkFreeMemory(device, rgb_lut_memory, NULL);
-        vkDestroyBuffer(device, blue_lut_buffer, NULL);
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
-        return 0;
+    pthread_mutex_unlock(&resident_lock);
+}
+
+int vk_resident_stats(uint64_t* used_bytes, uint64_t* budget_bytes) {
+    int count = 0;
+    pthread_mutex_lock(&resident_lock);
+    for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+        if (resident_images[i].pixels.buffer != VK_NULL_HANDLE) count++;
     }
-    vkBindBufferMemory(device, green_lut_buffer, green_lut_memory, 0);
-    
-    result = vkAllocateMemory(device, &alloc_info, NULL, &blue_lut_memory);
-    if (!check_vk_result(result, "vkAllocateMemory (blue_lut)")) {
-        processing = 0;
-        vkFreeMemory(device, green_lut_memory, NULL);
-        vkFreeMemory(device, red_lut_memory, NULL);
-        vkFreeMemory(device, rgb_lut_memory, NULL);
-        vkDestroyBuffer(device, blue_lut_buffer, NULL);
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
+    if (used_bytes) *used_bytes = resident_bytes();
+    if (budget_bytes) *budget_bytes = initialized ? resident_budget() : 0;
+    pthread_mutex_unlock(&resident_lock);
+    return count;
+}
+
+// Create the DCT pipeline the first time a JPEG is encoded. Called with
+// init_lock held.
+static int jpeg_pipeline_init(void) {
+    if (jpeg_state != 0) return jpeg_state == 1;
+    jpeg_state = -1;
+    
+    if (!load_shader_module("jpeg_dct", &jpeg_shader_module)) {
         return 0;
     }
-    vkBindBufferMemory(device, blue_lut_buffer, blue_lut_memory, 0);
-    
-    // Copy LUT data to GPU
-    void* mapped_lut;
-    vkMapMemory(device, rgb_lut_memory, 0, lut_size, 0, &mapped_lut);
-    memcpy(mapped_lut, rgb_lut, lut_size);
-    vkUnmapMemory(device, rgb_lut_memory);
-    
-    vkMapMemory(device, red_lut_memory, 0, lut_size, 0, &mapped_lut);
-    memcpy(mapped_lut, red_lut, lut_size);
-    vkUnmapMemory(device, red_lut_memory);
     
-    vkMapMemory(device, green_lut_memory, 0, lut_size, 0, &mapped_lut);
-    memcpy(mapped_lut, green_lut, lut_size);
-    vkUnmapMemory(device, green_lut_memory);
-    
-    vkMapMemory(device, blue_lut_memory, 0, lut_size, 0, &mapped_lut);
-    memcpy(mapped_lut, blue_lut, lut_size);
-    vkUnmapMemory(device, blue_lut_memory);
-    
-    VLOG("vk_process_image_internal: Tone curve LUTs uploaded\n");
-    
-    // Upload uniform data (adjustment parameters)
-    void* mapped_uniform;
-    vkMapMemory(device, uniform_memory, 0, uniform_size, 0, &mapped_uniform);
-    
-    // Pack adjustment parameters to match shader uniform structure
-    float packed_params[20] = {0}; // Initialize all to 0 (now includes crop params)
-    
-    // Copy the adjustments
-    int params_to_copy = (adjustment_count < 20) ? adjustment_count : 20;
-    for (int i = 0; i < params_to_copy; i++) {
-        packed_params[i] = adjustments[i];
+    VkDescriptorSetLayoutBinding bindings[3];
+    for (int i = 0; i < 3; i++) {
+        bindings[i] = (VkDescriptorSetLayoutBinding){
+            .binding = i,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT
+        };
     }
     
-    // Always set image dimensions
-    packed_params[11] = (float)width;   // imageWidth
-    packed_params[12] = (float)height;  // imageHeight
-    
-    // If crop parameters weren't provided (adjustment_count < 18), set defaults
-    if (adjustment_count < 15) packed_params[14] = 0.0f;  // cropLeft
-    if (adjustment_count < 16) packed_params[15] = 0.0f;  // cropTop
-    if (adjustment_count < 17) packed_params[16] = 1.0f;  // cropRight
-    if (adjustment_count < 18) packed_params[17] = 1.0f;  // cropBottom
-    
-    VLOG("vk_process_image_internal: Params: temp=%.1f, exp=%.2f, width=%.0f, height=%.0f\n", 
-         packed_params[0], packed_params[2], packed_params[11], packed_params[12]);
-    
-    memcpy(mapped_uniform, packed_params, sizeof(packed_params));
-    vkUnmapMemory(device, uniform_memory);
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 3,
+        .pBindings = bindings
+    };
     
-    // Create staging buffer for input upload
-    VkBuffer staging_in;
-    VkDeviceMemory staging_in_memory;
+    VkResult result = vkCreateDescriptorSetLayout(device, &layout_info, NULL, &jpeg_set_layout);
+    if (!check_vk_result(result, "vkCreateDescriptorSetLayout (jpeg)")) return 0;
     
-    buffer_info.size = input_size;
-    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    VkPushConstantRange push_range = {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(JpegDctConstants)
+    };
     
-    vkCreateBuffer(device, &buffer_info, NULL, &staging_in);
-    vkGetBufferMemoryRequirements(device, staging_in, &mem_reqs);
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &jpeg_set_layout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &push_range
+    };
     
-    alloc_info.allocationSize = mem_reqs.size;
-    alloc_info.memoryTypeIndex = find_memory_type(mem_reqs.memoryTypeBits,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    result = vkCreatePipelineLayout(device, &pipeline_layout_info, NULL, &jpeg_pipeline_layout);
+    if (!check_vk_result(result, "vkCreatePipelineLayout (jpeg)")) return 0;
     
-    vkAllocateMemory(device, &alloc_info, NULL, &staging_in_memory);
-    vkBindBufferMemory(device, staging_in, staging_in_memory, 0);
+    VkComputePipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = jpeg_shader_module,
+            .pName = "main"
+        },
+        .layout = jpeg_pipeline_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1
+    };
     
-    // Upload input data
-    void* mapped_input;
-    vkMapMemory(device, staging_in_memory, 0, input_size, 0, &mapped_input);
-    memcpy(mapped_input, input_pixels, input_size);
-    vkUnmapMemory(device, staging_in_memory);
+    result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &jpeg_pipeline);
+    if (!check_vk_result(result, "vkCreateComputePipelines (jpeg)")) return 0;
     
-    // Create staging buffer for output download
-    VkBuffer staging_out;
-    VkDeviceMemory staging_out_memory;
+    jpeg_state = 1;
+    return 1;
+}
+
+// The DCT descriptor set and quantisation tables of a context, made on its
+// first export
+static int context_jpeg_init(VkProcessorContext* ctx) {
+    if (ctx->jpeg_descriptor_set != VK_NULL_HANDLE) return 1;
+    
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 3
+    };
     
-    buffer_info.size = output_size;
-    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size
+    };
     
-    vkCreateBuffer(device, &buffer_info, NULL, &staging_out);
-    vkGetBufferMemoryRequirements(device, staging_out, &mem_reqs);
+    if (ctx->jpeg_descriptor_pool == VK_NULL_HANDLE) {
+        VkResult result = vkCreateDescriptorPool(device, &pool_info, NULL, &ctx->jpeg_descriptor_pool);
+        if (!check_vk_result(result, "vkCreateDescriptorPool (jpeg)")) return 0;
+    }
     
-    alloc_info.allocationSize = mem_reqs.size;
-    vkAllocateMemory(device, &alloc_info, NULL, &staging_out_memory);
-    vkBindBufferMemory(device, staging_out, staging_out_memory, 0);
+    if (!pooled_buffer_reserve(&ctx->quant_pool, sizeof(float) * 128, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            MEM_VK_LUT, "quant")) {
+        return 0;
+    }
     
-    // Create descriptor set
-    VkDescriptorSet descriptor_set;
-    VkDescriptorSetAllocateInfo desc_alloc_info = {
+    VkDescriptorSetAllocateInfo alloc_info = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = descriptor_pool,
+        .descriptorPool = ctx->jpeg_descriptor_pool,
         .descriptorSetCount = 1,
-        .pSetLayouts = &descriptor_set_layout
+        .pSetLayouts = &jpeg_set_layout
     };
     
-    vkAllocateDescriptorSets(device, &desc_alloc_info, &descriptor_set);
-    
-    // Update descriptor set
-    VkDescriptorBufferInfo buffer_infos[] = {
-        { .buffer = input_buffer, .offset = 0, .range = VK_WHOLE_SIZE },
-        { .buffer = output_buffer, .offset = 0, .range = VK_WHOLE_SIZE },
-        { .buffer = uniform_buffer, .offset = 0, .range = uniform_size },
-        { .buffer = rgb_lut_buffer, .offset = 0, .range = lut_size },
-        { .buffer = red_lut_buffer, .offset = 0, .range = lut_size },
-        { .buffer = green_lut_buffer, .offset = 0, .range = lut_size },
-        { .buffer = blue_lut_buffer, .offset = 0, .range = lut_size }
+    VkResult result = vkAllocateDescriptorSets(device, &alloc_info, &ctx->jpeg_descriptor_set);
+    return check_vk_result(result, "vkAllocateDescriptorSets (jpeg)");
+}
+
+// Render graph passes of the JPEG export. Buffers are looked up by resource
+// id when recording since transients only exist once the graph is compiled.
+typedef struct {
+    int source;
+    int destination;
+    VkDeviceSize size;
+} GraphCopy;
+
+typedef struct {
+    VkProcessorContext* context;
+    int input;
+    int output;
+    uint32_t group_count_x;
+    uint32_t group_count_y;
+} GraphAdjust;
+
+typedef struct {
+    VkProcessorContext* context;
+    int input;
+    int coefficients;
+    const JpegCoefLayout* layout;
+} GraphDct;
+
+static void record_graph_copy(VkCommandBuffer cmd, const RenderGraph* graph, void* user_data) {
+    const GraphCopy* copy = user_data;
+    VkBufferCopy region = { .size = copy->size };
+    vkCmdCopyBuffer(cmd, rg_buffer(graph, copy->source), rg_buffer(graph, copy->destination), 1, &region);
+}
+
+static void record_graph_adjust(VkCommandBuffer cmd, const RenderGraph* graph, void* user_data) {
+    const GraphAdjust* adjust = user_data;
+    bind_adjustment_pipeline(adjust->context, cmd,
+        rg_buffer(graph, adjust->input), rg_buffer(graph, adjust->output));
+    vkCmdDispatch(cmd, adjust->group_count_x, adjust->group_count_y, 1);
+}
+
+static void record_graph_dct(VkCommandBuffer cmd, const RenderGraph* graph, void* user_data) {
+    const GraphDct* dct = user_data;
+    const JpegCoefLayout* layout = dct->layout;
+    VkProcessorContext* ctx = dct->context;
+    
+    // The buffers are new for every export, so a plain update is fine here
+    VkDescriptorBufferInfo buffer_infos[3] = {
+        { .buffer = rg_buffer(graph, dct->input), .offset = 0, .range = VK_WHOLE_SIZE },
+        { .buffer = rg_buffer(graph, dct->coefficients), .offset = 0, .range = VK_WHOLE_SIZE },
+        { .buffer = ctx->quant_pool.buffer, .offset = 0, .range = VK_WHOLE_SIZE }
     };
-    
-    VkWriteDescriptorSet writes[] = {
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 0,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[0]
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 1,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[1]
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 2,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .pBufferInfo = &buffer_infos[2]
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 3,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[3]
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 4,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[4]
-        },
-        {
-            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 5,
-            .descriptorCount = 1,
-            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[5]
-        },
-        {
+    VkWriteDescriptorSet writes[3];
+    for (int i = 0; i < 3; i++) {
+        writes[i] = (VkWriteDescriptorSet){
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-            .dstSet = descriptor_set,
-            .dstBinding = 6,
+            .dstSet = ctx->jpeg_descriptor_set,
+            .dstBinding = i,
             .descriptorCount = 1,
             .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .pBufferInfo = &buffer_infos[6]
-        }
-    };
-    
-    vkUpdateDescriptorSets(device, 7, writes, 0, NULL);
-    
-    VLOG("vk_process_image_internal: Recording command buffer...\n");
-    
-    // Record and execute command buffer
-    VkCommandBufferBeginInfo begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
-    };
-    
-    result = vkBeginCommandBuffer(command_buffer, &begin_info);
-    if (!check_vk_result(result, "vkBeginCommandBuffer")) {
-        // Cleanup and return
-        vkDestroyBuffer(device, staging_in, NULL);
-        vkFreeMemory(device, staging_in_memory, NULL);
-        vkDestroyBuffer(device, staging_out, NULL);
-        vkFreeMemory(device, staging_out_memory, NULL);
-        vkDestroyBuffer(device, input_buffer, NULL);
-        vkFreeMemory(device, input_memory, NULL);
-        vkDestroyBuffer(device, output_buffer, NULL);
-        vkFreeMemory(device, output_memory, NULL);
-        vkDestroyBuffer(device, uniform_buffer, NULL);
-        vkFreeMemory(device, uniform_memory, NULL);
+            .pBufferInfo = &buffer_infos[i]
+        };
+    }
+    vkUpdateDescriptorSets(device, 3, writes, 0, NULL);
+    
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, jpeg_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+        jpeg_pipeline_layout, 0, 1, &ctx->jpeg_descriptor_set, 0, NULL);
+    
+    for (int c = 0; c < 3; c++) {
+        JpegDctConstants constants = {
+            .width = layout->width,
+            .height = layout->height,
+            .component = c,
+            .sample_x = c == 0 ? 1 : layout->h_samp,
+            .sample_y = c == 0 ? 1 : layout->v_samp,
+            .blocks_wide = layout->blocks_w[c],
+            .offset = (uint32_t)layout->offset[c]
+        };
+        vkCmdPushConstants(cmd, jpeg_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT,
+            0, sizeof(constants), &constants);
+        vkCmdDispatch(cmd, layout->blocks_w[c], layout->blocks_h[c], 1);
+    }
+}
+
+// Upload, adjust, DCT and readback in a single submission. The device side
+// input is dead once the adjustment pass has run, so the graph places the
+// coefficients on its memory.
+static int jpeg_run_graph(
+    VkProcessorContext* ctx,
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const JpegCoefLayout* layout,
+    const uint16_t luma[64],
+    const uint16_t chroma[64]
+) {
+    VkDeviceSize input_size = ((VkDeviceSize)width * height * 3 + 3) / 4 * 4;
+    VkDeviceSize rgba_size = (VkDeviceSize)layout->width * layout->height * 4;
+    VkDeviceSize coefficient_size = layout->coefficient_count * sizeof(int16_t);
+    VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!pooled_buffer_reserve(&ctx->staging_in_pool, input_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, host, MEM_VK_STAGING, "staging_in") ||
+        !pooled_buffer_reserve(&ctx->coefficient_staging_pool, coefficient_size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT, host, MEM_VK_STAGING, "coefficient_staging")) {
         return 0;
     }
     
-    VLOG("vk_process_image_internal: Command buffer recording started\n");
+    memcpy(ctx->staging_in_pool.mapped, input_pixels, (size_t)width * height * 3);
     
-    // Copy input data from staging to device
-    VkBufferCopy copy_region = { .size = input_size };
-    vkCmdCopyBuffer(command_buffer, staging_in, input_buffer, 1, &copy_region);
+    float* table = (float*)ctx->quant_pool.mapped;
+    for (int i = 0; i < 64; i++) {
+        table[i] = luma[i];
+        table[64 + i] = chroma[i];
+    }
     
-    // Memory barrier before compute
-    VkMemoryBarrier barrier = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
-        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
-        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT
+    RenderGraph* graph = rg_create(device, physical_device);
+    if (!graph) return 0;
+    
+    int staging_in = rg_import_buffer(graph, "staging_in", ctx->staging_in_pool.buffer);
+    int input = rg_create_buffer(graph, "input", input_size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    int rgba = rg_create_buffer(graph, "rgba", rgba_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    int coefficients = rg_create_buffer(graph, "coefficients", coefficient_size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    int staging_out = rg_import_buffer(graph, "coefficient_staging", ctx->coefficient_staging_pool.buffer);
+    
+    GraphCopy upload = { .source = staging_in, .destination = input, .size = input_size };
+    GraphAdjust adjust = {
+        .context = ctx,
+        .input = input,
+        .output = rgba,
+        .group_count_x = (layout->width + 15) / 16,
+        .group_count_y = (layout->height + 15) / 16
     };
+    GraphDct dct = { .context = ctx, .input = rgba, .coefficients = coefficients, .layout = layout };
+    GraphCopy readback = { .source = coefficients, .destination = staging_out, .size = coefficient_size };
     
-    vkCmdPipelineBarrier(command_buffer,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        0, 1, &barrier, 0, NULL, 0, NULL);
-    
-    // Bind pipeline and descriptor set
-    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline);
-    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-        pipeline_layout, 0, 1, &descriptor_set, 0, NULL);
+    int pass = rg_add_pass(graph, "upload", record_graph_copy, &upload);
+    rg_use(graph, pass, staging_in, RG_ACCESS_TRANSFER_READ);
+    rg_use(graph, pass, input, RG_ACCESS_TRANSFER_WRITE);
     
-    // Dispatch compute shader (16x16 workgroups) based on output dimensions
-    uint32_t group_count_x = (output_width + 15) / 16;
-    uint32_t group_count_y = (output_height + 15) / 16;
-    vkCmdDispatch(command_buffer, group_count_x, group_count_y, 1);
+    pass = rg_add_pass(graph, "adjust", record_graph_adjust, &adjust);
+    rg_use(graph, pass, input, RG_ACCESS_SHADER_READ);
+    rg_use(graph, pass, rgba, RG_ACCESS_SHADER_WRITE);
     
-    // Memory barrier after compute
-    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    pass = rg_add_pass(graph, "dct", record_graph_dct, &dct);
+    rg_use(graph, pass, rgba, RG_ACCESS_SHADER_READ);
+    rg_use(graph, pass, coefficients, RG_ACCESS_SHADER_WRITE);
     
-    vkCmdPipelineBarrier(command_buffer,
-        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-        VK_PIPELINE_STAGE_TRANSFER_BIT,
-        0, 1, &barrier, 0, NULL, 0, NULL);
+    pass = rg_add_pass(graph, "readback", record_graph_copy, &readback);
+    rg_use(graph, pass, coefficients, RG_ACCESS_TRANSFER_READ);
+    rg_use(graph, pass, staging_out, RG_ACCESS_TRANSFER_WRITE);
     
-    // Copy output data from device to staging
-    copy_region.size = output_size;
-    vkCmdCopyBuffer(command_buffer, output_buffer, staging_out, 1, &copy_region);
+    if (!rg_compile(graph)) {
+        rg_destroy(graph);
+        return 0;
+    }
     
-    vkEndCommandBuffer(command_buffer);
+    VkDeviceSize unaliased = 0;
+    VkDeviceSize transient = rg_transient_bytes(graph, &unaliased);
+    VLOG("jpeg_run_graph: %llu MB device memory (%llu MB without aliasing)\n",
+         (unsigned long long)(transient >> 20), (unsigned long long)(unaliased >> 20));
     
-    // Submit command buffer
-    VkSubmitInfo submit_info = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &command_buffer
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
     };
     
-    vkQueueSubmit(compute_queue, 1, &submit_info, VK_NULL_HANDLE);
-    vkQueueWaitIdle(compute_queue);
+    VkResult result = vkBeginCommandBuffer(ctx->command_buffer, &begin_info);
+    if (!check_vk_result(result, "vkBeginCommandBuffer")) {
+        rg_destroy(graph);
+        return 0;
+    }
+    
+    rg_execute(graph, ctx->command_buffer);
+    vkEndCommandBuffer(ctx->command_buffer);
     
-    // Download output data
-    *output_pixels = (uint8_t*)malloc(output_size);
-    void* mapped_output;
-    vkMapMemory(device, staging_out_memory, 0, output_size, 0, &mapped_output);
-    memcpy(*output_pixels, mapped_output, output_size);
-    vkUnmapMemory(device, staging_out_memory);
-    
-    // Cleanup
-    vkDestroyBuffer(device, staging_in, NULL);
-    vkFreeMemory(device, staging_in_memory, NULL);
-    vkDestroyBuffer(device, staging_out, NULL);
-    vkFreeMemory(device, staging_out_memory, NULL);
-    vkDestroyBuffer(device, input_buffer, NULL);
-    vkFreeMemory(device, input_memory, NULL);
-    vkDestroyBuffer(device, output_buffer, NULL);
-    vkFreeMemory(device, output_memory, NULL);
-    vkDestroyBuffer(device, uniform_buffer, NULL);
-    vkFreeMemory(device, uniform_memory, NULL);
-    
-    // Clean up tone curve LUT buffers if they were created
-    if (rgb_lut != NULL) {
-        vkDestroyBuffer(device, rgb_lut_buffer, NULL);
-        vkFreeMemory(device, rgb_lut_memory, NULL);
-        vkDestroyBuffer(device, red_lut_buffer, NULL);
-        vkFreeMemory(device, red_lut_memory, NULL);
-        vkDestroyBuffer(device, green_lut_buffer, NULL);
-        vkFreeMemory(device, green_lut_memory, NULL);
-        vkDestroyBuffer(device, blue_lut_buffer, NULL);
-        vkFreeMemory(device, blue_lut_memory, NULL);
-    }
-    
-    // Free descriptor set
-    vkFreeDescriptorSets(device, descriptor_pool, 1, &descriptor_set);
-    
-    vkResetCommandBuffer(command_buffer, 0);
-    
-    processing = 0; // Clear processing flag
-    VLOG("vk_process_image_internal: Complete\n");
-    return 1;
+    result = context_submit(ctx);
+    
+    // The persistent set may point at the graph's buffers
+    rg_destroy(graph);
+    ctx->descriptor_generation = 0;
+    return result == VK_SUCCESS;
 }
 
-// Process image with tone curves support
-int vk_process_image_with_curves(
+int vk_encode_jpeg_params(
     const uint8_t* input_pixels,
     int width,
     int height,
-    const float* adjustments,
-    int adjustment_count,
+    const AksAdjustmentParams* adjustments,
     const uint8_t* rgb_lut,
     const uint8_t* red_lut,
     const uint8_t* green_lut,
     const uint8_t* blue_lut,
-    uint8_t** output_pixels
+    int quality,
+    int subsampling,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
 ) {
-    return vk_process_image_internal(
-        input_pixels, width, height,
-        adjustments, adjustment_count,
+    return vk_context_encode_jpeg_params(
+        NULL, input_pixels, width, height, adjustments,
         rgb_lut, red_lut, green_lut, blue_lut,
-        output_pixels
+        quality, subsampling, jpeg_data, jpeg_size
     );
 }
 
-int vk_process_image_with_curves_and_crop(
+int vk_context_encode_jpeg_params(
+    VkProcessorContext* context,
     const uint8_t* input_pixels,
     int width,
     int height,
-    const float* adjustments,
-    int adjustment_count,
-    float crop_left,
-    float crop_top,
-    float crop_right,
-    float crop_bottom,
+    const AksAdjustmentParams* adjustments,
     const uint8_t* rgb_lut,
     const uint8_t* red_lut,
     const uint8_t* green_lut,
     const uint8_t* blue_lut,
-    uint8_t** output_pixels,
-    int* output_width,
-    int* output_height
+    int quality,
+    int subsampling,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
 ) {
-    // Validate crop parameters
-    if (crop_left < 0.0f) crop_left = 0.0f;
-    if (crop_top < 0.0f) crop_top = 0.0f;
-    if (crop_right > 1.0f) crop_right = 1.0f;
-    if (crop_bottom > 1.0f) crop_bottom = 1.0f;
-    if (crop_left >= crop_right || crop_top >= crop_bottom) {
-        // Invalid crop, use full image
-        crop_left = 0.0f;
-        crop_top = 0.0f;
-        crop_right = 1.0f;
-        crop_bottom = 1.0f;
-    }
-    
-    // Calculate output dimensions
-    // Match CPU's approach: round to pixels first, then subtract
-    int crop_left_px = (int)round(crop_left * width);
-    int crop_top_px = (int)round(crop_top * height);
-    int crop_right_px = (int)round(crop_right * width);
-    int crop_bottom_px = (int)round(crop_bottom * height);
-    
-    *output_width = crop_right_px - crop_left_px;
-    *output_height = crop_bottom_px - crop_top_px;
-    
-    fprintf(stderr, "DEBUG vk_process_image_with_curves_and_crop:\n");
-    fprintf(stderr, "  Input: %dx%d\n", width, height);
-    fprintf(stderr, "  Crop: %.4f,%.4f to %.4f,%.4f\n", crop_left, crop_top, crop_right, crop_bottom);
-    fprintf(stderr, "  Pixels: left=%d, top=%d, right=%d, bottom=%d\n", 
-            crop_left_px, crop_top_px, crop_right_px, crop_bottom_px);
-    fprintf(stderr, "  Output: %dx%d\n", *output_width, *output_height);
-    
-    // Create extended adjustments array with crop parameters
-    // We need 18 floats total (14 base + 4 crop parameters)
-    float* extended_adjustments = (float*)malloc(sizeof(float) * 18);
-    if (!extended_adjustments) {
-        fprintf(stderr, "Failed to allocate extended adjustments\n");
+    if (!jpeg_data || !jpeg_size) return 0;
+    
+    AksAdjustmentParams params;
+    if (!aks_params_load(&params, adjustments)) {
+        fprintf(stderr, "vk_encode_jpeg_params: invalid parameters\n");
         return 0;
     }
+    aks_params_clamp_crop(&params);
+    params.image_width = (float)width;
+    params.image_height = (float)height;
     
-    // Copy original adjustments
-    memcpy(extended_adjustments, adjustments, sizeof(float) * adjustment_count);
+    int crop_x, crop_y, output_width, output_height;
+    aks_params_crop_rect(&params, width, height, &crop_x, &crop_y, &output_width, &output_height);
     
-    // Ensure we have at least 14 floats (pad with zeros if needed)
-    for (int i = adjustment_count; i < 14; i++) {
-        extended_adjustments[i] = 0.0f;
+    JpegCoefLayout layout;
+    if (!jpeg_coef_layout(output_width, output_height, subsampling, &layout)) {
+        fprintf(stderr, "vk_encode_jpeg_params: unsupported geometry %dx%d\n", output_width, output_height);
+        return 0;
     }
     
-    // Set image dimensions
-    extended_adjustments[11] = (float)width;  // imageWidth
-    extended_adjustments[12] = (float)height; // imageHeight
+    VkProcessorContext* ctx = context_enter(context, "vk_encode_jpeg_params");
+    if (!ctx) return 0;
     
-    // Add crop parameters at indices 14-17
-    extended_adjustments[14] = crop_left;
-    extended_adjustments[15] = crop_top;
-    extended_adjustments[16] = crop_right;
-    extended_adjustments[17] = crop_bottom;
+    pthread_mutex_lock(&init_lock);
+    int ready = jpeg_pipeline_init();
+    pthread_mutex_unlock(&init_lock);
+    if (!ready || !context_jpeg_init(ctx)) {
+        VLOG("vk_encode_jpeg_params: DCT pipeline unavailable\n");
+        context_leave(ctx);
+        return 0;
+    }
     
-    int result = vk_process_image_internal(
-        input_pixels, width, height,
-        extended_adjustments, 18,
-        rgb_lut, red_lut, green_lut, blue_lut,
-        output_pixels
-    );
+    if (!write_adjustment_inputs(ctx, &params, rgb_lut, red_lut, green_lut, blue_lut)) {
+        context_leave(ctx);
+        return 0;
+    }
     
-    free(extended_adjustments);
-    return result;
+    uint16_t luma[64], chroma[64];
+    jpeg_quant_tables(quality, luma, chroma);
+    
+    job_begin(ctx->job_class);
+    int ok = jpeg_run_graph(ctx, input_pixels, width, height, &layout, luma, chroma);
+    if (ok) {
+        ok = jpeg_encode_coefficients(&layout, (const int16_t*)ctx->coefficient_staging_pool.mapped,
+                                      luma, chroma, 0, jpeg_data, jpeg_size);
+    }
+    job_end(ctx->job_class);
+    
+    trim_image_buffers(ctx);
+    context_leave(ctx);
+    
+    VLOG("vk_encode_jpeg_params: %dx%d -> %zu bytes\n", output_width, output_height, ok ? *jpeg_size : 0);
+    return ok;
 }
 
 void vk_free_buffer(uint8_t* buffer) {
     free(buffer);
 }
 
-void vk_cleanup() {
-    if (!initialized) return;
-    
+// Tear down whatever init_device got to. Called with init_lock held.
+static void cleanup_device(void) {
     if (device != VK_NULL_HANDLE) {
         vkDeviceWaitIdle(device);
         
-        if (command_pool != VK_NULL_HANDLE) {
-            vkDestroyCommandPool(device, command_pool, NULL);
+        context_free(default_context);
+        default_context = NULL;
+        
+        // Nothing is processing any more, so pinned images go too
+        pthread_mutex_lock(&resident_lock);
+        for (int i = 0; i < RESIDENT_MAX_IMAGES; i++) {
+            if (resident_images[i].pixels.buffer != VK_NULL_HANDLE) {
+                resident_release(&resident_images[i]);
+            }
+        }
+        resident_clock = 0;
+        pthread_mutex_unlock(&resident_lock);
+        
+        pthread_mutex_lock(&lut_lock);
+        for (int i = 0; i < LUT_TEXTURE_CACHE; i++) {
+            lut_texture_release(&lut_textures[i]);
         }
+        lut_texture_release(&identity_lut_texture);
+        lut_clock = 0;
+        pthread_mutex_unlock(&lut_lock);
         
-        if (descriptor_pool != VK_NULL_HANDLE) {
-            vkDestroyDescriptorPool(device, descriptor_pool, NULL);
+        if (lut_sampler != VK_NULL_HANDLE) {
+            vkDestroySampler(device, lut_sampler, NULL);
+            lut_sampler = VK_NULL_HANDLE;
         }
         
+        if (descriptor_template != VK_NULL_HANDLE) {
+            vkDestroyDescriptorUpdateTemplate(device, descriptor_template, NULL);
+            descriptor_template = VK_NULL_HANDLE;
+        }
+        
+        if (jpeg_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(device, jpeg_pipeline, NULL);
+            jpeg_pipeline = VK_NULL_HANDLE;
+        }
+        if (jpeg_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(device, jpeg_pipeline_layout, NULL);
+            jpeg_pipeline_layout = VK_NULL_HANDLE;
+        }
+        if (jpeg_set_layout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(device, jpeg_set_layout, NULL);
+            jpeg_set_layout = VK_NULL_HANDLE;
+        }
+        if (jpeg_shader_module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(device, jpeg_shader_module, NULL);
+            jpeg_shader_module = VK_NULL_HANDLE;
+        }
+        jpeg_state = 0;
+        
         if (compute_shader_module != VK_NULL_HANDLE) {
             vkDestroyShaderModule(device, compute_shader_module, NULL);
+            compute_shader_module = VK_NULL_HANDLE;
         }
         
         if (compute_pipeline != VK_NULL_HANDLE) {
             vkDestroyPipeline(device, compute_pipeline, NULL);
+            compute_pipeline = VK_NULL_HANDLE;
         }
         
         if (pipeline_layout != VK_NULL_HANDLE) {
             vkDestroyPipelineLayout(device, pipeline_layout, NULL);
+            pipeline_layout = VK_NULL_HANDLE;
         }
         
         if (descriptor_set_layout != VK_NULL_HANDLE) {
             vkDestroyDescriptorSetLayout(device, descriptor_set_layout, NULL);
+            descriptor_set_layout = VK_NULL_HANDLE;
         }
         
         vkDestroyDevice(device, NULL);
+        device = VK_NULL_HANDLE;
+    }
+    
+    for (int i = 0; i < 2; i++) {
+        submit_queues[i].queue = VK_NULL_HANDLE;
     }
     
     if (instance != VK_NULL_HANDLE) {
         vkDestroyInstance(instance, NULL);
+        instance = VK_NULL_HANDLE;
     }
+    physical_device = VK_NULL_HANDLE;
     
     initialized = 0;
-}
\ No newline at end of file
+}
+
+// Contexts from vk_context_create must be destroyed before this
+void vk_cleanup() {
+    if (!initialized) return;
+    
+    // Waits for a running query before the device goes away
+    mem_stats_set_heap_query(NULL);
+    
+    pthread_mutex_lock(&init_lock);
+    cleanup_device();
+    pthread_mutex_unlock(&init_lock);
+}
@@ -2,6 +2,9 @@
 #define VULKAN_PROCESSOR_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include "tiled_image.h"
+#include "adjustment_params.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,6 +16,19 @@ int vk_init();
 // Check if Vulkan is available
 int vk_is_available();
 
+// A context owns a command pool, a fence and the working buffers and
+// descriptors of one caller, so each thread or isolate can submit work
+// without waiting for the others. Contexts share the device, pipelines and
+// resident images. One thread may use a context at a time; a call on a
+// context that is already busy returns 0. Contexts of JOB_CLASS_INTERACTIVE
+// submit to the highest priority queue, others to a lower priority queue
+// when the device has one. The functions without a context use a default
+// interactive one. Destroy contexts before vk_cleanup.
+typedef struct VkProcessorContext VkProcessorContext;
+
+VkProcessorContext* vk_context_create(int job_class);
+void vk_context_destroy(VkProcessorContext* context);
+
 // Process image with Vulkan (basic version)
 int vk_process_image(
     const uint8_t* input_pixels,
@@ -57,6 +73,193 @@ int vk_process_image_with_curves_and_crop(
     int* output_height   // Output cropped height
 );
 
+// Stream every tile of an RGB tiled image through the GPU into an RGBA tiled
+// image of the same geometry. Only one tile is resident on the GPU at a time.
+int vk_process_tiled(
+    TiledImage* source,
+    TiledImage* destination,
+    const float* adjustments,
+    int adjustment_count,
+    const uint8_t* rgb_lut,    // 256 bytes tone curve LUT for RGB
+    const uint8_t* red_lut,    // 256 bytes tone curve LUT for red
+    const uint8_t* green_lut,  // 256 bytes tone curve LUT for green
+    const uint8_t* blue_lut    // 256 bytes tone curve LUT for blue
+);
+
+// Capabilities of this engine (AKS_CAP_* bits). params_version, if not NULL,
+// receives the AksAdjustmentParams version it was built against.
+uint32_t vk_get_capabilities(uint32_t* params_version);
+
+// Process image with a versioned parameter struct. NULL LUTs are identity.
+int vk_process_image_params(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,    // 256 bytes tone curve LUT for RGB
+    const uint8_t* red_lut,    // 256 bytes tone curve LUT for red
+    const uint8_t* green_lut,  // 256 bytes tone curve LUT for green
+    const uint8_t* blue_lut,   // 256 bytes tone curve LUT for blue
+    uint8_t** output_pixels,
+    int* output_width,   // Output cropped width
+    int* output_height   // Output cropped height
+);
+
+// vk_process_tiled with a versioned parameter struct; the crop is ignored
+int vk_process_tiled_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+);
+
+// vk_process_tiled_params with the native CPU kernel working alongside the
+// GPU. Tiles come from one shared queue: the calling thread feeds them to the
+// GPU while cpu_threads workers (<= 0: all cores but one) run the CPU kernel
+// on the rest. The engines are first compared on VK_HYBRID_SAMPLE_TILES
+// tiles spread across the image; if they differ anywhere by more than
+// VK_HYBRID_TOLERANCE levels, the CPU workers are not started.
+#define VK_HYBRID_TOLERANCE 2
+#define VK_HYBRID_SAMPLE_TILES 5
+
+int vk_process_tiled_hybrid_params(
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int cpu_threads
+);
+
+// Resident images: keep decoded RGB sources on the GPU so switching between
+// recently viewed images skips the upload. image_id is chosen by the caller
+// and should differ per image and per level (preview, full). Images are
+// evicted least recently used first to stay within the VRAM budget
+// (VK_EXT_memory_budget when available).
+
+// Upload an image, evicting others as needed. Returns 0 if it can't fit.
+int vk_resident_upload(uint64_t image_id, const uint8_t* pixels, int width, int height);
+
+// Whether an image is resident
+int vk_resident_contains(uint64_t image_id);
+
+// vk_process_image_params on a resident image. Returns 0 if it isn't resident.
+// The image can't be evicted while it's being processed.
+int vk_process_resident_params(
+    uint64_t image_id,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+);
+
+// Drop one or all resident images
+void vk_resident_evict(uint64_t image_id);
+void vk_resident_clear(void);
+
+// Number of resident images; optionally the bytes they use and the budget
+int vk_resident_stats(uint64_t* used_bytes, uint64_t* budget_bytes);
+
+// Process an image and encode the result as a baseline JPEG. Colour
+// conversion, subsampling (JPEG_SUBSAMPLING_*), DCT and quantization run on
+// the GPU; Huffman coding runs on the CPU in parallel restart intervals.
+// Free the result with vk_free_buffer. Returns 0 if the DCT shader is missing
+// so callers can fall back to a CPU encoder.
+int vk_encode_jpeg_params(
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int quality,        // 1-100
+    int subsampling,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
+);
+
+// The above on a context of the caller's; NULL is the default context
+int vk_context_process_image_params(
+    VkProcessorContext* context,
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+);
+
+int vk_context_process_tiled_params(
+    VkProcessorContext* context,
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut
+);
+
+int vk_context_process_tiled_hybrid_params(
+    VkProcessorContext* context,
+    TiledImage* source,
+    TiledImage* destination,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int cpu_threads
+);
+
+int vk_context_resident_upload(VkProcessorContext* context, uint64_t image_id,
+                               const uint8_t* pixels, int width, int height);
+
+int vk_context_process_resident_params(
+    VkProcessorContext* context,
+    uint64_t image_id,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    uint8_t** output_pixels,
+    int* output_width,
+    int* output_height
+);
+
+int vk_context_encode_jpeg_params(
+    VkProcessorContext* context,
+    const uint8_t* input_pixels,
+    int width,
+    int height,
+    const AksAdjustmentParams* params,
+    const uint8_t* rgb_lut,
+    const uint8_t* red_lut,
+    const uint8_t* green_lut,
+    const uint8_t* blue_lut,
+    int quality,
+    int subsampling,
+    uint8_t** jpeg_data,
+    size_t* jpeg_size
+);
+
 // Free allocated buffer
 void vk_free_buffer(uint8_t* buffer);
 
@@ -0,0 +1,179 @@
+#!/bin/bash
+
+# Profile-guided, link-time optimized build of the native RAW and CPU kernel
+# libraries, with LibRaw built the same way and linked in statically.
+#
+#   scripts/build_native_pgo.sh [output dir]
+#
+# 1. LibRaw, libraw_processor.so and libcpu_kernel.so are built with
+#    profiling instrumentation
+# 2. aks_bench runs on its synthetic corpus as the training workload
+# 3. Everything is rebuilt with -flto and the collected profiles
+#
+# The libraries land in linux/ (or the given directory), where the tests and
+# the bundle pick them up. LibRaw comes from LIBRAW_SRC, or the release the
+# Flatpak uses is downloaded. AKS_PGO_MEGAPIXELS and AKS_PGO_FRAMES size the
+# training run; AKS_PGO_COMPARE=1 also benchmarks a plain -O3 build first.
+#
+# Profiles are matched to object files by path, so the instrumented and the
+# final build always use the same directories under build/native-pgo.
+
+set -e  # Exit on error
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+NC='\033[0m' # No Color
+
+LIBRAW_VERSION="0.21.3"
+LIBRAW_SHA256="dba34b7fc1143503942fa32ad9db43e94f714e62a4a856e91617f8f3e1e0aa5c"
+
+# Change to project root
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+PROJECT_ROOT="$( cd "$SCRIPT_DIR/.." && pwd )"
+cd "$PROJECT_ROOT"
+
+OUT="$(mkdir -p "${1:-linux}" && cd "${1:-linux}" && pwd)"
+WORK="$PROJECT_ROOT/build/native-pgo"
+PROFILES="$WORK/profiles"
+LIBRAW_PREFIX="$WORK/libraw"
+JOBS="$(nproc)"
+
+# Check dependencies
+echo -e "${YELLOW}Checking dependencies...${NC}"
+
+for tool in gcc g++ gcc-ar gcc-ranlib make pkg-config; do
+    if ! command -v $tool &> /dev/null; then
+        echo -e "${RED}Error: $tool not found. Please install build-essential.${NC}"
+        exit 1
+    fi
+done
+
+for package in libzstd libturbojpeg; do
+    if ! pkg-config --exists $package; then
+        echo -e "${RED}Error: $package not found.${NC}"
+        exit 1
+    fi
+done
+
+# LibRaw sources, built in place so the object paths stay the same
+mkdir -p "$WORK"
+LIBRAW_BUILD="$WORK/LibRaw-$LIBRAW_VERSION"
+if [ -n "$LIBRAW_SRC" ]; then
+    rm -rf "$LIBRAW_BUILD"
+    cp -r "$LIBRAW_SRC" "$LIBRAW_BUILD"
+elif [ ! -d "$LIBRAW_BUILD" ]; then
+    echo -e "${GREEN}Downloading LibRaw $LIBRAW_VERSION...${NC}"
+    ARCHIVE="$WORK/LibRaw-$LIBRAW_VERSION.tar.gz"
+    curl -fsSL -o "$ARCHIVE" "https://www.libraw.org/data/LibRaw-$LIBRAW_VERSION.tar.gz"
+    echo "$LIBRAW_SHA256  $ARCHIVE" | sha256sum -c --quiet
+    tar -xzf "$ARCHIVE" -C "$WORK"
+fi
+
+# build_libraw <flags>
+build_libraw() {
+    echo -e "${GREEN}Building LibRaw ($1)...${NC}"
+    (
+        cd "$LIBRAW_BUILD"
+        make distclean > /dev/null 2>&1 || true
+        ./configure --prefix="$LIBRAW_PREFIX" \
+            --enable-static --disable-shared --disable-examples --enable-openmp \
+            AR=gcc-ar RANLIB=gcc-ranlib \
+            CFLAGS="-O3 -fPIC $1" CXXFLAGS="-O3 -fPIC $1" LDFLAGS="$1" > /dev/null
+        make -j"$JOBS" > /dev/null
+        make install > /dev/null
+    )
+}
+
+# Shared helpers of the native libraries; not optimized further
+build_support() {
+    echo -e "${GREEN}Building support libraries...${NC}"
+    gcc -O2 -shared -fPIC -o "$OUT/libtiled_image.so" lib/ffi/tiles/tiled_image.c -lpthread
+    gcc -O2 -shared -fPIC -o "$OUT/libjob_scheduler.so" lib/ffi/common/job_scheduler.c -lpthread
+    gcc -O2 -shared -fPIC -o "$OUT/libmem_stats.so" lib/ffi/common/mem_stats.c -lpthread
+    gcc -O2 -shared -fPIC -o "$OUT/libsynthetic_raw.so" lib/ffi/corpus/synthetic_raw.c -lpthread -lm
+    gcc -O2 -shared -fPIC -o "$OUT/libcube_lut.so" lib/ffi/lut/cube_lut.c -lpthread -lm
+}
+
+RAW_SOURCES=(
+    linux/raw_processor/raw_processor.c
+    lib/ffi/raw/raw_tiled.c
+    lib/ffi/raw/smart_preview.c
+    lib/ffi/raw/raw_batch.c
+    lib/ffi/raw/dng_tiles.c
+    lib/ffi/raw/raw_cull.c
+    lib/ffi/raw/raw_hash.c
+)
+
+# build_native <flags>: libraw_processor.so, libcpu_kernel.so and aks_bench
+build_native() {
+    echo -e "${GREEN}Building libraw_processor.so and libcpu_kernel.so ($1)...${NC}"
+    local obj="$WORK/obj"
+    rm -rf "$obj"
+    mkdir -p "$obj"
+
+    local raw_objects=()
+    for source in "${RAW_SOURCES[@]}"; do
+        local object="$obj/$(basename "$source" .c).o"
+        gcc -O3 -fPIC $1 -Ilib/ffi/raw -I"$LIBRAW_PREFIX/include" \
+            $(pkg-config --cflags libzstd libturbojpeg) \
+            -c "$source" -o "$object"
+        raw_objects+=("$object")
+    done
+    g++ -std=c++17 -O3 -fPIC $1 -c lib/ffi/cpu/cpu_kernel.cpp -o "$obj/cpu_kernel.o"
+
+    gcc -shared $1 -o "$OUT/libraw_processor.so" "${raw_objects[@]}" \
+        $(PKG_CONFIG_PATH="$LIBRAW_PREFIX/lib/pkgconfig" pkg-config --static --libs libraw) \
+        $(pkg-config --libs libzstd libturbojpeg) \
+        -L"$OUT" -ltiled_image -ljob_scheduler -lmem_stats -Wl,-rpath,'$ORIGIN' \
+        -fopenmp -lstdc++ -lpthread -lm
+    g++ -shared $1 -o "$OUT/libcpu_kernel.so" "$obj/cpu_kernel.o" \
+        -L"$OUT" -ltiled_image -ljob_scheduler -lcube_lut -Wl,-rpath,'$ORIGIN' \
+        -lpthread -lm
+
+    gcc -O2 -o "$OUT/aks_bench" lib/ffi/bench/native_bench.c \
+        -Ilinux/raw_processor -Ilib/ffi/raw -Ilib/ffi/cpu -Ilib/ffi/corpus \
+        -L"$OUT" -lsynthetic_raw -lraw_processor -lcpu_kernel -Wl,-rpath,'$ORIGIN' \
+        -lm
+}
+
+run_bench() {
+    "$OUT/aks_bench" --megapixels "${AKS_PGO_MEGAPIXELS:-24}" --frames "${AKS_PGO_FRAMES:-4}" \
+        --iterations 2
+}
+
+build_support
+
+if [ "$AKS_PGO_COMPARE" = "1" ]; then
+    build_libraw ""
+    build_native ""
+    echo -e "${YELLOW}Baseline (-O3):${NC}"
+    run_bench
+fi
+
+# Instrumented build and training run. Atomic counter updates since the
+# decoders and kernels are multithreaded.
+GENERATE_FLAGS="-fprofile-generate=$PROFILES -fprofile-update=atomic"
+rm -rf "$PROFILES"
+build_libraw "$GENERATE_FLAGS"
+build_native "$GENERATE_FLAGS"
+echo -e "${GREEN}Training run...${NC}"
+run_bench > /dev/null
+
+if ! ls "$PROFILES" | grep -q '\.gcda$'; then
+    echo -e "${RED}✗ The training run wrote no profiles${NC}"
+    exit 1
+fi
+
+# Optimized build. Code the training run didn't reach is optimized as usual
+# rather than for size.
+USE_FLAGS="-flto=auto -fprofile-use=$PROFILES -fprofile-partial-training -Wno-missing-profile"
+build_libraw "$USE_FLAGS"
+build_native "$USE_FLAGS"
+
+echo -e "${YELLOW}Optimized (LTO + PGO):${NC}"
+run_bench
+
+echo -e "\n${GREEN}Build complete!${NC}"
+echo -e "Libraries built in: ${OUT}/"
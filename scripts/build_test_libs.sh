@@ -31,6 +31,27 @@ if ! pkg-config --exists libraw; then
     exit 1
 fi
 
+if ! pkg-config --exists libzstd; then
+    echo -e "${RED}Error: zstd not found. Please install libzstd-dev.${NC}"
+    exit 1
+fi
+
+if ! pkg-config --exists libturbojpeg; then
+    echo -e "${RED}Error: libturbojpeg not found. Please install libturbojpeg0-dev.${NC}"
+    exit 1
+fi
+
+# Dart SDK headers for native port completions (dart_api_dl.h)
+if [ -z "$DART_SDK_INCLUDE" ] && command -v flutter &> /dev/null; then
+    FLUTTER_BIN="$(dirname "$(readlink -f "$(command -v flutter)")")"
+    DART_SDK_INCLUDE="$FLUTTER_BIN/cache/dart-sdk/include"
+fi
+if [ ! -f "$DART_SDK_INCLUDE/dart_api_dl.h" ]; then
+    echo -e "${YELLOW}Warning: Dart SDK headers not found. libnative_async.so will not be built.${NC}"
+    echo -e "${YELLOW}Set DART_SDK_INCLUDE to <flutter>/bin/cache/dart-sdk/include.${NC}"
+    SKIP_NATIVE_ASYNC=1
+fi
+
 if ! pkg-config --exists vulkan; then
     echo -e "${RED}Error: vulkan not found. Please install libvulkan-dev.${NC}"
     exit 1
@@ -45,12 +66,142 @@ fi
 # Create linux directory if it doesn't exist
 mkdir -p linux
 
+# Build libtiled_image.so (linked by the other libraries)
+echo -e "${GREEN}Building libtiled_image.so...${NC}"
+gcc -shared -fPIC -o linux/libtiled_image.so \
+    lib/ffi/tiles/tiled_image.c \
+    -lpthread
+
+if [ -f "linux/libtiled_image.so" ]; then
+    echo -e "${GREEN}✓ libtiled_image.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libtiled_image.so${NC}"
+    exit 1
+fi
+
+# Build libjob_scheduler.so (shared by the other libraries)
+echo -e "${GREEN}Building libjob_scheduler.so...${NC}"
+gcc -shared -fPIC -o linux/libjob_scheduler.so \
+    lib/ffi/common/job_scheduler.c \
+    -lpthread
+
+if [ -f "linux/libjob_scheduler.so" ]; then
+    echo -e "${GREEN}✓ libjob_scheduler.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libjob_scheduler.so${NC}"
+    exit 1
+fi
+
+# Build libmem_stats.so (shared by the other libraries)
+echo -e "${GREEN}Building libmem_stats.so...${NC}"
+gcc -shared -fPIC -o linux/libmem_stats.so \
+    lib/ffi/common/mem_stats.c \
+    -lpthread
+
+if [ -f "linux/libmem_stats.so" ]; then
+    echo -e "${GREEN}✓ libmem_stats.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libmem_stats.so${NC}"
+    exit 1
+fi
+
+# Build libcube_lut.so (3D LUTs for both engines)
+echo -e "${GREEN}Building libcube_lut.so...${NC}"
+gcc -O2 -shared -fPIC -o linux/libcube_lut.so \
+    lib/ffi/lut/cube_lut.c \
+    -lpthread -lm
+
+if [ -f "linux/libcube_lut.so" ]; then
+    echo -e "${GREEN}✓ libcube_lut.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libcube_lut.so${NC}"
+    exit 1
+fi
+
+# Build libcpu_kernel.so
+echo -e "${GREEN}Building libcpu_kernel.so...${NC}"
+g++ -std=c++17 -O3 -shared -fPIC -o linux/libcpu_kernel.so \
+    lib/ffi/cpu/cpu_kernel.cpp \
+    -Llinux -ltiled_image -ljob_scheduler -lcube_lut -Wl,-rpath,'$ORIGIN' \
+    -lpthread -lm
+
+if [ -f "linux/libcpu_kernel.so" ]; then
+    echo -e "${GREEN}✓ libcpu_kernel.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libcpu_kernel.so${NC}"
+    exit 1
+fi
+
+# Build libjpeg_binding.so
+echo -e "${GREEN}Building libjpeg_binding.so...${NC}"
+mkdir -p linux/build
+gcc -O2 -fPIC -c -o linux/build/jpeg_entropy.o lib/ffi/jpeg/jpeg_entropy.c
+gcc -O2 -fPIC -c -o linux/build/jpeg_target.o lib/ffi/jpeg/jpeg_target.c -Ilib/ffi/common
+g++ -O2 -shared -fPIC -o linux/libjpeg_binding.so \
+    lib/ffi/jpeg/jpeg_binding.cpp \
+    linux/build/jpeg_entropy.o linux/build/jpeg_target.o \
+    $(pkg-config --cflags --libs libturbojpeg libjpeg) \
+    -Llinux -ltiled_image -ljob_scheduler -lmem_stats -Wl,-rpath,'$ORIGIN' \
+    -lpthread -lm
+rm -f linux/build/jpeg_entropy.o linux/build/jpeg_target.o
+
+if [ -f "linux/libjpeg_binding.so" ]; then
+    echo -e "${GREEN}✓ libjpeg_binding.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libjpeg_binding.so${NC}"
+    exit 1
+fi
+
+# Build libimage_metrics.so and the aks_metrics tool
+echo -e "${GREEN}Building libimage_metrics.so...${NC}"
+gcc -O2 -shared -fPIC -o linux/libimage_metrics.so \
+    lib/ffi/metrics/image_metrics.c \
+    -lpthread -lm
+gcc -O2 -o linux/aks_metrics \
+    lib/ffi/metrics/image_metrics_cli.c \
+    -Ilib/ffi/metrics \
+    -Llinux -limage_metrics -Wl,-rpath,'$ORIGIN' \
+    -lm
+
+if [ -f "linux/libimage_metrics.so" ] && [ -f "linux/aks_metrics" ]; then
+    echo -e "${GREEN}✓ libimage_metrics.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libimage_metrics.so${NC}"
+    exit 1
+fi
+
+# Build libsynthetic_raw.so and the aks_corpus tool
+echo -e "${GREEN}Building libsynthetic_raw.so...${NC}"
+gcc -O2 -shared -fPIC -o linux/libsynthetic_raw.so \
+    lib/ffi/corpus/synthetic_raw.c \
+    -lpthread -lm
+gcc -O2 -o linux/aks_corpus \
+    lib/ffi/corpus/synthetic_raw_cli.c \
+    -Ilib/ffi/corpus \
+    -Llinux -lsynthetic_raw -Wl,-rpath,'$ORIGIN' \
+    -lm
+
+if [ -f "linux/libsynthetic_raw.so" ] && [ -f "linux/aks_corpus" ]; then
+    echo -e "${GREEN}✓ libsynthetic_raw.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libsynthetic_raw.so${NC}"
+    exit 1
+fi
+
 # Build libraw_processor.so
 echo -e "${GREEN}Building libraw_processor.so...${NC}"
 gcc -shared -fPIC -o linux/libraw_processor.so \
     linux/raw_processor/raw_processor.c \
-    $(pkg-config --cflags --libs libraw) \
-    -lm
+    lib/ffi/raw/raw_tiled.c \
+    lib/ffi/raw/smart_preview.c \
+    lib/ffi/raw/raw_batch.c \
+    lib/ffi/raw/dng_tiles.c \
+    lib/ffi/raw/raw_cull.c \
+    lib/ffi/raw/raw_hash.c \
+    -Ilib/ffi/raw \
+    $(pkg-config --cflags --libs libraw libzstd libturbojpeg) \
+    -Llinux -ltiled_image -ljob_scheduler -lmem_stats -Wl,-rpath,'$ORIGIN' \
+    -lpthread -lm
 
 if [ -f "linux/libraw_processor.so" ]; then
     echo -e "${GREEN}✓ libraw_processor.so built successfully${NC}"
@@ -59,17 +210,23 @@ else
     exit 1
 fi
 
-# Build libvulkan_processor.so
-echo -e "${GREEN}Building libvulkan_processor.so...${NC}"
-gcc -shared -fPIC -o linux/libvulkan_processor.so \
-    linux/vulkan_processor/vulkan_processor.c \
-    -lvulkan -lm
+# Build libnative_async.so
+if [ -z "$SKIP_NATIVE_ASYNC" ]; then
+    echo -e "${GREEN}Building libnative_async.so...${NC}"
+    gcc -shared -fPIC -o linux/libnative_async.so \
+        lib/ffi/async/native_async.c \
+        "$DART_SDK_INCLUDE/dart_api_dl.c" \
+        -I"$DART_SDK_INCLUDE" \
+        -Ilib/ffi/raw \
+        -Llinux -lraw_processor -Wl,-rpath,'$ORIGIN' \
+        -lpthread
 
-if [ -f "linux/libvulkan_processor.so" ]; then
-    echo -e "${GREEN}✓ libvulkan_processor.so built successfully${NC}"
-else
-    echo -e "${RED}✗ Failed to build libvulkan_processor.so${NC}"
-    exit 1
+    if [ -f "linux/libnative_async.so" ]; then
+        echo -e "${GREEN}✓ libnative_async.so built successfully${NC}"
+    else
+        echo -e "${RED}✗ Failed to build libnative_async.so${NC}"
+        exit 1
+    fi
 fi
 
 # Compile shaders if glslc is available
@@ -95,19 +252,50 @@ if [ -z "$SKIP_SHADERS" ]; then
         fi
     done
     
-    # Also copy to build directory for runtime
-    mkdir -p linux/build/shaders
-    cp linux/vulkan_processor/shaders/*.spv linux/build/shaders/ 2>/dev/null || true
+    # Embed them in libvulkan_processor.so; it does not look for them on disk
+    SHADER_LIST=$(ls linux/vulkan_processor/shaders/*.spv 2>/dev/null | paste -sd'|')
+    if [ -n "$SHADER_LIST" ]; then
+        cmake -DOUTPUT=linux/build/embedded_shaders.c -DSHADERS="$SHADER_LIST" \
+            -P linux/vulkan_processor/embed_spirv.cmake
+        EMBEDDED_SHADERS="linux/build/embedded_shaders.c -DAKS_EMBEDDED_SHADERS -Ilinux/vulkan_processor"
+    fi
 else
     echo -e "${YELLOW}Skipping shader compilation (glslc not found)${NC}"
 fi
 
+# Build libvulkan_processor.so
+echo -e "${GREEN}Building libvulkan_processor.so...${NC}"
+gcc -shared -fPIC -o linux/libvulkan_processor.so \
+    linux/vulkan_processor/vulkan_processor.c \
+    linux/vulkan_processor/render_graph.c \
+    lib/ffi/jpeg/jpeg_entropy.c \
+    $EMBEDDED_SHADERS \
+    -Ilib/ffi/tiles -Ilib/ffi/common -Ilib/ffi/jpeg -Ilib/ffi/cpu -Ilib/ffi/lut \
+    -Llinux -ltiled_image -lcpu_kernel -lcube_lut -ljob_scheduler -lmem_stats -Wl,-rpath,'$ORIGIN' \
+    -lvulkan -lpthread -lm
+
+if [ -f "linux/libvulkan_processor.so" ]; then
+    echo -e "${GREEN}✓ libvulkan_processor.so built successfully${NC}"
+else
+    echo -e "${RED}✗ Failed to build libvulkan_processor.so${NC}"
+    exit 1
+fi
+
 # Create symlinks for alternative paths
 echo -e "${GREEN}Creating library symlinks...${NC}"
 
 # Create lib directory and symlinks for common search paths
 mkdir -p lib
+ln -sf ../linux/libtiled_image.so lib/libtiled_image.so 2>/dev/null || true
+ln -sf ../linux/libjob_scheduler.so lib/libjob_scheduler.so 2>/dev/null || true
+ln -sf ../linux/libmem_stats.so lib/libmem_stats.so 2>/dev/null || true
+ln -sf ../linux/libcube_lut.so lib/libcube_lut.so 2>/dev/null || true
+ln -sf ../linux/libcpu_kernel.so lib/libcpu_kernel.so 2>/dev/null || true
+ln -sf ../linux/libjpeg_binding.so lib/libjpeg_binding.so 2>/dev/null || true
+ln -sf ../linux/libimage_metrics.so lib/libimage_metrics.so 2>/dev/null || true
+ln -sf ../linux/libsynthetic_raw.so lib/libsynthetic_raw.so 2>/dev/null || true
 ln -sf ../linux/libraw_processor.so lib/libraw_processor.so 2>/dev/null || true
+ln -sf ../linux/libnative_async.so lib/libnative_async.so 2>/dev/null || true
 ln -sf ../linux/libvulkan_processor.so lib/libvulkan_processor.so 2>/dev/null || true
 
 # Summary
@@ -0,0 +1,51 @@
+import 'dart:io';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/corpus/synthetic_raw.dart';
+import 'package:aks/services/burst_grouper.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('Burst Grouping Tests', () {
+    late Directory tempDir;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+      tempDir = await Directory.systemTemp.createTemp('aks_bursts');
+    });
+
+    tearDownAll(() async {
+      await tempDir.delete(recursive: true);
+    });
+
+    test('groups frames of the same scene and keeps others apart', () async {
+      if (!TestHelper.isLibraryAvailable('corpus') || !TestHelper.isLibraryAvailable('raw')) {
+        print('SKIPPED: libsynthetic_raw or libraw_processor not built');
+        return;
+      }
+
+      // Two noise seeds of the chart form a burst; the noise scene does not
+      final specs = {
+        'chart1': const SyntheticSpec(width: 900, height: 600, seed: 1),
+        'noise': const SyntheticSpec(width: 900, height: 600, scene: SyntheticScene.noise),
+        'chart2': const SyntheticSpec(width: 900, height: 600, seed: 2),
+      };
+      final paths = <String>[];
+      for (final entry in specs.entries) {
+        final path = '${tempDir.path}/${entry.key}.dng';
+        SyntheticRaw.writeDng(entry.value, path);
+        paths.add(path);
+      }
+      paths.add('${tempDir.path}/missing.dng');
+
+      final groups = await BurstGrouper.group(paths);
+      expect(groups.length, equals(3));
+
+      expect(groups[0].paths, equals([paths[0], paths[2]]));
+      expect(groups[0].representative, equals(paths[0]));
+      expect(groups[0].isBurst, isTrue);
+      expect(groups[1].paths, equals([paths[1]]));
+      expect(groups[2].paths, equals([paths[3]]));
+    });
+  });
+}
@@ -0,0 +1,179 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/common/adjustment_params.dart';
+import 'package:aks/ffi/cpu/cpu_kernel.dart';
+import 'package:aks/ffi/lut/cube_lut.dart';
+import 'package:aks/models/adjustments.dart';
+import 'package:aks/models/edit_pipeline.dart';
+import 'package:aks/services/lut_library.dart';
+import 'package:aks/services/processors/vulkan_processor.dart';
+import '../test_helper.dart';
+
+/// .cube text of a size^3 LUT computed by f
+String cubeText(int size, List<double> Function(double r, double g, double b) f, {String? title}) {
+  final buffer = StringBuffer();
+  if (title != null) buffer.writeln('TITLE "$title"');
+  buffer.writeln('# generated');
+  buffer.writeln('LUT_3D_SIZE $size');
+  for (int b = 0; b < size; b++) {
+    for (int g = 0; g < size; g++) {
+      for (int r = 0; r < size; r++) {
+        final value = f(r / (size - 1), g / (size - 1), b / (size - 1));
+        buffer.writeln(value.map((v) => v.toStringAsFixed(6)).join(' '));
+      }
+    }
+  }
+  return buffer.toString();
+}
+
+void main() {
+  group('Cube LUT Tests', () {
+    const width = 64;
+    const height = 48;
+    late Uint8List pixels;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+
+      pixels = Uint8List(width * height * 3);
+      for (int i = 0; i < width * height; i++) {
+        pixels[i * 3] = (i * 7) % 256;
+        pixels[i * 3 + 1] = (i * 13) % 256;
+        pixels[i * 3 + 2] = (i * 29) % 256;
+      }
+    });
+
+    /// Run pixels through the CPU kernel with only the 3D LUT stage
+    Uint8List applyOnCpu(int lutId, double opacity) {
+      final input = malloc<Uint8>(pixels.length);
+      final params = calloc<AdjustmentParams>();
+      final output = calloc<Pointer<Uint8>>();
+      final outputWidth = calloc<Int32>();
+      final outputHeight = calloc<Int32>();
+      try {
+        input.asTypedList(pixels.length).setAll(0, pixels);
+        params.ref.reset();
+        params.ref.stages = AdjustmentStage.lut3d;
+        params.ref.lutId = lutId;
+        params.ref.lutOpacity = opacity;
+
+        final ok = CpuKernel.bindings.cpuProcessImageParams(input, width, height, params,
+            nullptr, nullptr, nullptr, nullptr, output, outputWidth, outputHeight);
+        expect(ok, equals(1));
+        final result = Uint8List.fromList(output.value.asTypedList(width * height * 4));
+        CpuKernel.bindings.cpuFreeBuffer(output.value);
+        return result;
+      } finally {
+        malloc.free(input);
+        calloc.free(params);
+        calloc.free(output);
+        calloc.free(outputWidth);
+        calloc.free(outputHeight);
+      }
+    }
+
+    test('parses a LUT and reports its size and title', () {
+      if (!TestHelper.isLibraryAvailable('lut')) {
+        print('SKIPPED: libcube_lut not built');
+        return;
+      }
+
+      final lut = CubeLut.parse(cubeText(17, (r, g, b) => [r, g, b], title: 'Identity'));
+      expect(lut.id, isNot(0));
+      expect(lut.size, equals(17));
+      expect(lut.title, equals('Identity'));
+      lut.dispose();
+      expect(lut.id, equals(0));
+    });
+
+    test('rejects what the engines cannot apply', () {
+      if (!TestHelper.isLibraryAvailable('lut')) {
+        print('SKIPPED: libcube_lut not built');
+        return;
+      }
+
+      final identity = cubeText(2, (r, g, b) => [r, g, b]);
+      expect(() => CubeLut.parse('LUT_1D_SIZE 16\n'), throwsFormatException);
+      expect(() => CubeLut.parse('LUT_3D_SIZE 99\n'), throwsFormatException);
+      expect(() => CubeLut.parse(identity.split('\n').take(5).join('\n')), throwsFormatException);
+      expect(() => CubeLut.parse('DOMAIN_MAX 2 2 2\n$identity'), throwsFormatException);
+      expect(() => CubeLut.load('/nonexistent/look.cube'), throwsFormatException);
+    });
+
+    test('CPU kernel applies LUTs with tetrahedral interpolation', () {
+      if (!TestHelper.isLibraryAvailable('lut') || !TestHelper.isLibraryAvailable('cpu')) {
+        print('SKIPPED: libcube_lut or libcpu_kernel not built');
+        return;
+      }
+
+      final identity = CubeLut.parse(cubeText(33, (r, g, b) => [r, g, b]));
+      final invert = CubeLut.parse(cubeText(17, (r, g, b) => [1 - r, 1 - g, 1 - b]));
+      try {
+        // Linear LUTs are reproduced exactly, up to the final truncation
+        final same = applyOnCpu(identity.id, 1.0);
+        final inverted = applyOnCpu(invert.id, 1.0);
+        final untouched = applyOnCpu(invert.id, 0.0);
+        for (int i = 0; i < width * height; i++) {
+          for (int c = 0; c < 3; c++) {
+            final value = pixels[i * 3 + c];
+            expect(same[i * 4 + c], equals(value));
+            expect((inverted[i * 4 + c] - (255 - value)).abs(), lessThanOrEqualTo(1));
+            expect(untouched[i * 4 + c], equals(value));
+          }
+        }
+
+        // Unregistered LUTs are skipped
+        final id = invert.id;
+        invert.dispose();
+        final skipped = applyOnCpu(id, 1.0);
+        for (int i = 0; i < width * height; i++) {
+          expect(skipped[i * 4], equals(pixels[i * 3]));
+        }
+      } finally {
+        identity.dispose();
+        invert.dispose();
+      }
+    });
+
+    test('pipeline LUT selection reaches the engine parameters', () {
+      if (!TestHelper.isLibraryAvailable('lut')) {
+        print('SKIPPED: libcube_lut not built');
+        return;
+      }
+
+      final directory = Directory.systemTemp.createTempSync('aks-lut-test');
+      final params = calloc<AdjustmentParams>();
+      try {
+        final path = '${directory.path}/invert.cube';
+        File(path).writeAsStringSync(cubeText(17, (r, g, b) => [1 - r, 1 - g, 1 - b]));
+
+        // Saved with the pipeline by path, like a sidecar
+        final pipeline = EditPipeline()..initialize('${directory.path}/image.arw');
+        final look = pipeline.getAdjustment<LutAdjustment>('lut_3d')!;
+        expect(look.isDefault, isTrue);
+        expect(pipeline.hasAdjustments, isFalse);
+        pipeline.updateAdjustment(look.copyWith(path: path, opacity: 40));
+        expect(pipeline.hasAdjustments, isTrue);
+        final restored = EditPipeline()..fromJson(pipeline.toJson());
+
+        VulkanProcessor.fillParams(params.ref, restored.adjustments.toList());
+        expect(params.ref.stages & AdjustmentStage.lut3d, isNot(0));
+        expect(params.ref.lutId, equals(LutLibrary.lookup(path)!.id));
+        expect(params.ref.lutOpacity, closeTo(0.4, 1e-6));
+
+        // A file that can't be loaded leaves the stage off
+        restored.updateAdjustment(LutAdjustment(path: '${directory.path}/missing.cube'));
+        VulkanProcessor.fillParams(params.ref, restored.adjustments.toList());
+        expect(params.ref.stages & AdjustmentStage.lut3d, equals(0));
+        expect(params.ref.lutId, equals(0));
+      } finally {
+        calloc.free(params);
+        directory.deleteSync(recursive: true);
+      }
+    });
+  });
+}
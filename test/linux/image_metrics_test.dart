@@ -0,0 +1,70 @@
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/metrics/image_metrics.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('Image Metrics Tests', () {
+    const width = 256;
+    const height = 192;
+    late Uint8List reference;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+
+      // Smooth gradients with some texture so SSIM has structure to compare
+      reference = Uint8List(width * height * 4);
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          final i = (y * width + x) * 4;
+          final texture = (math.sin(x * 0.3) * math.cos(y * 0.2) * 20).round();
+          reference[i] = (x + texture).clamp(0, 255);
+          reference[i + 1] = (y + texture).clamp(0, 255);
+          reference[i + 2] = ((x + y) ~/ 2).clamp(0, 255);
+          reference[i + 3] = 255;
+        }
+      }
+    });
+
+    test('identical images have no error', () {
+      if (!TestHelper.isLibraryAvailable('metrics')) {
+        print('SKIPPED: libimage_metrics not built');
+        return;
+      }
+
+      final quality = ImageMetrics.compare(reference, Uint8List.fromList(reference), width, height);
+      expect(quality.maxAbsError, equals(0));
+      expect(quality.meanAbsError, equals(0));
+      expect(quality.psnr, equals(double.infinity));
+      expect(quality.ssim, closeTo(1.0, 1e-9));
+      expect(quality.deltaEMax, equals(0));
+    });
+
+    test('uniform offset gives the expected error and PSNR', () {
+      if (!TestHelper.isLibraryAvailable('metrics')) {
+        print('SKIPPED: libimage_metrics not built');
+        return;
+      }
+
+      final shifted = Uint8List.fromList(reference);
+      for (int i = 0; i < shifted.length; i++) {
+        if (i % 4 == 3) continue;
+        shifted[i] = reference[i] < 254 ? reference[i] + 2 : reference[i] - 2;
+      }
+
+      final quality = ImageMetrics.compare(reference, shifted, width, height);
+      print('Offset by 2: $quality');
+      expect(quality.maxAbsError, equals(2));
+      expect(quality.meanAbsError, closeTo(2.0, 1e-9));
+      expect(quality.psnr, closeTo(10 * math.log(255 * 255 / 4) / math.ln10, 1e-6));
+      expect(quality.ssim, greaterThan(0.99));
+      expect(quality.deltaEMean, greaterThan(0));
+      expect(quality.deltaEMean, lessThan(2.0));
+
+      expect(quality.meets(const QualityBudget(maxAbsError: 2, minPsnr: 40)), isTrue);
+      expect(quality.violations(const QualityBudget(minPsnr: 45)), hasLength(1));
+    });
+  });
+}
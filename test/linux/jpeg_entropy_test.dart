@@ -0,0 +1,176 @@
+import 'dart:ffi';
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/jpeg/jpeg_processor.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('JPEG Entropy Coding Tests', () {
+    // 4:2:0 MCUs are 16x16, so both edges are partial and the 38 MCU rows
+    // wrap the RST0-RST7 numbering several times
+    const width = 1001;
+    const height = 603;
+    const subsamplings = {'4:4:4': 0, '4:2:2': 1, '4:2:0': 2};
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+    });
+
+    /// Smooth gradients with texture, so every block has AC coefficients
+    Uint8List syntheticRgb(int width, int height) {
+      final pixels = Uint8List(width * height * 3);
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          final i = (y * width + x) * 3;
+          final texture = (math.sin(x * 0.3) * math.cos(y * 0.2) * 20).round();
+          pixels[i] = (x * 255 ~/ width + texture).clamp(0, 255);
+          pixels[i + 1] = (y * 255 ~/ height + texture).clamp(0, 255);
+          pixels[i + 2] = (x + y) * 255 ~/ (width + height);
+        }
+      }
+      return pixels;
+    }
+
+    /// Encode through the coefficient path at one quality; the size budget
+    /// never binds, so this is a single parallel Huffman pass
+    Uint8List encode(Uint8List rgb, int width, int height, int subsampling,
+        int quality, int threads) {
+      final bindings = JpegProcessor.bindings;
+      final pixels = malloc<Uint8>(rgb.length);
+      final jpegData = calloc<Pointer<Uint8>>();
+      final jpegSize = calloc<Size>();
+      final qualityUsed = calloc<Int32>();
+      try {
+        pixels.asTypedList(rgb.length).setAll(0, rgb);
+        final ok = bindings.jpegEncodeTargetSize(pixels, width, height, 3, width * 3,
+            subsampling, 1 << 30, quality, quality, threads, jpegData, jpegSize, qualityUsed);
+        expect(ok, equals(1));
+        expect(qualityUsed.value, equals(quality));
+        try {
+          return Uint8List.fromList(jpegData.value.asTypedList(jpegSize.value));
+        } finally {
+          bindings.jpegTargetFree(jpegData.value);
+        }
+      } finally {
+        malloc.free(pixels);
+        calloc.free(jpegData);
+        calloc.free(jpegSize);
+        calloc.free(qualityUsed);
+      }
+    }
+
+    /// Decode with TurboJPEG; null if it reports any error or warning
+    ({int width, int height, Uint8List pixels})? decode(Uint8List jpeg) {
+      final bindings = JpegProcessor.bindings;
+      final data = malloc<Uint8>(jpeg.length);
+      final decodedWidth = calloc<Int32>();
+      final decodedHeight = calloc<Int32>();
+      try {
+        data.asTypedList(jpeg.length).setAll(0, jpeg);
+        final buffer = bindings.jpegDecompressRgb(data, jpeg.length, decodedWidth, decodedHeight);
+        if (buffer.data == nullptr) return null;
+        try {
+          return (
+            width: decodedWidth.value,
+            height: decodedHeight.value,
+            pixels: Uint8List.fromList(buffer.data.asTypedList(buffer.size)),
+          );
+        } finally {
+          bindings.jpegFreeBuffer(buffer);
+        }
+      } finally {
+        malloc.free(data);
+        calloc.free(decodedWidth);
+        calloc.free(decodedHeight);
+      }
+    }
+
+    /// n of every RSTn marker in file order. 0xFF in entropy coded data is
+    /// always stuffed with 0x00, so FF D0-D7 can only be a marker.
+    List<int> restartMarkers(Uint8List jpeg) {
+      final markers = <int>[];
+      for (int i = 0; i + 1 < jpeg.length; i++) {
+        if (jpeg[i] == 0xff && jpeg[i + 1] >= 0xd0 && jpeg[i + 1] <= 0xd7) {
+          markers.add(jpeg[i + 1] - 0xd0);
+        }
+      }
+      return markers;
+    }
+
+    ({double psnr, int maxError}) compare(Uint8List reference, Uint8List decoded) {
+      double squared = 0;
+      int maxError = 0;
+      for (int i = 0; i < reference.length; i++) {
+        final error = (reference[i] - decoded[i]).abs();
+        squared += error * error;
+        maxError = math.max(maxError, error);
+      }
+      final mse = squared / reference.length;
+      return (psnr: 10 * math.log(255 * 255 / mse) / math.ln10, maxError: maxError);
+    }
+
+    for (final MapEntry(key: name, value: subsampling) in subsamplings.entries) {
+      test('$name output decodes cleanly with one restart interval per MCU row', () {
+        if (!TestHelper.isLibraryAvailable('jpeg')) {
+          print('SKIPPED: libjpeg_binding not built');
+          return;
+        }
+
+        final rgb = syntheticRgb(width, height);
+        final jpeg = encode(rgb, width, height, subsampling, 95, 8);
+
+        final mcuHeight = subsampling == 2 ? 16 : 8;
+        final mcuRows = (height + mcuHeight - 1) ~/ mcuHeight;
+        expect(restartMarkers(jpeg),
+            equals(List<int>.generate(mcuRows - 1, (i) => i % 8)));
+
+        final decoded = decode(jpeg);
+        expect(decoded, isNotNull);
+        expect(decoded!.width, equals(width));
+        expect(decoded.height, equals(height));
+
+        final quality = compare(rgb, decoded.pixels);
+        print('$name: ${jpeg.length} bytes, PSNR ${quality.psnr.toStringAsFixed(2)} dB, '
+            'max error ${quality.maxError}');
+        expect(quality.psnr, greaterThan(44));
+        expect(quality.maxError, lessThanOrEqualTo(12));
+      });
+
+      test('$name output does not depend on the thread count', () {
+        if (!TestHelper.isLibraryAvailable('jpeg')) {
+          print('SKIPPED: libjpeg_binding not built');
+          return;
+        }
+
+        final rgb = syntheticRgb(width, height);
+        final single = encode(rgb, width, height, subsampling, 80, 1);
+        for (final threads in [2, 3, 8]) {
+          expect(encode(rgb, width, height, subsampling, 80, threads), equals(single),
+              reason: '$threads threads');
+        }
+      });
+    }
+
+    test('4:2:0 image with a single MCU row', () {
+      if (!TestHelper.isLibraryAvailable('jpeg')) {
+        print('SKIPPED: libjpeg_binding not built');
+        return;
+      }
+
+      const smallWidth = 17;
+      const smallHeight = 9;
+      final rgb = syntheticRgb(smallWidth, smallHeight);
+      final jpeg = encode(rgb, smallWidth, smallHeight, 2, 95, 0);
+      expect(restartMarkers(jpeg), isEmpty);
+
+      final decoded = decode(jpeg);
+      expect(decoded, isNotNull);
+      expect(decoded!.width, equals(smallWidth));
+      expect(decoded.height, equals(smallHeight));
+      expect(compare(rgb, decoded.pixels).psnr, greaterThan(35));
+    });
+  });
+}
@@ -0,0 +1,158 @@
+import 'dart:ffi';
+import 'dart:math' as math;
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/jpeg/jpeg_processor.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('JPEG Size Target Tests', () {
+    const width = 1001;
+    const height = 603;
+    const minQuality = 30;
+    const maxQuality = 95;
+    late Uint8List rgb;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+
+      // Gradients with texture, so file size keeps growing with quality
+      rgb = Uint8List(width * height * 3);
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          final i = (y * width + x) * 3;
+          final texture = (math.sin(x * 0.3) * math.cos(y * 0.2) * 20).round();
+          rgb[i] = (x * 255 ~/ width + texture).clamp(0, 255);
+          rgb[i + 1] = (y * 255 ~/ height + texture).clamp(0, 255);
+          rgb[i + 2] = (x + y) * 255 ~/ (width + height);
+        }
+      }
+    });
+
+    /// jpeg_encode_target_size in 4:2:0; null when it returns 0
+    ({Uint8List jpeg, int quality})? encode(int maxBytes,
+        {int min = minQuality, int max = maxQuality, Uint8List? pixels, int channels = 3, int stride = 0}) {
+      final source = pixels ?? rgb;
+      final bindings = JpegProcessor.bindings;
+      final input = malloc<Uint8>(source.length);
+      final jpegData = calloc<Pointer<Uint8>>();
+      final jpegSize = calloc<Size>();
+      final qualityUsed = calloc<Int32>();
+      try {
+        input.asTypedList(source.length).setAll(0, source);
+        final ok = bindings.jpegEncodeTargetSize(input, width, height, channels, stride, 2,
+            maxBytes, min, max, 0, jpegData, jpegSize, qualityUsed);
+        if (ok == 0) return null;
+        try {
+          return (
+            jpeg: Uint8List.fromList(jpegData.value.asTypedList(jpegSize.value)),
+            quality: qualityUsed.value,
+          );
+        } finally {
+          bindings.jpegTargetFree(jpegData.value);
+        }
+      } finally {
+        malloc.free(input);
+        calloc.free(jpegData);
+        calloc.free(jpegSize);
+        calloc.free(qualityUsed);
+      }
+    }
+
+    /// Decoded size, or null if TurboJPEG reports any error or warning
+    ({int width, int height})? decode(Uint8List jpeg) {
+      final bindings = JpegProcessor.bindings;
+      final data = malloc<Uint8>(jpeg.length);
+      final decodedWidth = calloc<Int32>();
+      final decodedHeight = calloc<Int32>();
+      try {
+        data.asTypedList(jpeg.length).setAll(0, jpeg);
+        final buffer = bindings.jpegDecompressRgb(data, jpeg.length, decodedWidth, decodedHeight);
+        if (buffer.data == nullptr) return null;
+        bindings.jpegFreeBuffer(buffer);
+        return (width: decodedWidth.value, height: decodedHeight.value);
+      } finally {
+        malloc.free(data);
+        calloc.free(decodedWidth);
+        calloc.free(decodedHeight);
+      }
+    }
+
+    for (final target in [40000, 80000, 120000]) {
+      test('fits a ${target ~/ 1000} KB target at the highest quality that does', () {
+        if (!TestHelper.isLibraryAvailable('jpeg')) {
+          print('SKIPPED: libjpeg_binding not built');
+          return;
+        }
+
+        final result = encode(target);
+        expect(result, isNotNull);
+        print('${target ~/ 1000} KB target: quality ${result!.quality}, ${result.jpeg.length} bytes');
+        expect(result.jpeg.length, lessThanOrEqualTo(target));
+        expect(result.quality, inInclusiveRange(minQuality, maxQuality));
+        expect(decode(result.jpeg), equals((width: width, height: height)));
+
+        // One step up no longer fits
+        if (result.quality < maxQuality) {
+          final above = encode(1 << 30, min: result.quality + 1, max: result.quality + 1);
+          expect(above!.jpeg.length, greaterThan(target));
+        }
+      });
+    }
+
+    test('a target every quality fits uses the maximum', () {
+      if (!TestHelper.isLibraryAvailable('jpeg')) {
+        print('SKIPPED: libjpeg_binding not built');
+        return;
+      }
+
+      final result = encode(1 << 30);
+      expect(result!.quality, equals(maxQuality));
+      expect(decode(result.jpeg), isNotNull);
+    });
+
+    test('an impossible target returns the minimum quality result', () {
+      if (!TestHelper.isLibraryAvailable('jpeg')) {
+        print('SKIPPED: libjpeg_binding not built');
+        return;
+      }
+
+      // Documented in jpeg_target.h: the closest result comes back and the
+      // caller checks its size against the budget
+      const target = 1000;
+      final result = encode(target);
+      expect(result, isNotNull);
+      expect(result!.quality, equals(minQuality));
+      expect(result.jpeg.length, greaterThan(target));
+      expect(decode(result.jpeg), equals((width: width, height: height)));
+
+      // No budget at all is an invalid argument
+      expect(encode(0), isNull);
+    });
+
+    test('RGBA rows with padding encode like packed RGB', () {
+      if (!TestHelper.isLibraryAvailable('jpeg')) {
+        print('SKIPPED: libjpeg_binding not built');
+        return;
+      }
+
+      const stride = width * 4 + 16;
+      final rgba = Uint8List(stride * height);
+      for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+          final from = (y * width + x) * 3;
+          final to = y * stride + x * 4;
+          rgba.setRange(to, to + 3, rgb, from);
+          rgba[to + 3] = 255;
+        }
+      }
+
+      final packed = encode(80000);
+      final padded = encode(80000, pixels: rgba, channels: 4, stride: stride);
+      expect(padded!.quality, equals(packed!.quality));
+      expect(padded.jpeg, equals(packed.jpeg));
+    });
+  });
+}
@@ -12,6 +12,7 @@ import 'package:aks/models/edit_pipeline.dart';
 import 'package:aks/models/crop_state.dart';
 import 'package:aks/services/raw_processor.dart';
 import 'package:aks/services/image_processor.dart';
+import 'package:aks/ffi/metrics/image_metrics.dart';
 import '../test_helper.dart';
 
 void main() {
@@ -108,7 +109,9 @@ void main() {
       gpuProcessor.dispose();
       
       // Compare results
-      _comparePixels(cpuResult, gpuResult, 'No adjustments');
+      _comparePixels(cpuResult, gpuResult, 'No adjustments',
+        width: imageWidth, height: imageHeight,
+        budget: const QualityBudget(minPsnr: 42, maxDeltaE: 1.0, maxDeltaEP95: 2.0));
     });
     
     test('CPU and GPU should produce identical results with exposure adjustment', () async {
@@ -155,7 +158,9 @@ void main() {
       gpuProcessor.dispose();
       
       // Compare results
-      _comparePixels(cpuResult, gpuResult, 'Exposure +0.5');
+      _comparePixels(cpuResult, gpuResult, 'Exposure +0.5',
+        width: imageWidth, height: imageHeight,
+        budget: const QualityBudget(minPsnr: 42, maxDeltaE: 1.0, maxDeltaEP95: 2.0));
     });
     
     test('Identity tone curve should not change the image', () async {
@@ -195,7 +200,8 @@ void main() {
       cpuProcessor.dispose();
       
       // Compare - should be identical
-      _comparePixels(baselineResult, toneCurveResult, 'Identity tone curve vs baseline');
+      _comparePixels(baselineResult, toneCurveResult, 'Identity tone curve vs baseline',
+        width: imageWidth, height: imageHeight);
     });
     
     test('Near-diagonal tone curve point should have minimal effect', () async {
@@ -236,7 +242,8 @@ void main() {
       cpuProcessor.dispose();
       
       // Compare - should have minimal difference
-      _comparePixels(baselineResult, curveResult, 'Near-diagonal curve', maxDifference: 5);
+      _comparePixels(baselineResult, curveResult, 'Near-diagonal curve', maxDifference: 5,
+        width: imageWidth, height: imageHeight);
     });
     
     test('Exposure adjustment should brighten image', () async {
@@ -535,7 +542,9 @@ void main() {
       
       // Compare results - allow more tolerance for combined adjustments
       // as small floating point differences can accumulate
-      _comparePixels(cpuResult, gpuResult, 'All adjustments', maxDifference: 50);
+      _comparePixels(cpuResult, gpuResult, 'All adjustments', maxDifference: 50,
+        width: imageWidth, height: imageHeight,
+        budget: const QualityBudget(minPsnr: 30, maxDeltaE: 3.0, maxDeltaEP95: 6.0));
     });
     
     group('Cropping Tests', () {
@@ -833,8 +842,10 @@ void main() {
   });
 }
 
-/// Compare two pixel arrays and report differences
-void _comparePixels(Uint8List pixels1, Uint8List pixels2, String testName, {int maxDifference = 1}) {
+/// Compare two pixel arrays and report differences. With [budget], the
+/// full-image metrics must also meet it when the metrics library is built.
+void _comparePixels(Uint8List pixels1, Uint8List pixels2, String testName,
+    {int maxDifference = 1, int? width, int? height, QualityBudget? budget}) {
   expect(pixels1.length, equals(pixels2.length), reason: 'Pixel array lengths should match');
   
   int totalDifferences = 0;
@@ -884,6 +895,18 @@ void _comparePixels(Uint8List pixels1, Uint8List pixels2, String testName, {int
   print('  Average difference: ${avgDiff.toStringAsFixed(2)}');
   print('  Pixels with difference > $maxDifference: $totalDifferences');
   
+  // Full-image metrics over every pixel, when the native library is built
+  if (width != null && height != null && ImageMetrics.isAvailable) {
+    final quality = ImageMetrics.compare(pixels1, pixels2, width, height);
+    print('  Full image: $quality');
+    if (budget != null) {
+      expect(quality.meets(budget), isTrue,
+          reason: '[$testName] ${quality.violations(budget).join(', ')}');
+    }
+  } else if (budget != null) {
+    print('  SKIPPED quality budget: libimage_metrics not built');
+  }
+  
   // Compare histograms
   print('  Histogram comparison:');
   print('    Red mean: ${hist1['red_mean']!.toStringAsFixed(2)} vs ${hist2['red_mean']!.toStringAsFixed(2)}');
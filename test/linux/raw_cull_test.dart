@@ -0,0 +1,57 @@
+import 'dart:io';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/corpus/synthetic_raw.dart';
+import 'package:aks/services/raw_culler.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('RAW Culling Tests', () {
+    late Directory tempDir;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+      tempDir = await Directory.systemTemp.createTemp('aks_cull');
+    });
+
+    tearDownAll(() async {
+      await tempDir.delete(recursive: true);
+    });
+
+    test('scores files in path order and reports failures', () async {
+      if (!TestHelper.isLibraryAvailable('corpus') || !TestHelper.isLibraryAvailable('raw')) {
+        print('SKIPPED: libsynthetic_raw or libraw_processor not built');
+        return;
+      }
+
+      final paths = <String>[];
+      for (final scene in SyntheticScene.values) {
+        final path = '${tempDir.path}/${scene.name}.dng';
+        SyntheticRaw.writeDng(SyntheticSpec(width: 1200, height: 800, scene: scene), path);
+        paths.add(path);
+      }
+      paths.add('${tempDir.path}/missing.dng');
+
+      final scores = await RawCuller.scoreAll(paths);
+      expect(scores.length, equals(paths.length));
+      for (int i = 0; i < scores.length; i++) {
+        expect(scores[i].index, equals(i));
+        expect(scores[i].path, equals(paths[i]));
+      }
+
+      // Synthetic DNGs carry no preview
+      final chart = scores[SyntheticScene.chart.index];
+      expect(chart.isValid, isTrue);
+      expect(chart.fromPreview, isFalse);
+      expect(chart.sharpness, greaterThan(0));
+      expect(chart.peakSharpness, greaterThanOrEqualTo(chart.sharpness));
+
+      final highlights = scores[SyntheticScene.highlights.index];
+      expect(highlights.highlightsClipped, greaterThan(chart.highlightsClipped));
+      expect(highlights.meanLuma, greaterThan(chart.meanLuma));
+
+      expect(scores.last.isValid, isFalse);
+      expect(scores.last.error, isNotEmpty);
+    });
+  });
+}
@@ -0,0 +1,84 @@
+import 'dart:io';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/corpus/synthetic_raw.dart';
+import 'package:aks/services/raw_processor.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('Synthetic Corpus Tests', () {
+    late Directory tempDir;
+
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+      tempDir = await Directory.systemTemp.createTemp('aks_corpus');
+    });
+
+    tearDownAll(() async {
+      await tempDir.delete(recursive: true);
+    });
+
+    test('generated content is deterministic', () {
+      if (!TestHelper.isLibraryAvailable('corpus')) {
+        print('SKIPPED: libsynthetic_raw not built');
+        return;
+      }
+
+      const spec = SyntheticSpec(width: 640, height: 427, scene: SyntheticScene.highlights);
+      final first = SyntheticRaw.renderSrgb8(spec);
+      final second = SyntheticRaw.renderSrgb8(spec);
+      expect(first, equals(second));
+
+      final reseeded = SyntheticRaw.renderSrgb8(const SyntheticSpec(
+        width: 640, height: 427, scene: SyntheticScene.highlights, seed: 2));
+      expect(reseeded, isNot(equals(first)));
+    });
+
+    for (final pattern in CfaPattern.values) {
+      test('LibRaw decodes a ${pattern.name} DNG at its full size', () async {
+        if (!TestHelper.isLibraryAvailable('corpus') || !TestHelper.isLibraryAvailable('raw')) {
+          print('SKIPPED: libsynthetic_raw or libraw_processor not built');
+          return;
+        }
+
+        final spec = SyntheticSpec(width: 1200, height: 800, pattern: pattern);
+        final path = '${tempDir.path}/${pattern.name}.dng';
+        SyntheticRaw.writeDng(spec, path);
+
+        RawProcessor.initialize();
+        final decoded = await RawProcessor.loadRawFile(path);
+        expect(decoded, isNotNull);
+        expect(decoded!.width, equals(spec.width));
+        expect(decoded.height, equals(spec.height));
+      });
+    }
+
+    // Decode time across resolutions, e.g. AKS_CORPUS_SWEEP=12,24,50,100
+    test('decode scaling sweep', () async {
+      final sweep = Platform.environment['AKS_CORPUS_SWEEP'];
+      if (sweep == null || !TestHelper.isLibraryAvailable('corpus')) {
+        print('SKIPPED: set AKS_CORPUS_SWEEP to a list of megapixel sizes');
+        return;
+      }
+
+      RawProcessor.initialize();
+      for (final megapixels in sweep.split(',').map(double.parse)) {
+        for (final pattern in CfaPattern.values) {
+          final spec = SyntheticSpec.megapixels(megapixels, pattern: pattern);
+          final path = '${tempDir.path}/sweep.dng';
+          SyntheticRaw.writeDng(spec, path);
+
+          final stopwatch = Stopwatch()..start();
+          final decoded = await RawProcessor.loadRawFile(path);
+          stopwatch.stop();
+          expect(decoded, isNotNull);
+
+          final rate = spec.megapixels / (stopwatch.elapsedMilliseconds / 1000);
+          print('$spec (${spec.megapixels.toStringAsFixed(1)} MP): '
+              '${stopwatch.elapsedMilliseconds} ms, ${rate.toStringAsFixed(1)} MP/s');
+          await File(path).delete();
+        }
+      }
+    });
+  });
+}
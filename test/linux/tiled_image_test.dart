@@ -0,0 +1,132 @@
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+import 'package:ffi/ffi.dart';
+import 'package:flutter_test/flutter_test.dart';
+
+import 'package:aks/ffi/tiles/tiled_image.dart';
+import 'package:aks/services/raw_processor.dart';
+import 'package:aks/services/image_processor.dart';
+import '../test_helper.dart';
+
+void main() {
+  group('Tiled Image Tests', () {
+    const testImagePath = 'test/fixtures/test_image.arw';
+    RawPixelData? inMemory;
+    TiledImage? tiled;
+    
+    setUpAll(() async {
+      await TestHelper.ensureInitialized();
+      
+      if (!await File(testImagePath).exists()) {
+        print('WARNING: Test image not found at $testImagePath');
+        return;
+      }
+      
+      RawProcessor.initialize();
+      inMemory = await RawProcessor.loadRawFile(testImagePath);
+      // Small tiles so the image spans many of them, including padded edges
+      tiled = await RawProcessor.loadRawFileTiled(testImagePath, tileSize: 256);
+    });
+    
+    tearDownAll(() {
+      tiled?.close();
+    });
+    
+    test('probe reports the decoded dimensions', () {
+      if (inMemory == null) return;
+      
+      final dimensions = RawProcessor.probeDimensions(testImagePath);
+      expect(dimensions, isNotNull);
+      expect(dimensions!.width, equals(inMemory!.width));
+      expect(dimensions.height, equals(inMemory!.height));
+    });
+    
+    test('tiled decode matches the in-memory decode', () {
+      if (inMemory == null || tiled == null) return;
+      
+      expect(tiled!.width, equals(inMemory!.width));
+      expect(tiled!.height, equals(inMemory!.height));
+      expect(tiled!.channels, equals(3));
+      
+      // Compare a band straddling a tile boundary
+      const y = 250;
+      const rows = 12;
+      final band = tiled!.readRegion(0, y, tiled!.width, rows);
+      final start = y * inMemory!.width * 3;
+      expect(band, equals(inMemory!.pixels.sublist(start, start + band.length)));
+    });
+    
+    test('fromPixels copies an in-memory image into tiles unchanged', () {
+      if (inMemory == null) return;
+      
+      final copy = TiledImage.fromPixels(inMemory!, tileSize: 256);
+      try {
+        expect(copy.width, equals(inMemory!.width));
+        expect(copy.height, equals(inMemory!.height));
+        expect(copy.readRegion(0, 0, copy.width, copy.height), equals(inMemory!.pixels));
+      } finally {
+        copy.close();
+      }
+    });
+    
+    test('downsample keeps the aspect ratio within the size limit', () async {
+      if (tiled == null) return;
+      
+      final preview = await tiled!.downsample(1024);
+      expect(preview.width, lessThanOrEqualTo(1024));
+      expect(preview.height, lessThanOrEqualTo(1024));
+      expect(preview.pixels.length, equals(preview.width * preview.height * 3));
+      
+      final sourceRatio = tiled!.width / tiled!.height;
+      final previewRatio = preview.width / preview.height;
+      expect((sourceRatio - previewRatio).abs(), lessThan(0.01));
+    });
+    
+    test('open rejects corrupt headers and truncated files', () {
+      if (!File('linux/libtiled_image.so').existsSync()) return;
+      
+      final directory = Directory.systemTemp.createTempSync('aks-tiles-test');
+      final path = '${directory.path}/image.tiles';
+      final pathPointer = path.toNativeUtf8();
+      final bindings = TiledImage.bindings;
+      try {
+        void writeValid() {
+          final handle = bindings.tiledImageCreate(pathPointer, 300, 200, 3, 128);
+          expect(handle, isNot(nullptr));
+          bindings.tiledImageClose(handle);
+        }
+        
+        // Header fields: width, height, channels and tile size after the
+        // magic and version
+        void patchHeader(int offset, int value) {
+          final bytes = File(path).readAsBytesSync();
+          ByteData.sublistView(bytes).setUint32(offset, value, Endian.little);
+          File(path).writeAsBytesSync(bytes);
+        }
+        
+        writeValid();
+        final opened = bindings.tiledImageOpen(pathPointer);
+        expect(opened, isNot(nullptr));
+        bindings.tiledImageClose(opened);
+        
+        for (final (offset, value) in [(24, 0), (20, 0), (20, 9), (12, 0), (12, 0xffffffff)]) {
+          writeValid();
+          patchHeader(offset, value);
+          expect(bindings.tiledImageOpen(pathPointer), equals(nullptr),
+              reason: 'header field at $offset = $value');
+        }
+        
+        // Short files are an error, not grown to size
+        writeValid();
+        File(path).writeAsBytesSync(File(path).readAsBytesSync().sublist(0, 8192));
+        expect(bindings.tiledImageOpen(pathPointer), equals(nullptr));
+        expect(bindings.tiledImageGetError(), contains('truncated'));
+        expect(File(path).lengthSync(), equals(8192));
+      } finally {
+        calloc.free(pathPointer);
+        directory.deleteSync(recursive: true);
+      }
+    });
+  });
+}
@@ -33,6 +33,7 @@ class TestHelper {
   static Future<void> _ensureLinuxLibraries() async {
     // Check if libraries exist
     final librawPath = 'linux/libraw_processor.so';
+    final tiledPath = 'linux/libtiled_image.so';
     final vulkanPath = 'linux/libvulkan_processor.so';
     final shaderPath = 'linux/vulkan_processor/shaders/image_process.spv';
     
@@ -43,6 +44,11 @@ class TestHelper {
       needsBuild = true;
     }
     
+    if (!File(tiledPath).existsSync()) {
+      print('  libtiled_image.so not found');
+      needsBuild = true;
+    }
+    
     if (!File(vulkanPath).existsSync()) {
       print('  libvulkan_processor.so not found');
       needsBuild = true;
@@ -90,6 +96,21 @@ class TestHelper {
       case 'raw':
         return currentPlatform == 'linux' && 
                File('linux/libraw_processor.so').existsSync();
+      case 'metrics':
+        return currentPlatform == 'linux' && 
+               File('linux/libimage_metrics.so').existsSync();
+      case 'corpus':
+        return currentPlatform == 'linux' && 
+               File('linux/libsynthetic_raw.so').existsSync();
+      case 'cpu':
+        return currentPlatform == 'linux' && 
+               File('linux/libcpu_kernel.so').existsSync();
+      case 'lut':
+        return currentPlatform == 'linux' && 
+               File('linux/libcube_lut.so').existsSync();
+      case 'jpeg':
+        return currentPlatform == 'linux' && 
+               File('linux/libjpeg_binding.so').existsSync();
       default:
         return false;
     }